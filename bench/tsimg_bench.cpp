@@ -0,0 +1,490 @@
+// Benchmark de ponta a ponta: gera séries temporais sintéticas, executa o binário tsimg real
+// (mesmos caminhos de main.cpp) e mede tempo de parede, CPU, vazão e pico de RSS de cada caso,
+// comparando com um baseline salvo para que regressões apareçam como diferenças explícitas.
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define TSIMG_BENCH_POSIX 1
+#endif
+
+namespace fs = std::filesystem;
+using nlohmann::json;
+
+namespace {
+
+    struct Resolution {
+        std::string name;
+        int width;
+        int height;
+    };
+
+    struct BenchCase {
+        size_t frames;
+        Resolution resolution;
+        std::string imageFormat; // png ou jpg
+        std::string output;      // spice ou gif
+
+        std::string seriesName() const {
+            return std::to_string(frames) + "f_" + resolution.name + "_" + imageFormat;
+        }
+        std::string name() const {
+            return seriesName() + "_" + output;
+        }
+    };
+
+    struct Measurement {
+        double wallSeconds = 0;
+        double cpuSeconds = 0;
+        size_t peakRssBytes = 0;
+        int exitCode = 0;
+    };
+
+    struct Options {
+        std::string tsimgPath;
+        std::string workDir = "bench_data";
+        std::string baselinePath;
+        std::string saveBaselinePath;
+        std::string resultsPath;
+        std::vector<size_t> frames = {10, 100};
+        std::vector<std::string> sizes = {"512", "2k"};
+        std::vector<std::string> imageFormats = {"png", "jpg"};
+        std::vector<std::string> outputs = {"spice", "gif"};
+        double maxGigapixels = 4.0; // casos maiores que isso (quadros x pixels) são pulados
+        int repeat = 3;
+        double tolerance = 0.10;
+        bool keepOutputs = false;
+    };
+
+    const std::vector<Resolution> kResolutions = {
+        {"512", 512, 512},
+        {"1k", 1024, 1024},
+        {"2k", 2048, 2048},
+        {"4k", 3840, 2160},
+        {"8k", 7680, 4320},
+    };
+
+    const Resolution& resolutionByName(const std::string& name) {
+        for (const auto& resolution : kResolutions) {
+            if (resolution.name == name) return resolution;
+        }
+        throw std::runtime_error("Unknown size: " + name + " (expected 512, 1k, 2k, 4k or 8k)");
+    }
+
+    std::vector<std::string> splitList(const std::string& text) {
+        std::vector<std::string> items;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            if (!item.empty()) items.push_back(item);
+        }
+        return items;
+    }
+
+    // Gerador determinístico (splitmix64): a mesma série é produzida em qualquer máquina
+    uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // Campo suave que evolui no tempo (como um índice de vegetação), com ruído fino para
+    // que a compressão tenha trabalho realista. As tabelas separáveis evitam trigonometria
+    // por pixel, o que importa nos quadros 8K.
+    void renderFrame(const Resolution& resolution, size_t index, size_t count, std::vector<unsigned char>& rgb) {
+        const int w = resolution.width;
+        const int h = resolution.height;
+        const double phase = count > 1 ? static_cast<double>(index) / (count - 1) : 0.0;
+        std::vector<float> columns(w), rows(h);
+        for (int x = 0; x < w; ++x) {
+            columns[x] = static_cast<float>(std::sin(x * 6.2831853 / w * 3.0 + phase * 6.2831853));
+        }
+        for (int y = 0; y < h; ++y) {
+            rows[y] = static_cast<float>(std::cos(y * 6.2831853 / h * 2.0 - phase * 3.1415926));
+        }
+
+        rgb.resize(static_cast<size_t>(w) * h * 3);
+        uint64_t seed = mix(index + 1);
+        for (int y = 0; y < h; ++y) {
+            unsigned char* row = rgb.data() + static_cast<size_t>(y) * w * 3;
+            for (int x = 0; x < w; ++x) {
+                float value = 0.5f + 0.25f * columns[x] + 0.25f * rows[y];
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                int noise = static_cast<int>((seed >> 59) & 0x0f) - 8;
+                int v = std::clamp(static_cast<int>(value * 255.0f) + noise, 0, 255);
+                row[x * 3 + 0] = static_cast<unsigned char>(255 - v);
+                row[x * 3 + 1] = static_cast<unsigned char>(v);
+                row[x * 3 + 2] = static_cast<unsigned char>(v / 3);
+            }
+        }
+    }
+
+    std::string frameName(size_t index, const std::string& imageFormat) {
+        std::ostringstream name;
+        name << "frame_" << std::setw(5) << std::setfill('0') << index << "." << imageFormat;
+        return name.str();
+    }
+
+    // Gera a série uma única vez por diretório; a geração não entra nas medições
+    fs::path ensureSeries(const Options& options, const BenchCase& benchCase) {
+        fs::path directory = fs::path(options.workDir) / benchCase.seriesName();
+        fs::path marker = directory / ".complete";
+        if (fs::exists(marker)) {
+            return directory;
+        }
+        fs::create_directories(directory);
+        std::cerr << "Generating " << benchCase.seriesName() << "..." << std::endl;
+
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        auto worker = [&]() {
+            std::vector<unsigned char> rgb;
+            for (size_t i = next.fetch_add(1); i < benchCase.frames && !failed; i = next.fetch_add(1)) {
+                renderFrame(benchCase.resolution, i, benchCase.frames, rgb);
+                std::string path = (directory / frameName(i, benchCase.imageFormat)).string();
+                int ok = benchCase.imageFormat == "png"
+                    ? stbi_write_png(path.c_str(), benchCase.resolution.width, benchCase.resolution.height, 3, rgb.data(), 0)
+                    : stbi_write_jpg(path.c_str(), benchCase.resolution.width, benchCase.resolution.height, 3, rgb.data(), 90);
+                if (!ok) failed = true;
+            }
+        };
+        std::vector<std::thread> workers;
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back(worker);
+        }
+        for (auto& t : workers) {
+            t.join();
+        }
+        if (failed) {
+            throw std::runtime_error("Could not write synthetic frames to " + directory.string());
+        }
+        std::ofstream(marker) << benchCase.frames << std::endl;
+        return directory;
+    }
+
+    size_t directoryBytes(const fs::path& directory) {
+        size_t total = 0;
+        for (const auto& entry : fs::directory_iterator(directory)) {
+            if (entry.is_regular_file() && entry.path().filename() != ".complete") {
+                total += entry.file_size();
+            }
+        }
+        return total;
+    }
+
+#ifdef TSIMG_BENCH_POSIX
+    double seconds(const struct timeval& tv) {
+        return tv.tv_sec + tv.tv_usec / 1e6;
+    }
+#endif
+
+    // Executa o tsimg como processo filho; wait4 devolve CPU e pico de RSS só desse filho
+    Measurement runTsimg(const std::vector<std::string>& args) {
+#ifdef TSIMG_BENCH_POSIX
+        std::vector<char*> argv;
+        for (const auto& arg : args) {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        auto start = std::chrono::steady_clock::now();
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error("fork failed: " + std::string(std::strerror(errno)));
+        }
+        if (pid == 0) {
+            int devNull = open("/dev/null", O_WRONLY);
+            if (devNull >= 0) {
+                dup2(devNull, STDOUT_FILENO);
+                close(devNull);
+            }
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+
+        int status = 0;
+        struct rusage usage {};
+        if (wait4(pid, &status, 0, &usage) < 0) {
+            throw std::runtime_error("wait4 failed: " + std::string(std::strerror(errno)));
+        }
+        Measurement measurement;
+        measurement.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        measurement.cpuSeconds = seconds(usage.ru_utime) + seconds(usage.ru_stime);
+#ifdef __APPLE__
+        measurement.peakRssBytes = static_cast<size_t>(usage.ru_maxrss);
+#else
+        measurement.peakRssBytes = static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+        measurement.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        return measurement;
+#else
+        throw std::runtime_error("tsimg_bench requires a POSIX system (fork/wait4)");
+#endif
+    }
+
+    json runCase(const Options& options, const BenchCase& benchCase) {
+        fs::path series = ensureSeries(options, benchCase);
+        size_t inputBytes = directoryBytes(series);
+        fs::path output = fs::path(options.workDir) / ("out_" + benchCase.name() + (benchCase.output == "gif" ? ".gif" : ".html"));
+
+        std::vector<std::string> args = {
+            options.tsimgPath, "-n", output.string(), "-i", series.string(), "-labelbyname", "-f", benchCase.output
+        };
+
+        // Mediana das repetições; o pico de RSS é o maior observado
+        std::vector<Measurement> runs;
+        for (int r = 0; r < options.repeat; ++r) {
+            Measurement measurement = runTsimg(args);
+            if (measurement.exitCode != 0) {
+                throw std::runtime_error("tsimg exited with code " + std::to_string(measurement.exitCode) + " for case " + benchCase.name());
+            }
+            runs.push_back(measurement);
+        }
+        std::sort(runs.begin(), runs.end(), [](const Measurement& a, const Measurement& b) {
+            return a.wallSeconds < b.wallSeconds;
+        });
+        const Measurement& median = runs[runs.size() / 2];
+        size_t peakRss = 0;
+        for (const auto& run : runs) {
+            peakRss = std::max(peakRss, run.peakRssBytes);
+        }
+
+        size_t outputBytes = fs::exists(output) ? fs::file_size(output) : 0;
+        if (!options.keepOutputs) {
+            std::error_code ec;
+            fs::remove(output, ec);
+        }
+
+        return {
+            {"name", benchCase.name()},
+            {"frames", benchCase.frames},
+            {"width", benchCase.resolution.width},
+            {"height", benchCase.resolution.height},
+            {"image_format", benchCase.imageFormat},
+            {"output", benchCase.output},
+            {"input_bytes", inputBytes},
+            {"output_bytes", outputBytes},
+            {"wall_s", median.wallSeconds},
+            {"cpu_s", median.cpuSeconds},
+            {"mb_per_s", median.wallSeconds > 0 ? inputBytes / (1024.0 * 1024.0) / median.wallSeconds : 0.0},
+            {"peak_rss_bytes", peakRss},
+        };
+    }
+
+    std::string formatChange(double current, double baseline) {
+        if (baseline <= 0) return "n/a";
+        std::ostringstream out;
+        out << std::showpos << std::fixed << std::setprecision(1) << (current / baseline - 1.0) * 100.0 << "%";
+        return out.str();
+    }
+
+    // Compara com o baseline caso a caso; devolve quantas métricas pioraram além da tolerância
+    int compareWithBaseline(const json& results, const json& baseline, double tolerance) {
+        std::map<std::string, json> previous;
+        for (const auto& entry : baseline.value("cases", json::array())) {
+            previous[entry.value("name", "")] = entry;
+        }
+
+        // Para vazão, maior é melhor; nas demais, menor é melhor
+        struct Metric { const char* key; bool higherIsBetter; };
+        const Metric metrics[] = {{"wall_s", false}, {"cpu_s", false}, {"mb_per_s", true}, {"peak_rss_bytes", false}};
+
+        int regressions = 0;
+        std::cout << std::endl << "Comparison with baseline (tolerance " << tolerance * 100 << "%):" << std::endl;
+        for (const auto& entry : results["cases"]) {
+            std::string name = entry["name"];
+            auto it = previous.find(name);
+            if (it == previous.end()) {
+                std::cout << "  " << name << ": not in baseline" << std::endl;
+                continue;
+            }
+            std::cout << "  " << name << ":";
+            for (const auto& metric : metrics) {
+                double current = entry.value(metric.key, 0.0);
+                double before = it->second.value(metric.key, 0.0);
+                double ratio = before > 0 ? current / before : 1.0;
+                bool regressed = metric.higherIsBetter ? ratio < 1.0 - tolerance : ratio > 1.0 + tolerance;
+                regressions += regressed ? 1 : 0;
+                std::cout << " " << metric.key << " " << formatChange(current, before) << (regressed ? " [REGRESSION]" : "");
+            }
+            std::cout << std::endl;
+        }
+        return regressions;
+    }
+
+    void printUsage() {
+        std::cerr << "Usage: tsimg_bench [options]" << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --tsimg <path>          tsimg binary to benchmark (default: next to tsimg_bench)." << std::endl;
+        std::cerr << "  --work-dir <dir>        Where synthetic series are generated and cached (default: bench_data)." << std::endl;
+        std::cerr << "  --suite <quick|full>    quick: 10/100 frames, 512/2k; full: 10/100/1000/5000 frames, 512 to 8k." << std::endl;
+        std::cerr << "  --frames <n,...>        Frame counts (overrides the suite)." << std::endl;
+        std::cerr << "  --sizes <s,...>         Frame sizes: 512, 1k, 2k, 4k, 8k (overrides the suite)." << std::endl;
+        std::cerr << "  --formats <f,...>       Input image formats: png, jpg (default: both)." << std::endl;
+        std::cerr << "  --outputs <o,...>       Outputs: spice, gif (default: both)." << std::endl;
+        std::cerr << "  --max-gpixels <n>       Skip cases larger than n gigapixels in total (default: 4)." << std::endl;
+        std::cerr << "  --repeat <n>            Runs per case; the median is reported (default: 3)." << std::endl;
+        std::cerr << "  --results <file>        Write the results as JSON." << std::endl;
+        std::cerr << "  --baseline <file>       Compare against a previous results file; exits 1 on regression." << std::endl;
+        std::cerr << "  --save-baseline <file>  Write the results as the new baseline." << std::endl;
+        std::cerr << "  --tolerance <pct>       Allowed slowdown before a metric counts as a regression (default: 10)." << std::endl;
+        std::cerr << "  --keep-outputs          Keep the generated .html/.gif files." << std::endl;
+    }
+
+    std::string defaultTsimgPath(const char* argv0) {
+        fs::path self(argv0);
+        fs::path sibling = self.parent_path() / "tsimg";
+        return sibling.string();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    options.tsimgPath = defaultTsimgPath(argv[0]);
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--tsimg" && hasValue) {
+                options.tsimgPath = argv[++i];
+            } else if (arg == "--work-dir" && hasValue) {
+                options.workDir = argv[++i];
+            } else if (arg == "--suite" && hasValue) {
+                std::string suite = argv[++i];
+                if (suite == "full") {
+                    options.frames = {10, 100, 1000, 5000};
+                    options.sizes = {"512", "1k", "2k", "4k", "8k"};
+                } else if (suite != "quick") {
+                    throw std::runtime_error("Unknown suite: " + suite);
+                }
+            } else if (arg == "--frames" && hasValue) {
+                options.frames.clear();
+                for (const auto& item : splitList(argv[++i])) {
+                    options.frames.push_back(std::stoul(item));
+                }
+            } else if (arg == "--sizes" && hasValue) {
+                options.sizes = splitList(argv[++i]);
+            } else if (arg == "--formats" && hasValue) {
+                options.imageFormats = splitList(argv[++i]);
+            } else if (arg == "--outputs" && hasValue) {
+                options.outputs = splitList(argv[++i]);
+            } else if (arg == "--max-gpixels" && hasValue) {
+                options.maxGigapixels = std::stod(argv[++i]);
+            } else if (arg == "--repeat" && hasValue) {
+                options.repeat = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--results" && hasValue) {
+                options.resultsPath = argv[++i];
+            } else if (arg == "--baseline" && hasValue) {
+                options.baselinePath = argv[++i];
+            } else if (arg == "--save-baseline" && hasValue) {
+                options.saveBaselinePath = argv[++i];
+            } else if (arg == "--tolerance" && hasValue) {
+                options.tolerance = std::stod(argv[++i]) / 100.0;
+            } else if (arg == "--keep-outputs") {
+                options.keepOutputs = true;
+            } else {
+                printUsage();
+                return 1;
+            }
+        }
+
+        if (!fs::exists(options.tsimgPath)) {
+            throw std::runtime_error("tsimg binary not found: " + options.tsimgPath + " (use --tsimg)");
+        }
+        for (const auto& format : options.imageFormats) {
+            if (format != "png" && format != "jpg") throw std::runtime_error("Unknown image format: " + format);
+        }
+        for (const auto& output : options.outputs) {
+            if (output != "spice" && output != "gif") throw std::runtime_error("Unknown output: " + output);
+        }
+
+        std::vector<BenchCase> cases;
+        for (size_t frames : options.frames) {
+            for (const auto& size : options.sizes) {
+                const Resolution& resolution = resolutionByName(size);
+                double gigapixels = static_cast<double>(frames) * resolution.width * resolution.height / 1e9;
+                if (gigapixels > options.maxGigapixels) {
+                    std::cerr << "Skipping " << frames << " frames at " << size << " (" << gigapixels
+                              << " gigapixels > --max-gpixels " << options.maxGigapixels << ")" << std::endl;
+                    continue;
+                }
+                for (const auto& format : options.imageFormats) {
+                    for (const auto& output : options.outputs) {
+                        cases.push_back({frames, resolution, format, output});
+                    }
+                }
+            }
+        }
+
+        json results = {
+            {"tsimg", options.tsimgPath},
+            {"hardware_threads", std::thread::hardware_concurrency()},
+            {"repeat", options.repeat},
+            {"cases", json::array()},
+        };
+
+        std::cout << std::left << std::setw(28) << "case" << std::right
+                  << std::setw(10) << "wall s" << std::setw(10) << "cpu s"
+                  << std::setw(10) << "MB/s" << std::setw(12) << "RSS MiB" << std::endl;
+        for (const auto& benchCase : cases) {
+            json entry = runCase(options, benchCase);
+            std::cout << std::left << std::setw(28) << benchCase.name() << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(10) << entry["wall_s"].get<double>()
+                      << std::setw(10) << entry["cpu_s"].get<double>()
+                      << std::setw(10) << entry["mb_per_s"].get<double>()
+                      << std::setw(12) << entry["peak_rss_bytes"].get<size_t>() / (1024.0 * 1024.0) << std::endl;
+            results["cases"].push_back(entry);
+        }
+
+        if (!options.resultsPath.empty()) {
+            std::ofstream(options.resultsPath) << results.dump(2) << std::endl;
+        }
+        if (!options.saveBaselinePath.empty()) {
+            std::ofstream(options.saveBaselinePath) << results.dump(2) << std::endl;
+            std::cout << "Baseline saved to " << options.saveBaselinePath << std::endl;
+        }
+        if (!options.baselinePath.empty()) {
+            std::ifstream file(options.baselinePath);
+            if (!file.is_open()) {
+                throw std::runtime_error("Could not open baseline: " + options.baselinePath);
+            }
+            json baseline = json::parse(file);
+            int regressions = compareWithBaseline(results, baseline, options.tolerance);
+            if (regressions > 0) {
+                std::cout << regressions << " metric(s) regressed beyond tolerance" << std::endl;
+                return 1;
+            }
+            std::cout << "No regressions beyond tolerance" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
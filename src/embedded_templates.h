@@ -0,0 +1,887 @@
+#pragma once
+
+// Gerado por utils/generate_embedded_templates.py a partir de templates/*.html; não editar.
+
+#include <cstddef>
+#include <string_view>
+
+namespace tsimg::embedded {
+
+    struct Placeholder {
+        size_t offset;        // posição em bytes no conteúdo do template
+        std::string_view tag; // inclui os sinais < e >
+    };
+
+    struct Template {
+        std::string_view name;
+        std::string_view content;
+        const Placeholder* placeholders;
+        size_t placeholderCount;
+    };
+
+    // Confere em tempo de compilação que cada offset aponta para a sua tag
+    template <size_t ContentSize, size_t Count>
+    constexpr bool placeholdersMatch(const char (&content)[ContentSize], const Placeholder (&placeholders)[Count]) {
+        std::string_view text(content, ContentSize - 1);
+        for (size_t i = 0; i < Count; ++i) {
+            if (text.substr(placeholders[i].offset, placeholders[i].tag.size()) != placeholders[i].tag) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline constexpr char kTemplateRangeContent[] =
+        "<!DOCTYPE html>\n"
+        "<!--\n"
+        "    Carregador de um contêiner .spice binário, gerado pelo TSIMG.\n"
+        "    Em vez de trazer todos os quadros embutidos em Base64, esta página lê o cabeçalho e o índice\n"
+        "    do contêiner por HTTP Range e busca cada quadro só quando ele vai ser exibido (mais os\n"
+        "    vizinhos). O servidor precisa aceitar requisições Range; se não aceitar, o arquivo é baixado\n"
+        "    inteiro uma única vez e os quadros são recortados dele.\n"
+        "    O contêiner pode ser trocado pelo parâmetro ?src=<url>.\n"
+        "\n"
+        "    Para mais informações sobre o projeto TSIMG, visite o repositório oficial no GitHub:\n"
+        "    www.github.com/NEPEM-UFSC/tsimg\n"
+        "-->\n"
+        "<html lang=\"en\">\n"
+        "<head>\n"
+        "    <meta charset=\"UTF-8\">\n"
+        "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
+        "    <title> <SPICE_TITLE> </title>\n"
+        "    <style>\n"
+        "        body {\n"
+        "            font-family: 'Roboto', sans-serif;\n"
+        "            text-align: center;\n"
+        "            padding: 8px 8px 20px 20px;\n"
+        "            background-color: #f4f4f9;\n"
+        "            color: #333;\n"
+        "        }\n"
+        "\n"
+        "        .slider-images-container {\n"
+        "            display: flex;\n"
+        "            justify-content: center;\n"
+        "            width: 100%;\n"
+        "            min-height: 30vh;\n"
+        "        }\n"
+        "\n"
+        "        .slider-images {\n"
+        "            width: 50%;\n"
+        "            display: flex;\n"
+        "            justify-content: center;\n"
+        "            margin: 0 10px;\n"
+        "        }\n"
+        "\n"
+        "        .slider-images img {\n"
+        "            max-height: 70vh;\n"
+        "            max-width: 100%;\n"
+        "            height: auto;\n"
+        "        }\n"
+        "\n"
+        "        .slider-control {\n"
+        "            display: flex;\n"
+        "            align-items: center;\n"
+        "            justify-content: center;\n"
+        "            width: 100%;\n"
+        "            margin-top: 20px;\n"
+        "        }\n"
+        "\n"
+        "        input[type=\"range\"] {\n"
+        "            width: 60%;\n"
+        "            margin: 0px 12px 0px 0px;\n"
+        "        }\n"
+        "\n"
+        "        .player-button {\n"
+        "            background-color: transparent;\n"
+        "            border: none;\n"
+        "            cursor: pointer;\n"
+        "            margin-left: 40px;\n"
+        "            font-size: 2em;\n"
+        "        }\n"
+        "\n"
+        "        .speed-option {\n"
+        "            cursor: pointer;\n"
+        "            margin-right: 12px;\n"
+        "        }\n"
+        "\n"
+        "        .slider-label {\n"
+        "            font-size: 1.25em;\n"
+        "            font-weight: lighter;\n"
+        "            margin-top: 8px;\n"
+        "        }\n"
+        "\n"
+        "        .status {\n"
+        "            color: #888;\n"
+        "            font-size: 0.9em;\n"
+        "        }\n"
+        "    </style>\n"
+        "</head>\n"
+        "<body>\n"
+        "    <h1 id=\"title\"><SPICE_TITLE></h1>\n"
+        "\n"
+        "    <div class=\"slider-control\">\n"
+        "        <span id=\"speedDisplay\" class=\"speed-option\" onclick=\"cycleSpeed()\">1x</span>\n"
+        "        <input type=\"range\" min=\"1\" max=\"1\" value=\"1\" id=\"imageSlider\" oninput=\"show(Number(this.value))\">\n"
+        "        <button id=\"playerButton\" class=\"player-button\" onclick=\"togglePlayPause()\">&#9658;</button>\n"
+        "    </div>\n"
+        "    <div class=\"slider-label\"><span id=\"labelDisplay\"></span></div>\n"
+        "\n"
+        "    <div class=\"slider-images-container\" id=\"lists\"></div>\n"
+        "    <div class=\"status\" id=\"status\">Loading…</div>\n"
+        "\n"
+        "    <script>\n"
+        "        const containerUrl = new URLSearchParams(location.search).get('src') || '<SPICE_CONTAINER_URL>';\n"
+        "        const MAGIC = [0x89, 0x53, 0x50, 0x43, 0x0d, 0x0a, 0x1a, 0x0a];\n"
+        "        const HEADER_SIZE = 64;\n"
+        "        const PREFETCH = 2;\n"
+        "        const MAX_CACHED = 48;\n"
+        "\n"
+        "        let whole = null;       // corpo inteiro, se o servidor ignorar Range\n"
+        "        let entries = [];       // índice: {offset, size, width, height, list, mime, label}\n"
+        "        let meta = {};\n"
+        "        let lists = [];         // por lista, os índices de entries na ordem\n"
+        "        let current = 1;\n"
+        "        const cache = new Map(); // índice do quadro -> Promise<object URL>\n"
+        "\n"
+        "        async function fetchRange(start, end) {\n"
+        "            if (whole) return whole.subarray(start, end);\n"
+        "            const response = await fetch(containerUrl, { headers: { Range: `bytes=${start}-${end - 1}` } });\n"
+        "            if (!response.ok) throw new Error(`HTTP ${response.status} for ${containerUrl}`);\n"
+        "            const body = new Uint8Array(await response.arrayBuffer());\n"
+        "            if (response.status === 206) return body;\n"
+        "            whole = body;\n"
+        "            return whole.subarray(start, end);\n"
+        "        }\n"
+        "\n"
+        "        function u64(view, offset) {\n"
+        "            return Number(view.getBigUint64(offset, true));\n"
+        "        }\n"
+        "\n"
+        "        async function open() {\n"
+        "            const head = await fetchRange(0, HEADER_SIZE);\n"
+        "            if (head.length < HEADER_SIZE || MAGIC.some((b, i) => head[i] !== b)) {\n"
+        "                throw new Error('Not a SPICE container');\n"
+        "            }\n"
+        "            const view = new DataView(head.buffer, head.byteOffset, head.byteLength);\n"
+        "            const frameCount = view.getUint32(16, true);\n"
+        "            const entrySize = view.getUint32(20, true);\n"
+        "            const indexOffset = u64(view, 24);\n"
+        "            const metaOffset = u64(view, 32);\n"
+        "            const metaSize = u64(view, 40);\n"
+        "\n"
+        "            // Índice e metadados são contíguos: uma requisição só\n"
+        "            const start = Math.min(indexOffset, metaOffset);\n"
+        "            const block = await fetchRange(start, metaOffset + metaSize);\n"
+        "            const blockView = new DataView(block.buffer, block.byteOffset, block.byteLength);\n"
+        "            meta = JSON.parse(new TextDecoder().decode(block.subarray(metaOffset - start)));\n"
+        "            for (let i = 0; i < frameCount; ++i) {\n"
+        "                const at = indexOffset - start + i * entrySize;\n"
+        "                entries.push({\n"
+        "                    offset: u64(blockView, at),\n"
+        "                    size: u64(blockView, at + 8),\n"
+        "                    width: blockView.getUint32(at + 16, true),\n"
+        "                    height: blockView.getUint32(at + 20, true),\n"
+        "                    list: blockView.getUint16(at + 24, true),\n"
+        "                    mime: (meta.mime_types || [])[block[at + 26]] || 'application/octet-stream',\n"
+        "                    label: blockView.getUint32(at + 28, true),\n"
+        "                });\n"
+        "            }\n"
+        "        }\n"
+        "\n"
+        "        function frameUrl(index) {\n"
+        "            if (!cache.has(index)) {\n"
+        "                const entry = entries[index];\n"
+        "                cache.set(index, fetchRange(entry.offset, entry.offset + entry.size)\n"
+        "                    .then((bytes) => URL.createObjectURL(new Blob([bytes], { type: entry.mime }))));\n"
+        "                // Mantém só os quadros mais recentes\n"
+        "                while (cache.size > MAX_CACHED) {\n"
+        "                    const [oldest, url] = cache.entries().next().value;\n"
+        "                    cache.delete(oldest);\n"
+        "                    url.then(URL.revokeObjectURL);\n"
+        "                }\n"
+        "            }\n"
+        "            return cache.get(index);\n"
+        "        }\n"
+        "\n"
+        "        async function show(position) {\n"
+        "            current = position;\n"
+        "            document.getElementById('imageSlider').value = position;\n"
+        "            const labels = meta.labels || [];\n"
+        "            lists.forEach((frames, list) => {\n"
+        "                const index = frames[position - 1];\n"
+        "                const img = document.getElementById(`frame-${list}`);\n"
+        "                if (index === undefined) {\n"
+        "                    img.removeAttribute('src');\n"
+        "                    return;\n"
+        "                }\n"
+        "                const entry = entries[index];\n"
+        "                if (entry.width && entry.height) {\n"
+        "                    img.width = entry.width;\n"
+        "                    img.height = entry.height;\n"
+        "                }\n"
+        "                img.alt = (meta.names || [])[index] || '';\n"
+        "                frameUrl(index).then((url) => {\n"
+        "                    if (current === position) img.src = url;\n"
+        "                });\n"
+        "                if (list === 0) {\n"
+        "                    const label = entry.label < labels.length ? labels[entry.label] : '';\n"
+        "                    document.getElementById('labelDisplay').innerText = label;\n"
+        "                }\n"
+        "            });\n"
+        "            for (let step = 1; step <= PREFETCH; ++step) {\n"
+        "                lists.forEach((frames) => {\n"
+        "                    const next = frames[(position - 1 + step) % frames.length];\n"
+        "                    if (next !== undefined) frameUrl(next);\n"
+        "                });\n"
+        "            }\n"
+        "        }\n"
+        "\n"
+        "        const speeds = [0.5, 1, 1.5, 2, 5, 10];\n"
+        "        let speedIndex = 1;\n"
+        "        let playInterval = null;\n"
+        "\n"
+        "        function restart() {\n"
+        "            clearInterval(playInterval);\n"
+        "            playInterval = setInterval(() => show((current % lists[0].length) + 1), 800 / speeds[speedIndex]);\n"
+        "        }\n"
+        "\n"
+        "        function cycleSpeed() {\n"
+        "            speedIndex = (speedIndex + 1) % speeds.length;\n"
+        "            document.getElementById('speedDisplay').innerText = `${speeds[speedIndex]}x`;\n"
+        "            if (playInterval) restart();\n"
+        "        }\n"
+        "\n"
+        "        function togglePlayPause() {\n"
+        "            const button = document.getElementById('playerButton');\n"
+        "            if (playInterval) {\n"
+        "                clearInterval(playInterval);\n"
+        "                playInterval = null;\n"
+        "                button.innerHTML = '&#9658;';\n"
+        "            } else {\n"
+        "                restart();\n"
+        "                button.innerHTML = '&#10074;&#10074;';\n"
+        "            }\n"
+        "        }\n"
+        "\n"
+        "        document.addEventListener('DOMContentLoaded', async () => {\n"
+        "            const status = document.getElementById('status');\n"
+        "            try {\n"
+        "                await open();\n"
+        "                entries.forEach((entry, index) => {\n"
+        "                    while (lists.length <= entry.list) lists.push([]);\n"
+        "                    lists[entry.list].push(index);\n"
+        "                });\n"
+        "                const container = document.getElementById('lists');\n"
+        "                lists.forEach((frames, list) => {\n"
+        "                    const div = document.createElement('div');\n"
+        "                    div.className = 'slider-images';\n"
+        "                    const img = document.createElement('img');\n"
+        "                    img.id = `frame-${list}`;\n"
+        "                    div.appendChild(img);\n"
+        "                    container.appendChild(div);\n"
+        "                });\n"
+        "                if (meta.title) {\n"
+        "                    document.title = meta.title;\n"
+        "                    document.getElementById('title').innerText = meta.title;\n"
+        "                }\n"
+        "                document.getElementById('imageSlider').max = lists.length ? lists[0].length : 1;\n"
+        "                status.innerText = `${entries.length} frames`;\n"
+        "                show(1);\n"
+        "            } catch (error) {\n"
+        "                status.innerText = `Could not load ${containerUrl}: ${error.message}`;\n"
+        "            }\n"
+        "        });\n"
+        "    </script>\n"
+        "</body>\n"
+        "</html>\n";
+    static_assert(sizeof(kTemplateRangeContent) - 1 == 10101, "template_range.html: unexpected size");
+
+    inline constexpr Placeholder kTemplateRangePlaceholders[] = {
+        {779, "<SPICE_TITLE>"},
+        {2305, "<SPICE_TITLE>"},
+        {2939, "<SPICE_CONTAINER_URL>"},
+    };
+    static_assert(placeholdersMatch(kTemplateRangeContent, kTemplateRangePlaceholders), "template_range.html: stale placeholder table");
+
+    inline constexpr char kTemplateVsContent[] =
+        "<!DOCTYPE html>\n"
+        "<!--\n"
+        "    Este é um arquivo HTML, gerado a partir de um arquivo .spice.\n"
+        "    Um arquivo .spice é um formato customizado desenvolvido para facilitar a exibição de imagens seriadas em uma plataforma web, multiplataforma, sem a necessidade de plugins ou extensões adicionais. Imagens seriadas são uma série de imagens que representam alterações temporais ou dimensionais de um objeto ou fenômeno, e são comumente utilizadas em áreas como medicina, geociências, astronomia, entre outras. Seus usos incluem a visualização de mapas de profundiade, imagens de ressonância magnética, tomografias computadorizadas, imagens de satélite em diferentes datas e etc.\n"
+        "    O nome \"SPICE\" é um acrônimo para \"Serialized Picture Interactive Content Environment\". Este formato permite a integração de texto, imagens e outros elementos multimídia em um único arquivo HTML, que pode ser facilmente visualizado em navegadores modernos.\n"
+        "\n"
+        "    A criação e manipulação de arquivos .spice é feita atraves do projeto TSIMG, que visa facilitar a visualização de imagens seriadas em navegadores web. O projeto TSIMG e suas ferramentas, como o gerador deste arquivo são mantidos pelo NEPEM-UFSC\n"
+        "\n"
+        "    Para mais informações sobre o projeto TSIMG, visite o repositório oficial no GitHub:\n"
+        "    www.github.com/NEPEM-UFSC/tsimg\n"
+        "\n"
+        "-->\n"
+        "<html lang=\"en\">\n"
+        "<head>\n"
+        "    <meta charset=\"UTF-8\">\n"
+        "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
+        "    <title> <SPICE_TITLE> </title>\n"
+        "    <style>\n"
+        "        body {\n"
+        "            font-family: 'Roboto', sans-serif;\n"
+        "            text-align: center;\n"
+        "            padding: 8px 8px 20px 20px;\n"
+        "            background-color: #f4f4f9;\n"
+        "            color: #333;\n"
+        "        }\n"
+        "        \n"
+        "        /* Main Content Area */\n"
+        "        .content {\n"
+        "            margin-bottom: 20px;\n"
+        "            font-size: 1.2em;\n"
+        "            background: #fff;\n"
+        "            padding: 20px;\n"
+        "            border-radius: 6px;\n"
+        "            box-shadow: 0 4px 8px rgba(0, 0, 0, 0.1);\n"
+        "            width: 95%;\n"
+        "            max-width: 800px;\n"
+        "            margin: 0 auto;\n"
+        "        }\n"
+        "        \n"
+        "        .slider-container {\n"
+        "            display: flex;\n"
+        "            align-items: center;\n"
+        "            justify-content: center;\n"
+        "            margin-top: 20px;\n"
+        "        }\n"
+        "        \n"
+        "        .slider-images-container {\n"
+        "            display: flex;\n"
+        "            justify-content: center;\n"
+        "            width: 100%;\n"
+        "        }\n"
+        "    \n"
+        "        .slider-images {\n"
+        "            width: 50%;\n"
+        "            display: flex;\n"
+        "            justify-content: center;\n"
+        "            margin: 0 10px;\n"
+        "        }\n"
+        "        \n"
+        "        .slider-images img {\n"
+        "            max-height: 70vh;\n"
+        "            width: auto;\n"
+        "            display: none;\n"
+        "        }\n"
+        "        \n"
+        "        .slider-images img.active {\n"
+        "            display: block;\n"
+        "            max-width: 100%;\n"
+        "            height: auto;\n"
+        "        }\n"
+        "\n"
+        "        /* Com atlas, as imagens são folhas e o quadro atual é desenhado neste canvas */\n"
+        "        .slider-images canvas.atlas-frame {\n"
+        "            display: block;\n"
+        "            max-width: 100%;\n"
+        "            max-height: 70vh;\n"
+        "        }\n"
+        "        \n"
+        "        .slider-label {\n"
+        "            font-size: 1.25em;\n"
+        "            font-weight: lighter;\n"
+        "            margin-top: 8px;\n"
+        "        }\n"
+        "        \n"
+        "        .slider-control {\n"
+        "            display: flex;\n"
+        "            align-items: center;\n"
+        "            justify-content: center;\n"
+        "            width: 100%;\n"
+        "        }\n"
+        "        \n"
+        "        input[type=\"range\"] {\n"
+        "            -webkit-appearance: none;\n"
+        "            appearance: none;\n"
+        "            width: 60%;\n"
+        "            height: 10px;\n"
+        "            background: #ddd;\n"
+        "            outline: none;\n"
+        "            border-radius: 5px;\n"
+        "            margin: 0px 12px 0px 0px;\n"
+        "        }\n"
+        "        \n"
+        "        input[type=\"range\"]::-webkit-slider-thumb {\n"
+        "            -webkit-appearance: none;\n"
+        "            appearance: none;\n"
+        "            width: 20px;\n"
+        "            height: 20px;\n"
+        "            background: #4CAF50;\n"
+        "            cursor: pointer;\n"
+        "            border-radius: 50%;\n"
+        "        }\n"
+        "        \n"
+        "        input[type=\"range\"]::-moz-range-thumb {\n"
+        "            width: 20px;\n"
+        "            height: 20px;\n"
+        "            background: #4CAF50;\n"
+        "            cursor: pointer;\n"
+        "            border-radius: 50%;\n"
+        "        }\n"
+        "        \n"
+        "        .slider-labels {\n"
+        "            display: none;\n"
+        "            -webkit-user-select: none;\n"
+        "            user-select: none;\n"
+        "        }\n"
+        "\n"
+        "        /* Estatísticas por quadro, exibidas só quando o arquivo as traz */\n"
+        "        .stats-chart {\n"
+        "            display: none;\n"
+        "            justify-content: center;\n"
+        "            gap: 12px;\n"
+        "            margin: 16px auto 0;\n"
+        "            max-width: 800px;\n"
+        "        }\n"
+        "\n"
+        "        .stats-chart canvas {\n"
+        "            background: #fff;\n"
+        "            border-radius: 6px;\n"
+        "            box-shadow: 0 4px 8px rgba(0, 0, 0, 0.1);\n"
+        "            max-width: 100%;\n"
+        "        }\n"
+        "        \n"
+        "        .player-button {\n"
+        "            background-color: transparent;\n"
+        "            border: none;\n"
+        "            cursor: pointer;\n"
+        "            margin-left: 40px;\n"
+        "            font-size: 2em;\n"
+        "        }\n"
+        "        .speed-control {\n"
+        "            display: flex;\n"
+        "            align-items: center;\n"
+        "            justify-content: center;\n"
+        "            margin-left: 20px;\n"
+        "        }\n"
+        "        \n"
+        "        .speed-option {\n"
+        "            margin: 0 5px;\n"
+        "            cursor: pointer;\n"
+        "            font-size: 1em;\n"
+        "            color: #4CAF50;\n"
+        "            transition: color 0.3s;\n"
+        "        }\n"
+        "        \n"
+        "        .speed-option:hover {\n"
+        "            color: #388E3C;\n"
+        "        }\n"
+        "\n"
+        "        .bottom-objects {\n"
+        "            position: fixed;\n"
+        "            bottom: 10px;\n"
+        "            left: 0;\n"
+        "            width: 100%;\n"
+        "            display: flex;\n"
+        "            justify-content: space-between;\n"
+        "            align-items: center;\n"
+        "            padding: 0 10px;\n"
+        "            z-index: 1000;\n"
+        "        }\n"
+        "\n"
+        "        .author-logo {\n"
+        "            max-width: 10vw;\n"
+        "            opacity: 0.9;\n"
+        "            border-radius: 5px;\n"
+        "            background-color: #fff;\n"
+        "            box-shadow: 0px 4px 8px rgba(0, 0, 0, 0.2);\n"
+        "            overflow: hidden;\n"
+        "            display: flex;\n"
+        "            align-items: center;\n"
+        "            justify-content: center;\n"
+        "        }\n"
+        "    \n"
+        "        .author-logo img {\n"
+        "            width: 70%;\n"
+        "            height: 70%;\n"
+        "            object-fit: cover;\n"
+        "            border-radius: inherit;\n"
+        "            margin: 0;\n"
+        "        }\n"
+        "        \n"
+        "        .help-button-container {\n"
+        "            position: fixed;\n"
+        "            bottom: 10px;\n"
+        "            right: 10px;\n"
+        "            max-width: 10vw;\n"
+        "            display: flex;\n"
+        "            flex-direction: column;\n"
+        "            align-items: flex-end;\n"
+        "        }\n"
+        "\n"
+        "        .help-text {\n"
+        "            display: flex;\n"
+        "            flex-direction: column;\n"
+        "            justify-content: center;\n"
+        "            align-items: center;\n"
+        "            position: fixed;\n"
+        "            bottom: 10px;\n"
+        "            right: 10px;\n"
+        "            background-color: #fff;\n"
+        "            padding: 10px;\n"
+        "            border-radius: 5px;\n"
+        "            box-shadow: 0px 4px 8px rgba(0, 0, 0, 0.2);\n"
+        "            max-width: 16vw;\n"
+        "            overflow-y: auto;\n"
+        "            z-index: 1000;\n"
+        "        }\n"
+        "    \n"
+        "        .help-badge {\n"
+        "            display: flex;\n"
+        "            justify-content: center;\n"
+        "            align-items: center;\n"
+        "            bottom: 10px;\n"
+        "            right: 10px;\n"
+        "            max-width: fit-content;\n"
+        "            background-color: #4CAF50;\n"
+        "            color: #fff;\n"
+        "            padding: 3px 8px;\n"
+        "            border-radius: 5px;\n"
+        "            cursor: pointer;\n"
+        "            box-shadow: 0px 4px 8px rgba(0, 0, 0, 0.2);\n"
+        "            transition: background-color 0.3s;\n"
+        "        }\n"
+        "        \n"
+        "        .help-badge:hover {\n"
+        "            background-color: #388E3C;\n"
+        "        }\n"
+        "\n"
+        "        @media (max-width: 820px) {\n"
+        "            .author-logo, .help-button-container {\n"
+        "                max-width: 15vw;\n"
+        "            }\n"
+        "    \n"
+        "            .help-text {\n"
+        "                width: 80vw;\n"
+        "                padding: 8px;\n"
+        "            }\n"
+        "    \n"
+        "            .slider-images-container {\n"
+        "                flex-direction: column;\n"
+        "            }\n"
+        "    \n"
+        "            .slider-images {\n"
+        "                width: 100%;\n"
+        "                margin: 10px 0;\n"
+        "            }\n"
+        "    \n"
+        "            .slider-images img {\n"
+        "                max-height: 50vh;\n"
+        "            }\n"
+        "        }\n"
+        "    </style>\n"
+        "</head>\n"
+        "<body>\n"
+        "    \n"
+        "    <SPICE_TITLE>\n"
+        "    \n"
+        "    <div class=\"content\">\n"
+        "        <SPICE_TEXT>\n"
+        "    </div>\n"
+        "\n"
+        "    <div class=\"slider-container\">\n"
+        "        <SPICE_SLIDER>\n"
+        "        <div class=\"slider-control\">\n"
+        "            <div class=\"speed-control\">\n"
+        "                <span id=\"speedDisplay\" class=\"speed-option\" onclick=\"cycleSpeed()\">1.0x</span>\n"
+        "            </div>\n"
+        "            <button id=\"playerButton\" class=\"player-button\" onclick=\"togglePlayPause()\">&#9658;</button>\n"
+        "            <input type=\"range\" min=\"1\" max=\"1\" value=\"1\" id=\"imageSlider\" oninput=\"updateSlider(this.value, true)\">\n"
+        "            <div class=\"slider-label\">\n"
+        "                <span id=\"labelDisplay\"></span>\n"
+        "            </div>\n"
+        "        </div>\n"
+        "    </div>\n"
+        "    <div class=\"slider-images-container\">\n"
+        "        <div class=\"slider-images\" id=\"slider-images-1\">\n"
+        "            <SPICE_IMAGES>\n"
+        "        </div>\n"
+        "        <!-- Conditionally include the second image list -->\n"
+        "        <div class=\"slider-images\" id=\"slider-images-2\" style=\"display: none;\">\n"
+        "            <SPICE_IMAGES_1>\n"
+        "        </div>\n"
+        "    </div>\n"
+        "\n"
+        "    <div class=\"slider-labels\">\n"
+        "        <SPICE_LABELS>\n"
+        "    </div>\n"
+        "\n"
+        "    <div class=\"stats-chart\" id=\"statsChart\">\n"
+        "        <canvas id=\"statsSeries\" width=\"560\" height=\"140\"></canvas>\n"
+        "        <canvas id=\"statsHistogram\" width=\"200\" height=\"140\"></canvas>\n"
+        "    </div>\n"
+        "    <script type=\"application/json\" id=\"spiceStats\"><SPICE_STATS></script>\n"
+        "    <script type=\"application/json\" id=\"spiceAtlas\"><SPICE_ATLAS></script>\n"
+        "\n"
+        "    <div class=\"bottom-objects\">\n"
+        "        <div class=\"author-logo\">\n"
+        "            <img src=\"<SPICE_AUTHOR_IMAGE>\" alt=\"Author Image\">\n"
+        "        </div>\n"
+        "        <div class=\"help-button-container\">\n"
+        "            <div class=\"help-text\">\n"
+        "                <SPICE_HELP_TEXT>\n"
+        "            </div>\n"
+        "            <div class=\"help-badge\">\n"
+        "                <SPICE_HELP_CONTENT>\n"
+        "            </div>\n"
+        "        </div>\n"
+        "    </div>\n"
+        "\n"
+        "    <script>\n"
+        "        let isPlaying = false;\n"
+        "        let playInterval = null;\n"
+        "        let currentImageIndex = 1;\n"
+        "        const speeds = [0.5, 1.0, 1.5, 2.0, 5.0, 10.0];\n"
+        "        let currentSpeedIndex = 1.0;\n"
+        "        let playSpeed = 1.0;\n"
+        "        const images1 = document.querySelectorAll('#slider-images-1 img');\n"
+        "        const images2 = document.querySelectorAll('#slider-images-2 img');\n"
+        "    \n"
+        "        // Blocos JSON opcionais gerados pelo tsimg; sem eles o bloco fica com o marcador original\n"
+        "        function readJson(id) {\n"
+        "            const raw = document.getElementById(id).textContent.trim();\n"
+        "            if (!raw.startsWith('{')) return null;\n"
+        "            try {\n"
+        "                return JSON.parse(raw);\n"
+        "            } catch (e) {\n"
+        "                return null;\n"
+        "            }\n"
+        "        }\n"
+        "\n"
+        "        // Estatísticas por quadro (--stats)\n"
+        "        const stats = readJson('spiceStats');\n"
+        "\n"
+        "        // Atlas (--atlas): as imagens de cada lista são folhas e cada quadro é o recorte\n"
+        "        // [folha, x, y, largura, altura] desenhado num canvas no lugar delas\n"
+        "        const atlas = readJson('spiceAtlas');\n"
+        "        const atlasViews = [['SPICE_IMAGES', 'slider-images-1'], ['SPICE_IMAGES_1', 'slider-images-2']]\n"
+        "            .filter(([tag]) => atlas && atlas[tag])\n"
+        "            .map(([tag, id]) => {\n"
+        "                const container = document.getElementById(id);\n"
+        "                const canvas = document.createElement('canvas');\n"
+        "                canvas.className = 'atlas-frame';\n"
+        "                container.appendChild(canvas);\n"
+        "                return { frames: atlas[tag], sheets: container.querySelectorAll('img'), canvas: canvas, current: -1 };\n"
+        "            });\n"
+        "\n"
+        "        function frameCount() {\n"
+        "            return atlasViews.length ? atlasViews[0].frames.length : images1.length;\n"
+        "        }\n"
+        "\n"
+        "        function showAtlasFrame(view, index) {\n"
+        "            const frame = view.frames[index];\n"
+        "            if (!frame) return;\n"
+        "            const [sheet, x, y, w, h] = frame;\n"
+        "            const image = view.sheets[sheet];\n"
+        "            view.current = index;\n"
+        "            const draw = () => {\n"
+        "                if (view.current !== index) return;\n"
+        "                if (view.canvas.width !== w || view.canvas.height !== h) {\n"
+        "                    view.canvas.width = w;\n"
+        "                    view.canvas.height = h;\n"
+        "                }\n"
+        "                view.canvas.getContext('2d').drawImage(image, x, y, w, h, 0, 0, w, h);\n"
+        "            };\n"
+        "            if (image.complete) {\n"
+        "                draw();\n"
+        "            } else {\n"
+        "                image.addEventListener('load', draw, { once: true });\n"
+        "            }\n"
+        "        }\n"
+        "\n"
+        "        // Média ao longo da série com as faixas p25-p75 e p5-p95, e o histograma do quadro atual\n"
+        "        function drawStats(value) {\n"
+        "            if (!stats || !stats.mean || stats.mean.length === 0) return;\n"
+        "            const index = Number(value) - 1;\n"
+        "            const pad = 6;\n"
+        "\n"
+        "            const series = document.getElementById('statsSeries');\n"
+        "            const ctx = series.getContext('2d');\n"
+        "            const w = series.width;\n"
+        "            const h = series.height;\n"
+        "            const n = stats.mean.length;\n"
+        "            const x = (i) => n > 1 ? pad + i * (w - 2 * pad) / (n - 1) : w / 2;\n"
+        "            const y = (v) => h - pad - v * (h - 2 * pad) / 255;\n"
+        "            const trace = (values) => values.forEach((v, i) => i ? ctx.lineTo(x(i), y(v)) : ctx.moveTo(x(i), y(v)));\n"
+        "            const band = (low, high, color) => {\n"
+        "                ctx.beginPath();\n"
+        "                trace(low);\n"
+        "                for (let i = n - 1; i >= 0; i--) ctx.lineTo(x(i), y(high[i]));\n"
+        "                ctx.closePath();\n"
+        "                ctx.fillStyle = color;\n"
+        "                ctx.fill();\n"
+        "            };\n"
+        "            ctx.clearRect(0, 0, w, h);\n"
+        "            band(stats.p5, stats.p95, 'rgba(76, 175, 80, 0.15)');\n"
+        "            band(stats.p25, stats.p75, 'rgba(76, 175, 80, 0.35)');\n"
+        "            ctx.beginPath();\n"
+        "            trace(stats.mean);\n"
+        "            ctx.strokeStyle = '#388E3C';\n"
+        "            ctx.lineWidth = 2;\n"
+        "            ctx.stroke();\n"
+        "            ctx.fillStyle = '#333';\n"
+        "            ctx.fillRect(x(index) - 1, pad, 2, h - 2 * pad);\n"
+        "            series.title = `${stats.channel}: mean ${stats.mean[index]}, median ${stats.p50[index]}, ` +\n"
+        "                           `p5-p95 ${stats.p5[index]}-${stats.p95[index]}`;\n"
+        "\n"
+        "            const canvas = document.getElementById('statsHistogram');\n"
+        "            const hctx = canvas.getContext('2d');\n"
+        "            const histogram = stats.histogram[index] || [];\n"
+        "            const peak = Math.max(1, ...histogram);\n"
+        "            const barWidth = (canvas.width - 2 * pad) / Math.max(1, histogram.length);\n"
+        "            hctx.clearRect(0, 0, canvas.width, canvas.height);\n"
+        "            hctx.fillStyle = '#4CAF50';\n"
+        "            histogram.forEach((count, i) => {\n"
+        "                const barHeight = count / peak * (canvas.height - 2 * pad);\n"
+        "                hctx.fillRect(pad + i * barWidth, canvas.height - pad - barHeight, Math.max(1, barWidth - 1), barHeight);\n"
+        "            });\n"
+        "        }\n"
+        "\n"
+        "        function preloadImages(images) {\n"
+        "            images.forEach((image) => {\n"
+        "                const img = new Image();\n"
+        "                img.src = image.src;\n"
+        "            });\n"
+        "        }\n"
+        "    \n"
+        "        function setSpeed(speed) {\n"
+        "            playSpeed = speed;\n"
+        "            if (isPlaying) {\n"
+        "                clearInterval(playInterval);\n"
+        "                playInterval = setInterval(() => {\n"
+        "                    currentImageIndex = (currentImageIndex % frameCount()) + 1;\n"
+        "                    updateSlider(currentImageIndex, true);\n"
+        "                }, 800 / playSpeed);\n"
+        "            }\n"
+        "        }\n"
+        "            \n"
+        "        function updateSlider(value, debug = false) {\n"
+        "            const labels = document.querySelectorAll('.slider-labels span');\n"
+        "            const labelDisplay = document.getElementById('labelDisplay');\n"
+        "            const slider = document.getElementById('imageSlider');\n"
+        "    \n"
+        "            // Remove a classe 'active' de todas as imagens\n"
+        "            images1.forEach((image, index) => {\n"
+        "                image.classList.remove('active');\n"
+        "            });\n"
+        "            images2.forEach((image, index) => {\n"
+        "                image.classList.remove('active');\n"
+        "            });\n"
+        "    \n"
+        "            // Exibe a imagem correspondente ao valor do slider\n"
+        "            if (atlasViews.length) {\n"
+        "                atlasViews.forEach((view) => showAtlasFrame(view, value - 1));\n"
+        "            } else {\n"
+        "                if (images1[value - 1]) {\n"
+        "                    images1[value - 1].classList.add('active');\n"
+        "                }\n"
+        "                if (images2[value - 1]) {\n"
+        "                    images2[value - 1].classList.add('active');\n"
+        "                }\n"
+        "            }\n"
+        "            slider.value = value;\n"
+        "    \n"
+        "            // Atualiza o rótulo do slider com o rótulo correspondente\n"
+        "            if (labels[value - 1]) {\n"
+        "                labelDisplay.innerText = labels[value - 1].innerText;\n"
+        "            } else {\n"
+        "                labelDisplay.innerText = '';\n"
+        "            }\n"
+        "    \n"
+        "            currentImageIndex = value;\n"
+        "            drawStats(value);\n"
+        "        }\n"
+        "    \n"
+        "        function cycleSpeed() {\n"
+        "            currentSpeedIndex = (currentSpeedIndex + 1) % speeds.length;\n"
+        "            const newSpeed = speeds[currentSpeedIndex];\n"
+        "            setSpeed(newSpeed);\n"
+        "            document.getElementById('speedDisplay').innerText = `${newSpeed}x`;\n"
+        "        }\n"
+        "    \n"
+        "        function togglePlayPause() {\n"
+        "            const playerButton = document.getElementById('playerButton');\n"
+        "            const images = document.querySelectorAll('.slider-images img');\n"
+        "    \n"
+        "            if (isPlaying) {\n"
+        "                // Pausa a reprodução\n"
+        "                clearInterval(playInterval);\n"
+        "                isPlaying = false;\n"
+        "                playerButton.innerHTML = \"&#9658;\";  // Ícone de play\n"
+        "            } else {\n"
+        "                // Inicia a reprodução\n"
+        "                playInterval = setInterval(() => {\n"
+        "                    currentImageIndex = (currentImageIndex % frameCount()) + 1;\n"
+        "                    updateSlider(currentImageIndex, true);\n"
+        "                }, 1600 / playSpeed);\n"
+        "                isPlaying = true;\n"
+        "                playerButton.innerHTML = \"&#10074;&#10074;\";  // Ícone de pausa\n"
+        "            }\n"
+        "        }\n"
+        "    \n"
+        "        document.addEventListener(\"DOMContentLoaded\", function() {\n"
+        "            const slider = document.getElementById('imageSlider');\n"
+        "            const images1 = document.querySelectorAll('#slider-images-1 img');\n"
+        "            const images2 = document.querySelectorAll('#slider-images-2 img');\n"
+        "            \n"
+        "            // Conditionally display the second image list if it contains images\n"
+        "            if (images2.length > 0) {\n"
+        "                document.getElementById('slider-images-2').style.display = 'flex';\n"
+        "            }\n"
+        "            \n"
+        "            if (stats) {\n"
+        "                document.getElementById('statsChart').style.display = 'flex';\n"
+        "            }\n"
+        "\n"
+        "            // Define o valor máximo do slider como o número de imagens\n"
+        "            slider.max = frameCount();\n"
+        "    \n"
+        "            // Pré-carrega as imagens\n"
+        "            preloadImages(images1);\n"
+        "            preloadImages(images2);\n"
+        "    \n"
+        "            // Atualiza o slider para mostrar a primeira imagem\n"
+        "            updateSlider(slider.value, true);\n"
+        "    \n"
+        "            // Atualiza a imagem exibida com base no valor do slider\n"
+        "            slider.addEventListener('input', function() {\n"
+        "                updateSlider(this.value, true);\n"
+        "            });\n"
+        "    \n"
+        "            // Define a velocidade inicial\n"
+        "            setSpeed(speeds[currentSpeedIndex]);\n"
+        "            document.getElementById('speedDisplay').innerText = `${speeds[currentSpeedIndex]}x`;\n"
+        "        });\n"
+        "    </script>\n"
+        "</body>\n"
+        "</html>";
+    static_assert(sizeof(kTemplateVsContent) - 1 == 19426, "template_vs.html: unexpected size");
+
+    inline constexpr Placeholder kTemplateVsPlaceholders[] = {
+        {1482, "<SPICE_TITLE>"},
+        {8075, "<SPICE_TITLE>"},
+        {8128, "<SPICE_TEXT>"},
+        {8196, "<SPICE_SLIDER>"},
+        {8868, "<SPICE_IMAGES>"},
+        {9051, "<SPICE_IMAGES_1>"},
+        {9135, "<SPICE_LABELS>"},
+        {9410, "<SPICE_STATS>"},
+        {9485, "<SPICE_ATLAS>"},
+        {9598, "<SPICE_AUTHOR_IMAGE>"},
+        {9751, "<SPICE_HELP_TEXT>"},
+        {9841, "<SPICE_HELP_CONTENT>"},
+    };
+    static_assert(placeholdersMatch(kTemplateVsContent, kTemplateVsPlaceholders), "template_vs.html: stale placeholder table");
+
+    inline constexpr Template kTemplates[] = {
+        {"template_range", std::string_view(kTemplateRangeContent, sizeof(kTemplateRangeContent) - 1), kTemplateRangePlaceholders, 3},
+        {"template_vs", std::string_view(kTemplateVsContent, sizeof(kTemplateVsContent) - 1), kTemplateVsPlaceholders, 12},
+    };
+
+    inline constexpr std::string_view kDefaultTemplate = "template_vs";
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -5,10 +7,28 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <future>
+#include <limits>
+#include <type_traits>
 #include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include "tsimg_spice.h" 
+#include "tsimg_align.h"
+#include "tsimg_atlas.h"
+#include "tsimg_roi.h"
+#include "tsimg_container.h"
+#include "tsimg_downscale.h"
+#include "tsimg_estimate.h"
+#include "tsimg_normalize.h"
 #include "tsimg_gif.h"
+#include "tsimg_inputs.h"
+#include "tsimg_memory.h"
+#include "tsimg_png.h"
+#include "tsimg_raw.h"
+#include "tsimg_serve.h"
+#include "tsimg_stats.h"
+#include "tsimg_watch.h"
 #include "build_info.h"
 
 const std::string DEFAULT_TITLE = "TSIMG Presentation";
@@ -26,6 +46,191 @@ std::vector<std::string> split(const std::string& str, char delimiter) {
     return tokens;
 }
 
+// Caminho do argumento -i ou -n que representa stdin/stdout
+const std::string STDIO_PATH = "-";
+
+std::string trim(const std::string& str) {
+    size_t first = str.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "";
+    }
+    size_t last = str.find_last_not_of(" \t\r");
+    return str.substr(first, last - first + 1);
+}
+
+// Lê do stdin, sob demanda, um caminho de imagem por linha; linhas em branco são ignoradas.
+// Um caminho inválido interrompe a geração com exceção, como a validação do modo CLI.
+tsimg::pipeline::PathSource stdinPathSource(bool debug) {
+    return [debug](std::string& path) {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            path = trim(line);
+            if (path.empty()) {
+                continue;
+            }
+            if (!tsimg::utils::ImageValidator::validateImagePath(path, debug)) {
+                throw std::runtime_error("Invalid image file: " + path);
+            }
+            return true;
+        }
+        return false;
+    };
+}
+
+// Série crua lida inteira, porque o GIF precisa de todos os quadros. Só o SPICE usa o tamanho
+// original: sem ele cada quadro já é guardado no tamanho do GIF; com ele o original fica até o
+// SPICE consumi-lo e então é reduzido (ou descartado, se o GIF já o leu). Os quadros guardados são
+// admitidos no orçamento de memória, até metade dele, para o GIF seguir adiante com a outra.
+class RawSeries {
+public:
+    // Lança std::runtime_error se a fonte não trouxer quadros ou se eles não couberem no orçamento;
+    // names recebe os nomes sintéticos dos quadros
+    RawSeries(const tsimg::raw::FrameSource& source, int maxDimension, bool keepFullSize, std::vector<std::string>& names, bool debug) {
+        const size_t limit = tsimg::memory::budget() / 2;
+        size_t retained = 0;
+        tsimg::raw::Frame frame;
+        while (source(frame)) {
+            if (frames.empty()) {
+                canvasWidth = frame.width;
+                canvasHeight = frame.height;
+                tsimg::downscale::fitWithin(canvasWidth, canvasHeight, maxDimension);
+            }
+            Retained slot;
+            slot.frame = keepFullSize ? std::move(frame) : toCanvas(frame);
+            slot.spiceRead = !keepFullSize;
+            frame = tsimg::raw::Frame();
+            const size_t bytes = slot.frame.rgba->size();
+            if (limit > 0 && (retained + bytes > limit || !tsimg::memory::tryAdmit(bytes, slot.admission))) {
+                throw std::runtime_error("Raw frames exceed half of --memory-budget after " + std::to_string(frames.size()) +
+                                         " frames; raise the budget" + (keepFullSize ? "" : " or lower --gif-max-size"));
+            }
+            retained += bytes;
+            frames.push_back(std::move(slot));
+            names.push_back(tsimg::raw::frameName(names.size()));
+        }
+        if (frames.empty()) {
+            throw std::runtime_error("No raw frames received");
+        }
+        tsimg::utils::debugLog(debug, "Holding " + std::to_string(frames.size()) + " raw frames (" + std::to_string(retained >> 20) +
+                               " MB) " + (keepFullSize ? "at full size" : "at GIF size"));
+    }
+
+    // Leitura do GIF; o quadro 0 é lido duas vezes (dimensões e pixels)
+    bool gifFrame(size_t index, int& width, int& height, std::shared_ptr<const std::vector<uint8_t>>& rgba) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (index >= frames.size() || !frames[index].frame.rgba) return false;
+        Retained& slot = frames[index];
+        width = slot.frame.width;
+        height = slot.frame.height;
+        rgba = slot.frame.rgba;
+        ++slot.gifReads;
+        if (slot.spiceRead && gifDone(slot, index)) {
+            drop(slot);
+        }
+        return true;
+    }
+
+    // Leitura do SPICE, na ordem dos quadros
+    bool spiceFrame(size_t index, tsimg::raw::Frame& frame) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (index >= frames.size() || !frames[index].frame.rgba) return false;
+            Retained& slot = frames[index];
+            frame = slot.frame;
+            slot.spiceRead = true;
+            if (gifDone(slot, index)) {
+                drop(slot);
+                return true;
+            }
+            if (frame.width == canvasWidth && frame.height == canvasHeight) return true;
+        }
+        // O GIF ainda não leu: fica só a versão reduzida, sem segurar o GIF durante a redução
+        tsimg::raw::Frame reduced = toCanvas(frame);
+        std::lock_guard<std::mutex> lock(mutex);
+        Retained& slot = frames[index];
+        if (slot.frame.rgba == frame.rgba) {
+            slot.frame = std::move(reduced);
+        }
+        return true;
+    }
+
+private:
+    struct Retained {
+        tsimg::raw::Frame frame;
+        tsimg::memory::Admission admission;
+        unsigned gifReads = 0;
+        bool spiceRead = false;
+    };
+
+    // Pixels reduzidos e a contagem de memória no mesmo bloco, como os quadros da fonte
+    struct HeldPixels {
+        std::vector<uint8_t> rgba;
+        tsimg::memory::Charge charge;
+    };
+
+    static bool gifDone(const Retained& slot, size_t index) { return slot.gifReads >= (index == 0 ? 2u : 1u); }
+
+    static void drop(Retained& slot) {
+        slot.frame.rgba.reset();
+        slot.admission.release();
+    }
+
+    tsimg::raw::Frame toCanvas(const tsimg::raw::Frame& frame) const {
+        if (frame.width == canvasWidth && frame.height == canvasHeight) return frame;
+        auto held = std::make_shared<HeldPixels>();
+        tsimg::downscale::resizeRgba(frame.rgba->data(), frame.width, frame.height, canvasWidth, canvasHeight, held->rgba);
+        held->charge = tsimg::memory::Charge(tsimg::memory::Stage::Ingest, held->rgba.size());
+        tsimg::raw::Frame reduced;
+        reduced.width = canvasWidth;
+        reduced.height = canvasHeight;
+        reduced.rgba = std::shared_ptr<const std::vector<uint8_t>>(held, &held->rgba);
+        return reduced;
+    }
+
+    std::vector<Retained> frames;
+    int canvasWidth = 0;
+    int canvasHeight = 0;
+    std::mutex mutex;
+};
+
+// Lê a série crua para o GIF e liga o GIF a ela; com SPICE junto, os dois leem da mesma série
+std::shared_ptr<RawSeries> readRawSeries(const tsimg::raw::FrameSource& source, std::vector<std::string>& names,
+                                         GifOptions& gif_options, bool keepFullSize, bool debug) {
+    auto series = std::make_shared<RawSeries>(source, gif_options.maxDimension, keepFullSize, names, debug);
+    gif_options.framePixels = [series](size_t index, int& width, int& height, std::shared_ptr<const std::vector<uint8_t>>& rgba) {
+        return series->gifFrame(index, width, height, rgba);
+    };
+    return series;
+}
+
+// Quadros crus para o SPICE: da série já lida, quando existe, ou direto da fonte, sob demanda
+tsimg::pipeline::PixelSource rawPixelSource(tsimg::raw::FrameSource source, std::shared_ptr<RawSeries> series) {
+    auto next = std::make_shared<size_t>(0);
+    return [source, series, next](tsimg::pipeline::PixelFrame& pixels) {
+        tsimg::raw::Frame frame;
+        if (series) {
+            if (!series->spiceFrame(*next, frame)) return false;
+        } else if (!source(frame)) {
+            return false;
+        }
+        pixels.name = tsimg::raw::frameName((*next)++);
+        pixels.width = frame.width;
+        pixels.height = frame.height;
+        pixels.rgba = std::move(frame.rgba);
+        return true;
+    };
+}
+
+std::vector<std::string> readStdinPaths(bool debug) {
+    std::vector<std::string> paths;
+    auto source = stdinPathSource(debug);
+    std::string path;
+    while (source(path)) {
+        paths.push_back(path);
+    }
+    return paths;
+}
+
 std::string concatenateStrings(const std::vector<std::string>& vec) {
     std::ostringstream oss;
     for (const auto& str : vec) {
@@ -98,10 +303,17 @@ void display_info() {
     }
     std::cerr << "Usage: create_file -n <output_filename> -i <image1.jpg,image2.png,...> [-l <label1,label2,...>] [-f <format>] [-debug] [-config <config.json>]" << std::endl;
     std::cerr << "Options:" << std::endl;
-    std::cerr << "  -n <output_filename>    Specify the output filename." << std::endl;
-    std::cerr << "  -i <image_paths>        Comma-separated list of image paths." << std::endl;
+    std::cerr << "  -n <output_filename>    Specify the output filename ('-' streams to stdout)." << std::endl;
+    std::cerr << "  -i <image_paths>        Comma-separated list of image paths, directories or globs such as 'frames/*.png'" << std::endl;
+    std::cerr << "                          (natural/date order); '-' reads one path per line from stdin." << std::endl;
+    std::cerr << "  --raw-frames <source>   Read raw pixel frames instead of -i, with no PNG or file in between: '-' for stdin" << std::endl;
+    std::cerr << "                          (per frame \"TSRF\", then width, height and channels 1/3/4 as little-endian" << std::endl;
+    std::cerr << "                          uint32, then the pixels) or 'shm:<name>' for a POSIX shared-memory ring (spice, gif)." << std::endl;
     std::cerr << "  -l <labels>             Comma-separated list of labels (optional)." << std::endl;
-    std::cerr << "  -f <format>             Output format: 'spice' or 'gif' (default: 'spice')." << std::endl;
+    std::cerr << "  -f <formats>            Output format: 'spice', 'spicebin' (binary container) or 'gif' (default: 'spice')." << std::endl;
+    std::cerr << "                          A list such as 'spice,gif' reads the frames once and writes every format" << std::endl;
+    std::cerr << "                          concurrently, each named after <output_filename> with its own extension." << std::endl;
+    std::cerr << "  --loader <file.html>    With 'spicebin', also write a page that loads the container via HTTP Range." << std::endl;
     std::cerr << "  -debug                  Enable debug mode (optional)." << std::endl;
     std::cerr << "  --config <config.json>   Path to JSON config file (optional)." << std::endl;
     std::cerr << "  --labelbyname           Generate labels from image names (optional)." << std::endl;
@@ -110,6 +322,92 @@ void display_info() {
     std::cerr << "  -help_link <link>       Help link URL (optional)." << std::endl;
     std::cerr << "  -help_badge_url <url>   Help badge image URL (optional)." << std::endl;
     std::cerr << "  -template <template_path> Path to custom HTML template (optional)." << std::endl;
+    std::cerr << "  --gif-quality <level>   GIF palette quality: 'fast', 'balanced' or 'best' (default: 'balanced')." << std::endl;
+    std::cerr << "  --gif-dither            Apply ordered dithering to GIF frames." << std::endl;
+    std::cerr << "  --gif-max-size <px>     Longest side of the GIF; larger frames are downscaled (default: 4096, 0 = no limit)." << std::endl;
+    std::cerr << "  --frame-buffer-mb <mb>  Input rows held in memory while downscaling each frame (default: 256)." << std::endl;
+    std::cerr << "  --interpolate <n>       GIF: blend <n> intermediate frames between each pair of frames in memory;" << std::endl;
+    std::cerr << "                          each real frame keeps its display time (0 to 49, default: 0)." << std::endl;
+    std::cerr << "  --align <mode>          Co-register frames before encoding: 'translation' or 'scale' (translation plus" << std::endl;
+    std::cerr << "                          small zoom); frames are cropped to the area they all cover (spice, spicebin, gif)." << std::endl;
+    std::cerr << "  --align-reference <n>   Frame (1-based) the others are aligned to (default: 1)." << std::endl;
+    std::cerr << "  --roi <x,y,w,h>         Crop every frame to this box before encoding; only the cropped pixels are" << std::endl;
+    std::cerr << "                          embedded (after --align, in aligned coordinates). JSON: \"roi\" and" << std::endl;
+    std::cerr << "                          \"roi_frames\" (one box per frame)." << std::endl;
+    std::cerr << "  --normalize <mode>      Even out exposure across the series before encoding (spice, spicebin, gif):" << std::endl;
+    std::cerr << "                          'stretch' maps each frame's clipped luma range to the series median range," << std::endl;
+    std::cerr << "                          'match' matches each frame's histogram to the series mean (after --roi)." << std::endl;
+    std::cerr << "                          JSON: \"normalize\"." << std::endl;
+    std::cerr << "  --normalize-clip <pct>  Share of darkest and brightest pixels ignored by 'stretch' (default: 0.5)." << std::endl;
+    std::cerr << "                          JSON: \"normalize_clip\"." << std::endl;
+    std::cerr << "  --stats                 Embed per-frame mean, percentiles and histogram as a chart under the slider" << std::endl;
+    std::cerr << "                          (spice, spicebin). JSON: \"stats\": true or an object with the options below." << std::endl;
+    std::cerr << "  --stats-channel <name>  Channel measured: 'luma', 'red', 'green' or 'blue' (default: 'luma')." << std::endl;
+    std::cerr << "  --stats-bins <n>        Histogram bins, a divisor of 256 (default: 32)." << std::endl;
+    std::cerr << "  --stats-roi <x,y,w,h>   Measure only this box of each frame." << std::endl;
+    std::cerr << "  --stats-mask <image>    Measure only where this frame-sized mask is not black." << std::endl;
+    std::cerr << "  --atlas                 Pack frames into a few sprite sheets; the viewer draws each frame from its" << std::endl;
+    std::cerr << "                          offset (spice only; for long series of small frames). JSON: \"atlas\"." << std::endl;
+    std::cerr << "  --atlas-max-side <px>   Largest atlas sheet side (default: 4096)." << std::endl;
+    std::cerr << "  --optimize-png          Re-encode embedded PNG frames losslessly (palette, grayscale or RGB when the" << std::endl;
+    std::cerr << "                          pixels allow, per-row filters); kept only when smaller (spice). JSON: \"optimize_png\"." << std::endl;
+    std::cerr << "  --shard-mb <mb>         Split the SPICE output into linked pages of at most <mb> each, written in" << std::endl;
+    std::cerr << "                          parallel; the output file becomes an index of the pages (spice; not with" << std::endl;
+    std::cerr << "                          --stats, --atlas or --raw-frames). JSON: \"shard_mb\"." << std::endl;
+    std::cerr << "  --watch <directory>     Regenerate the output whenever frames in <directory> change (labels from file names)." << std::endl;
+    std::cerr << "  --debounce-ms <ms>      Quiet period before regenerating in watch mode (default: 500)." << std::endl;
+    std::cerr << "  --memory-budget <mb>    Admit frame reads, encodes and GIF/align/crop workers only while their estimated" << std::endl;
+    std::cerr << "                          live bytes fit in <mb> (default: no limit)." << std::endl;
+    std::cerr << "  --dry-run               Probe every frame header in parallel, without decoding, and print the exact HTML" << std::endl;
+    std::cerr << "                          size, estimated GIF size, peak memory and runtime per list and output; nothing" << std::endl;
+    std::cerr << "                          is written (also with -config)." << std::endl;
+    std::cerr << "  --estimate <file>       Dry run that also writes the estimate as JSON ('-' prints only the JSON)." << std::endl;
+    std::cerr << "  --memory-stats          Print bytes held per stage (ingest, encode, render, write, gif) and peak RSS at exit." << std::endl;
+    std::cerr << "  --memory-report <file>  Write the same memory report as JSON." << std::endl;
+    std::cerr << "\nServer mode: tsimg serve [--socket <path>] [--workers <n>] [--cache-mb <mb>] [--memory-budget <mb>] [--memory-stats] [-debug]" << std::endl;
+    std::cerr << "  Accepts one JSON job per line (same schema as --config) on a Unix domain socket." << std::endl;
+    std::cerr << "  Send {\"command\": \"stats\"} for queue depth, latency and cache counters." << std::endl;
+    std::cerr << "\nConversion: tsimg convert <input> <output> [-template <template>] [-debug]" << std::endl;
+    std::cerr << "  Binary .spice container to HTML, or tsimg-generated HTML to container (detected from <input>)." << std::endl;
+}
+
+// "spice,gif" -> {"spice", "gif"}; lança std::runtime_error para formatos desconhecidos ou repetidos
+std::vector<std::string> parseFormats(const std::vector<std::string>& names) {
+    std::vector<std::string> formats;
+    for (const auto& name : names) {
+        if (name != "spice" && name != "spicebin" && name != "gif") {
+            throw std::runtime_error("Unsupported format: " + name);
+        }
+        if (std::find(formats.begin(), formats.end(), name) != formats.end()) {
+            throw std::runtime_error("Format requested twice: " + name);
+        }
+        formats.push_back(name);
+    }
+    if (formats.empty()) {
+        throw std::runtime_error("No output format given");
+    }
+    return formats;
+}
+
+// "export_format" no JSON: "spice", "spice,gif" ou ["spice", "gif"]
+std::vector<std::string> formatsFromJson(const nlohmann::json& value) {
+    if (value.is_array()) {
+        return parseFormats(value.get<std::vector<std::string>>());
+    }
+    return parseFormats(split(value.get<std::string>(), ','));
+}
+
+bool hasFormat(const std::vector<std::string>& formats, const std::string& format) {
+    return std::find(formats.begin(), formats.end(), format) != formats.end();
+}
+
+// Com um só formato a saída é output_filename; com vários, cada formato troca a extensão
+std::string outputFileFor(const std::string& output_filename, const std::string& format, size_t formatCount) {
+    if (formatCount == 1) {
+        return output_filename;
+    }
+    const char* extension = format == "gif" ? ".gif" : format == "spicebin" ? ".spice" : ".html";
+    return std::filesystem::path(output_filename).replace_extension(extension).string();
 }
 
 bool validateJsonConfig(const nlohmann::json& config, bool debug) {
@@ -123,9 +421,10 @@ bool validateJsonConfig(const nlohmann::json& config, bool debug) {
     }
     
     // Validar formato de exportação
-    std::string format = config["export_format"];
-    if (format != "spice" && format != "gif") {
-        if (debug) std::cerr << "Error: Invalid export format in config: " << format << std::endl;
+    try {
+        formatsFromJson(config["export_format"]);
+    } catch (const std::exception& e) {
+        if (debug) std::cerr << "Error: Invalid export format in config: " << config["export_format"].dump() << std::endl;
         return false;
     }
     
@@ -139,21 +438,531 @@ bool validateJsonConfig(const nlohmann::json& config, bool debug) {
             return false;
         }
         
+        // Os caminhos (arquivos, diretórios ou globs) são expandidos e validados em paralelo no runJsonJob
         for (const auto& img : config[key]) {
             if (!img.is_string()) {
                 if (debug) std::cerr << "Error: Image path must be a string" << std::endl;
                 return false;
             }
-            // Usar a função do namespace
-            if (!tsimg::utils::ImageValidator::validateImagePath(img, debug)) {
-                return false;
-            }
         }
     }
     
     return true;
 }
 
+// Grava o contêiner binário e, se pedido, a página que o lê por HTTP Range (com a URL do
+// contêiner relativa à página)
+void writeContainerOutput(const SPICEBuilder& builder, const std::string& output_filename, const std::string& loader_file, bool debug) {
+    if (!loader_file.empty() && output_filename == STDIO_PATH) {
+        throw std::runtime_error("The Range loader needs a container file, not stdout");
+    }
+    tsimg::container::write(output_filename, tsimg::container::fromBuilder(builder), debug);
+    if (!loader_file.empty()) {
+        std::error_code ec;
+        auto loaderDir = std::filesystem::absolute(loader_file).parent_path();
+        auto relative = std::filesystem::relative(std::filesystem::absolute(output_filename), loaderDir, ec);
+        std::string url = ec || relative.empty() ? std::filesystem::path(output_filename).filename().generic_string() : relative.generic_string();
+        tsimg::container::writeLoader(loader_file, url, builder.getTitle(), debug);
+    }
+}
+
+// Janela de quadros lidos pelo SPICE que ficam à espera do GIF na mesma execução
+const size_t SHARED_FRAME_BYTES = size_t(256) << 20;
+
+// Grava todas as saídas pedidas ao mesmo tempo. Com SPICE e GIF juntos, os bytes que o leitor do
+// SPICE já trouxe do disco seguem para o GIF em vez de o arquivo ser lido de novo; o que não
+// couber na janela é relido. builder só é usado pelos formatos SPICE. Lança em caso de falha.
+// shard_bytes > 0 divide o SPICE em páginas ligadas (TemplateWriter::streamShards)
+void writeOutputs(const std::vector<std::string>& formats, const std::string& output_filename, const SPICEBuilder* builder,
+                  const std::vector<std::string>& gif_paths, GifOptions gif_options, const std::string& loader_file,
+                  uintmax_t shard_bytes, bool debug) {
+    if (formats.size() > 1 && output_filename == STDIO_PATH) {
+        throw std::runtime_error("Several output formats need an output file, not stdout");
+    }
+    // Com atlas o SPICE lê as folhas, não os quadros que o GIF espera; quadros crus já estão em memória
+    std::unique_ptr<tsimg::pipeline::SharedFrames> shared;
+    if (hasFormat(formats, "gif") && hasFormat(formats, "spice") && builder->getAtlasFrameCounts().empty() && !gif_options.framePixels) {
+        shared = std::make_unique<tsimg::pipeline::SharedFrames>(gif_paths, SHARED_FRAME_BYTES);
+        gif_options.frameBytes = [&shared](size_t index) { return shared->take(index); };
+    }
+
+    std::vector<std::future<void>> writers;
+    for (const auto& format : formats) {
+        std::string file = outputFileFor(output_filename, format, formats.size());
+        auto write = [&, format, file]() {
+            if (format == "gif") {
+                if (!createGif(file, gif_paths, debug, gif_options)) {
+                    throw std::runtime_error("Failed to create GIF file: " + file);
+                }
+            } else if (format == "spicebin") {
+                writeContainerOutput(*builder, file, loader_file, debug);
+            } else {
+                // Fechar a janela no fim (ou na falha) libera o GIF para ler o que faltou
+                try {
+                    TemplateWriter writer(builder->getTemplatePath(), debug);
+                    tsimg::pipeline::RawFrameObserver observer;
+                    if (shared) {
+                        observer = [&shared](const std::string& path, std::shared_ptr<const std::vector<unsigned char>> data) {
+                            shared->deposit(path, std::move(data));
+                        };
+                    }
+                    if (shard_bytes > 0) {
+                        writer.streamShards(file, *builder, shard_bytes, observer);
+                    } else {
+                        writer.streamToFile(file, *builder, observer);
+                    }
+                } catch (...) {
+                    if (shared) shared->close();
+                    throw;
+                }
+                if (shared) shared->close();
+            }
+        };
+        if (formats.size() == 1) {
+            write();
+        } else {
+            writers.push_back(std::async(std::launch::async, write));
+        }
+    }
+
+    // Espera todas as saídas antes de relançar a primeira falha
+    std::exception_ptr failure;
+    for (auto& writer : writers) {
+        try {
+            writer.get();
+        } catch (...) {
+            if (!failure) failure = std::current_exception();
+        }
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+// Argumento numérico de uma opção da linha de comando. O texto inteiro precisa ser um número ("12mb"
+// e "" são recusados) e o valor precisa caber em [minimum, maximum]; nada é truncado nem dá a volta,
+// como o "-1" que o std::stoul transformaria num size_t gigante.
+template <typename T>
+T parseNumber(const char* flag, const std::string& text, T minimum = std::numeric_limits<T>::lowest(), T maximum = std::numeric_limits<T>::max()) {
+    static_assert(std::is_arithmetic_v<T> && sizeof(T) <= sizeof(long long), "parseNumber needs a built-in number type");
+    size_t parsed = 0;
+    T value{};
+    bool inRange = false;
+    try {
+        if constexpr (std::is_floating_point_v<T>) {
+            double number = std::stod(text, &parsed);
+            if (!std::isfinite(number)) parsed = 0;  // "nan" e "inf" não são medidas
+            inRange = number >= minimum && number <= maximum;
+            value = static_cast<T>(number);
+        } else {
+            long long number = std::stoll(text, &parsed);
+            if constexpr (std::is_signed_v<T>) {
+                inRange = number >= minimum && number <= maximum;
+            } else {
+                inRange = number >= 0 && static_cast<unsigned long long>(number) >= minimum && static_cast<unsigned long long>(number) <= maximum;
+            }
+            value = static_cast<T>(number);
+        }
+    } catch (const std::out_of_range&) {
+        parsed = text.size();  // número válido, mas grande demais para o tipo
+    } catch (const std::exception&) {
+        parsed = 0;
+    }
+    if (parsed == 0 || parsed != text.size()) {
+        throw std::runtime_error(std::string(flag) + (std::is_floating_point_v<T> ? " expects a number" : " expects an integer") + ", got \"" + text + "\"");
+    }
+    if (!inRange) {
+        std::ostringstream range;
+        if (minimum == std::numeric_limits<T>::lowest() && maximum == std::numeric_limits<T>::max()) {
+            range << "a representable number";
+        } else if (maximum == std::numeric_limits<T>::max()) {
+            range << "at least " << +minimum;
+        } else {
+            range << "between " << +minimum << " and " << +maximum;
+        }
+        throw std::runtime_error(std::string(flag) + " must be " + range.str() + ", got " + text);
+    }
+    return value;
+}
+
+// Maior quantidade de megabytes que ainda cabe num size_t depois do << 20
+constexpr size_t kMaxMegabytes = std::numeric_limits<size_t>::max() >> 20;
+
+// Teto de "serve --workers" (0 = um por núcleo); cada worker é uma thread com seus próprios buffers
+constexpr size_t kMaxServeWorkers = 1024;
+
+// Tamanho de página de --shard-mb / "shard_mb": megabytes positivos, fracionários inclusive
+uintmax_t shardBytes(double mb) {
+    constexpr double kMaxMb = 1 << 30;
+    if (!(mb > 0.0) || mb > kMaxMb) {
+        throw std::runtime_error("Shard size must be a positive number of megabytes, got " + std::to_string(mb));
+    }
+    return std::max<uintmax_t>(1, static_cast<uintmax_t>(mb * 1048576.0));
+}
+
+uintmax_t shardBytes(const std::string& text) {
+    return shardBytes(parseNumber<double>("--shard-mb", text));
+}
+
+// --interpolate / "interpolate": cada saída precisa de ao menos 2 cs dentro do tempo do quadro real
+int interpolateCount(int count) {
+    if (count < 0 || count > kGifMaxInterpolate) {
+        throw std::runtime_error("--interpolate must be between 0 and " + std::to_string(kGifMaxInterpolate) + " (each blended frame needs at least 2 cs of the " +
+                                 std::to_string(kGifFrameDelay) + " cs frame delay), got " + std::to_string(count));
+    }
+    return count;
+}
+
+// --normalize-clip / "normalize_clip": percentual ignorado em cada ponta do histograma; com 50 ou
+// mais as duas pontas se cruzam e não sobra faixa para esticar
+double clipPercent(double percent) {
+    if (!(percent >= 0.0 && percent < 50.0)) {
+        std::ostringstream message;
+        message << "--normalize-clip must be at least 0 and below 50 percent, got " << percent;
+        throw std::runtime_error(message.str());
+    }
+    return percent;
+}
+
+// As páginas repartem os quadros e os rótulos; o gráfico de estatísticas e os deslocamentos do
+// atlas valem para a série inteira. Só o HTML do SPICE é paginado.
+void checkSharding(uintmax_t shard_bytes, const std::vector<std::string>& formats, bool stats, bool atlas) {
+    if (shard_bytes > 0 && (stats || atlas)) {
+        throw std::runtime_error("--shard-mb cannot be combined with --stats or --atlas");
+    }
+    if (shard_bytes > 0 && !hasFormat(formats, "spice")) {
+        throw std::runtime_error("--shard-mb only splits the 'spice' output; it cannot be used without -f spice");
+    }
+}
+
+// Aplica o alinhamento, o recorte da região de interesse e a normalização, quando ligados, e
+// devolve as entradas dos quadros derivados; as séries guardadas em derived precisam sobreviver
+// até o fim da escrita
+std::vector<tsimg::inputs::ImageInput> deriveInputs(const std::vector<tsimg::inputs::ImageInput>& inputs, tsimg::align::Options align,
+                                                    tsimg::roi::Options roi, tsimg::normalize::Options normalize,
+                                                    std::vector<tsimg::inputs::TemporaryFrames>& derived, bool debug) {
+    if (align.mode != tsimg::align::Mode::Off && align.reference >= inputs.size()) {
+        throw std::runtime_error("Alignment reference must be a frame between 1 and " + std::to_string(inputs.size()) + ", got " +
+                                 std::to_string(align.reference + 1));
+    }
+    bool aligning = align.mode != tsimg::align::Mode::Off && inputs.size() > 1;
+    if (!aligning && !roi.enabled() && !normalize.enabled()) {
+        return inputs;
+    }
+    std::vector<std::string> paths = tsimg::inputs::pathsOf(inputs);
+    if (aligning) {
+        align.debug = debug;
+        derived.push_back(tsimg::align::alignSeries(paths, align));
+        paths = derived.back().paths;
+    }
+    if (roi.enabled()) {
+        roi.debug = debug;
+        derived.push_back(tsimg::roi::cropSeries(paths, roi));
+        paths = derived.back().paths;
+    }
+    // Depois do recorte: o alvo da série sai só dos pixels que vão para a saída
+    if (normalize.enabled()) {
+        normalize.debug = debug;
+        derived.push_back(tsimg::normalize::normalizeSeries(paths, normalize));
+        paths = derived.back().paths;
+    }
+    return tsimg::inputs::collectInputs(paths, debug);
+}
+
+// Caixa no JSON: "x,y,largura,altura" ou [x, y, largura, altura]
+tsimg::roi::Box boxFromJson(const nlohmann::json& value) {
+    if (value.is_string()) {
+        return tsimg::roi::parseBox(value.get<std::string>());
+    }
+    if (!value.is_array() || value.size() != 4) {
+        throw std::runtime_error("Invalid region of interest in JSON config: " + value.dump());
+    }
+    return tsimg::roi::parseBox(std::to_string(value[0].get<int>()) + "," + std::to_string(value[1].get<int>()) + "," +
+                                std::to_string(value[2].get<int>()) + "," + std::to_string(value[3].get<int>()));
+}
+
+// "stats" no JSON: true ou {"channel": "luma", "bins": 32, "roi": ..., "mask": "mask.png"}
+tsimg::stats::Options statsFromJson(const nlohmann::json& config) {
+    tsimg::stats::Options stats;
+    if (!config.contains("stats")) {
+        return stats;
+    }
+    const auto& value = config["stats"];
+    if (value.is_boolean()) {
+        stats.enabled = value.get<bool>();
+        return stats;
+    }
+    if (!value.is_object()) {
+        throw std::runtime_error("Invalid statistics options in JSON config: " + value.dump());
+    }
+    stats.enabled = value.value("enabled", true);
+    stats.channel = tsimg::stats::parseChannel(value.value("channel", "luma"));
+    stats.bins = value.value("bins", stats.bins);
+    if (value.contains("roi")) {
+        stats.box = boxFromJson(value["roi"]);
+    }
+    stats.maskPath = value.value("mask", "");
+    return stats;
+}
+
+// Mede os quadros da lista principal (já alinhados/recortados) e embute o resultado em
+// <SPICE_STATS>, de onde o template desenha o gráfico sob o slider
+void addFrameStats(SPICEBuilder& builder, tsimg::stats::Options stats, bool debug) {
+    const auto& lists = builder.getImagePaths();
+    auto mainList = lists.find("SPICE_IMAGES");
+    if (!stats.enabled || mainList == lists.end() || mainList->second.empty()) {
+        return;
+    }
+    stats.debug = debug;
+    builder.addContent("SPICE_STATS", tsimg::stats::toJson(tsimg::stats::compute(mainList->second, stats), stats).dump());
+}
+
+// "atlas" no JSON: true ou {"max_side": 4096}
+tsimg::atlas::Options atlasFromJson(const nlohmann::json& config) {
+    tsimg::atlas::Options atlas;
+    if (!config.contains("atlas")) {
+        return atlas;
+    }
+    const auto& value = config["atlas"];
+    if (value.is_boolean()) {
+        atlas.enabled = value.get<bool>();
+        return atlas;
+    }
+    if (!value.is_object()) {
+        throw std::runtime_error("Invalid atlas options in JSON config: " + value.dump());
+    }
+    atlas.enabled = value.value("enabled", true);
+    atlas.maxSheetSide = value.value("max_side", atlas.maxSheetSide);
+    if (atlas.maxSheetSide <= 0) {
+        throw std::runtime_error("\"max_side\" of the atlas must be a positive number of pixels, got " + std::to_string(atlas.maxSheetSide));
+    }
+    return atlas;
+}
+
+// Empacota cada lista do builder em folhas de atlas e embute as posições em <SPICE_ATLAS>; as
+// folhas ficam em derived até o fim da escrita. Vem depois dos rótulos e das estatísticas, que
+// precisam dos quadros individuais.
+void applyAtlas(SPICEBuilder& builder, const std::vector<std::string>& formats, tsimg::atlas::Options atlas,
+                std::vector<tsimg::inputs::TemporaryFrames>& derived, bool debug) {
+    if (!atlas.enabled) {
+        return;
+    }
+    if (hasFormat(formats, "spicebin")) {
+        throw std::runtime_error("Atlas packing is only supported with the 'spice' format");
+    }
+    atlas.debug = debug;
+    nlohmann::json offsets = nlohmann::json::object();
+    auto lists = builder.getImagePaths();
+    for (const auto& [tag, paths] : lists) {
+        if (paths.empty()) continue;
+        auto packed = tsimg::atlas::pack(paths, atlas);
+        builder.setAtlasSheets(tag, packed.sheets.paths, paths.size());
+        offsets[tag] = tsimg::atlas::toJson(packed.frames);
+        derived.push_back(std::move(packed.sheets));
+    }
+    builder.addContent("SPICE_ATLAS", offsets.dump());
+}
+
+// Reotimiza sem perdas os PNG lidos pelo streaming do SPICE (tsimg::png); o que não encolhe ou não
+// é PNG segue como estava. Também alcança as folhas de atlas, gravadas pelo stbi_write_png.
+void applyPngOptimization(SPICEBuilder& builder, bool enabled, bool debug) {
+    if (!enabled) {
+        return;
+    }
+    tsimg::png::Options options;
+    options.debug = debug;
+    builder.setFrameTransform([options](const std::string& path, std::vector<unsigned char>& data) {
+        tsimg::png::Result result;
+        if (tsimg::png::optimize(data, options, &result)) {
+            tsimg::utils::debugLog(options.debug, "Optimized " + path + " as " + tsimg::png::layoutName(result.layout) + ": " +
+                                   std::to_string(result.before) + " -> " + std::to_string(result.after) + " bytes");
+        }
+    });
+}
+
+// --dry-run e --estimate: nada é decodificado nem gravado. O relatório vai para o stdout e, com
+// --estimate, também em JSON para reportFile ("-" troca o relatório pelo JSON no stdout).
+struct DryRun {
+    bool enabled = false;
+    std::string reportFile;
+};
+
+// Etapas ligadas que o ensaio não executa; as estimativas usam os quadros de origem
+std::vector<std::string> dryRunSkipped(const tsimg::align::Options& align, const tsimg::roi::Options& roi, const tsimg::normalize::Options& normalize,
+                                       bool stats, bool atlas, bool optimizePng) {
+    std::vector<std::string> skipped;
+    if (align.mode != tsimg::align::Mode::Off) skipped.push_back("--align");
+    if (roi.enabled()) skipped.push_back("--roi");
+    if (normalize.enabled()) skipped.push_back("--normalize");
+    if (stats) skipped.push_back("--stats");
+    if (atlas) skipped.push_back("--atlas");
+    if (optimizePng) skipped.push_back("--optimize-png");
+    return skipped;
+}
+
+void reportEstimate(const std::vector<std::string>& formats, const std::string& output_filename, const SPICEBuilder* builder,
+                    const std::vector<std::string>& gif_paths, const GifOptions& gif_options, const std::vector<std::string>& skipped,
+                    uintmax_t shard_bytes, const DryRun& dry_run, bool debug) {
+    tsimg::estimate::Options options;
+    options.formats = formats;
+    options.shardBytes = shard_bytes;
+    for (const auto& format : formats) {
+        options.files.push_back(outputFileFor(output_filename, format, formats.size()));
+    }
+    options.gif = gif_options;
+    options.sharedFrameBytes = SHARED_FRAME_BYTES;
+    options.debug = debug;
+    auto estimate = tsimg::estimate::run(builder, gif_paths, options);
+    for (const auto& step : skipped) {
+        estimate.notes.push_back(step + " is not run in a dry run; sizes are those of the source frames");
+    }
+
+    if (dry_run.reportFile == STDIO_PATH) {
+        std::cout << tsimg::estimate::toJson(estimate).dump(2) << std::endl;
+        return;
+    }
+    tsimg::estimate::print(estimate, std::cout);
+    if (!dry_run.reportFile.empty()) {
+        std::ofstream file(dry_run.reportFile);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not write estimate: " + dry_run.reportFile);
+        }
+        file << tsimg::estimate::toJson(estimate).dump(2) << std::endl;
+    }
+}
+
+// Executa um job descrito no esquema do arquivo de configuração JSON (usado pelo -config e pelo
+// modo servidor). Lança exceção em caso de falha e devolve o arquivo gerado (vazio num ensaio).
+std::string runJsonJob(const nlohmann::json& config, bool debug, bool createLabelsFromImages, const DryRun& dry_run = {}) {
+    if (!validateJsonConfig(config, debug)) {
+        throw std::runtime_error("Invalid JSON configuration file");
+    }
+
+    std::vector<std::string> formats = formatsFromJson(config["export_format"]);
+    std::string output_filename = config.value("output_filename", "output.html");
+    std::vector<std::string> labels = config.value("labels", std::vector<std::string>{});
+    std::string title = config.value("title", DEFAULT_TITLE);  // Usar título padrão
+    std::string main_text = config.value("main_text", "This is generated from a JSON config.");
+
+    std::string job_help_text = config.value("help_text", "");
+    std::string job_help_link = config.value("help_link", "");
+    std::string job_help_badge_url = config.value("help_badge_url", "");
+    std::string author_image = config.value("author_image", "");
+    std::string template_file = config.value("template", "");
+
+    std::map<std::string, std::vector<tsimg::inputs::ImageInput>> imageLists;
+    for (int i = 0; ; ++i) {
+        std::string key = "images" + (i == 0 ? "" : "_" + std::to_string(i));
+        if (!config.contains(key)) {
+            break;
+        }
+        std::string placeholder = "SPICE_IMAGES" + (i == 0 ? "" : "_" + std::to_string(i));
+        std::vector<std::string> specs;
+        for (const auto& img : config[key]) {
+            if (debug) std::cout << "Processing image: " << img << std::endl;
+            specs.push_back(img.get<std::string>());
+        }
+        imageLists[placeholder] = tsimg::inputs::collectInputs(specs, debug);
+    }
+
+    tsimg::align::Options align_options;
+    align_options.mode = tsimg::align::parseMode(config.value("align", "off"));
+    int alignReference = config.value("align_reference", 1);
+    if (alignReference < 1) {
+        throw std::runtime_error("\"align_reference\" must be a 1-based frame number, got " + std::to_string(alignReference));
+    }
+    align_options.reference = static_cast<size_t>(alignReference - 1);
+    tsimg::roi::Options roi_options;
+    if (config.contains("roi")) {
+        roi_options.box = boxFromJson(config["roi"]);
+    }
+    for (const auto& box : config.value("roi_frames", nlohmann::json::array())) {
+        roi_options.frameBoxes.push_back(boxFromJson(box));
+    }
+    tsimg::normalize::Options normalize_options;
+    normalize_options.mode = tsimg::normalize::parseMode(config.value("normalize", "off"));
+    normalize_options.clipPercent = clipPercent(config.value("normalize_clip", normalize_options.clipPercent));
+    std::vector<tsimg::inputs::TemporaryFrames> derived;
+
+    std::unique_ptr<SPICEBuilder> builder;
+    if (hasFormat(formats, "spice") || hasFormat(formats, "spicebin")) {
+        builder = std::make_unique<SPICEBuilder>(title, debug);
+        builder->addTitle(title);  // Consistência no uso do título
+        builder->addContent("SPICE_TEXT", main_text);
+        for (const auto& [tag, inputs] : imageLists) {
+            builder->addImageInputs(tag, dry_run.enabled ? inputs : deriveInputs(inputs, align_options, roi_options, normalize_options, derived, debug));
+        }
+        if (createLabelsFromImages) {
+            // Com quadros derivados, os nomes vêm dos arquivos originais e não dos temporários
+            auto mainList = imageLists.begin();
+            if (derived.empty() || mainList == imageLists.end()) {
+                builder->generateLabelsFromImages();
+            } else {
+                builder->addLabels(tsimg::inputs::pathsOf(mainList->second));
+            }
+        }
+        builder->addLabels(labels);
+        if (!job_help_text.empty() && !job_help_link.empty() && !job_help_badge_url.empty()) {
+            builder->setHelp(job_help_text, job_help_link, job_help_badge_url);
+        }
+        if (!author_image.empty()) {
+            builder->setAuthorImage(author_image);
+        }
+        if (!template_file.empty()) {
+            builder->setTemplate(template_file);
+        }
+        if (!dry_run.enabled) {
+            addFrameStats(*builder, statsFromJson(config), debug);
+        }
+    }
+
+    // O GIF usa a lista principal; com SPICE junto, reaproveita os quadros já derivados
+    std::vector<std::string> gif_paths;
+    GifOptions gif_options;
+    if (hasFormat(formats, "gif")) {
+        auto mainList = imageLists.find("SPICE_IMAGES");
+        if (builder) {
+            const auto& built = builder->getImagePaths();
+            auto it = built.find("SPICE_IMAGES");
+            if (it != built.end()) gif_paths = it->second;
+        } else if (mainList != imageLists.end()) {
+            gif_paths = tsimg::inputs::pathsOf(dry_run.enabled ? mainList->second : deriveInputs(mainList->second, align_options, roi_options, normalize_options, derived, debug));
+        }
+        gif_options.quantize.quality = tsimg::quantize::parseQuality(config.value("gif_quality", "balanced"));
+        gif_options.quantize.dither = config.value("gif_dither", false);
+        gif_options.maxDimension = config.value("gif_max_size", gif_options.maxDimension);
+        if (gif_options.maxDimension <= 0) {
+            throw std::runtime_error("\"gif_max_size\" must be a positive number of pixels, got " + std::to_string(gif_options.maxDimension));
+        }
+        long long frameBufferMb = config.value("frame_buffer_mb", 256LL);
+        if (frameBufferMb <= 0 || static_cast<unsigned long long>(frameBufferMb) > kMaxMegabytes) {
+            throw std::runtime_error("\"frame_buffer_mb\" must be a positive number of megabytes, got " + std::to_string(frameBufferMb));
+        }
+        gif_options.frameBufferBytes = static_cast<size_t>(frameBufferMb) << 20;
+        gif_options.interpolate = interpolateCount(config.value("interpolate", 0));
+    }
+    uintmax_t shard_bytes = 0;
+    if (config.contains("shard_mb")) {
+        if (!config["shard_mb"].is_number()) {
+            throw std::runtime_error("\"shard_mb\" must be a positive number of megabytes");
+        }
+        shard_bytes = shardBytes(config["shard_mb"].get<double>());
+    }
+    checkSharding(shard_bytes, formats, statsFromJson(config).enabled, atlasFromJson(config).enabled);
+    if (dry_run.enabled) {
+        auto skipped = dryRunSkipped(align_options, roi_options, normalize_options, statsFromJson(config).enabled, atlasFromJson(config).enabled,
+                                     config.value("optimize_png", false));
+        reportEstimate(formats, output_filename, builder.get(), gif_paths, gif_options, skipped, shard_bytes, dry_run, debug);
+        return "";
+    }
+    if (builder) {
+        applyAtlas(*builder, formats, atlasFromJson(config), derived, debug);
+        applyPngOptimization(*builder, config.value("optimize_png", false), debug);
+    }
+    writeOutputs(formats, output_filename, builder.get(), gif_paths, gif_options, config.value("loader", ""), shard_bytes, debug);
+    return outputFileFor(output_filename, formats.front(), formats.size());
+}
+
 int main(int argc, char* argv[]) {
     if (argc == 1) {
         // Modo Interativo
@@ -204,13 +1013,15 @@ int main(int argc, char* argv[]) {
 
         // Processamento dos dados de entrada
         try {
+            auto image_inputs = tsimg::inputs::collectInputs(image_paths, debug);
+            image_paths = tsimg::inputs::pathsOf(image_inputs);
             if (format == "spice") {
                 SPICEBuilder builder(title, debug);
                 builder.addTitle(title);  // Usar o mesmo título
-                builder.addImagesAsync(image_paths);  // Usar a versão assíncrona
+                builder.addImageInputs("SPICE_IMAGES", image_inputs);  // Lidas e codificadas durante a escrita
                 builder.addLabels(labels);
                 TemplateWriter writer("template_vs.html", debug);
-                writer.writeToFile(output_filename, builder.getContents(), builder.getImageLists(), builder.getLabels(), builder.getAuthorImageBase64());
+                writer.streamToFile(output_filename, builder);
                 std::cout << "Arquivo SPICE gerado com sucesso: " << output_filename << std::endl;
             } else if (format == "gif") {
                 if (createGif(output_filename, image_paths, debug)) {
@@ -229,17 +1040,98 @@ int main(int argc, char* argv[]) {
 
         return 0;
     }
+    if (std::strcmp(argv[1], "convert") == 0) {
+        std::vector<std::string> files;
+        std::string convert_template;
+        bool convert_debug = false;
+        for (int i = 2; i < argc; ++i) {
+            if (std::strcmp(argv[i], "-template") == 0 && i + 1 < argc) {
+                convert_template = argv[++i];
+            } else if (std::strcmp(argv[i], "-debug") == 0) {
+                convert_debug = true;
+            } else {
+                files.push_back(argv[i]);
+            }
+        }
+        if (files.size() != 2) {
+            std::cerr << "Usage: tsimg convert <input> <output> [-template <template>] [-debug]" << std::endl;
+            return 1;
+        }
+        if (files[1] == STDIO_PATH) {
+            tsimg::utils::FileHandler::reserveStdout();
+        }
+        try {
+            tsimg::container::convert(files[0], files[1], convert_template, convert_debug);
+        } catch (const std::exception& e) {
+            std::cerr << "Error while converting " << files[0] << ": " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (std::strcmp(argv[1], "serve") == 0) {
+        tsimg::serve::ServeOptions serveOptions;
+        for (int i = 2; i < argc; ++i) {
+            if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+                serveOptions.socketPath = argv[++i];
+            } else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+                try {
+                    serveOptions.workers = parseNumber<size_t>("--workers", argv[++i], 0, kMaxServeWorkers);
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << std::endl;
+                    return 1;
+                }
+            } else if (std::strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc) {
+                try {
+                    serveOptions.frameCacheBytes = parseNumber<size_t>("--cache-mb", argv[++i], 0, kMaxMegabytes) << 20;
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << std::endl;
+                    return 1;
+                }
+            } else if (std::strcmp(argv[i], "-debug") == 0) {
+                serveOptions.debug = true;
+            } else if (std::strcmp(argv[i], "--memory-budget") == 0 && i + 1 < argc) {
+                try {
+                    tsimg::memory::setBudget(parseNumber<size_t>("--memory-budget", argv[++i], 0, kMaxMegabytes) << 20);
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << std::endl;
+                    return 1;
+                }
+            } else if (std::strcmp(argv[i], "--memory-stats") == 0) {
+                tsimg::memory::setEnabled(true);  // exposto no comando "stats"
+            }
+        }
+        bool serveDebug = serveOptions.debug;
+        return tsimg::serve::runServer(serveOptions, [serveDebug](const nlohmann::json& job) {
+            return runJsonJob(job, serveDebug, job.value("labelbyname", false));
+        });
+    }
+
     std::string output_filename;
     std::vector<std::string> image_paths;
     std::vector<std::string> labels;
     bool debug = false;
     bool createLabelsFromImages = false;
     std::string format = "spice";
+    std::vector<std::string> formats;
     std::string json_config_file;
     std::string author_image_path;
     std::string template_path;
+    std::string loader_file;
 
     std::vector<std::vector<std::string>> imagePathsExtras;
+    tsimg::watch::WatchOptions watchOptions;
+    bool memory_stats = false;
+    std::string memory_report_file;
+    GifOptions gif_options;
+    tsimg::align::Options align_options;
+    tsimg::roi::Options roi_options;
+    tsimg::normalize::Options normalize_options;
+    tsimg::stats::Options stats_options;
+    tsimg::atlas::Options atlas_options;
+    bool optimize_png = false;
+    uintmax_t shard_bytes = 0;
+    std::string raw_frames_source;
+    DryRun dry_run;
 
     for (int i = 1; i < argc; ++i) {
         if (std::strcmp(argv[i], "-info") == 0) {
@@ -275,140 +1167,335 @@ int main(int argc, char* argv[]) {
             imagePathsExtras.push_back(split(argv[++i], ','));
         } else if (std::strcmp(argv[i], "-template") == 0 && i + 1 < argc) {
             template_path = argv[++i];
-        }
-    }
-
-    if (!json_config_file.empty()) {
-        try {
-            nlohmann::json config = read_json_file(json_config_file, debug);
-            
-            if (!validateJsonConfig(config, debug)) {
-                std::cerr << "Invalid JSON configuration file" << std::endl;
+        } else if (std::strcmp(argv[i], "--loader") == 0 && i + 1 < argc) {
+            loader_file = argv[++i];
+        } else if (std::strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+            watchOptions.directory = argv[++i];
+        } else if (std::strcmp(argv[i], "--debounce-ms") == 0 && i + 1 < argc) {
+            try {
+                watchOptions.debounceMs = parseNumber<int>("--debounce-ms", argv[++i], 0);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
                 return 1;
             }
-            
-            format = config.value("export_format", "spice");
-            output_filename = config.value("output_filename", "output.html");
-            labels = config.value("labels", std::vector<std::string>{});
-            std::string title = config.value("title", DEFAULT_TITLE);  // Usar título padrão
-            std::string main_text = config.value("main_text", "This is generated from a JSON config.");
-
-            help_text = config.value("help_text", "");
-            help_link = config.value("help_link", "");
-            help_badge_url = config.value("help_badge_url", "");
-            std::string author_image = config.value("author_image", "");
-            std::string template_file = config.value("template", "");
-
-            std::map<std::string, std::unique_ptr<ImageList>> imageLists;
-            for (int i = 0; ; ++i) {
-                std::string key = "images" + (i == 0 ? "" : "_" + std::to_string(i));
-                if (config.contains(key)) {
-                    std::string placeholder = "SPICE_IMAGES" + (i == 0 ? "" : "_" + std::to_string(i));
-                    auto imageList = std::make_unique<ImageList>();
-                    for (const auto& img : config[key]) {
-                        if (debug) std::cout << "Processing image: " << img << std::endl;
-                        imageList->addImage(std::make_unique<Image>(img, ""));
-                        if (debug) std::cout << "Image added successfully: " << img << std::endl;
-                    }
-                    imageLists[placeholder] = std::move(imageList);
-                } else {
-                    break;
-                }
+        } else if (std::strcmp(argv[i], "--gif-quality") == 0 && i + 1 < argc) {
+            try {
+                gif_options.quantize.quality = tsimg::quantize::parseQuality(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
             }
-
-            if (format == "gif") {
-                if (!createGif(output_filename, image_paths, debug)) {
-                    std::cerr << "Failed to create GIF file: " << output_filename << std::endl;
-                    return 1;
-                }
-            } else if (format == "spice") {
-                SPICEBuilder builder(title, debug);
-                builder.addTitle(title);  // Consistência no uso do título
-                builder.addContent("SPICE_TEXT", main_text);
-                if (createLabelsFromImages) {
-                    builder.generateLabelsFromImages();
-                }
-                builder.addLabels(labels);
-                if (!help_text.empty() && !help_link.empty() && !help_badge_url.empty()) {
-                    builder.setHelp(help_text, help_link, help_badge_url);
-                }
-                if (!author_image.empty()) {
-                    builder.setAuthorImage(author_image);
-                }
-                if (!template_file.empty()) {
-                    builder.setTemplate(template_file);
-                }
-                for (const auto& [tag, list] : imageLists) {
-                    for (const auto& img : list->getImages()) {
-                        builder.addImageToList(tag, img->getPath());
-                    }
+        } else if (std::strcmp(argv[i], "--gif-dither") == 0) {
+            gif_options.quantize.dither = true;
+        } else if (std::strcmp(argv[i], "--gif-max-size") == 0 && i + 1 < argc) {
+            try {
+                gif_options.maxDimension = parseNumber<int>("--gif-max-size", argv[++i], 1);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--frame-buffer-mb") == 0 && i + 1 < argc) {
+            try {
+                gif_options.frameBufferBytes = parseNumber<size_t>("--frame-buffer-mb", argv[++i], 1, kMaxMegabytes) << 20;
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--interpolate") == 0 && i + 1 < argc) {
+            try {
+                gif_options.interpolate = interpolateCount(parseNumber<int>("--interpolate", argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--align") == 0 && i + 1 < argc) {
+            try {
+                align_options.mode = tsimg::align::parseMode(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--align-reference") == 0 && i + 1 < argc) {
+            try {
+                align_options.reference = parseNumber<size_t>("--align-reference", argv[++i], 1, std::numeric_limits<size_t>::max()) - 1;
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--roi") == 0 && i + 1 < argc) {
+            try {
+                roi_options.box = tsimg::roi::parseBox(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--normalize") == 0 && i + 1 < argc) {
+            try {
+                normalize_options.mode = tsimg::normalize::parseMode(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--normalize-clip") == 0 && i + 1 < argc) {
+            try {
+                normalize_options.clipPercent = clipPercent(parseNumber<double>("--normalize-clip", argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--atlas") == 0) {
+            atlas_options.enabled = true;
+        } else if (std::strcmp(argv[i], "--atlas-max-side") == 0 && i + 1 < argc) {
+            try {
+                atlas_options.maxSheetSide = parseNumber<int>("--atlas-max-side", argv[++i], 1);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            atlas_options.enabled = true;
+        } else if (std::strcmp(argv[i], "--raw-frames") == 0 && i + 1 < argc) {
+            raw_frames_source = argv[++i];
+        } else if (std::strcmp(argv[i], "--optimize-png") == 0) {
+            optimize_png = true;
+        } else if (std::strcmp(argv[i], "--shard-mb") == 0 && i + 1 < argc) {
+            try {
+                shard_bytes = shardBytes(std::string(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--dry-run") == 0) {
+            dry_run.enabled = true;
+        } else if (std::strcmp(argv[i], "--estimate") == 0 && i + 1 < argc) {
+            dry_run.reportFile = argv[++i];
+            dry_run.enabled = true;
+        } else if (std::strcmp(argv[i], "--stats") == 0) {
+            stats_options.enabled = true;
+        } else if (std::strcmp(argv[i], "--stats-channel") == 0 && i + 1 < argc) {
+            try {
+                stats_options.channel = tsimg::stats::parseChannel(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            stats_options.enabled = true;
+        } else if (std::strcmp(argv[i], "--stats-bins") == 0 && i + 1 < argc) {
+            try {
+                stats_options.bins = parseNumber<int>("--stats-bins", argv[++i], 1, 256);
+                if (256 % stats_options.bins != 0) {
+                    throw std::runtime_error("--stats-bins must divide 256, got " + std::to_string(stats_options.bins));
                 }
-                TemplateWriter writer(builder.getTemplatePath(), debug);
-                writer.writeToFile(output_filename, builder.getContents(), builder.getImageLists(), builder.getLabels(), builder.getAuthorImageBase64());
-            } else {
-                std::cerr << "Unsupported format in JSON config: " << format << std::endl;
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            stats_options.enabled = true;
+        } else if (std::strcmp(argv[i], "--stats-roi") == 0 && i + 1 < argc) {
+            try {
+                stats_options.box = tsimg::roi::parseBox(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            stats_options.enabled = true;
+        } else if (std::strcmp(argv[i], "--stats-mask") == 0 && i + 1 < argc) {
+            stats_options.maskPath = argv[++i];
+            stats_options.enabled = true;
+        } else if (std::strcmp(argv[i], "--memory-budget") == 0 && i + 1 < argc) {
+            try {
+                tsimg::memory::setBudget(parseNumber<size_t>("--memory-budget", argv[++i], 0, kMaxMegabytes) << 20);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
                 return 1;
             }
+        } else if (std::strcmp(argv[i], "--memory-stats") == 0) {
+            memory_stats = true;
+        } else if (std::strcmp(argv[i], "--memory-report") == 0 && i + 1 < argc) {
+            memory_report_file = argv[++i];
+        }
+    }
+
+    try {
+        formats = parseFormats(split(format, ','));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    if (memory_stats || !memory_report_file.empty()) {
+        tsimg::memory::reportAtExit(memory_stats, memory_report_file);
+    }
+
+    // Com a saída no stdout, qualquer mensagem precisa ir para o stderr desde o início; o ensaio
+    // não grava a saída e o stdout fica com o relatório
+    if (output_filename == STDIO_PATH && !dry_run.enabled) {
+        tsimg::utils::FileHandler::reserveStdout();
+    }
+
+    if (!watchOptions.directory.empty()) {
+        if (output_filename.empty() || output_filename == STDIO_PATH) {
+            std::cerr << "Watch mode requires an output file (-n <output_filename>)." << std::endl;
+            return 1;
+        }
+        // O watch reescreve um único arquivo a cada mudança: um formato só, já validado
+        if (formats.size() != 1) {
+            std::cerr << "Watch mode writes a single format (-f spice or -f gif), got \"" << format << "\"." << std::endl;
+            return 1;
+        }
+        SPICEBuilder builder(DEFAULT_TITLE, debug);
+        builder.addTitle(DEFAULT_TITLE);
+        if (!help_text.empty() && !help_link.empty() && !help_badge_url.empty()) {
+            builder.setHelp(help_text, help_link, help_badge_url);
+        }
+        if (!author_image_path.empty()) {
+            builder.setAuthorImage(author_image_path);
+        }
+        if (!template_path.empty()) {
+            builder.setTemplate(template_path);
+        }
+        watchOptions.outputFile = output_filename;
+        watchOptions.format = formats.front();
+        watchOptions.debug = debug;
+        watchOptions.gifOptions = gif_options;
+        return tsimg::watch::runWatch(watchOptions, builder);
+    }
+
+    if (!json_config_file.empty()) {
+        try {
+            nlohmann::json config = read_json_file(json_config_file, debug);
+            runJsonJob(config, debug, createLabelsFromImages, dry_run);
         } catch (const std::exception& e) {
             std::cerr << "Error reading or processing JSON config file: " << e.what() << std::endl;
             return 1;
         }
     } else {
-        if (output_filename.empty() || image_paths.empty()) {
+        if (output_filename.empty() || (image_paths.empty() && raw_frames_source.empty())) {
             display_info();
             return 1;
         }
 
-        // Validar caminhos de imagem em modo CLI
-        for (const auto& img : image_paths) {
-            if (!tsimg::utils::ImageValidator::validateImagePath(img, debug)) {
-                std::cerr << "Invalid image file: " << img << std::endl;
+        // Quadros crus substituem -i; sem arquivos, o que precisa deles (rótulos pelo nome,
+        // alinhamento, recorte, estatísticas, atlas, contêiner) não se aplica. Só o SPICE sozinho
+        // lê a fonte sob demanda.
+        tsimg::raw::FrameSource raw_source;
+        std::shared_ptr<RawSeries> raw_series;
+        std::vector<std::string> raw_names;
+        if (!raw_frames_source.empty()) {
+            if (dry_run.enabled) {
+                std::cerr << "A dry run needs frame files; raw frames have no headers to probe ahead." << std::endl;
+                return 1;
+            }
+            if (!image_paths.empty() || createLabelsFromImages || align_options.mode != tsimg::align::Mode::Off || roi_options.enabled() ||
+                normalize_options.enabled() || stats_options.enabled || atlas_options.enabled || shard_bytes > 0 || hasFormat(formats, "spicebin")) {
+                std::cerr << "--raw-frames replaces -i and cannot be combined with -labelbyname, --align, --roi, --normalize, --stats, --atlas, --shard-mb or spicebin." << std::endl;
+                return 1;
+            }
+            try {
+                raw_source = tsimg::raw::open(raw_frames_source, debug);
+                if (hasFormat(formats, "gif")) {
+                    raw_series = readRawSeries(raw_source, raw_names, gif_options, hasFormat(formats, "spice"), debug);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Error while reading raw frames: " << e.what() << std::endl;
+                return 1;
+            }
+        }
+
+        // "-i -" só é lido sob demanda no SPICE com rótulos explícitos; rótulos pelo nome, GIF,
+        // alinhamento, recorte, estatísticas, atlas, páginas e o ensaio precisam da lista completa antes de começar
+        bool lazy_stdin = image_paths.size() == 1 && image_paths[0] == STDIO_PATH;
+        if (lazy_stdin && (dry_run.enabled || shard_bytes > 0 || createLabelsFromImages || formats != std::vector<std::string>{"spice"} || align_options.mode != tsimg::align::Mode::Off || roi_options.enabled() || normalize_options.enabled() || stats_options.enabled || atlas_options.enabled)) {
+            try {
+                image_paths = readStdinPaths(debug);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            lazy_stdin = false;
+            if (image_paths.empty()) {
+                std::cerr << "No image paths received on stdin." << std::endl;
                 return 1;
             }
         }
-        
-        // Validar caminhos de imagem extras
-        for (const auto& extraList : imagePathsExtras) {
-            for (const auto& img : extraList) {
-                if (!tsimg::utils::ImageValidator::validateImagePath(img, debug)) {
-                    std::cerr << "Invalid image file in extra list: " << img << std::endl;
-                    return 1;
+
+        // Expandir diretórios/globs e validar os caminhos de imagem em paralelo
+        std::vector<tsimg::inputs::ImageInput> image_inputs;
+        std::vector<std::vector<tsimg::inputs::ImageInput>> extra_inputs;
+        try {
+            if (!lazy_stdin) {
+                image_inputs = tsimg::inputs::collectInputs(image_paths, debug);
+                image_paths = tsimg::inputs::pathsOf(image_inputs);
+            }
+            for (const auto& extraList : imagePathsExtras) {
+                extra_inputs.push_back(tsimg::inputs::collectInputs(extraList, debug));
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid image input: " << e.what() << std::endl;
+            return 1;
+        }
+
+        // Co-registro e recorte opcionais: as listas passam a apontar para os quadros derivados,
+        // que vivem até o fim da escrita
+        std::vector<tsimg::inputs::TemporaryFrames> derived;
+        std::vector<std::string> original_paths = image_paths;
+        try {
+            // O ensaio estima sobre os quadros originais (ver dryRunSkipped)
+            if (!dry_run.enabled) {
+                image_inputs = deriveInputs(image_inputs, align_options, roi_options, normalize_options, derived, debug);
+                image_paths = tsimg::inputs::pathsOf(image_inputs);
+                for (auto& extra : extra_inputs) {
+                    extra = deriveInputs(extra, align_options, roi_options, normalize_options, derived, debug);
                 }
             }
+        } catch (const std::exception& e) {
+            std::cerr << "Error while preparing frames: " << e.what() << std::endl;
+            return 1;
         }
 
-        if (format == "spice") {
-            SPICEBuilder builder(DEFAULT_TITLE, debug);  // Usar título padrão
-            builder.addTitle(DEFAULT_TITLE);
-            builder.addImagesAsync(image_paths);  // Usar a versão assíncrona
+        std::unique_ptr<SPICEBuilder> builder;
+        if (hasFormat(formats, "spice") || hasFormat(formats, "spicebin")) {
+            builder = std::make_unique<SPICEBuilder>(DEFAULT_TITLE, debug);  // Usar título padrão
+            builder->addTitle(DEFAULT_TITLE);
+            if (lazy_stdin) {
+                builder->addImageSource("SPICE_IMAGES", stdinPathSource(debug));
+            } else if (raw_source) {
+                builder->addPixelSource("SPICE_IMAGES", rawPixelSource(raw_source, raw_series));
+            } else {
+                builder->addImageInputs("SPICE_IMAGES", image_inputs);  // Lidas e codificadas durante a escrita
+            }
             if (createLabelsFromImages) {
-                builder.generateLabelsFromImages();
+                builder->addLabels(original_paths);  // Os nomes originais, mesmo com quadros alinhados
             }
-            builder.addLabels(labels);
+            builder->addLabels(labels);
             if (!help_text.empty() && !help_link.empty() && !help_badge_url.empty()) {
-                builder.setHelp(help_text, help_link, help_badge_url);
+                builder->setHelp(help_text, help_link, help_badge_url);
             }
             if (!author_image_path.empty()) {
-                builder.setAuthorImage(author_image_path);
+                builder->setAuthorImage(author_image_path);
             }
             if (!template_path.empty()) {
-                builder.setTemplate(template_path);
+                builder->setTemplate(template_path);
             }
-            for (size_t i = 0; i < imagePathsExtras.size(); ++i) {
+            for (size_t i = 0; i < extra_inputs.size(); ++i) {
                 std::string tag = "SPICE_IMAGES_" + std::to_string(i + 1);
-                for (const auto& img : imagePathsExtras[i]) {
-                    builder.addImageToList(tag, img);
-                }
+                builder->addImageInputs(tag, extra_inputs[i]);
             }
-            TemplateWriter writer(builder.getTemplatePath(), debug);
-            writer.writeToFile(output_filename, builder.getContents(), builder.getImageLists(), builder.getLabels(), builder.getAuthorImageBase64());
-        } else if (format == "gif") {
-            if (!createGif(output_filename, image_paths, debug)) {
-                std::cerr << "Error while trying to create the gif file: " << output_filename << std::endl;
-                return 1;
+        }
+        try {
+            checkSharding(shard_bytes, formats, stats_options.enabled, atlas_options.enabled);
+            if (dry_run.enabled) {
+                auto skipped = dryRunSkipped(align_options, roi_options, normalize_options, stats_options.enabled, atlas_options.enabled, optimize_png);
+                reportEstimate(formats, output_filename, builder.get(), image_paths, gif_options, skipped, shard_bytes, dry_run, debug);
+                return 0;
             }
-        } else {
-            std::cerr << "Unsupported format: " << format << std::endl;
+            if (builder) {
+                addFrameStats(*builder, stats_options, debug);
+                applyAtlas(*builder, formats, atlas_options, derived, debug);
+                applyPngOptimization(*builder, optimize_png, debug);
+            }
+            writeOutputs(formats, output_filename, builder.get(), raw_source ? raw_names : image_paths, gif_options, loader_file, shard_bytes, debug);
+        } catch (const std::exception& e) {
+            std::cerr << "Error while trying to create the output: " << e.what() << std::endl;
             return 1;
         }
     }
@@ -0,0 +1,411 @@
+#include "tsimg_align.h"
+#include "tsimg_downscale.h"
+#include "tsimg_memory.h"
+#include "tsimg_pipeline.h"
+#include "tsimg_spice.h"
+#include <stb_image.h>
+#include <stb_image_write.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+
+namespace tsimg::align {
+
+namespace {
+    constexpr double kPi = 3.14159265358979323846;
+
+    // FFT 2D complexa de lado n (potência de dois), com real e imaginário em vetores separados:
+    // os laços internos percorrem memória contígua e o compilador os vetoriza.
+    class Fft2D {
+    public:
+        explicit Fft2D(int n) : n(n), rowRe(n), rowIm(n), scratchRe(static_cast<size_t>(n) * n), scratchIm(static_cast<size_t>(n) * n) {
+            int bits = 0;
+            while ((1 << bits) < n) ++bits;
+            reversed.resize(n);
+            for (int i = 0; i < n; ++i) {
+                int r = 0;
+                for (int b = 0; b < bits; ++b) r |= ((i >> b) & 1) << (bits - 1 - b);
+                reversed[i] = r;
+            }
+            // Fatores de cada estágio lado a lado: estágio de tamanho len começa em len/2 - 1
+            twiddleRe.resize(n);
+            twiddleIm.resize(n);
+            for (int len = 2; len <= n; len <<= 1) {
+                int half = len / 2;
+                for (int k = 0; k < half; ++k) {
+                    double angle = -2.0 * kPi * k / len;
+                    twiddleRe[half - 1 + k] = static_cast<float>(std::cos(angle));
+                    twiddleIm[half - 1 + k] = static_cast<float>(std::sin(angle));
+                }
+            }
+        }
+
+        // Transformada in-place; a inversa já sai dividida por n²
+        void transform(float* re, float* im, bool inverse) {
+            for (int y = 0; y < n; ++y) transformRow(re + static_cast<size_t>(y) * n, im + static_cast<size_t>(y) * n, inverse);
+            transpose(re, scratchRe.data());
+            transpose(im, scratchIm.data());
+            for (int y = 0; y < n; ++y) transformRow(re + static_cast<size_t>(y) * n, im + static_cast<size_t>(y) * n, inverse);
+            transpose(re, scratchRe.data());
+            transpose(im, scratchIm.data());
+            if (inverse) {
+                const float scale = 1.0f / (static_cast<float>(n) * n);
+                const size_t total = static_cast<size_t>(n) * n;
+                for (size_t i = 0; i < total; ++i) {
+                    re[i] *= scale;
+                    im[i] *= scale;
+                }
+            }
+        }
+
+        int size() const { return n; }
+
+    private:
+        void transformRow(float* re, float* im, bool inverse) {
+            for (int i = 0; i < n; ++i) {
+                rowRe[i] = re[reversed[i]];
+                rowIm[i] = im[reversed[i]];
+            }
+            const float sign = inverse ? -1.0f : 1.0f;
+            for (int len = 2; len <= n; len <<= 1) {
+                const int half = len / 2;
+                const float* wr = twiddleRe.data() + half - 1;
+                const float* wi = twiddleIm.data() + half - 1;
+                for (int start = 0; start < n; start += len) {
+                    float* aRe = rowRe.data() + start;
+                    float* aIm = rowIm.data() + start;
+                    float* bRe = aRe + half;
+                    float* bIm = aIm + half;
+                    for (int k = 0; k < half; ++k) {
+                        float tRe = bRe[k] * wr[k] - bIm[k] * wi[k] * sign;
+                        float tIm = bRe[k] * wi[k] * sign + bIm[k] * wr[k];
+                        bRe[k] = aRe[k] - tRe;
+                        bIm[k] = aIm[k] - tIm;
+                        aRe[k] += tRe;
+                        aIm[k] += tIm;
+                    }
+                }
+            }
+            std::copy(rowRe.begin(), rowRe.end(), re);
+            std::copy(rowIm.begin(), rowIm.end(), im);
+        }
+
+        void transpose(float* data, float* scratch) {
+            constexpr int kBlock = 16;
+            for (int by = 0; by < n; by += kBlock) {
+                for (int bx = 0; bx < n; bx += kBlock) {
+                    for (int y = by; y < std::min(n, by + kBlock); ++y) {
+                        for (int x = bx; x < std::min(n, bx + kBlock); ++x) {
+                            scratch[static_cast<size_t>(x) * n + y] = data[static_cast<size_t>(y) * n + x];
+                        }
+                    }
+                }
+            }
+            std::copy(scratch, scratch + static_cast<size_t>(n) * n, data);
+        }
+
+        int n;
+        std::vector<int> reversed;
+        std::vector<float> twiddleRe, twiddleIm;
+        std::vector<float> rowRe, rowIm;
+        std::vector<float> scratchRe, scratchIm;
+    };
+
+    struct Spectrum {
+        std::vector<float> re;
+        std::vector<float> im;
+    };
+
+    struct Peak {
+        double x = 0.0;
+        double y = 0.0;
+        double value = 0.0;
+    };
+
+    // Quadro em tons de cinza na grade de análise (n x n), com média zero
+    std::vector<float> analysisImage(const std::string& path, int n, bool debug) {
+        std::vector<uint8_t> rgba;
+        tsimg::downscale::Options downscale;
+        downscale.stage = tsimg::memory::Stage::Ingest;
+        downscale.threads = 1; // o paralelismo é entre quadros
+        downscale.debug = debug;
+        if (!tsimg::downscale::loadResizedRgba(path, n, n, rgba, downscale)) {
+            throw std::runtime_error("Failed to load image for alignment: " + path);
+        }
+        std::vector<float> gray(static_cast<size_t>(n) * n);
+        double sum = 0.0;
+        for (size_t i = 0; i < gray.size(); ++i) {
+            gray[i] = 0.299f * rgba[i * 4] + 0.587f * rgba[i * 4 + 1] + 0.114f * rgba[i * 4 + 2];
+            sum += gray[i];
+        }
+        const float mean = static_cast<float>(sum / gray.size());
+        for (auto& v : gray) v -= mean;
+        return gray;
+    }
+
+    // g(q) = image(scale * (q - c) + c), bilinear; fora da imagem vale 0 (a média)
+    std::vector<float> rescaled(const std::vector<float>& image, int n, double scale) {
+        std::vector<float> out(image.size(), 0.0f);
+        const double c = (n - 1) / 2.0;
+        for (int y = 0; y < n; ++y) {
+            double sy = scale * (y - c) + c;
+            int y0 = static_cast<int>(std::floor(sy));
+            float fy = static_cast<float>(sy - y0);
+            if (y0 < 0 || y0 + 1 >= n) continue;
+            for (int x = 0; x < n; ++x) {
+                double sx = scale * (x - c) + c;
+                int x0 = static_cast<int>(std::floor(sx));
+                if (x0 < 0 || x0 + 1 >= n) continue;
+                float fx = static_cast<float>(sx - x0);
+                const float* p = image.data() + static_cast<size_t>(y0) * n + x0;
+                float top = p[0] + (p[1] - p[0]) * fx;
+                float bottom = p[n] + (p[n + 1] - p[n]) * fx;
+                out[static_cast<size_t>(y) * n + x] = top + (bottom - top) * fy;
+            }
+        }
+        return out;
+    }
+
+    // RGBA inteiro do quadro segundo o cabeçalho (0 se não der para ler)
+    size_t decodedBytes(const std::string& path) {
+        int width = 0, height = 0;
+        return tsimg::downscale::imageSize(path, width, height) ? static_cast<size_t>(width) * height * 4 : 0;
+    }
+
+    // Estimativa para o orçamento de memória: a redução do downscale (RGBA inteiro ou a janela de
+    // linhas padrão) mais as grades de análise
+    size_t analysisFootprint(const std::string& path) {
+        return std::min(decodedBytes(path), tsimg::downscale::Options{}.maxBufferBytes) + (size_t(1) << 20);
+    }
+
+    class Correlator {
+    public:
+        explicit Correlator(int n) : fft(n), window(n) {
+            for (int i = 0; i < n; ++i) window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * i / (n - 1)));
+        }
+
+        // Janela de Hann (corta as bordas, que a FFT trata como periódicas) e transformada
+        Spectrum spectrum(const std::vector<float>& image) {
+            const int n = fft.size();
+            Spectrum s{std::vector<float>(image.size()), std::vector<float>(image.size(), 0.0f)};
+            for (int y = 0; y < n; ++y) {
+                const float wy = window[y];
+                const float* src = image.data() + static_cast<size_t>(y) * n;
+                float* dst = s.re.data() + static_cast<size_t>(y) * n;
+                for (int x = 0; x < n; ++x) dst[x] = src[x] * wy * window[x];
+            }
+            fft.transform(s.re.data(), s.im.data(), false);
+            return s;
+        }
+
+        // Pico de IFFT(M * conj(R) / |M * conj(R)|): o deslocamento t em que moving(x) ≈ ref(x - t)
+        Peak correlate(const Spectrum& reference, const Spectrum& moving) {
+            const int n = fft.size();
+            const size_t total = static_cast<size_t>(n) * n;
+            re.resize(total);
+            im.resize(total);
+            for (size_t i = 0; i < total; ++i) {
+                float cr = moving.re[i] * reference.re[i] + moving.im[i] * reference.im[i];
+                float ci = moving.im[i] * reference.re[i] - moving.re[i] * reference.im[i];
+                float magnitude = std::sqrt(cr * cr + ci * ci) + 1e-12f;
+                re[i] = cr / magnitude;
+                im[i] = ci / magnitude;
+            }
+            fft.transform(re.data(), im.data(), true);
+
+            size_t best = static_cast<size_t>(std::max_element(re.begin(), re.end()) - re.begin());
+            int px = static_cast<int>(best % n);
+            int py = static_cast<int>(best / n);
+            auto at = [&](int x, int y) { return re[static_cast<size_t>((y + n) % n) * n + (x + n) % n]; };
+            // Refinamento subpixel por parábola nos vizinhos
+            auto refine = [](float left, float centre, float right) {
+                float denominator = left - 2.0f * centre + right;
+                return std::fabs(denominator) > 1e-12f ? 0.5 * (left - right) / denominator : 0.0;
+            };
+            Peak peak;
+            peak.value = re[best];
+            peak.x = px + refine(at(px - 1, py), at(px, py), at(px + 1, py));
+            peak.y = py + refine(at(px, py - 1), at(px, py), at(px, py + 1));
+            if (peak.x > n / 2.0) peak.x -= n;
+            if (peak.y > n / 2.0) peak.y -= n;
+            return peak;
+        }
+
+    private:
+        Fft2D fft;
+        std::vector<float> window;
+        std::vector<float> re, im;
+    };
+}
+
+Mode parseMode(const std::string& name) {
+    if (name == "off" || name == "none") return Mode::Off;
+    if (name == "translation") return Mode::Translation;
+    if (name == "scale") return Mode::Scale;
+    throw std::runtime_error("Invalid alignment mode: " + name + " (expected 'off', 'translation' or 'scale')");
+}
+
+std::vector<Transform> estimate(const std::vector<std::string>& paths, const Options& options) {
+    if (paths.empty()) return {};
+    if (options.reference >= paths.size()) {
+        throw std::runtime_error("Alignment reference " + std::to_string(options.reference + 1) + " is out of range");
+    }
+    int n = 16;
+    while (n < options.analysisSize) n <<= 1;
+
+    int refWidth = 0, refHeight = 0;
+    if (!tsimg::downscale::imageSize(paths[options.reference], refWidth, refHeight)) {
+        throw std::runtime_error("Failed to read image header: " + paths[options.reference]);
+    }
+
+    Correlator referenceCorrelator(n);
+    const Spectrum reference = referenceCorrelator.spectrum(analysisImage(paths[options.reference], n, options.debug));
+
+    // Escalas candidatas a cada 0,5%, com refinamento parabólico em volta da melhor
+    std::vector<double> scales{1.0};
+    if (options.mode == Mode::Scale) {
+        int steps = static_cast<int>(std::round(options.maxScale / 0.005));
+        scales.clear();
+        for (int k = -steps; k <= steps; ++k) scales.push_back(1.0 + 0.005 * k);
+    }
+
+    std::vector<Transform> transforms(paths.size());
+    auto started = std::chrono::steady_clock::now();
+    tsimg::pipeline::parallelFor(paths.size(), options.threads, [&](size_t i) {
+        Transform& transform = transforms[i];
+        if (i == options.reference) {
+            transform.confidence = 1.0;
+            return;
+        }
+        Correlator correlator(n);
+        const std::vector<float> image = analysisImage(paths[i], n, options.debug);
+
+        std::vector<Peak> peaks(scales.size());
+        size_t best = 0;
+        for (size_t k = 0; k < scales.size(); ++k) {
+            peaks[k] = correlator.correlate(reference, correlator.spectrum(scales[k] == 1.0 ? image : rescaled(image, n, scales[k])));
+            if (peaks[k].value > peaks[best].value) best = k;
+        }
+        double scale = scales[best];
+        Peak peak = peaks[best];
+        if (best > 0 && best + 1 < scales.size()) {
+            double left = peaks[best - 1].value, centre = peak.value, right = peaks[best + 1].value;
+            double denominator = left - 2.0 * centre + right;
+            if (std::fabs(denominator) > 1e-12) {
+                scale += 0.5 * (left - right) / denominator * (scales[1] - scales[0]);
+                peak = correlator.correlate(reference, correlator.spectrum(rescaled(image, n, scale)));
+            }
+        }
+
+        if (std::fabs(peak.x) > options.maxShift * n || std::fabs(peak.y) > options.maxShift * n) {
+            if (options.debug) {
+                tsimg::utils::debugLog(true, "Alignment of " + paths[i] + " rejected (shift " + std::to_string(peak.x) + ", " +
+                                       std::to_string(peak.y) + " on the analysis grid); keeping it unaligned");
+            }
+            return;
+        }
+        transform.scale = scale;
+        transform.dx = peak.x * refWidth / n;
+        transform.dy = peak.y * refHeight / n;
+        transform.confidence = peak.value;
+    }, [&](size_t i) { return analysisFootprint(paths[i]); });
+
+    if (options.debug) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+        for (size_t i = 0; i < transforms.size(); ++i) {
+            char line[160];
+            std::snprintf(line, sizeof(line), "Align %zu: dx=%.2f dy=%.2f scale=%.4f confidence=%.3f", i + 1,
+                          transforms[i].dx, transforms[i].dy, transforms[i].scale, transforms[i].confidence);
+            tsimg::utils::debugLog(true, line);
+        }
+        tsimg::utils::debugLog(true, "Estimated alignment of " + std::to_string(paths.size()) + " frames in " + std::to_string(elapsed) + " ms");
+    }
+    return transforms;
+}
+
+tsimg::inputs::TemporaryFrames alignSeries(const std::vector<std::string>& paths, const Options& options) {
+    if (options.mode == Mode::Off || paths.size() < 2) {
+        tsimg::inputs::TemporaryFrames unchanged;
+        unchanged.paths = paths;
+        return unchanged;
+    }
+    const std::vector<Transform> transforms = estimate(paths, options);
+
+    int refWidth = 0, refHeight = 0;
+    tsimg::downscale::imageSize(paths[options.reference], refWidth, refHeight);
+    const double cx = (refWidth - 1) / 2.0;
+    const double cy = (refHeight - 1) / 2.0;
+
+    // Área da referência que todos os quadros cobrem: p = (p' - c) / s + c - shift, p' nas bordas
+    double left = 0.0, top = 0.0, right = refWidth - 1.0, bottom = refHeight - 1.0;
+    for (const auto& t : transforms) {
+        left = std::max(left, -cx / t.scale + cx - t.dx);
+        right = std::min(right, cx / t.scale + cx - t.dx);
+        top = std::max(top, -cy / t.scale + cy - t.dy);
+        bottom = std::min(bottom, cy / t.scale + cy - t.dy);
+    }
+    const int x0 = static_cast<int>(std::ceil(left - 1e-6));
+    const int y0 = static_cast<int>(std::ceil(top - 1e-6));
+    const int cropWidth = static_cast<int>(std::floor(right + 1e-6)) - x0 + 1;
+    const int cropHeight = static_cast<int>(std::floor(bottom + 1e-6)) - y0 + 1;
+    if (cropWidth < 1 || cropHeight < 1) {
+        throw std::runtime_error("Aligned frames have no area in common");
+    }
+    if (options.debug) {
+        tsimg::utils::debugLog(true, "Aligned crop: " + std::to_string(cropWidth) + "x" + std::to_string(cropHeight) +
+                               " at (" + std::to_string(x0) + ", " + std::to_string(y0) + ")");
+    }
+
+    tsimg::inputs::TemporaryFrames series("tsimg-align");
+    series.paths.resize(paths.size());
+    tsimg::pipeline::parallelFor(paths.size(), options.threads, [&](size_t i) {
+        int width = 0, height = 0, channels = 0;
+        tsimg::memory::Charge source;
+        if (tsimg::downscale::imageSize(paths[i], width, height)) {
+            source = tsimg::memory::Charge(tsimg::memory::Stage::Ingest, static_cast<size_t>(width) * height * 4);
+        }
+        stbi_uc* pixels = stbi_load(paths[i].c_str(), &width, &height, &channels, 4);
+        if (!pixels) {
+            throw std::runtime_error("Failed to load image for alignment: " + paths[i]);
+        }
+        std::unique_ptr<stbi_uc, void (*)(void*)> owned(pixels, stbi_image_free);
+
+        // Quadros de tamanho diferente da referência: coordenadas proporcionais
+        const Transform& t = transforms[i];
+        const double fx = static_cast<double>(width) / refWidth;
+        const double fy = static_cast<double>(height) / refHeight;
+        tsimg::memory::Charge output(tsimg::memory::Stage::Ingest, static_cast<size_t>(cropWidth) * cropHeight * 4);
+        std::vector<uint8_t> out(static_cast<size_t>(cropWidth) * cropHeight * 4);
+        for (int y = 0; y < cropHeight; ++y) {
+            double sy = std::clamp((t.scale * (y0 + y - cy + t.dy) + cy) * fy, 0.0, height - 1.0);
+            int py = std::min(static_cast<int>(sy), height - 2 < 0 ? 0 : height - 2);
+            double wy = height > 1 ? sy - py : 0.0;
+            const stbi_uc* row0 = pixels + static_cast<size_t>(py) * width * 4;
+            const stbi_uc* row1 = height > 1 ? row0 + static_cast<size_t>(width) * 4 : row0;
+            uint8_t* dst = out.data() + static_cast<size_t>(y) * cropWidth * 4;
+            for (int x = 0; x < cropWidth; ++x) {
+                double sx = std::clamp((t.scale * (x0 + x - cx + t.dx) + cx) * fx, 0.0, width - 1.0);
+                int px = std::min(static_cast<int>(sx), width - 2 < 0 ? 0 : width - 2);
+                double wx = width > 1 ? sx - px : 0.0;
+                int next = width > 1 ? 4 : 0;
+                for (int c = 0; c < 4; ++c) {
+                    double a = row0[px * 4 + c] + (row0[px * 4 + next + c] - row0[px * 4 + c]) * wx;
+                    double b = row1[px * 4 + c] + (row1[px * 4 + next + c] - row1[px * 4 + c]) * wx;
+                    dst[x * 4 + c] = static_cast<uint8_t>(std::lround(a + (b - a) * wy));
+                }
+            }
+        }
+
+        std::string target = series.pathFor(i, paths[i], ".png");
+        if (!stbi_write_png(target.c_str(), cropWidth, cropHeight, 4, out.data(), cropWidth * 4)) {
+            throw std::runtime_error("Failed to write aligned frame: " + target);
+        }
+        series.paths[i] = target;
+    }, [&](size_t i) { return decodedBytes(paths[i]) + static_cast<size_t>(cropWidth) * cropHeight * 4; });
+    return series;
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "tsimg_inputs.h"
+
+namespace tsimg::align {
+
+    // Translation: só deslocamento. Scale: deslocamento e escala uniforme pequena (voos em
+    // altitudes um pouco diferentes). Rotação não é estimada.
+    enum class Mode { Off, Translation, Scale };
+
+    struct Options {
+        Mode mode = Mode::Off;
+        size_t reference = 0;       // índice do quadro de referência
+        int analysisSize = 256;     // lado (potência de dois) da grade usada na estimativa
+        double maxShift = 0.25;     // fração do lado acima da qual a estimativa é descartada
+        double maxScale = 0.05;     // busca de escala em [1 - maxScale, 1 + maxScale]
+        unsigned threads = 0;       // 0 = std::thread::hardware_concurrency()
+        bool debug = false;
+    };
+
+    // "off", "translation" ou "scale"; lança std::runtime_error para outros nomes
+    Mode parseMode(const std::string& name);
+
+    // Leva um ponto da referência para o quadro: p' = scale * (p - c + shift) + c, c = centro
+    struct Transform {
+        double scale = 1.0;
+        double dx = 0.0;
+        double dy = 0.0;
+        double confidence = 0.0; // pico da correlação de fase (0 a 1)
+    };
+
+    // Estima a transformação de cada quadro em relação à referência por correlação de fase
+    // (FFT) numa versão reduzida em tons de cinza; os quadros são processados em paralelo.
+    std::vector<Transform> estimate(const std::vector<std::string>& paths, const Options& options);
+
+    // estimate + reamostragem bilinear na resolução original + recorte na área comum a todos os
+    // quadros, gravados como PNG num diretório temporário. Com o alinhamento desligado devolve os
+    // próprios caminhos, sem diretório.
+    tsimg::inputs::TemporaryFrames alignSeries(const std::vector<std::string>& paths, const Options& options);
+}
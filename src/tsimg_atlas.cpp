@@ -0,0 +1,141 @@
+#include "tsimg_atlas.h"
+#include "tsimg_downscale.h"
+#include "tsimg_memory.h"
+#include "tsimg_pipeline.h"
+#include "tsimg_spice.h"
+#include <stb_image_write.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace tsimg::atlas {
+
+namespace {
+    struct SheetSize {
+        int width = 0;
+        int height = 0;
+    };
+
+    // Prateleiras da esquerda para a direita, de cima para baixo; uma folha nova quando a altura
+    // acaba. Séries de quadros do mesmo tamanho viram uma grade regular.
+    std::vector<SheetSize> layout(std::vector<Placement>& frames, int maxSide) {
+        double area = 0.0;
+        int widest = 0;
+        for (const auto& frame : frames) {
+            area += static_cast<double>(frame.width) * frame.height;
+            widest = std::max(widest, frame.width);
+        }
+        const int shelfWidth = std::clamp(static_cast<int>(std::ceil(std::sqrt(area))), widest, maxSide);
+
+        std::vector<SheetSize> sheets(1);
+        int x = 0, y = 0, shelfHeight = 0;
+        for (auto& frame : frames) {
+            if (x + frame.width > shelfWidth) {
+                y += shelfHeight;
+                x = 0;
+                shelfHeight = 0;
+            }
+            if (y + frame.height > maxSide) {
+                sheets.emplace_back();
+                x = y = shelfHeight = 0;
+            }
+            frame.sheet = sheets.size() - 1;
+            frame.x = x;
+            frame.y = y;
+            x += frame.width;
+            shelfHeight = std::max(shelfHeight, frame.height);
+            sheets.back().width = std::max(sheets.back().width, x);
+            sheets.back().height = std::max(sheets.back().height, y + frame.height);
+        }
+        return sheets;
+    }
+}
+
+Atlas pack(const std::vector<std::string>& paths, const Options& options) {
+    Atlas atlas;
+    if (paths.empty()) {
+        return atlas;
+    }
+    auto started = std::chrono::steady_clock::now();
+
+    // Só os cabeçalhos: o layout sai antes de qualquer decodificação
+    atlas.frames.resize(paths.size());
+    std::atomic<size_t> jpegFrames{0};
+    tsimg::pipeline::parallelFor(paths.size(), options.threads, [&](size_t i) {
+        auto& frame = atlas.frames[i];
+        if (!tsimg::downscale::imageSize(paths[i], frame.width, frame.height)) {
+            throw std::runtime_error("Failed to read image header: " + paths[i]);
+        }
+        if (frame.width > options.maxSheetSide || frame.height > options.maxSheetSide) {
+            throw std::runtime_error("Frame of " + std::to_string(frame.width) + "x" + std::to_string(frame.height) +
+                                     " does not fit in a " + std::to_string(options.maxSheetSide) + " px atlas sheet: " + paths[i]);
+        }
+        if (tsimg::inputs::isJpeg(paths[i])) {
+            jpegFrames.fetch_add(1);
+        }
+    });
+    std::vector<SheetSize> sheets = layout(atlas.frames, options.maxSheetSide);
+    const bool jpeg = jpegFrames.load() == paths.size();
+
+    atlas.sheets = tsimg::inputs::TemporaryFrames("tsimg-atlas");
+    atlas.sheets.paths.resize(sheets.size());
+    size_t first = 0;
+    for (size_t s = 0; s < sheets.size(); ++s) {
+        size_t last = first;
+        while (last < atlas.frames.size() && atlas.frames[last].sheet == s) ++last;
+
+        const size_t sheetStride = static_cast<size_t>(sheets[s].width) * 4;
+        std::vector<uint8_t> sheet(sheetStride * sheets[s].height, 0);
+        tsimg::memory::Charge sheetCharge(tsimg::memory::Stage::Encode, sheet.size());
+
+        // Cada quadro ocupa um retângulo próprio da folha: as threads escrevem sem travas
+        tsimg::pipeline::parallelFor(last - first, options.threads, [&](size_t k) {
+            const size_t i = first + k;
+            const auto& frame = atlas.frames[i];
+            tsimg::downscale::Options decode;
+            decode.stage = tsimg::memory::Stage::Ingest;
+            decode.debug = options.debug;
+            std::vector<uint8_t> rgba;
+            if (!tsimg::downscale::loadCroppedRgba(paths[i], 0, 0, frame.width, frame.height, rgba, decode)) {
+                throw std::runtime_error("Failed to decode image for the atlas: " + paths[i]);
+            }
+            tsimg::memory::Charge decoded(tsimg::memory::Stage::Ingest, rgba.size());
+            const size_t rowBytes = static_cast<size_t>(frame.width) * 4;
+            for (int row = 0; row < frame.height; ++row) {
+                std::memcpy(sheet.data() + (static_cast<size_t>(frame.y) + row) * sheetStride + static_cast<size_t>(frame.x) * 4,
+                            rgba.data() + row * rowBytes, rowBytes);
+            }
+        }, [&](size_t k) {
+            // Estimativa para o orçamento de memória: o quadro decodificado
+            const auto& frame = atlas.frames[first + k];
+            return static_cast<size_t>(frame.width) * frame.height * 4;
+        });
+
+        std::string target = atlas.sheets.pathFor(s, "atlas", jpeg ? ".jpg" : ".png");
+        int written = jpeg ? stbi_write_jpg(target.c_str(), sheets[s].width, sheets[s].height, 4, sheet.data(), options.jpegQuality)
+                           : stbi_write_png(target.c_str(), sheets[s].width, sheets[s].height, 4, sheet.data(), static_cast<int>(sheetStride));
+        if (!written) {
+            throw std::runtime_error("Failed to write atlas sheet: " + target);
+        }
+        atlas.sheets.paths[s] = target;
+        first = last;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+    tsimg::utils::debugLog(options.debug, "Packed " + std::to_string(paths.size()) + " frames into " + std::to_string(sheets.size()) +
+                           " atlas sheets in " + std::to_string(elapsed) + " ms");
+    return atlas;
+}
+
+nlohmann::json toJson(const std::vector<Placement>& frames) {
+    nlohmann::json json = nlohmann::json::array();
+    for (const auto& frame : frames) {
+        json.push_back({frame.sheet, frame.x, frame.y, frame.width, frame.height});
+    }
+    return json;
+}
+
+}
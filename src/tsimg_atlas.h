@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "tsimg_inputs.h"
+
+namespace tsimg::atlas {
+
+    struct Options {
+        bool enabled = false;
+        int maxSheetSide = 4096;     // lado máximo de cada folha; quadros maiores não entram no atlas
+        int jpegQuality = 95;        // folhas de quadros JPEG continuam JPEG
+        unsigned threads = 0;        // 0 = std::thread::hardware_concurrency()
+        bool debug = false;
+    };
+
+    // Posição de um quadro dentro da sua folha
+    struct Placement {
+        size_t sheet = 0;
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    struct Atlas {
+        tsimg::inputs::TemporaryFrames sheets; // uma imagem por folha, num diretório temporário
+        std::vector<Placement> frames;         // na ordem dos caminhos recebidos
+    };
+
+    // Distribui os quadros em prateleiras, na ordem da série, em folhas de até maxSheetSide de lado
+    // (quase quadradas quando tudo cabe numa só), decodifica os quadros em paralelo direto na
+    // posição de cada um e grava cada folha uma única vez: JPEG se todos os quadros forem JPEG, PNG
+    // caso contrário. Lança std::runtime_error se um quadro não puder ser lido ou não couber numa folha.
+    Atlas pack(const std::vector<std::string>& paths, const Options& options);
+
+    // Forma embutida no SPICE (<SPICE_ATLAS>): [folha, x, y, largura, altura] por quadro
+    nlohmann::json toJson(const std::vector<Placement>& frames);
+}
@@ -0,0 +1,653 @@
+#include "tsimg_container.h"
+#include "tsimg_memory.h"
+#include "tsimg_spice.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define TSIMG_HAS_MMAP 1
+#endif
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+
+namespace tsimg::container {
+
+namespace {
+    // Tamanho dos pedaços de Base64 decodificados por vez (múltiplo de 4)
+    constexpr size_t kDecodeChunk = size_t(1) << 18;
+    // Prefixo decodificado para descobrir tipo e dimensões de um quadro em Base64
+    constexpr size_t kProbeChars = size_t(1) << 16;
+
+    void put16(uint8_t* p, uint16_t v) {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    void put32(uint8_t* p, uint32_t v) {
+        for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    void put64(uint8_t* p, uint64_t v) {
+        for (int i = 0; i < 8; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    uint16_t get16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t get32(const uint8_t* p) {
+        uint32_t v = 0;
+        for (int i = 3; i >= 0; --i) v = (v << 8) | p[i];
+        return v;
+    }
+
+    uint64_t get64(const uint8_t* p) {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+        return v;
+    }
+
+    struct FrameInfo {
+        uint64_t size = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        Mime mime = Mime::Unknown;
+    };
+
+    void probe(const uint8_t* head, size_t length, FrameInfo& info) {
+        info.mime = sniffMime(head, length);
+        int w = 0, h = 0, c = 0;
+        if (length > 0 && stbi_info_from_memory(head, static_cast<int>(length), &w, &h, &c)) {
+            info.width = static_cast<uint32_t>(w);
+            info.height = static_cast<uint32_t>(h);
+        }
+    }
+
+    FrameInfo inspect(const FrameSource& frame) {
+        FrameInfo info;
+        if (!frame.path.empty()) {
+            std::error_code ec;
+            info.size = std::filesystem::file_size(frame.path, ec);
+            if (ec) {
+                throw std::runtime_error("Could not stat file: " + frame.path + " (" + ec.message() + ")");
+            }
+            uint8_t head[64] = {};
+            std::ifstream file(frame.path, std::ios::binary);
+            file.read(reinterpret_cast<char*>(head), sizeof(head));
+            info.mime = sniffMime(head, static_cast<size_t>(file.gcount()));
+            int w = 0, h = 0, c = 0;
+            if (stbi_info(frame.path.c_str(), &w, &h, &c)) {
+                info.width = static_cast<uint32_t>(w);
+                info.height = static_cast<uint32_t>(h);
+            }
+        } else {
+            info.size = tsimg::utils::Base64::decodedSize(frame.base64);
+            std::vector<uint8_t> head(kProbeChars / 4 * 3);
+            size_t length = tsimg::utils::Base64::decodeTo(frame.base64.substr(0, std::min(frame.base64.size(), kProbeChars)), head.data());
+            probe(head.data(), length, info);
+        }
+        return info;
+    }
+
+    nlohmann::json metadataJson(const Document& document) {
+        nlohmann::json contents = nlohmann::json::array();
+        for (const auto& [tag, content] : document.contents) {
+            contents.push_back({{"tag", tag}, {"content", content}});
+        }
+        nlohmann::json names = nlohmann::json::array();
+        for (const auto& frame : document.frames) {
+            names.push_back(frame.name);
+        }
+        nlohmann::json mimeTypes = nlohmann::json::array();
+        for (int m = 0; m <= static_cast<int>(Mime::Webp); ++m) {
+            mimeTypes.push_back(mimeName(static_cast<Mime>(m)));
+        }
+        return {
+            {"title", document.title},
+            {"template", document.templatePath},
+            {"contents", contents},
+            {"labels", document.labels},
+            {"author_image", document.authorImageBase64},
+            {"lists", document.lists},
+            {"names", names},
+            {"mime_types", mimeTypes},
+        };
+    }
+
+    // Destino do contêiner: descritor de arquivo com cópias feitas pelo kernel nas plataformas
+    // POSIX, std::ostream nas demais
+    class Output {
+    public:
+        Output(const std::string& path, bool debug) : path(path), debug(debug) {
+#ifdef TSIMG_HAS_MMAP
+            if (tsimg::utils::FileHandler::isStdStream(path)) {
+                tsimg::utils::FileHandler::reserveStdout();
+                fd = STDOUT_FILENO;
+            } else {
+                auto parent = std::filesystem::path(path).parent_path();
+                if (!parent.empty()) std::filesystem::create_directories(parent);
+                fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                if (fd < 0) {
+                    throw std::runtime_error("Could not open file for writing: " + path + " (" + std::strerror(errno) + ")");
+                }
+                ownsFd = true;
+            }
+#else
+            stream = tsimg::utils::FileHandler::openOutputStream(path, debug);
+#endif
+        }
+
+        ~Output() {
+#ifdef TSIMG_HAS_MMAP
+            if (ownsFd) ::close(fd);
+#endif
+        }
+
+        void write(const void* data, size_t size) {
+#ifdef TSIMG_HAS_MMAP
+            const auto* p = static_cast<const uint8_t*>(data);
+            while (size > 0) {
+                ssize_t n = ::write(fd, p, size);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error("Error writing file: " + path + " (" + std::strerror(errno) + ")");
+                }
+                p += n;
+                size -= static_cast<size_t>(n);
+            }
+#else
+            stream->write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            if (!*stream) throw std::runtime_error("Error writing file: " + path);
+#endif
+        }
+
+        // Acrescenta exatamente size bytes de source
+        void copyFile(const std::string& source, uint64_t size) {
+#ifdef TSIMG_HAS_MMAP
+            int in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+            if (in < 0) {
+                throw std::runtime_error("Could not open file: " + source + " (" + std::strerror(errno) + ")");
+            }
+            uint64_t copied = 0;
+            try {
+                copied = copyKernel(in, size);
+                if (copied < size) copied += copyBuffered(in, copied, size - copied);
+            } catch (...) {
+                ::close(in);
+                throw;
+            }
+            ::close(in);
+#else
+            auto data = tsimg::utils::FileIO::readBinary(source);
+            uint64_t copied = std::min<uint64_t>(data.size(), size);
+            write(data.data(), static_cast<size_t>(copied));
+#endif
+            if (copied != size) {
+                throw std::runtime_error("File changed while writing container: " + source);
+            }
+        }
+
+        void finish() {
+#ifndef TSIMG_HAS_MMAP
+            stream->flush();
+            if (!*stream) throw std::runtime_error("Error writing file: " + path);
+#endif
+        }
+
+    private:
+#ifdef TSIMG_HAS_MMAP
+        // copy_file_range (mesmo sistema de arquivos, pode virar reflink) e depois sendfile (que
+        // também serve para pipes). Devolve quanto foi copiado; o resto fica para copyBuffered.
+        uint64_t copyKernel(int in, uint64_t size) {
+            uint64_t copied = 0;
+#if defined(__linux__) && defined(SYS_copy_file_range)
+            while (useCopyFileRange && copied < size) {
+                loff_t inOffset = static_cast<loff_t>(copied);
+                ssize_t n = ::syscall(SYS_copy_file_range, in, &inOffset, fd, nullptr, static_cast<size_t>(size - copied), 0u);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) {
+                    // EXDEV, EINVAL (pipe, tty), ENOSYS...: este destino não aceita; não tenta de novo
+                    debugFallback("copy_file_range");
+                    useCopyFileRange = false;
+                    break;
+                }
+                if (n == 0) return copied;
+                copied += static_cast<uint64_t>(n);
+            }
+#endif
+#if defined(__linux__)
+            while (useSendfile && copied < size) {
+                off_t inOffset = static_cast<off_t>(copied);
+                ssize_t n = ::sendfile(fd, in, &inOffset, static_cast<size_t>(size - copied));
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) {
+                    debugFallback("sendfile");
+                    useSendfile = false;
+                    break;
+                }
+                if (n == 0) return copied;
+                copied += static_cast<uint64_t>(n);
+            }
+#endif
+            return copied;
+        }
+
+        uint64_t copyBuffered(int in, uint64_t offset, uint64_t size) {
+            std::vector<uint8_t> chunk(static_cast<size_t>(std::min<uint64_t>(size, kDecodeChunk)));
+            tsimg::memory::Charge charge(tsimg::memory::Stage::Write, chunk.size());
+            uint64_t copied = 0;
+            while (copied < size) {
+                ssize_t n = ::pread(in, chunk.data(), static_cast<size_t>(std::min<uint64_t>(chunk.size(), size - copied)), static_cast<off_t>(offset + copied));
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) {
+                    throw std::runtime_error(std::string("Error reading frame for container (") + std::strerror(errno) + ")");
+                }
+                if (n == 0) break;
+                write(chunk.data(), static_cast<size_t>(n));
+                copied += static_cast<uint64_t>(n);
+            }
+            return copied;
+        }
+
+        void debugFallback(const char* call) {
+            tsimg::utils::debugLog(debug, std::string(call) + " unavailable for " + path + " (" + std::strerror(errno) + "), falling back");
+        }
+
+        int fd = -1;
+        bool ownsFd = false;
+        bool useCopyFileRange = true;
+        bool useSendfile = true;
+#else
+        std::unique_ptr<std::ostream> stream;
+#endif
+        std::string path;
+        bool debug;
+    };
+
+    void writeBase64(Output& out, std::string_view base64) {
+        std::vector<uint8_t> chunk(kDecodeChunk / 4 * 3);
+        tsimg::memory::Charge charge(tsimg::memory::Stage::Write, chunk.size());
+        for (size_t pos = 0; pos < base64.size(); pos += kDecodeChunk) {
+            size_t length = tsimg::utils::Base64::decodeTo(base64.substr(pos, kDecodeChunk), chunk.data());
+            out.write(chunk.data(), length);
+        }
+    }
+
+    std::string trim(std::string_view text) {
+        size_t begin = text.find_first_not_of(" \t\r\n");
+        if (begin == std::string_view::npos) return "";
+        size_t end = text.find_last_not_of(" \t\r\n");
+        return std::string(text.substr(begin, end - begin + 1));
+    }
+
+    std::string replaceAll(std::string text, const std::string& tag, const std::string& value) {
+        for (size_t pos = text.find(tag); pos != std::string::npos; pos = text.find(tag, pos + value.size())) {
+            text.replace(pos, tag.size(), value);
+        }
+        return text;
+    }
+}
+
+const char* mimeName(Mime mime) {
+    switch (mime) {
+        case Mime::Png: return "image/png";
+        case Mime::Jpeg: return "image/jpeg";
+        case Mime::Gif: return "image/gif";
+        case Mime::Bmp: return "image/bmp";
+        case Mime::Webp: return "image/webp";
+        default: return "application/octet-stream";
+    }
+}
+
+Mime sniffMime(const uint8_t* data, size_t size) {
+    if (size >= 8 && std::memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) return Mime::Png;
+    if (size >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff) return Mime::Jpeg;
+    if (size >= 6 && (std::memcmp(data, "GIF87a", 6) == 0 || std::memcmp(data, "GIF89a", 6) == 0)) return Mime::Gif;
+    if (size >= 2 && data[0] == 'B' && data[1] == 'M') return Mime::Bmp;
+    if (size >= 12 && std::memcmp(data, "RIFF", 4) == 0 && std::memcmp(data + 8, "WEBP", 4) == 0) return Mime::Webp;
+    return Mime::Unknown;
+}
+
+Document fromBuilder(const SPICEBuilder& builder) {
+    Document document;
+    document.title = builder.getTitle();
+    document.templatePath = builder.getTemplatePath();
+    for (const auto& content : builder.getContents()) {
+        document.contents.emplace_back(content.getTag(), content.getVariableContent());
+    }
+    document.labels = builder.getLabels();
+    document.authorImageBase64 = builder.getAuthorImageBase64();
+
+    // Mesma ordem de listas do HTML: por tag, quadros já codificados, caminhos e por fim a fonte
+    std::set<std::string> tags;
+    for (const auto& entry : builder.getImageLists()) tags.insert(entry.first);
+    for (const auto& entry : builder.getImagePaths()) tags.insert(entry.first);
+    for (const auto& entry : builder.getImageSources()) tags.insert(entry.first);
+
+    for (const auto& tag : tags) {
+        auto list = static_cast<uint16_t>(document.lists.size());
+        document.lists.push_back(tag);
+        auto encoded = builder.getImageLists().find(tag);
+        if (encoded != builder.getImageLists().end()) {
+            for (const auto& image : encoded->second->getImages()) {
+                document.frames.push_back({image->getPath(), list, "", image->getBase64()});
+            }
+        }
+        auto pending = builder.getImagePaths().find(tag);
+        if (pending != builder.getImagePaths().end()) {
+            for (const auto& path : pending->second) {
+                document.frames.push_back({path, list, path, {}});
+            }
+        }
+        auto source = builder.getImageSources().find(tag);
+        if (source != builder.getImageSources().end()) {
+            std::string path;
+            while (source->second(path)) {
+                document.frames.push_back({path, list, path, {}});
+            }
+        }
+    }
+    return document;
+}
+
+Document fromHtml(std::string_view html) {
+    Document document;
+    size_t titleBegin = html.find("<title>");
+    size_t titleEnd = titleBegin == std::string_view::npos ? titleBegin : html.find("</title>", titleBegin);
+    if (titleEnd != std::string_view::npos) {
+        document.title = trim(html.substr(titleBegin + 7, titleEnd - titleBegin - 7));
+        document.contents.emplace_back("SPICE_TITLE", document.title);
+    }
+
+    // Quadros: cada sequência de tags encostadas é o conteúdo de um placeholder de lista
+    std::vector<std::pair<size_t, size_t>> frameTags;
+    std::string_view base64, path;
+    size_t end = 0;
+    size_t previousEnd = std::string_view::npos;
+    for (size_t start = tsimg::utils::HTMLBuilder::findImageTag(html, 0, base64, path, end); start != std::string_view::npos;
+         start = tsimg::utils::HTMLBuilder::findImageTag(html, end, base64, path, end)) {
+        if (start != previousEnd) {
+            size_t index = document.lists.size();
+            document.lists.push_back(index == 0 ? "SPICE_IMAGES" : "SPICE_IMAGES_" + std::to_string(index));
+        }
+        document.frames.push_back({std::string(path), static_cast<uint16_t>(document.lists.size() - 1), "", base64});
+        frameTags.emplace_back(start, end);
+        previousEnd = end;
+    }
+
+    // Imagem do autor: o primeiro data URI fora das tags de quadro
+    const std::string_view dataUri = "data:image/png;base64,";
+    for (size_t pos = html.find(dataUri); pos != std::string_view::npos; pos = html.find(dataUri, pos + 1)) {
+        bool insideFrame = std::any_of(frameTags.begin(), frameTags.end(), [pos](const auto& tag) {
+            return pos >= tag.first && pos < tag.second;
+        });
+        if (insideFrame) continue;
+        size_t begin = pos + dataUri.size();
+        size_t quote = html.find('"', begin);
+        if (quote != std::string_view::npos && quote > begin) {
+            document.authorImageBase64 = std::string(html.substr(begin, quote - begin));
+            break;
+        }
+    }
+
+    // Rótulos: os <span> sem atributos que createLabelTags gera
+    for (size_t pos = html.find("<span>"); pos != std::string_view::npos; pos = html.find("<span>", pos + 6)) {
+        size_t close = html.find("</span>", pos + 6);
+        if (close == std::string_view::npos) break;
+        document.labels.emplace_back(html.substr(pos + 6, close - pos - 6));
+    }
+    return document;
+}
+
+uint64_t write(const std::string& outputFile, const Document& document, bool debug) {
+    tsimg::utils::debugLog(debug, "Writing SPICE container: " + outputFile);
+    if (document.frames.empty()) {
+        throw std::runtime_error("No frames to write to container");
+    }
+    if (document.lists.size() > 0xffff || document.frames.size() > 0xffffffffu) {
+        throw std::runtime_error("Too many frames or lists for container");
+    }
+
+    std::vector<FrameInfo> infos;
+    infos.reserve(document.frames.size());
+    for (const auto& frame : document.frames) {
+        infos.push_back(inspect(frame));
+    }
+
+    std::string meta = metadataJson(document).dump();
+    Header header;
+    header.frameCount = static_cast<uint32_t>(document.frames.size());
+    header.metaOffset = kHeaderSize + kIndexEntrySize * document.frames.size();
+    header.metaSize = meta.size();
+    header.dataOffset = header.metaOffset + header.metaSize;
+
+    // Cabeçalho, índice e metadados num só buffer, escrito de uma vez
+    std::vector<uint8_t> head(static_cast<size_t>(header.metaOffset), 0);
+    std::vector<size_t> positionInList(document.lists.size(), 0);
+    uint64_t offset = header.dataOffset;
+    for (size_t i = 0; i < document.frames.size(); ++i) {
+        uint8_t* entry = head.data() + kHeaderSize + kIndexEntrySize * i;
+        const auto& frame = document.frames[i];
+        size_t position = positionInList[frame.list]++;
+        put64(entry, offset);
+        put64(entry + 8, infos[i].size);
+        put32(entry + 16, infos[i].width);
+        put32(entry + 20, infos[i].height);
+        put16(entry + 24, frame.list);
+        entry[26] = static_cast<uint8_t>(infos[i].mime);
+        put32(entry + 28, position < document.labels.size() ? static_cast<uint32_t>(position) : kNoLabel);
+        offset += infos[i].size;
+    }
+    header.fileSize = offset;
+
+    std::memcpy(head.data(), kMagic, sizeof(kMagic));
+    put32(head.data() + 8, header.version);
+    put32(head.data() + 12, static_cast<uint32_t>(kHeaderSize));
+    put32(head.data() + 16, header.frameCount);
+    put32(head.data() + 20, static_cast<uint32_t>(kIndexEntrySize));
+    put64(head.data() + 24, kHeaderSize);
+    put64(head.data() + 32, header.metaOffset);
+    put64(head.data() + 40, header.metaSize);
+    put64(head.data() + 48, header.dataOffset);
+    put64(head.data() + 56, header.fileSize);
+
+    try {
+        Output out(outputFile, debug);
+        out.write(head.data(), head.size());
+        out.write(meta.data(), meta.size());
+        for (size_t i = 0; i < document.frames.size(); ++i) {
+            const auto& frame = document.frames[i];
+            if (!frame.path.empty()) {
+                out.copyFile(frame.path, infos[i].size);
+            } else {
+                writeBase64(out, frame.base64);
+            }
+        }
+        out.finish();
+    } catch (...) {
+        if (!tsimg::utils::FileHandler::isStdStream(outputFile)) {
+            std::error_code ec;
+            std::filesystem::remove(outputFile, ec);
+        }
+        throw;
+    }
+
+    tsimg::utils::debugLog(debug, "Container written: " + std::to_string(header.frameCount) + " frames, " +
+                                      std::to_string(header.fileSize) + " bytes");
+    return header.fileSize;
+}
+
+Reader::Reader(const std::string& path) {
+#ifdef TSIMG_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file: " + path + " (" + std::strerror(errno) + ")");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not stat file: " + path + " (" + std::strerror(errno) + ")");
+    }
+    size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("Could not map file: " + path + " (" + std::strerror(errno) + ")");
+    }
+    data = static_cast<const uint8_t*>(mapping);
+#else
+    buffer = tsimg::utils::FileIO::readBinary(path);
+    data = buffer.data();
+    size = buffer.size();
+#endif
+
+    try {
+        if (size < kHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+            throw std::runtime_error("Not a SPICE container: " + path);
+        }
+        head.version = get32(data + 8);
+        if (head.version == 0 || head.version > kVersion) {
+            throw std::runtime_error("Unsupported SPICE container version " + std::to_string(head.version) + ": " + path);
+        }
+        uint32_t headerSize = get32(data + 12);
+        head.frameCount = get32(data + 16);
+        uint32_t entrySize = get32(data + 20);
+        uint64_t indexOffset = get64(data + 24);
+        head.metaOffset = get64(data + 32);
+        head.metaSize = get64(data + 40);
+        head.dataOffset = get64(data + 48);
+        head.fileSize = get64(data + 56);
+
+        // Versões futuras podem crescer cabeçalho e entradas; os campos conhecidos ficam no lugar.
+        // Offsets vêm do arquivo: as comparações subtraem de size para nunca estourar 64 bits.
+        if (headerSize < kHeaderSize || entrySize < kIndexEntrySize || indexOffset < headerSize ||
+            indexOffset > size || head.frameCount > (size - indexOffset) / entrySize ||
+            head.metaOffset > size || head.metaSize > size - head.metaOffset ||
+            head.dataOffset > size || head.fileSize > size) {
+            throw std::runtime_error("Corrupted SPICE container header: " + path);
+        }
+
+        index.resize(head.frameCount);
+        for (uint32_t i = 0; i < head.frameCount; ++i) {
+            const uint8_t* entry = data + indexOffset + uint64_t(entrySize) * i;
+            auto& e = index[i];
+            e.offset = get64(entry);
+            e.size = get64(entry + 8);
+            e.width = get32(entry + 16);
+            e.height = get32(entry + 20);
+            e.list = get16(entry + 24);
+            e.mime = entry[26] <= static_cast<uint8_t>(Mime::Webp) ? static_cast<Mime>(entry[26]) : Mime::Unknown;
+            e.label = get32(entry + 28);
+            if (e.offset > size || e.size > size - e.offset) {
+                throw std::runtime_error("Corrupted SPICE container index (frame " + std::to_string(i) + "): " + path);
+            }
+        }
+
+        meta = nlohmann::json::parse(data + head.metaOffset, data + head.metaOffset + head.metaSize);
+    } catch (...) {
+#ifdef TSIMG_HAS_MMAP
+        if (mapping) ::munmap(mapping, size);
+#endif
+        throw;
+    }
+}
+
+Reader::~Reader() {
+#ifdef TSIMG_HAS_MMAP
+    if (mapping) ::munmap(mapping, size);
+#endif
+}
+
+std::string_view Reader::frame(size_t i) const {
+    const auto& e = index.at(i);
+    return std::string_view(reinterpret_cast<const char*>(data + e.offset), static_cast<size_t>(e.size));
+}
+
+std::string Reader::frameName(size_t i) const {
+    auto names = meta.find("names");
+    if (names != meta.end() && names->is_array() && i < names->size() && (*names)[i].is_string()) {
+        return (*names)[i].get<std::string>();
+    }
+    return "frame_" + std::to_string(i + 1);
+}
+
+bool isContainer(const std::string& path) {
+    char magic[sizeof(kMagic)] = {};
+    std::ifstream file(path, std::ios::binary);
+    file.read(magic, sizeof(magic));
+    return file.gcount() == static_cast<std::streamsize>(sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+void convert(const std::string& input, const std::string& output, const std::string& templatePath, bool debug) {
+    if (isContainer(input)) {
+        Reader reader(input);
+        const auto& meta = reader.metadata();
+        tsimg::utils::debugLog(debug, "Converting container with " + std::to_string(reader.entries().size()) + " frames to HTML");
+
+        SPICEBuilder builder(meta.value("title", ""), debug);
+        for (const auto& content : meta.value("contents", nlohmann::json::array())) {
+            builder.addContent(content.value("tag", ""), content.value("content", ""));
+        }
+        builder.addLabels(meta.value("labels", std::vector<std::string>{}));
+        builder.setAuthorImageBase64(meta.value("author_image", ""));
+
+        // O template gravado pode não existir nesta máquina; nesse caso vale o padrão
+        std::string chosen = templatePath.empty() ? meta.value("template", "") : templatePath;
+        std::unique_ptr<TemplateWriter> writer;
+        try {
+            writer = std::make_unique<TemplateWriter>(chosen, debug);
+        } catch (const std::exception& e) {
+            if (!templatePath.empty()) throw;
+            tsimg::utils::debugLog(debug, "Template " + chosen + " unavailable (" + e.what() + "), using default");
+            writer = std::make_unique<TemplateWriter>("", debug);
+        }
+        writer->streamFromContainer(output, builder, reader);
+    } else {
+        std::string html = tsimg::utils::FileHandler::readFile(input, debug);
+        tsimg::memory::Charge charge(tsimg::memory::Stage::Ingest, html.size());
+        Document document = fromHtml(html);
+        if (document.frames.empty()) {
+            throw std::runtime_error("No SPICE frames found in " + input);
+        }
+        document.templatePath = templatePath;
+        tsimg::utils::debugLog(debug, "Converting HTML with " + std::to_string(document.frames.size()) + " frames in " +
+                                          std::to_string(document.lists.size()) + " lists to container");
+        write(output, document, debug);
+    }
+}
+
+void writeLoader(const std::string& loaderFile, const std::string& containerUrl, const std::string& title, bool debug) {
+    std::string content = tsimg::utils::getTemplateContent(TemplateWriter::resolveTemplatePath("template_range"), debug);
+    // A URL vai dentro de uma string JavaScript
+    std::string escapedUrl;
+    for (char c : containerUrl) {
+        if (c == '\\' || c == '\'' || c == '"') escapedUrl += '\\';
+        if (c == '<') {
+            escapedUrl += "\\x3c";
+            continue;
+        }
+        escapedUrl += c;
+    }
+    content = replaceAll(std::move(content), "<SPICE_CONTAINER_URL>", escapedUrl);
+    content = replaceAll(std::move(content), "<SPICE_TITLE>", title);
+    tsimg::utils::FileHandler::writeFile(loaderFile, content, debug);
+    tsimg::utils::debugLog(debug, "Range loader written: " + loaderFile + " -> " + containerUrl);
+}
+
+}
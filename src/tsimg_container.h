@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+class SPICEBuilder;
+
+// Contêiner binário .spice: os quadros ficam como estão no disco (sem Base64) e um índice no
+// início permite ler qualquer quadro isoladamente, por mmap ou por HTTP Range.
+//
+// Layout (inteiros little-endian):
+//   [0, 64)            cabeçalho (Header)
+//   [64, 64 + 32*n)    índice, uma IndexEntry por quadro
+//   [metaOffset, +metaSize)  metadados em JSON: título, conteúdos, rótulos, listas, nomes
+//   [dataOffset, ...)  quadros, na ordem do índice
+namespace tsimg::container {
+
+    constexpr char kMagic[8] = {'\x89', 'S', 'P', 'C', '\r', '\n', '\x1a', '\n'};
+    constexpr uint32_t kVersion = 1;
+    constexpr size_t kHeaderSize = 64;
+    constexpr size_t kIndexEntrySize = 32;
+    constexpr uint32_t kNoLabel = 0xffffffffu;
+
+    enum class Mime : uint8_t { Unknown, Png, Jpeg, Gif, Bmp, Webp };
+    const char* mimeName(Mime mime);
+    // Pelos primeiros bytes do arquivo
+    Mime sniffMime(const uint8_t* data, size_t size);
+
+    struct Header {
+        uint32_t version = kVersion;
+        uint32_t frameCount = 0;
+        uint64_t metaOffset = 0;
+        uint64_t metaSize = 0;
+        uint64_t dataOffset = 0;
+        uint64_t fileSize = 0;
+    };
+
+    struct IndexEntry {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t width = 0; // 0 quando o formato não é reconhecido
+        uint32_t height = 0;
+        uint16_t list = 0; // índice em Document::lists
+        Mime mime = Mime::Unknown;
+        uint32_t label = kNoLabel; // índice em Document::labels
+    };
+
+    // Quadro a gravar: lido de path ou decodificado de base64 (conversão a partir do HTML)
+    struct FrameSource {
+        std::string name;
+        uint16_t list = 0;
+        std::string path;
+        std::string_view base64;
+    };
+
+    struct Document {
+        std::string title;
+        std::string templatePath;
+        std::vector<std::pair<std::string, std::string>> contents; // tag e conteúdo, na ordem do builder
+        std::vector<std::string> labels;
+        std::string authorImageBase64;
+        std::vector<std::string> lists; // placeholder de cada lista (SPICE_IMAGES, SPICE_IMAGES_1...)
+        std::vector<FrameSource> frames;
+    };
+
+    // Caminhos pendentes e fontes sob demanda do builder (estas são consumidas aqui); quadros
+    // já codificados em Base64 entram como base64
+    Document fromBuilder(const SPICEBuilder& builder);
+
+    // Documento gerado pelo tsimg: cada sequência de tags <img> de quadro vira uma lista, na
+    // ordem do documento. As views apontam para html, que precisa continuar vivo até o write.
+    Document fromHtml(std::string_view html);
+
+    // Grava o contêiner ("-" = stdout). Cabeçalho, índice e metadados saem primeiro; os quadros
+    // são copiados arquivo a arquivo pelo kernel (copy_file_range/sendfile) quando possível.
+    // Devolve o tamanho do arquivo.
+    uint64_t write(const std::string& outputFile, const Document& document, bool debug);
+
+    // Contêiner aberto para leitura: mapeado em memória (mmap) quando a plataforma permite,
+    // senão lido inteiro. Lança std::runtime_error se o arquivo não for um contêiner válido.
+    class Reader {
+    public:
+        explicit Reader(const std::string& path);
+        ~Reader();
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        const Header& header() const { return head; }
+        const std::vector<IndexEntry>& entries() const { return index; }
+        const nlohmann::json& metadata() const { return meta; }
+        std::string_view frame(size_t i) const;
+        // Nome do quadro i (caminho original), para o alt das tags
+        std::string frameName(size_t i) const;
+
+    private:
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        void* mapping = nullptr;
+        std::vector<uint8_t> buffer;
+        Header head;
+        std::vector<IndexEntry> index;
+        nlohmann::json meta;
+    };
+
+    bool isContainer(const std::string& path);
+
+    // Contêiner -> HTML ou HTML -> contêiner, conforme o conteúdo de input. templatePath, se não
+    // vazio, substitui o template gravado no contêiner.
+    void convert(const std::string& input, const std::string& output, const std::string& templatePath, bool debug);
+
+    // Página (template_range) que lê o contêiner em containerUrl por HTTP Range, quadro a quadro
+    void writeLoader(const std::string& loaderFile, const std::string& containerUrl, const std::string& title, bool debug);
+}
@@ -0,0 +1,800 @@
+#include "tsimg_downscale.h"
+#include "tsimg_memory.h"
+#include "tsimg_spice.h"
+#include <stb_image.h>
+#include <stb_image_resize2.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace tsimg::downscale {
+
+namespace {
+    // Bytes do IDAT de um PNG, em sequência, atravessando os chunks
+    class IdatStream {
+    public:
+        IdatStream(std::FILE* file, uint32_t firstChunkLength) : file(file), chunkRemaining(firstChunkLength) {}
+
+        int next() {
+            if (pos == end && !refill()) return -1;
+            return buffer[pos++];
+        }
+
+    private:
+        bool refill() {
+            while (chunkRemaining == 0) {
+                uint8_t header[12]; // CRC do chunk anterior + tamanho + tipo do próximo
+                if (finished || std::fread(header, 1, 12, file) != 12) {
+                    finished = true;
+                    return false;
+                }
+                chunkRemaining = (uint32_t(header[4]) << 24) | (uint32_t(header[5]) << 16) | (uint32_t(header[6]) << 8) | header[7];
+                if (std::memcmp(header + 8, "IDAT", 4) != 0) {
+                    finished = true;
+                    return false;
+                }
+            }
+            size_t want = std::min<size_t>(chunkRemaining, sizeof(buffer));
+            size_t got = std::fread(buffer, 1, want, file);
+            if (got == 0) {
+                finished = true;
+                return false;
+            }
+            chunkRemaining -= static_cast<uint32_t>(got);
+            pos = 0;
+            end = got;
+            return true;
+        }
+
+        std::FILE* file;
+        uint32_t chunkRemaining;
+        bool finished = false;
+        uint8_t buffer[1 << 16];
+        size_t pos = 0;
+        size_t end = 0;
+    };
+
+    // Inflate (RFC 1950/1951) incremental: entrega o fluxo descomprimido aos pedaços, com a
+    // janela de 32 KiB como único estado grande
+    class Inflater {
+    public:
+        explicit Inflater(IdatStream& source) : source(source), window(kWindowSize) {
+            int cmf = source.next();
+            int flg = source.next();
+            if (cmf < 0 || flg < 0 || (cmf & 0x0f) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) {
+                throw std::runtime_error("Unsupported zlib stream in PNG");
+            }
+        }
+
+        // Preenche dst com n bytes; devolve false se o fluxo terminar antes
+        bool read(uint8_t* dst, size_t n) {
+            size_t produced = 0;
+            while (produced < n) {
+                if (copyRemaining > 0) {
+                    size_t count = std::min(copyRemaining, n - produced);
+                    for (size_t i = 0; i < count; ++i) {
+                        uint8_t byte = window[(windowPos - copyDistance) & kWindowMask];
+                        window[windowPos++ & kWindowMask] = byte;
+                        dst[produced++] = byte;
+                    }
+                    copyRemaining -= count;
+                } else if (state == State::Stored) {
+                    if (storedRemaining == 0) {
+                        state = State::Idle;
+                        continue;
+                    }
+                    uint8_t byte = static_cast<uint8_t>(bits(8));
+                    window[windowPos++ & kWindowMask] = byte;
+                    dst[produced++] = byte;
+                    --storedRemaining;
+                } else if (state == State::Huffman) {
+                    int symbol = decode(literals);
+                    if (symbol < 256) {
+                        window[windowPos++ & kWindowMask] = static_cast<uint8_t>(symbol);
+                        dst[produced++] = static_cast<uint8_t>(symbol);
+                    } else if (symbol == 256) {
+                        state = State::Idle;
+                    } else {
+                        symbol -= 257;
+                        if (symbol >= 29) throw std::runtime_error("Invalid deflate length code");
+                        copyRemaining = kLengthBase[symbol] + bits(kLengthExtra[symbol]);
+                        int distanceSymbol = decode(distances);
+                        if (distanceSymbol >= 30) throw std::runtime_error("Invalid deflate distance code");
+                        copyDistance = kDistanceBase[distanceSymbol] + bits(kDistanceExtra[distanceSymbol]);
+                        if (copyDistance > windowPos) throw std::runtime_error("Invalid deflate distance");
+                    }
+                } else {
+                    if (lastBlock) return false;
+                    startBlock();
+                }
+            }
+            return true;
+        }
+
+    private:
+        static constexpr size_t kWindowSize = 32768;
+        static constexpr size_t kWindowMask = kWindowSize - 1;
+        static constexpr int kFastBits = 10;
+
+        static constexpr uint16_t kLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static constexpr uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static constexpr uint16_t kDistanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        static constexpr uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+        enum class State { Idle, Stored, Huffman };
+
+        struct Huffman {
+            uint16_t counts[16] = {};
+            uint16_t symbols[288] = {};
+            uint16_t fast[1 << kFastBits] = {}; // símbolo << 4 | tamanho; 0 = código longo
+        };
+
+        void need(int count) {
+            while (bitCount < count) {
+                int byte = source.next();
+                if (byte < 0) {
+                    // Bits além do fim só podem ser lidos pela espiada da tabela rápida
+                    if (++overrun > 8) throw std::runtime_error("Truncated PNG data");
+                    byte = 0;
+                }
+                bitBuffer |= static_cast<uint64_t>(byte) << bitCount;
+                bitCount += 8;
+            }
+        }
+
+        uint32_t bits(int count) {
+            if (count == 0) return 0;
+            need(count);
+            uint32_t value = static_cast<uint32_t>(bitBuffer & ((uint64_t(1) << count) - 1));
+            bitBuffer >>= count;
+            bitCount -= count;
+            return value;
+        }
+
+        static void build(Huffman& h, const uint8_t* lengths, int count) {
+            std::fill(std::begin(h.counts), std::end(h.counts), 0);
+            std::fill(std::begin(h.fast), std::end(h.fast), 0);
+            for (int i = 0; i < count; ++i) {
+                ++h.counts[lengths[i]];
+            }
+            h.counts[0] = 0;
+            uint16_t offsets[16] = {};
+            for (int len = 1; len < 16; ++len) {
+                offsets[len] = offsets[len - 1] + h.counts[len - 1];
+            }
+            uint16_t nextCode[16] = {};
+            uint32_t code = 0;
+            for (int len = 1; len < 16; ++len) {
+                code = (code + h.counts[len - 1]) << 1;
+                nextCode[len] = static_cast<uint16_t>(code);
+            }
+            for (int symbol = 0; symbol < count; ++symbol) {
+                int len = lengths[symbol];
+                if (len == 0) continue;
+                h.symbols[offsets[len]++] = static_cast<uint16_t>(symbol);
+                uint32_t canonical = nextCode[len]++;
+                if (len <= kFastBits) {
+                    // Os códigos chegam com o bit mais significativo primeiro
+                    uint32_t reversed = 0;
+                    for (int b = 0; b < len; ++b) {
+                        reversed |= ((canonical >> b) & 1) << (len - 1 - b);
+                    }
+                    for (uint32_t fill = reversed; fill < (1u << kFastBits); fill += 1u << len) {
+                        h.fast[fill] = static_cast<uint16_t>((symbol << 4) | len);
+                    }
+                }
+            }
+        }
+
+        int decode(const Huffman& h) {
+            need(kFastBits);
+            uint16_t entry = h.fast[bitBuffer & ((1u << kFastBits) - 1)];
+            if (entry != 0) {
+                int len = entry & 0x0f;
+                bitBuffer >>= len;
+                bitCount -= len;
+                return entry >> 4;
+            }
+            // Código longo: decodificação canônica bit a bit
+            int code = 0, first = 0, index = 0;
+            for (int len = 1; len < 16; ++len) {
+                code |= static_cast<int>(bits(1));
+                int count = h.counts[len];
+                if (code - count < first) {
+                    return h.symbols[index + (code - first)];
+                }
+                index += count;
+                first = (first + count) << 1;
+                code <<= 1;
+            }
+            throw std::runtime_error("Invalid deflate Huffman code");
+        }
+
+        void startBlock() {
+            lastBlock = bits(1) != 0;
+            uint32_t type = bits(2);
+            if (type == 0) {
+                bitBuffer >>= bitCount & 7; // alinha no byte
+                bitCount -= bitCount & 7;
+                uint32_t length = bits(16);
+                uint32_t complement = bits(16);
+                if ((length ^ 0xffff) != complement) throw std::runtime_error("Invalid stored deflate block");
+                storedRemaining = length;
+                state = State::Stored;
+            } else if (type == 1) {
+                uint8_t lengths[288 + 30];
+                std::fill(lengths, lengths + 144, 8);
+                std::fill(lengths + 144, lengths + 256, 9);
+                std::fill(lengths + 256, lengths + 280, 7);
+                std::fill(lengths + 280, lengths + 288, 8);
+                std::fill(lengths + 288, lengths + 318, 5);
+                build(literals, lengths, 288);
+                build(distances, lengths + 288, 30);
+                state = State::Huffman;
+            } else if (type == 2) {
+                static constexpr uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+                int literalCount = static_cast<int>(bits(5)) + 257;
+                int distanceCount = static_cast<int>(bits(5)) + 1;
+                int codeLengthCount = static_cast<int>(bits(4)) + 4;
+                uint8_t codeLengths[19] = {};
+                for (int i = 0; i < codeLengthCount; ++i) {
+                    codeLengths[order[i]] = static_cast<uint8_t>(bits(3));
+                }
+                Huffman lengthCode;
+                build(lengthCode, codeLengths, 19);
+                uint8_t lengths[288 + 32] = {};
+                int total = literalCount + distanceCount;
+                for (int i = 0; i < total;) {
+                    int symbol = decode(lengthCode);
+                    if (symbol < 16) {
+                        lengths[i++] = static_cast<uint8_t>(symbol);
+                        continue;
+                    }
+                    int repeat = 0;
+                    uint8_t value = 0;
+                    if (symbol == 16) {
+                        if (i == 0) throw std::runtime_error("Invalid deflate code lengths");
+                        value = lengths[i - 1];
+                        repeat = 3 + static_cast<int>(bits(2));
+                    } else if (symbol == 17) {
+                        repeat = 3 + static_cast<int>(bits(3));
+                    } else {
+                        repeat = 11 + static_cast<int>(bits(7));
+                    }
+                    if (i + repeat > total) throw std::runtime_error("Invalid deflate code lengths");
+                    std::fill(lengths + i, lengths + i + repeat, value);
+                    i += repeat;
+                }
+                build(literals, lengths, literalCount);
+                build(distances, lengths + literalCount, distanceCount);
+                state = State::Huffman;
+            } else {
+                throw std::runtime_error("Invalid deflate block type");
+            }
+        }
+
+        IdatStream& source;
+        std::vector<uint8_t> window;
+        size_t windowPos = 0;
+        uint64_t bitBuffer = 0;
+        int bitCount = 0;
+        int overrun = 0;
+        State state = State::Idle;
+        bool lastBlock = false;
+        size_t storedRemaining = 0;
+        size_t copyRemaining = 0;
+        size_t copyDistance = 0;
+        Huffman literals;
+        Huffman distances;
+    };
+
+    uint32_t readBigEndian(const uint8_t* p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    }
+
+    // Leitor de PNG linha a linha: cabeçalho, paleta e IDAT em fluxo, sem carregar o arquivo
+    class PngRowReader {
+    public:
+        ~PngRowReader() {
+            if (file) std::fclose(file);
+        }
+
+        // false se não for um PNG que dê para ler em fluxo (entrelaçado, corrompido...)
+        bool open(const std::string& path) {
+            file = std::fopen(path.c_str(), "rb");
+            if (!file) return false;
+            uint8_t signature[8];
+            static const uint8_t pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+            if (std::fread(signature, 1, 8, file) != 8 || std::memcmp(signature, pngSignature, 8) != 0) return false;
+            png = true;
+
+            bool haveHeader = false;
+            for (;;) {
+                uint8_t header[8];
+                if (std::fread(header, 1, 8, file) != 8) return false;
+                uint32_t length = readBigEndian(header);
+                if (std::memcmp(header + 4, "IHDR", 4) == 0) {
+                    uint8_t data[13];
+                    if (length != 13 || std::fread(data, 1, 13, file) != 13) return false;
+                    width = static_cast<int>(readBigEndian(data));
+                    height = static_cast<int>(readBigEndian(data + 4));
+                    bitDepth = data[8];
+                    colorType = data[9];
+                    if (data[10] != 0 || data[11] != 0 || data[12] != 0) return false; // entrelaçado
+                    if (std::fseek(file, 4, SEEK_CUR) != 0) return false;
+                    haveHeader = true;
+                } else if (std::memcmp(header + 4, "PLTE", 4) == 0) {
+                    if (length > 768 || length % 3 != 0) return false;
+                    palette.resize(length);
+                    if (std::fread(palette.data(), 1, length, file) != length || std::fseek(file, 4, SEEK_CUR) != 0) return false;
+                } else if (std::memcmp(header + 4, "tRNS", 4) == 0) {
+                    // Paleta: alfa por entrada; cinza e RGB: a cor (nas amostras originais) que vira transparente
+                    if (!haveHeader || length > 256) return false;
+                    uint8_t data[256];
+                    if (std::fread(data, 1, length, file) != length || std::fseek(file, 4, SEEK_CUR) != 0) return false;
+                    if (colorType == 3) {
+                        paletteAlpha.assign(data, data + length);
+                    } else if ((colorType == 0 && length == 2) || (colorType == 2 && length == 6)) {
+                        for (uint32_t i = 0; i < length / 2; ++i) {
+                            transparentKey[i] = static_cast<uint16_t>((data[i * 2] << 8) | data[i * 2 + 1]);
+                        }
+                        hasTransparentKey = true;
+                    } else {
+                        return false;
+                    }
+                } else if (std::memcmp(header + 4, "IDAT", 4) == 0) {
+                    if (!haveHeader) return false;
+                    stream = std::make_unique<IdatStream>(file, length);
+                    break;
+                } else {
+                    if (std::fseek(file, static_cast<long>(length) + 4, SEEK_CUR) != 0) return false;
+                }
+            }
+
+            int samples = 0;
+            switch (colorType) {
+                case 0: samples = 1; channels = 1; break;
+                case 2: samples = 3; channels = 3; break;
+                case 3: samples = 1; channels = 3; break;
+                case 4: samples = 2; channels = 2; break;
+                case 6: samples = 4; channels = 4; break;
+                default: return false;
+            }
+            if (colorType == 3 && palette.empty()) return false;
+            // Com tRNS o quadro ganha um canal alfa
+            if (!paletteAlpha.empty() || hasTransparentKey) channels = colorType == 0 ? 2 : 4;
+            if (bitDepth != 1 && bitDepth != 2 && bitDepth != 4 && bitDepth != 8 && bitDepth != 16) return false;
+            if ((colorType == 2 || colorType == 4 || colorType == 6) && bitDepth < 8) return false;
+            if (width <= 0 || height <= 0) return false;
+
+            bytesPerPixel = std::max(1, samples * bitDepth / 8);
+            rowBytes = (static_cast<size_t>(width) * samples * bitDepth + 7) / 8;
+            current.assign(rowBytes, 0);
+            previous.assign(rowBytes, 0);
+            inflater = std::make_unique<Inflater>(*stream);
+            return true;
+        }
+
+        // Próxima linha, convertida para 8 bits por canal (channels canais)
+        void readRow(uint8_t* dst) {
+            uint8_t filter = 0;
+            if (!inflater->read(&filter, 1) || !inflater->read(current.data(), rowBytes)) {
+                throw std::runtime_error("Truncated PNG image data");
+            }
+            unfilter(filter);
+            convert(dst);
+            std::swap(current, previous);
+        }
+
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        bool png = false; // assinatura PNG reconhecida, mesmo que open devolva false
+
+    private:
+        void unfilter(uint8_t filter) {
+            uint8_t* cur = current.data();
+            const uint8_t* prev = previous.data();
+            const size_t bpp = static_cast<size_t>(bytesPerPixel);
+            switch (filter) {
+                case 0:
+                    break;
+                case 1:
+                    for (size_t i = bpp; i < rowBytes; ++i) cur[i] = static_cast<uint8_t>(cur[i] + cur[i - bpp]);
+                    break;
+                case 2:
+                    for (size_t i = 0; i < rowBytes; ++i) cur[i] = static_cast<uint8_t>(cur[i] + prev[i]);
+                    break;
+                case 3:
+                    for (size_t i = 0; i < rowBytes; ++i) {
+                        int left = i >= bpp ? cur[i - bpp] : 0;
+                        cur[i] = static_cast<uint8_t>(cur[i] + ((left + prev[i]) >> 1));
+                    }
+                    break;
+                case 4:
+                    for (size_t i = 0; i < rowBytes; ++i) {
+                        int a = i >= bpp ? cur[i - bpp] : 0;
+                        int b = prev[i];
+                        int c = i >= bpp ? prev[i - bpp] : 0;
+                        int p = a + b - c;
+                        int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+                        int predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                        cur[i] = static_cast<uint8_t>(cur[i] + predictor);
+                    }
+                    break;
+                default:
+                    throw std::runtime_error("Invalid PNG filter type");
+            }
+        }
+
+        void convert(uint8_t* dst) const {
+            const uint8_t* src = current.data();
+            if (bitDepth == 8 && colorType != 3 && !hasTransparentKey) {
+                std::memcpy(dst, src, static_cast<size_t>(width) * channels);
+                return;
+            }
+            if (bitDepth >= 8 && colorType != 3) {
+                // 8 ou 16 bits por amostra (16 ficam com o byte mais significativo); a chave do
+                // tRNS é comparada com as amostras originais
+                const int samples = hasTransparentKey ? channels - 1 : channels;
+                const int bytes = bitDepth / 8;
+                for (int x = 0; x < width; ++x) {
+                    const uint8_t* p = src + static_cast<size_t>(x) * samples * bytes;
+                    bool transparent = hasTransparentKey;
+                    for (int i = 0; i < samples; ++i) {
+                        uint16_t value = bytes == 2 ? static_cast<uint16_t>((p[i * 2] << 8) | p[i * 2 + 1]) : p[i];
+                        transparent = transparent && value == transparentKey[i];
+                        *dst++ = p[i * bytes];
+                    }
+                    if (hasTransparentKey) *dst++ = transparent ? 0 : 255;
+                }
+                return;
+            }
+            // Tons de cinza ou paleta com 1, 2, 4 ou 8 bits por pixel
+            int perByte = 8 / bitDepth;
+            int mask = (1 << bitDepth) - 1;
+            int scale = colorType == 0 ? 255 / mask : 1;
+            size_t paletteEntries = palette.size() / 3;
+            for (int x = 0; x < width; ++x) {
+                int shift = 8 - bitDepth * (x % perByte + 1);
+                int value = (src[x / perByte] >> shift) & mask;
+                if (colorType == 3) {
+                    size_t entry = static_cast<size_t>(value) < paletteEntries ? static_cast<size_t>(value) : 0;
+                    *dst++ = palette[entry * 3 + 0];
+                    *dst++ = palette[entry * 3 + 1];
+                    *dst++ = palette[entry * 3 + 2];
+                    if (channels == 4) *dst++ = entry < paletteAlpha.size() ? paletteAlpha[entry] : 255;
+                } else {
+                    *dst++ = static_cast<uint8_t>(value * scale);
+                    if (channels == 2) *dst++ = value == transparentKey[0] ? 0 : 255;
+                }
+            }
+        }
+
+        std::FILE* file = nullptr;
+        std::unique_ptr<IdatStream> stream;
+        std::unique_ptr<Inflater> inflater;
+        int bitDepth = 0;
+        int colorType = 0;
+        int bytesPerPixel = 1;
+        size_t rowBytes = 0;
+        std::vector<uint8_t> palette;
+        std::vector<uint8_t> paletteAlpha;
+        uint16_t transparentKey[3] = {0, 0, 0};
+        bool hasTransparentKey = false;
+        std::vector<uint8_t> current;
+        std::vector<uint8_t> previous;
+    };
+
+    // Linhas da imagem de entrada, nos canais nativos, disponíveis em [first, first + count)
+    class RowWindow {
+    public:
+        virtual ~RowWindow() = default;
+        virtual void ensure(int begin, int end) = 0;
+        virtual const uint8_t* row(int y) const = 0;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+    };
+
+    // Imagem decodificada inteira pelo stb_image (formatos sem leitura em fluxo)
+    class DecodedRows : public RowWindow {
+    public:
+        DecodedRows(uint8_t* pixels, int w, int h, int c, tsimg::memory::Stage stage)
+            : pixels(pixels), charge(stage, static_cast<size_t>(w) * h * c) {
+            width = w;
+            height = h;
+            channels = c;
+        }
+        ~DecodedRows() override {
+            stbi_image_free(pixels);
+        }
+        void ensure(int, int) override {}
+        const uint8_t* row(int y) const override {
+            return pixels + static_cast<size_t>(y) * width * channels;
+        }
+
+    private:
+        uint8_t* pixels;
+        tsimg::memory::Charge charge;
+    };
+
+    // Janela deslizante sobre um PNG lido em fluxo; nunca guarda mais que capacity linhas
+    class StreamedRows : public RowWindow {
+    public:
+        StreamedRows(std::unique_ptr<PngRowReader> reader, int capacity, tsimg::memory::Stage stage)
+            : reader(std::move(reader)), capacity(capacity) {
+            width = this->reader->width;
+            height = this->reader->height;
+            channels = this->reader->channels;
+            rowBytes = static_cast<size_t>(width) * channels;
+            buffer.resize(rowBytes * static_cast<size_t>(capacity));
+            charge = tsimg::memory::Charge(stage, buffer.size());
+        }
+
+        void ensure(int begin, int end) override {
+            end = std::min(end, height);
+            if (end - begin > capacity) throw std::runtime_error("Row window too small for resize band");
+            if (begin > first) {
+                // Descarta as linhas que nenhuma faixa seguinte vai usar
+                int drop = std::min(begin - first, count);
+                std::memmove(buffer.data(), buffer.data() + rowBytes * drop, rowBytes * (count - drop));
+                first += drop;
+                count -= drop;
+            }
+            while (first + count < end) {
+                if (first + count < begin) {
+                    // Linhas antes da janela: decodifica e descarta
+                    reader->readRow(buffer.data());
+                    ++first;
+                    continue;
+                }
+                reader->readRow(buffer.data() + rowBytes * count);
+                ++count;
+            }
+        }
+
+        const uint8_t* row(int y) const override {
+            // Fora da janela (não deveria acontecer com a margem usada) repete a borda
+            y = std::clamp(y, first, first + count - 1);
+            return buffer.data() + rowBytes * static_cast<size_t>(y - first);
+        }
+
+    private:
+        std::unique_ptr<PngRowReader> reader;
+        int capacity;
+        size_t rowBytes = 0;
+        std::vector<uint8_t> buffer;
+        tsimg::memory::Charge charge;
+        int first = 0;
+        int count = 0;
+    };
+
+    // count pixels com channels canais (1 a 4) para RGBA
+    void expandToRgba(const uint8_t* src, int channels, int count, uint8_t* dst) {
+        if (channels == 4) {
+            std::memcpy(dst, src, static_cast<size_t>(count) * 4);
+            return;
+        }
+        for (int i = 0; i < count; ++i, dst += 4) {
+            switch (channels) {
+                case 1: dst[0] = dst[1] = dst[2] = src[i]; dst[3] = 255; break;
+                case 2: dst[0] = dst[1] = dst[2] = src[i * 2]; dst[3] = src[i * 2 + 1]; break;
+                default: dst[0] = src[i * 3]; dst[1] = src[i * 3 + 1]; dst[2] = src[i * 3 + 2]; dst[3] = 255; break;
+            }
+        }
+    }
+
+    // Entrega ao stbir as linhas pedidas em RGBA, convertendo os canais nativos sob demanda
+    const void* inputRow(void* optionalOutput, const void*, int numPixels, int x, int y, void* context) {
+        const auto* rows = static_cast<const RowWindow*>(context);
+        const uint8_t* src = rows->row(y) + static_cast<size_t>(x) * rows->channels;
+        if (rows->channels == 4) {
+            return src;
+        }
+        expandToRgba(src, rows->channels, numPixels, static_cast<uint8_t*>(optionalOutput));
+        return optionalOutput;
+    }
+
+    void resizeBand(const RowWindow& rows, uint8_t* out, int outWidth, int outHeight, int bandBegin, int bandEnd) {
+        STBIR_RESIZE resize;
+        // A entrada vem toda pelo callback; o ponteiro só precisa ser válido
+        stbir_resize_init(&resize, rows.row(0), rows.width, rows.height, rows.width * rows.channels,
+                          out + static_cast<size_t>(bandBegin) * outWidth * 4, outWidth, bandEnd - bandBegin, outWidth * 4,
+                          STBIR_RGBA, STBIR_TYPE_UINT8);
+        // A faixa de saída corresponde à mesma faixa relativa da entrada; o filtro ainda lê as
+        // linhas vizinhas fora dela, então as faixas emendam sem costura
+        stbir_set_input_subrect(&resize, 0.0, static_cast<double>(bandBegin) / outHeight, 1.0, static_cast<double>(bandEnd) / outHeight);
+        stbir_set_pixel_callbacks(&resize, inputRow, nullptr);
+        stbir_set_user_data(&resize, const_cast<RowWindow*>(&rows));
+        stbir_resize_extended(&resize);
+    }
+
+    void tiledResize(RowWindow& rows, int outWidth, int outHeight, uint8_t* out, const Options& options, bool streamed) {
+        double scale = static_cast<double>(rows.height) / outHeight; // linhas de entrada por linha de saída
+        int margin = static_cast<int>(std::ceil(3.0 * std::max(1.0, scale))) + 2;
+        unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+        size_t rowBytes = static_cast<size_t>(rows.width) * rows.channels;
+
+        // Cada lote processa "threads" faixas em paralelo; a janela do lote cabe em maxBufferBytes
+        double budgetRows = static_cast<double>(options.maxBufferBytes / std::max<size_t>(rowBytes, 1)) - 2.0 * margin - 2.0;
+        int bandRows = static_cast<int>(std::max(1.0, budgetRows / threads / scale));
+        bandRows = std::min(bandRows, (outHeight + static_cast<int>(threads) - 1) / static_cast<int>(threads));
+        int batchRows = bandRows * static_cast<int>(threads);
+
+        tsimg::utils::debugLog(options.debug, "Tiled resize " + std::to_string(rows.width) + "x" + std::to_string(rows.height) +
+            " -> " + std::to_string(outWidth) + "x" + std::to_string(outHeight) + " in bands of " + std::to_string(bandRows) +
+            " rows on " + std::to_string(threads) + " threads" + (streamed ? " (streamed PNG)" : ""));
+
+        for (int batchBegin = 0; batchBegin < outHeight; batchBegin += batchRows) {
+            int batchEnd = std::min(outHeight, batchBegin + batchRows);
+            int inputBegin = std::max(0, static_cast<int>(std::floor(batchBegin * scale)) - margin);
+            int inputEnd = std::min(rows.height, static_cast<int>(std::ceil(batchEnd * scale)) + margin);
+            rows.ensure(inputBegin, inputEnd);
+
+            std::vector<std::thread> workers;
+            for (int band = batchBegin + bandRows; band < batchEnd; band += bandRows) {
+                workers.emplace_back(resizeBand, std::cref(rows), out, outWidth, outHeight, band, std::min(batchEnd, band + bandRows));
+            }
+            resizeBand(rows, out, outWidth, outHeight, batchBegin, std::min(batchEnd, batchBegin + bandRows));
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+    }
+}
+
+bool imageSize(const std::string& path, int& width, int& height) {
+    int channels = 0;
+    return stbi_info(path.c_str(), &width, &height, &channels) != 0;
+}
+
+void fitWithin(int& width, int& height, int maxDimension) {
+    int longest = std::max(width, height);
+    if (maxDimension <= 0 || longest <= maxDimension) return;
+    double factor = static_cast<double>(maxDimension) / longest;
+    width = std::max(1, static_cast<int>(std::lround(width * factor)));
+    height = std::max(1, static_cast<int>(std::lround(height * factor)));
+}
+
+bool loadResizedRgba(const std::string& path, int width, int height, std::vector<uint8_t>& out, const Options& options) {
+    int srcWidth = 0, srcHeight = 0;
+    if (!imageSize(path, srcWidth, srcHeight)) {
+        tsimg::utils::errorLog(options.debug, "Failed to read image header: " + path);
+        return false;
+    }
+    out.resize(static_cast<size_t>(width) * height * 4);
+
+    // Caminho direto quando o RGBA completo cabe no orçamento
+    if (static_cast<size_t>(srcWidth) * srcHeight * 4 <= options.maxBufferBytes) {
+        int w = 0, h = 0, c = 0;
+        unsigned char* pixels = stbi_load(path.c_str(), &w, &h, &c, 4);
+        if (!pixels) {
+            tsimg::utils::errorLog(options.debug, "Failed to load image: " + path);
+            return false;
+        }
+        tsimg::memory::Charge decoded(options.stage, static_cast<size_t>(w) * h * 4);
+        stbir_resize_uint8_linear(pixels, w, h, 0, out.data(), width, height, 0, STBIR_RGBA);
+        stbi_image_free(pixels);
+        return true;
+    }
+
+    bool png = false;
+    try {
+        auto reader = std::make_unique<PngRowReader>();
+        bool streamed = reader->open(path);
+        png = reader->png;
+        if (streamed) {
+            double scale = static_cast<double>(reader->height) / height;
+            size_t rowBytes = static_cast<size_t>(reader->width) * reader->channels;
+            int margin = static_cast<int>(std::ceil(3.0 * std::max(1.0, scale))) + 2;
+            // A janela comporta um lote inteiro mesmo quando o orçamento é menor que uma faixa mínima
+            int capacity = static_cast<int>(std::max<size_t>(options.maxBufferBytes / std::max<size_t>(rowBytes, 1),
+                static_cast<size_t>(std::ceil(scale * (options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency())))) + 2 * margin + 4));
+            capacity = std::min(capacity, reader->height);
+            StreamedRows rows(std::move(reader), capacity, options.stage);
+            tiledResize(rows, width, height, out.data(), options, true);
+            return true;
+        }
+    } catch (const std::exception& e) {
+        tsimg::utils::errorLog(options.debug, "Failed to decode PNG " + path + ": " + e.what());
+        return false;
+    }
+
+    // Sem leitura em fluxo: decodifica nos canais nativos e reduz em faixas do mesmo jeito. PNG
+    // vem sempre em RGBA: com tRNS o stb_image informa os canais sem o alfa que acrescentou
+    int w = 0, h = 0, c = 0;
+    unsigned char* pixels = stbi_load(path.c_str(), &w, &h, &c, png ? 4 : 0);
+    if (!pixels) {
+        tsimg::utils::errorLog(options.debug, "Failed to load image: " + path);
+        return false;
+    }
+    if (png) c = 4;
+    tsimg::utils::debugLog(options.debug, "Decoding " + path + " in full (" + std::to_string(c) + " channels); only non-interlaced PNG is streamed");
+    DecodedRows rows(pixels, w, h, c, options.stage);
+    tiledResize(rows, width, height, out.data(), options, false);
+    return true;
+}
+
+bool loadResizedRgbaFromMemory(const std::vector<unsigned char>& data, int width, int height, std::vector<uint8_t>& out,
+                               const Options& options) {
+    int srcWidth = 0, srcHeight = 0, channels = 0;
+    if (data.empty() || data.size() > static_cast<size_t>(std::numeric_limits<int>::max()) ||
+        !stbi_info_from_memory(data.data(), static_cast<int>(data.size()), &srcWidth, &srcHeight, &channels) ||
+        static_cast<size_t>(srcWidth) * srcHeight * 4 > options.maxBufferBytes) {
+        return false;
+    }
+    int w = 0, h = 0, c = 0;
+    unsigned char* pixels = stbi_load_from_memory(data.data(), static_cast<int>(data.size()), &w, &h, &c, 4);
+    if (!pixels) {
+        return false;
+    }
+    tsimg::memory::Charge decoded(options.stage, static_cast<size_t>(w) * h * 4);
+    out.resize(static_cast<size_t>(width) * height * 4);
+    stbir_resize_uint8_linear(pixels, w, h, 0, out.data(), width, height, 0, STBIR_RGBA);
+    stbi_image_free(pixels);
+    return true;
+}
+
+void resizeRgba(const uint8_t* pixels, int srcWidth, int srcHeight, int width, int height, std::vector<uint8_t>& out) {
+    out.resize(static_cast<size_t>(width) * height * 4);
+    stbir_resize_uint8_linear(pixels, srcWidth, srcHeight, 0, out.data(), width, height, 0, STBIR_RGBA);
+}
+
+bool loadCroppedRgba(const std::string& path, int x, int y, int width, int height, std::vector<uint8_t>& out, const Options& options) {
+    int srcWidth = 0, srcHeight = 0;
+    if (!imageSize(path, srcWidth, srcHeight)) {
+        tsimg::utils::errorLog(options.debug, "Failed to read image header: " + path);
+        return false;
+    }
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > srcWidth || y + height > srcHeight) {
+        tsimg::utils::errorLog(options.debug, "Crop box outside the " + std::to_string(srcWidth) + "x" + std::to_string(srcHeight) + " image: " + path);
+        return false;
+    }
+    out.resize(static_cast<size_t>(width) * height * 4);
+
+    // PNG em fluxo: só as linhas até o fim da caixa são decodificadas e só uma fica em memória
+    bool png = false;
+    try {
+        PngRowReader reader;
+        bool streamed = reader.open(path);
+        png = reader.png;
+        if (streamed) {
+            std::vector<uint8_t> row(static_cast<size_t>(reader.width) * reader.channels);
+            tsimg::memory::Charge rowCharge(options.stage, row.size());
+            for (int r = 0; r < y + height; ++r) {
+                reader.readRow(row.data());
+                if (r >= y) {
+                    expandToRgba(row.data() + static_cast<size_t>(x) * reader.channels, reader.channels, width,
+                                 out.data() + static_cast<size_t>(r - y) * width * 4);
+                }
+            }
+            return true;
+        }
+    } catch (const std::exception& e) {
+        tsimg::utils::errorLog(options.debug, "Failed to decode PNG " + path + ": " + e.what());
+        return false;
+    }
+
+    // PNG entrelaçado vem em RGBA, pelo mesmo motivo de loadResizedRgba
+    int w = 0, h = 0, c = 0;
+    unsigned char* pixels = stbi_load(path.c_str(), &w, &h, &c, png ? 4 : 0);
+    if (!pixels) {
+        tsimg::utils::errorLog(options.debug, "Failed to load image: " + path);
+        return false;
+    }
+    if (png) c = 4;
+    tsimg::memory::Charge decoded(options.stage, static_cast<size_t>(w) * h * c);
+    for (int r = 0; r < height; ++r) {
+        expandToRgba(pixels + (static_cast<size_t>(y + r) * w + x) * c, c, width, out.data() + static_cast<size_t>(r) * width * 4);
+    }
+    stbi_image_free(pixels);
+    return true;
+}
+
+}
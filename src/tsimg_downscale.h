@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "tsimg_memory.h"
+
+namespace tsimg::downscale {
+
+    struct Options {
+        // Teto para as linhas de entrada mantidas em memória ao reduzir um quadro grande
+        size_t maxBufferBytes = size_t(256) << 20;
+        unsigned threads = 0; // 0 = std::thread::hardware_concurrency()
+        tsimg::memory::Stage stage = tsimg::memory::Stage::Gif; // etapa à qual os buffers são atribuídos
+        bool debug = false;
+    };
+
+    // Dimensões da imagem sem decodificá-la
+    bool imageSize(const std::string& path, int& width, int& height);
+
+    // Reduz width x height para que o lado maior não passe de maxDimension, mantendo a
+    // proporção (maxDimension <= 0 não limita)
+    void fitWithin(int& width, int& height, int maxDimension);
+
+    // Decodifica path e redimensiona para width x height RGBA em out. Imagens cujo RGBA completo
+    // cabe em maxBufferBytes seguem o caminho direto (stbi_load + stbir). As maiores são reduzidas
+    // em faixas de linhas de saída, várias faixas em paralelo, lendo a entrada por uma janela de
+    // linhas limitada: PNGs não entrelaçados são decodificados em fluxo, linha a linha; os demais
+    // formatos são decodificados inteiros, mas nos canais nativos, sem a cópia RGBA.
+    bool loadResizedRgba(const std::string& path, int width, int height, std::vector<uint8_t>& out, const Options& options = {});
+
+    // Como loadResizedRgba, para um arquivo já lido em data. Só decodifica quando o RGBA completo
+    // cabe em maxBufferBytes; false nos demais casos, e o chamador lê pelo caminho (em fluxo).
+    bool loadResizedRgbaFromMemory(const std::vector<unsigned char>& data, int width, int height, std::vector<uint8_t>& out,
+                                   const Options& options = {});
+
+    // Redimensiona RGBA já em memória (ex.: quadros crus) para width x height em out
+    void resizeRgba(const uint8_t* pixels, int srcWidth, int srcHeight, int width, int height, std::vector<uint8_t>& out);
+
+    // Decodifica a caixa (x, y, width, height) de path em RGBA. PNGs não entrelaçados são lidos em
+    // fluxo e a decodificação para na última linha da caixa; os demais formatos são decodificados
+    // inteiros nos canais nativos. A transparência do tRNS (alfa da paleta, cor-chave em cinza e
+    // RGB) vira o canal alfa. false se a caixa sair da imagem.
+    bool loadCroppedRgba(const std::string& path, int x, int y, int width, int height, std::vector<uint8_t>& out, const Options& options = {});
+}
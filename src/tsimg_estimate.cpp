@@ -0,0 +1,282 @@
+#include "tsimg_estimate.h"
+#include "tsimg_container.h"
+#include "tsimg_downscale.h"
+#include "tsimg_memory.h"
+#include "tsimg_pipeline.h"
+#include "tsimg_spice.h"
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace tsimg::estimate {
+
+namespace {
+    // Vazões de referência por núcleo, em disco local com cache quente; NFS e discos frios deixam
+    // a leitura bem mais lenta. Servem para ordem de grandeza, não como prazo.
+    constexpr double kReadBytesPerSecond = 1.5e9;      // leitor do SPICE (serial)
+    constexpr double kBase64BytesPerSecond = 1.2e9;    // por thread de codificação
+    constexpr double kWriteBytesPerSecond = 2.0e9;     // escritor ordenado (serial)
+    constexpr double kDecodePixelsPerSecond = 1.0e8;   // decodificação e redução do GIF, por thread
+    constexpr double kQuantizePixelsPerSecond = 4.0e7; // paleta e mapeamento, por thread
+    constexpr double kLzwPixelsPerSecond = 6.0e7;      // LZW do gif.h (serial)
+    constexpr double kGifBytesPerPixel = 0.6;          // típico de quadros fotográficos com delta
+    constexpr size_t kGifFrameOverhead = 800;          // paleta local e cabeçalhos de cada quadro
+    // Quadros em voo no streaming do SPICE: as duas filas de StreamOptions mais os codificadores
+    constexpr size_t kSpiceQueuedFrames = 2 * 64;
+
+    struct Probe {
+        uintmax_t bytes = 0;
+        int width = 0;
+        int height = 0;
+        bool ok = false;
+    };
+
+    std::string formatMiB(double bytes) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MiB";
+        return out.str();
+    }
+
+    std::string formatSeconds(double seconds) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(seconds < 10.0 ? 1 : 0) << seconds << " s";
+        return out.str();
+    }
+
+    std::string formatSize(int minWidth, int minHeight, int maxWidth, int maxHeight) {
+        std::string size = std::to_string(maxWidth) + "x" + std::to_string(maxHeight);
+        if (minWidth != maxWidth || minHeight != maxHeight) {
+            size = std::to_string(minWidth) + "x" + std::to_string(minHeight) + ".." + size;
+        }
+        return size;
+    }
+
+    bool hasFormat(const std::vector<std::string>& formats, const std::string& format) {
+        return std::find(formats.begin(), formats.end(), format) != formats.end();
+    }
+}
+
+Estimate run(const SPICEBuilder* builder, const std::vector<std::string>& gifPaths, const Options& options) {
+    Estimate estimate;
+    const unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    // Listas do builder, ou só a do GIF; cada caminho é sondado uma vez, mesmo repetido
+    std::vector<std::pair<std::string, std::vector<std::string>>> lists;
+    std::map<std::string, std::vector<tsimg::pipeline::FileStamp>> stamps;
+    if (builder) {
+        for (const auto& [tag, paths] : builder->getImagePaths()) lists.emplace_back(tag, paths);
+        stamps = builder->getImageStamps();
+    } else {
+        lists.emplace_back("SPICE_IMAGES", gifPaths);
+    }
+    std::vector<std::string> paths;
+    std::vector<tsimg::pipeline::FileStamp> known;
+    std::unordered_map<std::string, size_t> probeIndex;
+    auto addPath = [&](const std::string& path, const tsimg::pipeline::FileStamp* stamp) {
+        if (probeIndex.emplace(path, paths.size()).second) {
+            paths.push_back(path);
+            known.push_back(stamp ? *stamp : tsimg::pipeline::FileStamp{});
+        }
+    };
+    for (const auto& [tag, list] : lists) {
+        const auto stampList = stamps.find(tag);
+        for (size_t i = 0; i < list.size(); ++i) {
+            bool stamped = stampList != stamps.end() && i < stampList->second.size();
+            addPath(list[i], stamped ? &stampList->second[i] : nullptr);
+        }
+    }
+    if (hasFormat(options.formats, "gif")) {
+        for (const auto& path : gifPaths) addPath(path, nullptr);
+    }
+
+    std::vector<Probe> probes(paths.size());
+    tsimg::pipeline::parallelFor(paths.size(), threads, [&](size_t i) {
+        Probe& probe = probes[i];
+        auto stamp = known[i].valid ? known[i] : tsimg::pipeline::stampFile(paths[i]);
+        probe.bytes = stamp.size;
+        probe.ok = tsimg::downscale::imageSize(paths[i], probe.width, probe.height);
+    });
+    auto probeOf = [&](const std::string& path) -> const Probe& { return probes[probeIndex.at(path)]; };
+
+    std::map<std::string, size_t> listIndex;
+    uintmax_t inputBytes = 0, tagBytes = 0, largestFrame = 0;
+    size_t totalFrames = 0;
+    for (const auto& [tag, list] : lists) {
+        ListEstimate entry;
+        entry.tag = tag;
+        entry.frames = list.size();
+        for (const auto& path : list) {
+            const Probe& probe = probeOf(path);
+            entry.inputBytes += probe.bytes;
+            entry.tagBytes += tsimg::utils::HTMLBuilder::imageTagSize(tsimg::utils::Base64::encodedSize(static_cast<size_t>(probe.bytes)), path.size());
+            largestFrame = std::max(largestFrame, probe.bytes);
+            if (!probe.ok) {
+                ++entry.unreadable;
+                continue;
+            }
+            entry.pixels += static_cast<uint64_t>(probe.width) * probe.height;
+            bool first = entry.maxWidth == 0;
+            entry.minWidth = first ? probe.width : std::min(entry.minWidth, probe.width);
+            entry.minHeight = first ? probe.height : std::min(entry.minHeight, probe.height);
+            entry.maxWidth = std::max(entry.maxWidth, probe.width);
+            entry.maxHeight = std::max(entry.maxHeight, probe.height);
+        }
+        inputBytes += entry.inputBytes;
+        tagBytes += entry.tagBytes;
+        totalFrames += entry.frames;
+        listIndex[tag] = estimate.lists.size();
+        if (entry.unreadable > 0) {
+            estimate.notes.push_back(std::to_string(entry.unreadable) + " frames of " + tag + " have headers that could not be read");
+        }
+        estimate.lists.push_back(std::move(entry));
+    }
+
+    for (size_t f = 0; f < options.formats.size(); ++f) {
+        const std::string& format = options.formats[f];
+        OutputEstimate out;
+        out.format = format;
+        out.file = f < options.files.size() ? options.files[f] : std::string();
+        if (format == "spice" && builder) {
+            TemplateWriter writer(builder->getTemplatePath(), options.debug);
+            out.bytes = writer.streamedSize(*builder, [&](const std::string& tag) { return estimate.lists[listIndex.at(tag)].tagBytes; });
+            out.exact = true;
+            // Quadros lidos e tags codificadas à espera do escritor, no pior caso todos do tamanho do maior
+            const size_t encoders = threads;
+            const size_t inFlight = std::min(totalFrames, kSpiceQueuedFrames + encoders);
+            const uintmax_t frameFootprint = largestFrame + tsimg::utils::Base64::encodedSize(static_cast<size_t>(largestFrame)) + 512;
+            out.peakBytes = static_cast<size_t>(inFlight * frameFootprint + (out.bytes - tagBytes));
+            if (options.shardBytes > 0) {
+                // Mesma divisão da escrita; cada página repete o layout, então a soma passa do arquivo único
+                uintmax_t pageBytes = 0;
+                for (const auto& page : writer.planShards(out.file, *builder, options.shardBytes)) {
+                    out.pages.push_back({page.file, page.last - page.first, page.bytes});
+                    pageBytes += page.bytes;
+                }
+                out.bytes = pageBytes;
+                out.exact = false;
+            }
+            out.seconds = std::max({inputBytes / kReadBytesPerSecond, tagBytes / (kBase64BytesPerSecond * encoders),
+                                    out.bytes / kWriteBytesPerSecond});
+        } else if (format == "spicebin" && builder) {
+            // Cabeçalho, índice e quadros como estão; os metadados JSON entram pela soma do que levam
+            uintmax_t meta = 256 + builder->getTitle().size();
+            for (const auto& content : builder->getContents()) meta += content.getTag().size() + content.getVariableContent().size() + 8;
+            for (const auto& label : builder->getLabels()) meta += label.size() + 4;
+            for (const auto& [tag, list] : lists) {
+                for (const auto& path : list) meta += std::filesystem::path(path).filename().string().size() + 4;
+            }
+            out.bytes = tsimg::container::kHeaderSize + tsimg::container::kIndexEntrySize * totalFrames + meta + inputBytes;
+            out.peakBytes = static_cast<size_t>(meta);
+            out.seconds = inputBytes / kReadBytesPerSecond;
+        } else if (format == "gif") {
+            if (gifPaths.empty() || !probeOf(gifPaths[0]).ok) {
+                estimate.notes.push_back("GIF size unknown: the first frame header could not be read");
+                estimate.outputs.push_back(std::move(out));
+                continue;
+            }
+            const Probe& first = probeOf(gifPaths[0]);
+            out.width = first.width;
+            out.height = first.height;
+            tsimg::downscale::fitWithin(out.width, out.height, options.gif.maxDimension);
+            const size_t steps = static_cast<size_t>(std::clamp(options.gif.interpolate, 0, kGifMaxInterpolate)) + 1;
+            out.frames = (gifPaths.size() - 1) * steps + 1;
+            const double canvasPixels = static_cast<double>(out.width) * out.height;
+            const size_t canvasBytes = static_cast<size_t>(out.width) * out.height * 4;
+
+            // createGif: window quadros prontos à frente do escritor, cada worker decodificando um
+            // quadro (até frameBufferBytes) e o quadro anterior do gif.h
+            const size_t workers = std::min<size_t>(threads, out.frames);
+            size_t largestSource = 0;
+            double sourcePixels = 0.0;
+            for (const auto& path : gifPaths) {
+                const Probe& probe = probeOf(path);
+                size_t rgba = static_cast<size_t>(probe.width) * probe.height * 4;
+                largestSource = std::max(largestSource, std::min(rgba, options.gif.frameBufferBytes));
+                sourcePixels += static_cast<double>(probe.width) * probe.height;
+            }
+            out.peakBytes = (workers + 1) * canvasBytes * (steps > 1 ? 2 : 1) + workers * largestSource + canvasBytes;
+            out.bytes = static_cast<uintmax_t>(out.frames * (canvasPixels * kGifBytesPerPixel + kGifFrameOverhead));
+            out.seconds = std::max((sourcePixels / kDecodePixelsPerSecond + out.frames * canvasPixels / kQuantizePixelsPerSecond) / workers,
+                                   out.frames * canvasPixels / kLzwPixelsPerSecond);
+        }
+        estimate.peakBytes += out.peakBytes;
+        estimate.seconds = std::max(estimate.seconds, out.seconds);
+        estimate.outputs.push_back(std::move(out));
+    }
+    if (hasFormat(options.formats, "spice") && hasFormat(options.formats, "gif")) {
+        estimate.peakBytes += static_cast<size_t>(std::min<uintmax_t>(options.sharedFrameBytes, inputBytes));
+    }
+    if (tsimg::memory::budget() > 0 && estimate.peakBytes > tsimg::memory::budget()) {
+        estimate.peakBytes = tsimg::memory::budget();
+        estimate.notes.push_back("peak memory is capped by --memory-budget; expect a longer run instead");
+    }
+
+    tsimg::utils::debugLog(options.debug, "Probed " + std::to_string(paths.size()) + " frame headers for the estimate");
+    return estimate;
+}
+
+nlohmann::json toJson(const Estimate& estimate) {
+    nlohmann::json lists = nlohmann::json::array();
+    for (const auto& list : estimate.lists) {
+        lists.push_back({{"tag", list.tag}, {"frames", list.frames}, {"unreadable", list.unreadable},
+                         {"input_bytes", list.inputBytes}, {"tag_bytes", list.tagBytes}, {"pixels", list.pixels},
+                         {"min_width", list.minWidth}, {"min_height", list.minHeight},
+                         {"max_width", list.maxWidth}, {"max_height", list.maxHeight}});
+    }
+    nlohmann::json outputs = nlohmann::json::array();
+    for (const auto& out : estimate.outputs) {
+        nlohmann::json entry = {{"format", out.format}, {"file", out.file}, {"bytes", out.bytes}, {"exact", out.exact},
+                                {"peak_bytes", out.peakBytes}, {"seconds", out.seconds}};
+        if (out.format == "gif") {
+            entry["width"] = out.width;
+            entry["height"] = out.height;
+            entry["frames"] = out.frames;
+        }
+        if (!out.pages.empty()) {
+            nlohmann::json pages = nlohmann::json::array();
+            for (const auto& page : out.pages) {
+                pages.push_back({{"file", page.file}, {"frames", page.frames}, {"bytes", page.bytes}});
+            }
+            entry["pages"] = std::move(pages);
+        }
+        outputs.push_back(std::move(entry));
+    }
+    return {{"lists", lists}, {"outputs", outputs}, {"peak_bytes", estimate.peakBytes},
+            {"seconds", estimate.seconds}, {"notes", estimate.notes}};
+}
+
+void print(const Estimate& estimate, std::ostream& out) {
+    out << "Dry run (nothing decoded or written):" << std::endl;
+    for (const auto& list : estimate.lists) {
+        out << "  " << std::left << std::setw(16) << list.tag << std::right << std::setw(7) << list.frames << " frames  "
+            << std::left << std::setw(20) << formatSize(list.minWidth, list.minHeight, list.maxWidth, list.maxHeight) << std::right
+            << " input " << std::setw(12) << formatMiB(static_cast<double>(list.inputBytes))
+            << "  html " << std::setw(12) << formatMiB(static_cast<double>(list.tagBytes)) << std::endl;
+    }
+    for (const auto& output : estimate.outputs) {
+        out << "  " << std::left << std::setw(9) << output.format << std::setw(24) << output.file << std::right
+            << (output.exact ? "  " : " ~") << std::setw(12) << formatMiB(static_cast<double>(output.bytes))
+            << (output.exact ? " (" + std::to_string(output.bytes) + " bytes)" : "");
+        if (output.format == "gif" && output.frames > 0) {
+            out << "  " << output.width << "x" << output.height << ", " << output.frames << " frames";
+        }
+        out << "  peak ~" << formatMiB(static_cast<double>(output.peakBytes)) << "  ~" << formatSeconds(output.seconds) << std::endl;
+        if (!output.pages.empty()) {
+            uintmax_t largest = 0;
+            for (const auto& page : output.pages) largest = std::max(largest, page.bytes);
+            out << "           index + " << output.pages.size() << (output.pages.size() == 1 ? " page" : " pages") << " ("
+                << output.pages.front().file << (output.pages.size() > 1 ? " ... " + output.pages.back().file : std::string())
+                << "), largest ~" << formatMiB(static_cast<double>(largest)) << std::endl;
+        }
+    }
+    out << "  total: peak ~" << formatMiB(static_cast<double>(estimate.peakBytes)) << ", ~" << formatSeconds(estimate.seconds) << std::endl;
+    for (const auto& note : estimate.notes) {
+        out << "  note: " << note << std::endl;
+    }
+}
+
+}
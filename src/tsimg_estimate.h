@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "tsimg_gif.h"
+
+class SPICEBuilder;
+
+namespace tsimg::estimate {
+
+    struct Options {
+        std::vector<std::string> formats;
+        std::vector<std::string> files; // arquivo de cada formato, na mesma ordem
+        GifOptions gif;
+        size_t sharedFrameBytes = 0;    // janela de quadros do SPICE para o GIF, com os dois juntos
+        uintmax_t shardBytes = 0;       // --shard-mb: o SPICE vira um índice e páginas de até tantos bytes
+        unsigned threads = 0; // 0 = std::thread::hardware_concurrency()
+        bool debug = false;
+    };
+
+    // Quadros de uma lista, só pelos cabeçalhos
+    struct ListEstimate {
+        std::string tag;
+        size_t frames = 0;
+        size_t unreadable = 0;        // cabeçalho não reconhecido (dimensões ficam de fora)
+        uintmax_t inputBytes = 0;
+        uintmax_t tagBytes = 0;       // tags <img> com Base64 no HTML, exato
+        uint64_t pixels = 0;
+        int minWidth = 0;
+        int minHeight = 0;
+        int maxWidth = 0;
+        int maxHeight = 0;
+    };
+
+    // Página de um SPICE dividido por --shard-mb
+    struct PageEstimate {
+        std::string file;
+        size_t frames = 0;
+        uintmax_t bytes = 0;
+    };
+
+    struct OutputEstimate {
+        std::string format;
+        std::string file;
+        uintmax_t bytes = 0;
+        bool exact = false;           // só o HTML do SPICE tem tamanho exato
+        size_t peakBytes = 0;
+        double seconds = 0.0;
+        // GIF: dimensões e quadros de saída (com os intermediários de interpolate)
+        int width = 0;
+        int height = 0;
+        size_t frames = 0;
+        // SPICE com shardBytes: file é só o índice e os quadros vão para estas páginas; bytes soma as
+        // páginas, sem o índice
+        std::vector<PageEstimate> pages;
+    };
+
+    struct Estimate {
+        std::vector<ListEstimate> lists;
+        std::vector<OutputEstimate> outputs;
+        size_t peakBytes = 0;         // saídas simultâneas somadas, limitado por --memory-budget
+        double seconds = 0.0;         // a saída mais lenta; as demais rodam junto
+        std::vector<std::string> notes;
+    };
+
+    // Lê em paralelo só os cabeçalhos e os tamanhos dos quadros do builder (ou de gifPaths, sem
+    // builder) e calcula o tamanho de cada saída, o pico de memória e o tempo aproximado, sem
+    // decodificar nem gravar nada. Tempo e memória vêm de um modelo das filas do pipeline e de
+    // vazões de referência; o tamanho do HTML é exato.
+    Estimate run(const SPICEBuilder* builder, const std::vector<std::string>& gifPaths, const Options& options);
+
+    nlohmann::json toJson(const Estimate& estimate);
+    void print(const Estimate& estimate, std::ostream& out);
+}
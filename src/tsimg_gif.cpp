@@ -1,55 +1,321 @@
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
 
 #include <stb_image.h>
 #include <stb_image_resize2.h>
+#include <stb_image_write.h>
 #include "gif.h"
 #include "tsimg_gif.h"
+#include "tsimg_downscale.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
 #include <fstream>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
 
-bool createGif(const std::string& output_filename, const std::vector<std::string>& image_paths, bool debug) {
+namespace {
+    // Substitui o GifWriteFrame do gif.h: paleta e mapeamento ficam com o tsimg::quantize e o
+    // gif.h só faz o LZW e os blocos. writer->oldImage guarda o último quadro quantizado. A paleta
+    // não depende do quadro anterior e chega pronta; o mapeamento (delta) precisa ser em ordem.
+    void writeQuantizedFrame(GifWriter* writer, const uint8_t* image, uint32_t width, uint32_t height, uint32_t delay,
+                             const tsimg::quantize::Palette& palette, const tsimg::quantize::Options& options, bool debug) {
+        auto start = std::chrono::steady_clock::now();
+        bool hasPrevious = !writer->firstFrame;
+        writer->firstFrame = false;
+
+        tsimg::quantize::mapFrame(image, writer->oldImage, static_cast<int>(width), static_cast<int>(height), hasPrevious, palette, options);
+
+        // Tabela local só do tamanho necessário (índice 0 + cores); códigos LZW menores em paletas pequenas
+        GifPalette gifPalette{};
+        gifPalette.bitDepth = 2;
+        while ((size_t(1) << gifPalette.bitDepth) < palette.size + 1) {
+            ++gifPalette.bitDepth;
+        }
+        for (size_t i = 0; i < palette.size; ++i) {
+            gifPalette.r[i + 1] = palette.r[i];
+            gifPalette.g[i + 1] = palette.g[i];
+            gifPalette.b[i + 1] = palette.b[i];
+        }
+        GifWriteLzwImage(writer->f, writer->oldImage, 0, 0, width, height, delay, &gifPalette);
+
+        if (debug) {
+            auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Mapped frame (" << tsimg::quantize::qualityName(options.quality) << (options.dither ? ", dithered" : "")
+                      << "): " << palette.size << " colors in " << ms << " ms" << std::endl;
+        }
+    }
+
+    tsimg::downscale::Options downscaleOptions(const GifOptions& options, bool debug) {
+        tsimg::downscale::Options downscale;
+        downscale.maxBufferBytes = options.frameBufferBytes;
+        downscale.stage = tsimg::memory::Stage::Gif;
+        downscale.debug = debug;
+        return downscale;
+    }
+
+    // Quadro real reduzido ao tamanho do GIF; carregado uma vez e compartilhado pelo quadro de
+    // saída correspondente e pelos intermediários vizinhos
+    struct SourceFrame {
+        std::once_flag loaded;
+        bool ok = false;
+        std::shared_ptr<const std::vector<unsigned char>> bytes; // entregues por GifOptions::frameBytes
+        std::shared_ptr<const std::vector<uint8_t>> rgba;
+        tsimg::memory::Charge charge;
+    };
+
+    // Quadro de saída (real ou intermediário) com a paleta pronta, à espera do escritor
+    struct PreparedFrame {
+        bool ready = false;
+        bool ok = false;
+        std::shared_ptr<const std::vector<uint8_t>> rgba;
+        tsimg::quantize::Palette palette;
+        tsimg::memory::Charge charge; // só dos intermediários; os reais são contados em SourceFrame
+        tsimg::memory::Admission admission;
+    };
+
+    // Mistura linear por canal em aritmética inteira, out = (a * (256 - weight) + b * weight) / 256;
+    // laço sem desvios que o compilador vetoriza
+    void blendFrames(const uint8_t* a, const uint8_t* b, uint32_t weight, uint8_t* out, size_t bytes) {
+        const uint32_t inverse = 256 - weight;
+        for (size_t i = 0; i < bytes; ++i) {
+            out[i] = static_cast<uint8_t>((a[i] * inverse + b[i] * weight + 128) >> 8);
+        }
+    }
+
+    // Estimativa dos bytes vivos ao preparar um quadro: a decodificação (RGBA inteiro ou, acima
+    // de frameBufferBytes, a janela de linhas do downscale) mais o quadro no tamanho do GIF
+    size_t prepareFootprint(const std::string& path, int width, int height, const GifOptions& options) {
+        size_t canvas = static_cast<size_t>(width) * height * 4;
+        int sourceWidth = 0, sourceHeight = 0;
+        if (!tsimg::downscale::imageSize(path, sourceWidth, sourceHeight)) return canvas;
+        return canvas + std::min(static_cast<size_t>(sourceWidth) * sourceHeight * 4, options.frameBufferBytes);
+    }
+
+    // Dimensões do GIF a partir do cabeçalho do primeiro quadro, sem decodificá-lo
+    bool canvasSize(const std::string& firstImage, const GifOptions& options, int& width, int& height, bool debug) {
+        if (!tsimg::downscale::imageSize(firstImage, width, height)) {
+            if (debug) std::cerr << "Failed to load image: " << firstImage << std::endl;
+            return false;
+        }
+        int sourceWidth = width, sourceHeight = height;
+        tsimg::downscale::fitWithin(width, height, options.maxDimension);
+        if (debug && (width != sourceWidth || height != sourceHeight)) {
+            std::cout << "Frames of " << sourceWidth << "x" << sourceHeight << " exceed " << options.maxDimension
+                      << " px; GIF reduced to " << width << "x" << height << std::endl;
+        }
+        return true;
+    }
+}
+
+bool createGif(const std::string& output_filename, const std::vector<std::string>& image_paths, bool debug,
+               const GifOptions& options) {
     if (image_paths.empty()) {
         if (debug) std::cerr << "Error: No images provided." << std::endl;
         return false;
     }
 
-    int width = 0, height = 0, channels = 0;
+    int width = 0, height = 0;
 
-    if (debug) std::cout << "Loading first image to get dimensions..." << std::endl;
-    unsigned char* first_image = stbi_load(image_paths[0].c_str(), &width, &height, &channels, 4);
-    if (!first_image) {
-        if (debug) std::cerr << "Failed to load image: " << image_paths[0] << std::endl;
+    if (debug) std::cout << "Reading first image header to get dimensions..." << std::endl;
+    if (options.framePixels) {
+        std::shared_ptr<const std::vector<uint8_t>> first;
+        if (!options.framePixels(0, width, height, first)) {
+            if (debug) std::cerr << "Failed to load image: " << image_paths[0] << std::endl;
+            return false;
+        }
+        tsimg::downscale::fitWithin(width, height, options.maxDimension);
+    } else if (!canvasSize(image_paths[0], options, width, height, debug)) {
         return false;
     }
-    stbi_image_free(first_image);
-    if (debug) std::cout << "First image loaded successfully. Dimensions: " << width << "x" << height << std::endl;
+    if (debug) std::cout << "GIF dimensions: " << width << "x" << height << std::endl;
+
+    // "-" grava na saída padrão; o gif.h só abre arquivos por nome, e cada quadro já é escrito assim que fica pronto
+    std::string gif_path = output_filename;
+    if (output_filename == "-") {
+#ifdef _WIN32
+        std::cerr << "Writing GIF to stdout is not supported on this platform." << std::endl;
+        return false;
+#else
+        gif_path = "/dev/stdout";
+#endif
+    }
 
     GifWriter gif;
-    if (!GifBegin(&gif, output_filename.c_str(), width, height, 100)) {
+    if (!GifBegin(&gif, gif_path.c_str(), width, height, kGifFrameDelay)) {
         if (debug) std::cerr << "Failed to initialize GIF: " << output_filename << std::endl;
         return false;
     }
+    tsimg::memory::Charge previous_frame(tsimg::memory::Stage::Gif, static_cast<size_t>(width) * height * 4); // oldImage do gif.h
 
-    for (const auto& image_path : image_paths) {
-        if (debug) std::cout << "Processing image: " << image_path << std::endl;
+    // Leitura, redução e paleta rodam em paralelo à frente do escritor, que mapeia e grava em
+    // ordem. Cada quadro é admitido no orçamento de memória na ordem dos quadros: o escritor
+    // sempre consegue o próximo, e os admitidos depois dele esperam a vez sem travar o resto.
+    // Com interpolate = N, entre os quadros reais k e k + 1 saem N misturas; a saída j corresponde
+    // ao real j / (N + 1) com peso (j % (N + 1)) / (N + 1) do seguinte.
+    const auto downscale = downscaleOptions(options, debug);
+    const size_t count = image_paths.size();
+    const size_t steps = static_cast<size_t>(std::clamp(options.interpolate, 0, kGifMaxInterpolate)) + 1;
+    const size_t outputCount = (count - 1) * steps + 1;
+    // O real e suas misturas somam kGifFrameDelay: os centésimos que sobram da divisão vão para as
+    // primeiras saídas do grupo; o último real, sem misturas depois dele, fica com o tempo inteiro
+    auto delayOf = [&](size_t i) -> uint32_t {
+        if (i + 1 == outputCount) return kGifFrameDelay;
+        const uint32_t share = static_cast<uint32_t>(kGifFrameDelay / steps);
+        return share + (i % steps < kGifFrameDelay % steps ? 1 : 0);
+    };
+    const size_t canvasBytes = static_cast<size_t>(width) * height * 4;
+    const size_t workerCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), outputCount);
+    const size_t window = workerCount + 1;
+    std::vector<SourceFrame> sources(count);
+    std::vector<bool> bytesFetched(count, false);
+    std::vector<PreparedFrame> frames(outputCount);
+    std::mutex framesMutex;
+    std::mutex claimMutex;
+    std::condition_variable changed;
+    size_t claimed = 0;
+    size_t written = 0;
+    std::atomic<bool> stop{false};
 
-        int img_width = 0, img_height = 0, img_channels = 0;
-        unsigned char* image_data = stbi_load(image_path.c_str(), &img_width, &img_height, &img_channels, 4);
-        if (!image_data) {
-            if (debug) std::cerr << "Failed to load image: " << image_path << std::endl;
-            GifEnd(&gif);
-            return false;
-        }
+    auto loadSource = [&](size_t k) -> const SourceFrame& {
+        SourceFrame& source = sources[k];
+        std::call_once(source.loaded, [&]() {
+            if (debug) std::cout << "Processing image: " << image_paths[k] << std::endl;
+            auto rgba = std::make_shared<std::vector<uint8_t>>();
+            if (options.framePixels) {
+                // Pixels já em memória: no tamanho do GIF seguem sem cópia, senão são redimensionados
+                std::shared_ptr<const std::vector<uint8_t>> pixels;
+                int sourceWidth = 0, sourceHeight = 0;
+                source.ok = !stop.load() && options.framePixels(k, sourceWidth, sourceHeight, pixels) && pixels;
+                if (source.ok && sourceWidth == width && sourceHeight == height) {
+                    source.rgba = std::move(pixels);
+                    return;
+                }
+                if (source.ok) {
+                    tsimg::downscale::resizeRgba(pixels->data(), sourceWidth, sourceHeight, width, height, *rgba);
+                    source.charge = tsimg::memory::Charge(tsimg::memory::Stage::Gif, rgba->size());
+                    source.rgba = std::move(rgba);
+                }
+                return;
+            }
+            try {
+                source.ok = !stop.load() &&
+                            ((source.bytes && tsimg::downscale::loadResizedRgbaFromMemory(*source.bytes, width, height, *rgba, downscale)) ||
+                             tsimg::downscale::loadResizedRgba(image_paths[k], width, height, *rgba, downscale));
+            } catch (const std::exception& e) {
+                if (debug) std::cerr << "Failed to prepare GIF frame " << image_paths[k] << ": " << e.what() << std::endl;
+                source.ok = false;
+            }
+            source.bytes.reset();
+            if (source.ok) {
+                source.charge = tsimg::memory::Charge(tsimg::memory::Stage::Gif, rgba->size());
+                source.rgba = std::move(rgba);
+            }
+        });
+        return source;
+    };
 
-        if (debug) std::cout << "Image loaded successfully. Dimensions: " << img_width << "x" << img_height << std::endl;
+    auto prepare = [&]() {
+        for (;;) {
+            size_t index = 0;
+            tsimg::memory::Admission admission;
+            {
+                std::lock_guard<std::mutex> claimLock(claimMutex);
+                {
+                    std::unique_lock<std::mutex> lock(framesMutex);
+                    changed.wait(lock, [&]() { return stop.load() || claimed >= outputCount || claimed < written + window; });
+                    if (stop.load() || claimed >= outputCount) return;
+                    index = claimed++;
+                }
+                // Os bytes compartilhados chegam antes da admissão: quem os produz também passa pelo
+                // orçamento, e esperar por eles segurando uma admissão poderia travar os dois lados
+                size_t last = std::min(index / steps + (index % steps ? 1 : 0), count - 1);
+                for (size_t k = index / steps; options.frameBytes && k <= last; ++k) {
+                    if (!bytesFetched[k]) {
+                        bytesFetched[k] = true;
+                        sources[k].bytes = options.frameBytes(k);
+                    }
+                }
+                if (tsimg::memory::budget() > 0) {
+                    size_t footprint = options.framePixels ? canvasBytes : prepareFootprint(image_paths[last], width, height, options);
+                    admission = tsimg::memory::admit(index % steps ? footprint + canvasBytes : footprint, &stop);
+                }
+            }
 
-        std::vector<uint8_t> resized_image(width * height * 4);
-        stbir_resize_uint8_linear(image_data, img_width, img_height, 0, resized_image.data(), width, height, 0, (stbir_pixel_layout)4);
+            PreparedFrame frame;
+            const SourceFrame& left = loadSource(index / steps);
+            if (index % steps == 0) {
+                frame.ok = left.ok;
+                frame.rgba = left.rgba;
+            } else {
+                const SourceFrame& right = loadSource(index / steps + 1);
+                frame.ok = left.ok && right.ok;
+                if (frame.ok) {
+                    uint32_t weight = static_cast<uint32_t>(((index % steps) * 256 + steps / 2) / steps);
+                    auto blended = std::make_shared<std::vector<uint8_t>>(canvasBytes);
+                    blendFrames(left.rgba->data(), right.rgba->data(), weight, blended->data(), canvasBytes);
+                    frame.charge = tsimg::memory::Charge(tsimg::memory::Stage::Gif, canvasBytes);
+                    frame.rgba = std::move(blended);
+                }
+            }
+            if (frame.ok) {
+                frame.palette = tsimg::quantize::buildPalette(frame.rgba->data(), static_cast<size_t>(width) * height, options.quantize.quality);
+            }
+            frame.admission = std::move(admission);
+            frame.ready = true;
+            {
+                std::lock_guard<std::mutex> lock(framesMutex);
+                frames[index] = std::move(frame);
+            }
+            changed.notify_all();
+        }
+    };
 
-        GifWriteFrame(&gif, resized_image.data(), width, height, 100);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < workerCount; ++t) {
+        workers.emplace_back(prepare);
+    }
 
-        stbi_image_free(image_data);
+    bool ok = true;
+    for (size_t i = 0; i < outputCount && ok; ++i) {
+        PreparedFrame frame;
+        {
+            std::unique_lock<std::mutex> lock(framesMutex);
+            changed.wait(lock, [&]() { return frames[i].ready; });
+            frame = std::move(frames[i]);
+        }
+        if (!frame.ok) {
+            if (debug) std::cerr << "Failed to load image: " << image_paths[std::min(i / steps + (i % steps ? 1 : 0), count - 1)] << std::endl;
+            ok = false;
+            break;
+        }
+        writeQuantizedFrame(&gif, frame.rgba->data(), width, height, delayOf(i), frame.palette, options.quantize, debug);
+        frame = PreparedFrame();
+        {
+            std::lock_guard<std::mutex> lock(framesMutex);
+            ++written;
+            // Último quadro de saída que usa o real i / steps: a versão reduzida pode ir embora
+            if (i % steps == steps - 1 || i + 1 == outputCount) {
+                sources[i / steps].rgba.reset();
+                sources[i / steps].charge.reset();
+            }
+        }
+        changed.notify_all();
+    }
+
+    stop.store(true);
+    changed.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (!ok) {
+        GifEnd(&gif);
+        return false;
     }
 
     GifEnd(&gif);
@@ -58,6 +324,83 @@ bool createGif(const std::string& output_filename, const std::vector<std::string
     return true;
 }
 
+GifSequence::GifSequence(uint32_t delay, GifOptions options)
+    : delay(delay), options(options), charge(tsimg::memory::Stage::Gif, 0) {}
+
+bool GifSequence::append(const std::string& imagePath, bool debug) {
+    // Como no createGif, o primeiro quadro define as dimensões e os demais são redimensionados
+    if (blocks.empty()) {
+        if (!canvasSize(imagePath, options, width, height, debug)) {
+            return false;
+        }
+        previous.assign(static_cast<size_t>(width) * height * 4, 0);
+    }
+
+    std::vector<uint8_t> resized_image;
+    tsimg::memory::Charge resized(tsimg::memory::Stage::Gif, static_cast<size_t>(width) * height * 4);
+    if (!tsimg::downscale::loadResizedRgba(imagePath, width, height, resized_image, downscaleOptions(options, debug))) {
+        if (debug) std::cerr << "Failed to load image: " << imagePath << std::endl;
+        return false;
+    }
+
+    // O gif.h só escreve em FILE*; o bloco do quadro passa por um arquivo temporário
+    FILE* block_file = std::tmpfile();
+    if (!block_file) {
+        if (debug) std::cerr << "Could not create temporary file for GIF frame: " << imagePath << std::endl;
+        return false;
+    }
+    GifWriter writer;
+    writer.f = block_file;
+    writer.oldImage = previous.data();
+    writer.firstFrame = blocks.empty();
+    auto palette = tsimg::quantize::buildPalette(resized_image.data(), static_cast<size_t>(width) * height, options.quantize.quality);
+    writeQuantizedFrame(&writer, resized_image.data(), width, height, delay, palette, options.quantize, debug);
+
+    std::string block(static_cast<size_t>(std::ftell(block_file)), '\0');
+    std::rewind(block_file);
+    bool ok = std::fread(&block[0], 1, block.size(), block_file) == block.size();
+    std::fclose(block_file);
+    if (!ok) {
+        if (debug) std::cerr << "Failed to read back GIF frame: " << imagePath << std::endl;
+        return false;
+    }
+    encodedBytes += block.size();
+    blocks.push_back(std::move(block));
+    charge.resize(encodedBytes + previous.size());
+    return true;
+}
+
+void GifSequence::reset() {
+    blocks.clear();
+    previous.clear();
+    width = height = 0;
+    encodedBytes = 0;
+    charge.reset();
+}
+
+size_t GifSequence::size() const {
+    return blocks.size();
+}
+
+bool GifSequence::writeTo(const std::string& outputFilename, bool debug) const {
+    if (blocks.empty()) {
+        if (debug) std::cerr << "Error: No images provided." << std::endl;
+        return false;
+    }
+    GifWriter gif;
+    if (!GifBegin(&gif, outputFilename.c_str(), width, height, delay)) {
+        if (debug) std::cerr << "Failed to initialize GIF: " << outputFilename << std::endl;
+        return false;
+    }
+    bool ok = true;
+    for (const auto& block : blocks) {
+        ok = ok && std::fwrite(block.data(), 1, block.size(), gif.f) == block.size();
+    }
+    GifEnd(&gif);
+    if (debug) std::cout << "GIF written with " << blocks.size() << " frames: " << outputFilename << std::endl;
+    return ok;
+}
+
 std::string encodeImageToBase64(const std::string& imagePath, bool debug) {
     if (debug) {
         std::cout << "Encoding image to Base64: " << imagePath << std::endl;
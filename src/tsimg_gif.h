@@ -1,7 +1,60 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
+#include "tsimg_memory.h"
+#include "tsimg_quantize.h"
 
-bool createGif(const std::string& output_filename, const std::vector<std::string>& image_paths, bool debug = false);
+// Centésimos de segundo em que cada quadro real fica na tela
+constexpr uint32_t kGifFrameDelay = 100;
+// Com interpolate = N, o quadro real e suas N misturas dividem kGifFrameDelay em quadros de ao
+// menos 2 cs, o menor atraso que os navegadores respeitam
+constexpr int kGifMaxInterpolate = static_cast<int>(kGifFrameDelay / 2) - 1;
+
+struct GifOptions {
+    tsimg::quantize::Options quantize;
+    // Lado maior do GIF; quadros maiores são reduzidos mantendo a proporção (0 = sem limite)
+    int maxDimension = 4096;
+    // Teto para as linhas de entrada em memória ao reduzir cada quadro (ver tsimg::downscale)
+    size_t frameBufferBytes = size_t(256) << 20;
+    // Quadros intermediários gerados entre cada par de quadros reais, por mistura linear em
+    // memória; o tempo de exibição de cada quadro real é mantido (0 = só os reais, no máximo
+    // kGifMaxInterpolate)
+    int interpolate = 0;
+    // Bytes já lidos do quadro index por outra saída da mesma execução (nullptr = ler o arquivo)
+    std::function<std::shared_ptr<const std::vector<unsigned char>>(size_t index)> frameBytes;
+    // Pixels RGBA do quadro index já em memória (ex.: --raw-frames); quando definido, os caminhos
+    // só nomeiam os quadros e nada é lido do disco
+    std::function<bool(size_t index, int& width, int& height, std::shared_ptr<const std::vector<uint8_t>>& rgba)> framePixels;
+};
+
+// Paleta e mapeamento de cores de cada quadro pelo tsimg::quantize; as dimensões vêm do cabeçalho
+// do primeiro quadro, limitadas a maxDimension, e cada quadro é reduzido pelo tsimg::downscale
+bool createGif(const std::string& output_filename, const std::vector<std::string>& image_paths, bool debug = false,
+               const GifOptions& options = {});
 std::string encodeImageToBase64(const std::string& imagePath, bool debug);
+
+// Sequência de quadros GIF já codificados, mantida em memória pelo modo --watch para regravar o
+// arquivo sem recodificar o que não mudou. O gif.h codifica cada quadro como delta do anterior,
+// então só dá para acrescentar no fim; qualquer outra mudança exige reset() e recomeçar.
+class GifSequence {
+public:
+    explicit GifSequence(uint32_t delay = kGifFrameDelay, GifOptions options = {});
+    bool append(const std::string& imagePath, bool debug = false);
+    void reset();
+    size_t size() const;
+    bool writeTo(const std::string& outputFilename, bool debug = false) const;
+
+private:
+    uint32_t delay;
+    GifOptions options;
+    int width = 0;
+    int height = 0;
+    std::vector<std::string> blocks;
+    std::vector<uint8_t> previous; // último quadro quantizado, base do delta do próximo
+    size_t encodedBytes = 0;
+    tsimg::memory::Charge charge;
+};
@@ -0,0 +1,363 @@
+#include "tsimg_inputs.h"
+#include "tsimg_spice.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <filesystem>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#define TSIMG_ACCESS _access
+#define TSIMG_R_OK 4
+#else
+#include <unistd.h>
+#define TSIMG_ACCESS ::access
+#define TSIMG_R_OK R_OK
+#endif
+
+namespace tsimg::inputs {
+
+namespace {
+    bool isSeparator(char c) {
+        return c == '-' || c == '_' || c == '.';
+    }
+
+    bool isDigit(char c) {
+        return std::isdigit(static_cast<unsigned char>(c)) != 0;
+    }
+
+    // Reescreve datas DD-MM-AAAA como AAAAMMDD para que a comparação natural as ordene
+    std::string sortKey(const std::string& name) {
+        std::string key = name;
+        for (size_t i = 0; i + 10 <= key.size(); ++i) {
+            if (i > 0 && isDigit(key[i - 1])) continue;
+            const char* p = key.data() + i;
+            bool match = isDigit(p[0]) && isDigit(p[1]) && isSeparator(p[2]) &&
+                         isDigit(p[3]) && isDigit(p[4]) && isSeparator(p[5]) &&
+                         isDigit(p[6]) && isDigit(p[7]) && isDigit(p[8]) && isDigit(p[9]) &&
+                         (i + 10 == key.size() || !isDigit(key[i + 10]));
+            if (!match) continue;
+            std::string date = key.substr(i + 6, 4) + key.substr(i + 3, 2) + key.substr(i, 2);
+            key.replace(i, 10, date);
+            i += date.size() - 1;
+        }
+        return key;
+    }
+
+    int compareNatural(const std::string& a, const std::string& b) {
+        size_t i = 0, j = 0;
+        while (i < a.size() && j < b.size()) {
+            if (isDigit(a[i]) && isDigit(b[j])) {
+                size_t si = i, sj = j;
+                while (si < a.size() && a[si] == '0') ++si;
+                while (sj < b.size() && b[sj] == '0') ++sj;
+                size_t ei = si, ej = sj;
+                while (ei < a.size() && isDigit(a[ei])) ++ei;
+                while (ej < b.size() && isDigit(b[ej])) ++ej;
+                if (ei - si != ej - sj) return ei - si < ej - sj ? -1 : 1;
+                int cmp = a.compare(si, ei - si, b, sj, ej - sj);
+                if (cmp != 0) return cmp;
+                i = ei;
+                j = ej;
+                continue;
+            }
+            int ca = std::tolower(static_cast<unsigned char>(a[i]));
+            int cb = std::tolower(static_cast<unsigned char>(b[j]));
+            if (ca != cb) return ca < cb ? -1 : 1;
+            ++i;
+            ++j;
+        }
+        if (i < a.size()) return 1;
+        if (j < b.size()) return -1;
+        return 0;
+    }
+
+    bool hasWildcard(const std::string& text) {
+        return text.find_first_of("*?[") != std::string::npos;
+    }
+
+    // Casamento de glob no estilo fnmatch para um único componente do caminho
+    bool globMatch(const char* pattern, const char* name) {
+        const char* starPattern = nullptr;
+        const char* starName = nullptr;
+        while (*name) {
+            if (*pattern == '*') {
+                starPattern = ++pattern;
+                starName = name;
+                continue;
+            }
+            bool matched = false;
+            if (*pattern == '?') {
+                matched = true;
+                ++pattern;
+            } else if (*pattern == '[') {
+                const char* p = pattern + 1;
+                bool negate = *p == '!' || *p == '^';
+                if (negate) ++p;
+                bool inSet = false;
+                const char* setStart = p;
+                while (*p && (*p != ']' || p == setStart)) {
+                    if (p[1] == '-' && p[2] && p[2] != ']') {
+                        inSet = inSet || (*name >= p[0] && *name <= p[2]);
+                        p += 3;
+                    } else {
+                        inSet = inSet || *name == *p;
+                        ++p;
+                    }
+                }
+                if (*p == ']') {
+                    matched = inSet != negate;
+                    pattern = p + 1;
+                } else {
+                    matched = *name == '['; // colchete sem fechamento é literal
+                    ++pattern;
+                }
+            } else {
+                matched = *pattern == *name;
+                if (matched) ++pattern;
+            }
+            if (matched) {
+                ++name;
+            } else if (starPattern) {
+                pattern = starPattern;
+                name = ++starName;
+            } else {
+                return false;
+            }
+        }
+        while (*pattern == '*') ++pattern;
+        return *pattern == '\0';
+    }
+
+    void sortNatural(std::vector<std::string>& paths) {
+        std::vector<std::pair<std::string, std::string>> keyed;
+        keyed.reserve(paths.size());
+        for (auto& path : paths) {
+            keyed.emplace_back(sortKey(std::filesystem::path(path).filename().string()), std::move(path));
+        }
+        std::sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b) {
+            int cmp = compareNatural(a.first, b.first);
+            return cmp != 0 ? cmp < 0 : a.second < b.second;
+        });
+        for (size_t i = 0; i < paths.size(); ++i) {
+            paths[i] = std::move(keyed[i].second);
+        }
+    }
+
+    std::vector<std::string> listImages(const std::filesystem::path& directory, const std::string& pattern) {
+        std::vector<std::string> paths;
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            std::string name = entry.path().filename().string();
+            if (!pattern.empty() && !globMatch(pattern.c_str(), name.c_str())) continue;
+            if (!tsimg::utils::FileHandler::isValidImageFormat(name)) continue;
+            std::error_code ec;
+            if (!entry.is_regular_file(ec)) continue;
+            paths.push_back(entry.path().string());
+        }
+        sortNatural(paths);
+        return paths;
+    }
+
+    // Caminho expandido; uma especificação literal já traz o stat que a classificou
+    struct Expanded {
+        std::string path;
+        tsimg::pipeline::FileStamp stamp;
+        bool statted = false;
+    };
+
+    std::vector<Expanded> expandSpec(const std::string& spec) {
+        std::filesystem::path specPath(spec);
+        std::vector<std::string> listed;
+        if (hasWildcard(spec)) {
+            std::filesystem::path directory = specPath.parent_path();
+            if (hasWildcard(directory.string())) {
+                throw std::runtime_error("Wildcards are only supported in the file name: " + spec);
+            }
+            listed = listImages(directory.empty() ? std::filesystem::path(".") : directory, specPath.filename().string());
+            if (listed.empty()) {
+                throw std::runtime_error("No images match pattern: " + spec);
+            }
+        } else {
+            bool directory = false;
+            auto stamp = tsimg::pipeline::stampFile(spec, directory);
+            if (!directory) {
+                return {Expanded{spec, stamp, true}};
+            }
+            listed = listImages(specPath, "");
+            if (listed.empty()) {
+                throw std::runtime_error("No images found in directory: " + spec);
+            }
+        }
+        std::vector<Expanded> expanded;
+        expanded.reserve(listed.size());
+        for (auto& path : listed) {
+            expanded.push_back(Expanded{std::move(path), {}, false});
+        }
+        return expanded;
+    }
+
+    // O stat é limitado por latência, não por CPU: mais threads que núcleos
+    unsigned statThreads() {
+        return std::max(4u, std::thread::hardware_concurrency()) * 2;
+    }
+
+    std::vector<Expanded> expandAll(const std::vector<std::string>& specs, bool debug) {
+        // Cada especificação é classificada (e listada, se for diretório ou padrão) em paralelo; a
+        // ordem das especificações é preservada e o erro relatado é o da primeira que falhou
+        std::vector<std::vector<Expanded>> expansions(specs.size());
+        std::vector<std::string> errors(specs.size());
+        tsimg::pipeline::parallelFor(specs.size(), statThreads(), [&](size_t i) {
+            try {
+                expansions[i] = expandSpec(specs[i]);
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+            }
+        });
+
+        std::vector<Expanded> paths;
+        for (size_t i = 0; i < expansions.size(); ++i) {
+            if (!errors[i].empty()) {
+                throw std::runtime_error(errors[i]);
+            }
+            auto& expanded = expansions[i];
+            if (expanded.size() != 1 || expanded[0].path != specs[i]) {
+                tsimg::utils::debugLog(debug, "Expanded " + specs[i] + " to " + std::to_string(expanded.size()) + " images");
+            }
+            paths.insert(paths.end(), std::make_move_iterator(expanded.begin()), std::make_move_iterator(expanded.end()));
+        }
+        return paths;
+    }
+
+    std::vector<ImageInput> validate(const std::vector<Expanded>& paths, bool debug) {
+        std::vector<ImageInput> inputs(paths.size());
+        std::vector<std::string> errors(paths.size());
+        std::atomic<size_t> next{0};
+
+        auto worker = [&]() {
+            for (size_t i = next.fetch_add(1); i < paths.size(); i = next.fetch_add(1)) {
+                const std::string& path = paths[i].path;
+                if (!tsimg::utils::FileHandler::isValidImageFormat(path)) {
+                    errors[i] = "Invalid image format. Supported formats: jpg, jpeg, png, gif, bmp. File: " + path;
+                    continue;
+                }
+                auto stamp = paths[i].statted ? paths[i].stamp : tsimg::pipeline::stampFile(path);
+                if (!stamp.valid) {
+                    errors[i] = "File does not exist: " + path;
+                    continue;
+                }
+                if (TSIMG_ACCESS(path.c_str(), TSIMG_R_OK) != 0) {
+                    errors[i] = "File is not readable or permission denied: " + path;
+                    continue;
+                }
+                inputs[i] = ImageInput{path, stamp};
+            }
+        };
+
+        // Poucos arquivos não compensam threads
+        size_t workerCount = std::min<size_t>(statThreads(), paths.size() / 64 + 1);
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < workerCount; ++t) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto& t : workers) {
+            t.join();
+        }
+
+        for (const auto& error : errors) {
+            if (!error.empty()) {
+                tsimg::utils::errorLog(debug, error);
+                throw std::runtime_error(error);
+            }
+        }
+        tsimg::utils::debugLog(debug, "Validated " + std::to_string(paths.size()) + " images with " + std::to_string(workerCount) + " threads");
+        return inputs;
+    }
+}
+
+bool naturalLess(const std::string& a, const std::string& b) {
+    int cmp = compareNatural(sortKey(a), sortKey(b));
+    return cmp != 0 ? cmp < 0 : a < b;
+}
+
+std::vector<std::string> expandInputs(const std::vector<std::string>& specs, bool debug) {
+    std::vector<std::string> paths;
+    for (auto& expanded : expandAll(specs, debug)) {
+        paths.push_back(std::move(expanded.path));
+    }
+    return paths;
+}
+
+std::vector<ImageInput> validateInputs(const std::vector<std::string>& paths, bool debug) {
+    std::vector<Expanded> unchecked;
+    unchecked.reserve(paths.size());
+    for (const auto& path : paths) {
+        unchecked.push_back(Expanded{path, {}, false});
+    }
+    return validate(unchecked, debug);
+}
+
+std::vector<ImageInput> collectInputs(const std::vector<std::string>& specs, bool debug) {
+    // Caminhos literais reaproveitam o stat da classificação
+    return validate(expandAll(specs, debug), debug);
+}
+
+std::vector<std::string> pathsOf(const std::vector<ImageInput>& inputs) {
+    std::vector<std::string> paths;
+    paths.reserve(inputs.size());
+    for (const auto& input : inputs) {
+        paths.push_back(input.path);
+    }
+    return paths;
+}
+
+bool isJpeg(const std::string& path) {
+    unsigned char magic[3] = {0, 0, 0};
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    size_t read = std::fread(magic, 1, sizeof(magic), file);
+    std::fclose(file);
+    return read == sizeof(magic) && magic[0] == 0xFF && magic[1] == 0xD8 && magic[2] == 0xFF;
+}
+
+TemporaryFrames::TemporaryFrames(const std::string& prefix) {
+    static std::atomic<unsigned> counter{0};
+    auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto path = std::filesystem::temp_directory_path() /
+                (prefix + "-" + std::to_string(stamp) + "-" + std::to_string(counter.fetch_add(1)));
+    std::filesystem::create_directories(path);
+    directory = path.string();
+}
+
+TemporaryFrames::TemporaryFrames(TemporaryFrames&& other) noexcept
+    : paths(std::move(other.paths)), directory(std::move(other.directory)) {
+    other.directory.clear();
+}
+
+TemporaryFrames& TemporaryFrames::operator=(TemporaryFrames&& other) noexcept {
+    if (this != &other) {
+        TemporaryFrames discarded(std::move(*this));
+        paths = std::move(other.paths);
+        directory = std::move(other.directory);
+        other.directory.clear();
+    }
+    return *this;
+}
+
+TemporaryFrames::~TemporaryFrames() {
+    if (directory.empty()) return;
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+}
+
+std::string TemporaryFrames::pathFor(size_t index, const std::string& original, const std::string& extension) const {
+    char prefix[32];
+    std::snprintf(prefix, sizeof(prefix), "%06zu_", index);
+    return (std::filesystem::path(directory) / (prefix + std::filesystem::path(original).stem().string() + extension)).string();
+}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "tsimg_pipeline.h"
+
+namespace tsimg::inputs {
+
+    // Caminho validado com os metadados coletados na validação, reaproveitados na leitura
+    struct ImageInput {
+        std::string path;
+        tsimg::pipeline::FileStamp stamp;
+    };
+
+    // Ordem natural (frame_2 antes de frame_10), sem diferenciar maiúsculas. Datas DD-MM-AAAA
+    // (separadas por '-', '_' ou '.') são comparadas como AAAAMMDD; datas ISO já ordenam sozinhas.
+    bool naturalLess(const std::string& a, const std::string& b);
+
+    // Expande cada especificação: diretórios viram suas imagens de primeiro nível e padrões glob
+    // (*, ? e [...] no nome do arquivo) viram os arquivos de imagem correspondentes, cada expansão
+    // em ordem natural. Caminhos comuns passam sem alteração, na ordem dada.
+    std::vector<std::string> expandInputs(const std::vector<std::string>& specs, bool debug = false);
+
+    // Valida os caminhos em paralelo (extensão, existência e permissão de leitura) com um único
+    // stat por arquivo. Lança std::runtime_error descrevendo o primeiro caminho inválido.
+    std::vector<ImageInput> validateInputs(const std::vector<std::string>& paths, bool debug = false);
+
+    // expandInputs seguido de validateInputs; cada caminho literal passa por um único stat, que o
+    // classifica como diretório ou arquivo e vira o carimbo da validação
+    std::vector<ImageInput> collectInputs(const std::vector<std::string>& specs, bool debug = false);
+
+    std::vector<std::string> pathsOf(const std::vector<ImageInput>& inputs);
+
+    // Pela assinatura no início do arquivo (FF D8 FF), não pela extensão
+    bool isJpeg(const std::string& path);
+
+    // Quadros derivados (alinhados, recortados...) gravados num diretório temporário próprio,
+    // removido junto com o objeto. paths guarda um caminho por quadro, na ordem original.
+    class TemporaryFrames {
+    public:
+        TemporaryFrames() = default;
+        explicit TemporaryFrames(const std::string& prefix); // cria <temp>/<prefix>-<sufixo único>
+        TemporaryFrames(TemporaryFrames&& other) noexcept;
+        TemporaryFrames& operator=(TemporaryFrames&& other) noexcept;
+        TemporaryFrames(const TemporaryFrames&) = delete;
+        TemporaryFrames& operator=(const TemporaryFrames&) = delete;
+        ~TemporaryFrames();
+
+        // <diretório>/<índice com 6 dígitos>_<nome do original><extension>
+        std::string pathFor(size_t index, const std::string& original, const std::string& extension) const;
+
+        std::vector<std::string> paths;
+
+    private:
+        std::string directory;
+    };
+}
@@ -0,0 +1,371 @@
+#include "tsimg_spice.h"
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#define TSIMG_HAS_PREAD 1
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define TSIMG_HAS_IO_URING 1
+#endif
+
+namespace tsimg::utils {
+
+namespace {
+
+#ifdef TSIMG_HAS_PREAD
+    // Abre o arquivo e descobre o tamanho; devolve -1 e preenche error em caso de falha.
+    int openForRead(const std::string& path, size_t& size, std::string& error) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            error = "Could not open file: " + path + " (" + std::strerror(errno) + ")";
+            return -1;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            error = "Could not stat file: " + path + " (" + std::strerror(errno) + ")";
+            ::close(fd);
+            return -1;
+        }
+        size = static_cast<size_t>(st.st_size);
+        return fd;
+    }
+
+    void preadWhole(int fd, const std::string& path, FileIO::ReadResult& result, size_t size) {
+        result.data.resize(size);
+        size_t offset = 0;
+        while (offset < size) {
+            ssize_t n = ::pread(fd, result.data.data() + offset, size - offset, static_cast<off_t>(offset));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                result.error = "Error reading file: " + path + " (" + std::strerror(errno) + ")";
+                result.data.clear();
+                return;
+            }
+            if (n == 0) break;
+            offset += static_cast<size_t>(n);
+        }
+        result.data.resize(offset);
+    }
+#endif
+
+    // Fallback portátil: um conjunto de threads bloqueantes, cada uma com uma leitura em andamento.
+    void readBatchThreads(const std::vector<std::string>& paths, const FileIO::ReadCallback& onComplete, size_t queueDepth) {
+        std::atomic<size_t> next{0};
+        std::mutex callbackMutex;
+        size_t workerCount = std::min(queueDepth == 0 ? size_t(1) : queueDepth, paths.size());
+
+        auto worker = [&]() {
+            for (size_t i = next.fetch_add(1); i < paths.size(); i = next.fetch_add(1)) {
+                FileIO::ReadResult result{i, {}, ""};
+#ifdef TSIMG_HAS_PREAD
+                size_t size = 0;
+                int fd = openForRead(paths[i], size, result.error);
+                if (fd >= 0) {
+                    preadWhole(fd, paths[i], result, size);
+                    ::close(fd);
+                }
+#else
+                try {
+                    result.data = FileIO::readBinary(paths[i]);
+                } catch (const std::exception& e) {
+                    result.error = e.what();
+                }
+#endif
+                std::lock_guard<std::mutex> lock(callbackMutex);
+                onComplete(std::move(result));
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < workerCount; ++t) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+#ifdef TSIMG_HAS_IO_URING
+    class IoUring {
+    public:
+        explicit IoUring(unsigned entries) {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if (fd < 0) {
+                return;
+            }
+
+            sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (singleMmap) {
+                sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+            }
+
+            sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sqRing == MAP_FAILED) {
+                sqRing = nullptr;
+                release();
+                return;
+            }
+            if (singleMmap) {
+                cqRing = sqRing;
+            } else {
+                cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+                if (cqRing == MAP_FAILED) {
+                    cqRing = nullptr;
+                    release();
+                    return;
+                }
+            }
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqesPtr = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (sqesPtr == MAP_FAILED) {
+                release();
+                return;
+            }
+            sqes = static_cast<io_uring_sqe*>(sqesPtr);
+
+            char* sq = static_cast<char*>(sqRing);
+            sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            sqEntries = params.sq_entries;
+
+            char* cq = static_cast<char*>(cqRing);
+            cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        }
+
+        ~IoUring() { release(); }
+
+        IoUring(const IoUring&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+
+        bool valid() const { return fd >= 0 && sqes != nullptr; }
+        unsigned capacity() const { return sqEntries; }
+
+        // Enfileira uma leitura vetorizada; só é enviada ao kernel no próximo enter().
+        void queueReadv(int fileFd, const iovec* iov, uint64_t offset, uint64_t userData) {
+            unsigned tail = *sqTail;
+            unsigned idx = tail & sqMask;
+            io_uring_sqe* sqe = &sqes[idx];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_READV;
+            sqe->fd = fileFd;
+            sqe->addr = reinterpret_cast<uint64_t>(iov);
+            sqe->len = 1;
+            sqe->off = offset;
+            sqe->user_data = userData;
+            sqArray[idx] = idx;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+            ++pending;
+        }
+
+        int enter(unsigned minComplete) {
+            unsigned toSubmit = pending;
+            pending = 0;
+            for (;;) {
+                int ret = static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete,
+                                                   minComplete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+                if (ret >= 0 || errno != EINTR) return ret;
+                toSubmit = 0;
+            }
+        }
+
+        template <typename Fn>
+        void drain(Fn&& fn) {
+            unsigned head = *cqHead;
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            while (head != tail) {
+                const io_uring_cqe& cqe = cqes[head & cqMask];
+                fn(cqe.user_data, cqe.res);
+                ++head;
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+
+    private:
+        void release() {
+            if (sqes) munmap(sqes, sqesSize);
+            if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+            if (sqRing) munmap(sqRing, sqRingSize);
+            if (fd >= 0) ::close(fd);
+            sqes = nullptr;
+            sqRing = cqRing = nullptr;
+            fd = -1;
+        }
+
+        int fd = -1;
+        void* sqRing = nullptr;
+        void* cqRing = nullptr;
+        size_t sqRingSize = 0;
+        size_t cqRingSize = 0;
+        size_t sqesSize = 0;
+        io_uring_sqe* sqes = nullptr;
+        unsigned* sqTail = nullptr;
+        unsigned* sqArray = nullptr;
+        unsigned sqMask = 0;
+        unsigned sqEntries = 0;
+        unsigned* cqHead = nullptr;
+        unsigned* cqTail = nullptr;
+        unsigned cqMask = 0;
+        io_uring_cqe* cqes = nullptr;
+        unsigned pending = 0;
+    };
+
+    struct ReadSlot {
+        size_t index = 0;
+        int fd = -1;
+        size_t offset = 0;
+        iovec iov{};
+        std::vector<unsigned char> data;
+    };
+
+    // Devolve false se o anel não pôde ser criado; nesse caso nenhum callback foi chamado.
+    bool readBatchIoUring(const std::vector<std::string>& paths, const FileIO::ReadCallback& onComplete, size_t queueDepth, bool debug) {
+        unsigned entries = static_cast<unsigned>(std::min<size_t>(std::max<size_t>(queueDepth, 1), 4096));
+        IoUring ring(entries);
+        if (!ring.valid()) {
+            debugLog(debug, "io_uring unavailable, falling back to pread threads");
+            return false;
+        }
+        debugLog(debug, "Reading " + std::to_string(paths.size()) + " files with io_uring (depth " + std::to_string(ring.capacity()) + ")");
+
+        std::vector<ReadSlot> slots(ring.capacity());
+        // Se o enter() ou um callback lançar com leituras em voo, os arquivos abertos dos slots
+        // precisam ser fechados mesmo assim (o anel guarda a própria referência deles)
+        struct SlotFiles {
+            std::vector<ReadSlot>& slots;
+            ~SlotFiles() {
+                for (auto& slot : slots) {
+                    if (slot.fd >= 0) ::close(slot.fd);
+                }
+            }
+        } slotFiles{slots};
+        std::vector<size_t> freeSlots;
+        for (size_t s = slots.size(); s > 0; --s) {
+            freeSlots.push_back(s - 1);
+        }
+
+        auto finish = [&](size_t s, std::string error) {
+            ReadSlot& slot = slots[s];
+            if (slot.fd >= 0) ::close(slot.fd);
+            slot.fd = -1;
+            FileIO::ReadResult result{slot.index, std::move(slot.data), std::move(error)};
+            if (!result.error.empty()) {
+                result.data.clear();
+            } else {
+                result.data.resize(slot.offset);
+            }
+            slot.data = {};
+            freeSlots.push_back(s);
+            onComplete(std::move(result));
+        };
+
+        auto submitRemaining = [&](size_t s) {
+            ReadSlot& slot = slots[s];
+            slot.iov.iov_base = slot.data.data() + slot.offset;
+            slot.iov.iov_len = slot.data.size() - slot.offset;
+            ring.queueReadv(slot.fd, &slot.iov, slot.offset, s);
+        };
+
+        size_t next = 0;
+        size_t inFlight = 0;
+        while (next < paths.size() || inFlight > 0) {
+            while (next < paths.size() && !freeSlots.empty()) {
+                size_t i = next++;
+                size_t size = 0;
+                std::string error;
+                int fd = openForRead(paths[i], size, error);
+                if (fd < 0 || size == 0) {
+                    if (fd >= 0) ::close(fd);
+                    onComplete(FileIO::ReadResult{i, {}, error});
+                    continue;
+                }
+                size_t s = freeSlots.back();
+                freeSlots.pop_back();
+                ReadSlot& slot = slots[s];
+                slot.index = i;
+                slot.fd = fd;
+                slot.offset = 0;
+                slot.data.resize(size);
+                submitRemaining(s);
+                ++inFlight;
+            }
+            if (inFlight == 0) {
+                continue;
+            }
+
+            if (ring.enter(1) < 0) {
+                throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+            }
+
+            ring.drain([&](uint64_t userData, int res) {
+                size_t s = static_cast<size_t>(userData);
+                ReadSlot& slot = slots[s];
+                if (res == -EINTR || res == -EAGAIN) {
+                    submitRemaining(s);
+                    return;
+                }
+                if (res < 0) {
+                    --inFlight;
+                    finish(s, "Error reading file: " + paths[slot.index] + " (" + std::strerror(-res) + ")");
+                    return;
+                }
+                slot.offset += static_cast<size_t>(res);
+                if (res > 0 && slot.offset < slot.data.size()) {
+                    // Leitura parcial (comum em NFS): reenvia o restante
+                    submitRemaining(s);
+                    return;
+                }
+                --inFlight;
+                finish(s, "");
+            });
+        }
+        return true;
+    }
+#endif
+
+}
+
+bool FileIO::ioUringAvailable() {
+#ifdef TSIMG_HAS_IO_URING
+    static const bool available = IoUring(1).valid();
+    return available;
+#else
+    return false;
+#endif
+}
+
+void FileIO::readBatch(const std::vector<std::string>& paths, const ReadCallback& onComplete, size_t queueDepth, bool debug) {
+    if (paths.empty()) {
+        return;
+    }
+#ifdef TSIMG_HAS_IO_URING
+    if (readBatchIoUring(paths, onComplete, queueDepth, debug)) {
+        return;
+    }
+#endif
+    debugLog(debug, "Reading " + std::to_string(paths.size()) + " files with " +
+                    std::to_string(std::min(queueDepth, paths.size())) + " reader threads");
+    readBatchThreads(paths, onComplete, queueDepth);
+}
+
+}
@@ -0,0 +1,289 @@
+#include "tsimg_memory.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#if defined(_WIN32)
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace tsimg::memory {
+
+namespace {
+    struct StageCounters {
+        std::atomic<size_t> live{0};
+        std::atomic<size_t> peak{0};
+        std::atomic<size_t> total{0};
+    };
+
+    std::atomic<bool> accountingEnabled{false};
+    StageCounters counters[kStageCount];
+
+    // Admissão: o orçamento é lido sem lock; as estimativas vivas ficam sob admissionMutex
+    std::atomic<size_t> budgetBytes{0};
+    std::mutex admissionMutex;
+    std::condition_variable admissionReleased;
+    size_t admittedLive = 0;
+    size_t admittedPeak = 0;
+    size_t admissionWaits = 0;
+
+    // Chamado com admissionMutex travado
+    bool fitsBudget(size_t bytes) {
+        return admittedLive == 0 || admittedLive + bytes <= budgetBytes.load(std::memory_order_relaxed);
+    }
+
+    void admitLocked(size_t bytes) {
+        admittedLive += bytes;
+        admittedPeak = std::max(admittedPeak, admittedLive);
+    }
+
+    bool exitPrint = false;
+    std::string exitJsonPath;
+
+    StageCounters& countersFor(Stage stage) {
+        return counters[static_cast<size_t>(stage)];
+    }
+
+    void reportOnExit() {
+        if (exitPrint) {
+            printReport(std::cerr);
+        }
+        if (!exitJsonPath.empty()) {
+            std::ofstream file(exitJsonPath);
+            if (file.is_open()) {
+                file << reportJson().dump(2) << std::endl;
+            } else {
+                std::cerr << "Could not write memory report: " << exitJsonPath << std::endl;
+            }
+        }
+    }
+
+    std::string formatMiB(size_t bytes) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MiB";
+        return out.str();
+    }
+}
+
+const char* stageName(Stage stage) {
+    switch (stage) {
+        case Stage::Ingest: return "ingest";
+        case Stage::Encode: return "encode";
+        case Stage::Render: return "render";
+        case Stage::Write: return "write";
+        case Stage::Gif: return "gif";
+    }
+    return "unknown";
+}
+
+void setEnabled(bool enabled) {
+    accountingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool enabled() {
+    return accountingEnabled.load(std::memory_order_relaxed);
+}
+
+void allocate(Stage stage, size_t bytes) {
+    if (bytes == 0) return;
+    auto& c = countersFor(stage);
+    size_t live = c.live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    c.total.fetch_add(bytes, std::memory_order_relaxed);
+    size_t peak = c.peak.load(std::memory_order_relaxed);
+    while (live > peak && !c.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+void release(Stage stage, size_t bytes) {
+    if (bytes == 0) return;
+    countersFor(stage).live.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+Charge::Charge(Stage stage, size_t bytes) : stage(stage) {
+    resize(bytes);
+}
+
+Charge::~Charge() {
+    reset();
+}
+
+Charge::Charge(Charge&& other) noexcept : stage(other.stage), bytes(other.bytes) {
+    other.bytes = 0;
+}
+
+Charge& Charge::operator=(Charge&& other) noexcept {
+    if (this != &other) {
+        reset();
+        stage = other.stage;
+        bytes = other.bytes;
+        other.bytes = 0;
+    }
+    return *this;
+}
+
+void Charge::resize(size_t newBytes) {
+    // Só contabiliza com a opção ligada; o que já foi contado é sempre devolvido
+    if (newBytes > 0 && !enabled()) newBytes = 0;
+    if (newBytes > bytes) {
+        allocate(stage, newBytes - bytes);
+    } else if (newBytes < bytes) {
+        release(stage, bytes - newBytes);
+    }
+    bytes = newBytes;
+}
+
+void setBudget(size_t bytes) {
+    budgetBytes.store(bytes, std::memory_order_relaxed);
+    admissionReleased.notify_all();
+}
+
+size_t budget() {
+    return budgetBytes.load(std::memory_order_relaxed);
+}
+
+Admission::~Admission() {
+    release();
+}
+
+Admission::Admission(Admission&& other) noexcept : bytes(other.bytes), admitted(other.admitted) {
+    other.admitted = false;
+}
+
+Admission& Admission::operator=(Admission&& other) noexcept {
+    if (this != &other) {
+        release();
+        bytes = other.bytes;
+        admitted = other.admitted;
+        other.admitted = false;
+    }
+    return *this;
+}
+
+void Admission::release() {
+    if (!admitted) return;
+    admitted = false;
+    {
+        std::lock_guard<std::mutex> lock(admissionMutex);
+        admittedLive -= bytes;
+    }
+    admissionReleased.notify_all();
+}
+
+Admission admit(size_t bytes, const std::atomic<bool>* cancel) {
+    Admission admission;
+    if (budget() == 0) return admission;
+    std::unique_lock<std::mutex> lock(admissionMutex);
+    if (!fitsBudget(bytes)) {
+        ++admissionWaits;
+        auto ready = [&]() { return budget() == 0 || fitsBudget(bytes); };
+        if (!cancel) {
+            admissionReleased.wait(lock, ready);
+        } else {
+            while (!admissionReleased.wait_for(lock, std::chrono::milliseconds(50), ready)) {
+                if (cancel->load(std::memory_order_relaxed)) return admission;
+            }
+        }
+        if (budget() == 0) return admission;
+    }
+    admitLocked(bytes);
+    admission.bytes = bytes;
+    admission.admitted = true;
+    return admission;
+}
+
+bool tryAdmit(size_t bytes, Admission& admission) {
+    if (budget() == 0) {
+        admission = Admission();
+        return true;
+    }
+    Admission granted;
+    {
+        std::lock_guard<std::mutex> lock(admissionMutex);
+        if (!fitsBudget(bytes)) return false;
+        admitLocked(bytes);
+    }
+    granted.bytes = bytes;
+    granted.admitted = true;
+    admission = std::move(granted);
+    return true;
+}
+
+StageUsage usage(Stage stage) {
+    auto& c = countersFor(stage);
+    return {c.live.load(std::memory_order_relaxed), c.peak.load(std::memory_order_relaxed), c.total.load(std::memory_order_relaxed)};
+}
+
+size_t peakRssBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return static_cast<size_t>(pmc.PeakWorkingSetSize);
+    }
+    return 0;
+#elif defined(__unix__) || defined(__APPLE__)
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<size_t>(ru.ru_maxrss);        // bytes no macOS
+#else
+    return static_cast<size_t>(ru.ru_maxrss) * 1024; // KiB no Linux
+#endif
+#else
+    return 0;
+#endif
+}
+
+nlohmann::json reportJson() {
+    nlohmann::json stages = nlohmann::json::object();
+    for (size_t i = 0; i < kStageCount; ++i) {
+        auto stage = static_cast<Stage>(i);
+        auto u = usage(stage);
+        stages[stageName(stage)] = {{"live_bytes", u.liveBytes}, {"peak_bytes", u.peakBytes}, {"total_bytes", u.totalBytes}};
+    }
+    nlohmann::json report = {{"stages", stages}, {"peak_rss_bytes", peakRssBytes()}};
+    if (budget() > 0) {
+        std::lock_guard<std::mutex> lock(admissionMutex);
+        report["admission"] = {{"budget_bytes", budget()}, {"peak_admitted_bytes", admittedPeak}, {"waits", admissionWaits}};
+    }
+    return report;
+}
+
+void printReport(std::ostream& out) {
+    out << "Memory usage by stage (peak live / total):" << std::endl;
+    for (size_t i = 0; i < kStageCount; ++i) {
+        auto stage = static_cast<Stage>(i);
+        auto u = usage(stage);
+        out << "  " << std::left << std::setw(8) << stageName(stage) << std::right
+            << std::setw(12) << formatMiB(u.peakBytes) << " / " << formatMiB(u.totalBytes) << std::endl;
+    }
+    out << "  peak RSS " << formatMiB(peakRssBytes()) << std::endl;
+    if (budget() > 0) {
+        std::lock_guard<std::mutex> lock(admissionMutex);
+        out << "  budget " << formatMiB(budget()) << ", peak admitted " << formatMiB(admittedPeak)
+            << ", " << admissionWaits << " tasks waited" << std::endl;
+    }
+}
+
+void reportAtExit(bool printToStderr, const std::string& jsonPath) {
+    static bool registered = false;
+    setEnabled(true);
+    exitPrint = printToStderr;
+    exitJsonPath = jsonPath;
+    if (!registered) {
+        registered = true;
+        std::atexit(reportOnExit);
+    }
+}
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace tsimg::memory {
+
+    // Etapas em que a memória dos quadros é contabilizada
+    enum class Stage { Ingest, Encode, Render, Write, Gif };
+    constexpr size_t kStageCount = 5;
+
+    const char* stageName(Stage stage);
+
+    // Contabilização opcional: desligada, Charge e allocate/release não custam mais que um load.
+    void setEnabled(bool enabled);
+    bool enabled();
+
+    void allocate(Stage stage, size_t bytes);
+    void release(Stage stage, size_t bytes);
+
+    // Bytes atribuídos a uma etapa enquanto o objeto vive; acompanha o buffer que contabiliza
+    // (membro ao lado do buffer, ou local durante uma cópia temporária).
+    class Charge {
+    public:
+        Charge() = default;
+        Charge(Stage stage, size_t bytes);
+        ~Charge();
+
+        Charge(Charge&& other) noexcept;
+        Charge& operator=(Charge&& other) noexcept;
+        Charge(const Charge&) = delete;
+        Charge& operator=(const Charge&) = delete;
+
+        void resize(size_t bytes);
+        void reset() { resize(0); }
+
+    private:
+        Stage stage = Stage::Ingest;
+        size_t bytes = 0;
+    };
+
+    // Orçamento de admissão (--memory-budget): cada tarefa declara quanto espera manter vivo e só
+    // começa enquanto a soma das estimativas admitidas cabe no orçamento. Uma tarefa maior que o
+    // orçamento inteiro roda quando nenhuma outra está admitida. 0 = sem limite (padrão).
+    void setBudget(size_t bytes);
+    size_t budget();
+
+    // Estimativa admitida enquanto o objeto vive (ou até release)
+    class Admission {
+    public:
+        Admission() = default;
+        ~Admission();
+
+        Admission(Admission&& other) noexcept;
+        Admission& operator=(Admission&& other) noexcept;
+        Admission(const Admission&) = delete;
+        Admission& operator=(const Admission&) = delete;
+
+        bool held() const { return admitted; }
+        void release();
+
+    private:
+        friend Admission admit(size_t bytes, const std::atomic<bool>* cancel);
+        friend bool tryAdmit(size_t bytes, Admission& admission);
+        size_t bytes = 0;
+        bool admitted = false;
+    };
+
+    // Bloqueia até bytes caber no orçamento; sem orçamento devolve na hora. Se cancel for
+    // sinalizado durante a espera, devolve sem admitir (held() == false).
+    Admission admit(size_t bytes, const std::atomic<bool>* cancel = nullptr);
+    // Não bloqueia: false (e admission intocada) se bytes não cabe agora
+    bool tryAdmit(size_t bytes, Admission& admission);
+
+    struct StageUsage {
+        size_t liveBytes = 0;
+        size_t peakBytes = 0;
+        size_t totalBytes = 0; // soma de tudo que passou pela etapa
+    };
+
+    StageUsage usage(Stage stage);
+
+    // Pico de memória residente do processo (0 se a plataforma não informa)
+    size_t peakRssBytes();
+
+    nlohmann::json reportJson();
+    void printReport(std::ostream& out);
+
+    // Liga a contabilização e registra o relatório para o fim do processo: no stderr se
+    // printToStderr, e em jsonPath se não estiver vazio.
+    void reportAtExit(bool printToStderr, const std::string& jsonPath);
+}
@@ -0,0 +1,273 @@
+#include "tsimg_normalize.h"
+#include "tsimg_downscale.h"
+#include "tsimg_memory.h"
+#include "tsimg_pipeline.h"
+#include "tsimg_spice.h"
+#include <stb_image_write.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace tsimg::normalize {
+
+namespace {
+    using Histogram = std::array<uint64_t, 256>;
+    using Lut = std::array<uint8_t, 256>;
+
+    // Luminância (BT.601, inteira) de cada pixel em quatro histogramas intercalados: pixels
+    // vizinhos com o mesmo valor não esperam um pelo incremento do outro. O cálculo da luminância
+    // num bloco sem desvio fica separado da contagem, para o compilador vetorizá-lo. Pixels com
+    // alfa 0 (nodata) vão para uma posição extra, descartada no fim.
+    Histogram lumaHistogram(const uint8_t* rgba, size_t pixels) {
+        constexpr size_t kBlock = 1024;
+        constexpr uint16_t kTransparent = 256;
+        std::array<std::array<uint64_t, 257>, 4> partial{};
+        std::array<uint16_t, kBlock> luma;
+        for (size_t start = 0; start < pixels; start += kBlock) {
+            const size_t count = std::min(kBlock, pixels - start);
+            const uint8_t* p = rgba + start * 4;
+            for (size_t i = 0; i < count; ++i) {
+                const uint16_t value = static_cast<uint16_t>((77u * p[i * 4] + 150u * p[i * 4 + 1] + 29u * p[i * 4 + 2] + 128u) >> 8);
+                luma[i] = p[i * 4 + 3] ? value : kTransparent;
+            }
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                ++partial[0][luma[i]];
+                ++partial[1][luma[i + 1]];
+                ++partial[2][luma[i + 2]];
+                ++partial[3][luma[i + 3]];
+            }
+            for (; i < count; ++i) {
+                ++partial[0][luma[i]];
+            }
+        }
+        Histogram total{};
+        for (const auto& h : partial) {
+            for (size_t v = 0; v < total.size(); ++v) total[v] += h[v];
+        }
+        return total;
+    }
+
+    // Tabela aplicada a R, G e B; o alfa fica como está e pixels transparentes (nodata) não mudam
+    void applyLut(uint8_t* rgba, size_t pixels, const Lut& lut) {
+        for (size_t i = 0; i < pixels; ++i) {
+            uint8_t* p = rgba + i * 4;
+            if (p[3] == 0) continue;
+            p[0] = lut[p[0]];
+            p[1] = lut[p[1]];
+            p[2] = lut[p[2]];
+        }
+    }
+
+    Lut identity() {
+        Lut lut;
+        for (size_t v = 0; v < lut.size(); ++v) lut[v] = static_cast<uint8_t>(v);
+        return lut;
+    }
+
+    uint64_t total(const Histogram& histogram) {
+        uint64_t count = 0;
+        for (uint64_t n : histogram) count += n;
+        return count;
+    }
+
+    // Menor valor cujo acumulado passa de percent% dos pixels
+    int percentile(const Histogram& histogram, uint64_t count, double percent) {
+        const double threshold = count * percent / 100.0;
+        uint64_t cumulative = 0;
+        for (size_t v = 0; v < histogram.size(); ++v) {
+            cumulative += histogram[v];
+            if (static_cast<double>(cumulative) > threshold || cumulative == count) return static_cast<int>(v);
+        }
+        return 255;
+    }
+
+    double median(std::vector<double> values) {
+        auto middle = values.begin() + values.size() / 2;
+        std::nth_element(values.begin(), middle, values.end());
+        return *middle;
+    }
+
+    // Stretch: [low, high] de cada quadro vai para a mediana dos low e dos high da série
+    std::vector<Lut> stretchTables(const std::vector<Histogram>& histograms, double clipPercent) {
+        std::vector<double> lows, highs;
+        std::vector<std::pair<int, int>> ranges(histograms.size(), {0, 0});
+        for (size_t i = 0; i < histograms.size(); ++i) {
+            const uint64_t count = total(histograms[i]);
+            if (count == 0) continue;
+            ranges[i] = {percentile(histograms[i], count, clipPercent), percentile(histograms[i], count, 100.0 - clipPercent)};
+            lows.push_back(ranges[i].first);
+            highs.push_back(ranges[i].second);
+        }
+        std::vector<Lut> tables(histograms.size(), identity());
+        if (lows.empty()) return tables;
+        const double targetLow = median(lows);
+        const double targetHigh = median(highs);
+        if (targetHigh <= targetLow) return tables;
+
+        for (size_t i = 0; i < histograms.size(); ++i) {
+            const auto [low, high] = ranges[i];
+            if (high <= low) continue;
+            const double scale = (targetHigh - targetLow) / (high - low);
+            for (int v = 0; v < 256; ++v) {
+                tables[i][v] = static_cast<uint8_t>(std::clamp(std::lround(targetLow + (v - low) * scale), 0L, 255L));
+            }
+        }
+        return tables;
+    }
+
+    // Match: cada valor vai para o menor valor do alvo com acumulado normalizado igual ou maior; o
+    // alvo é a média dos acumulados dos quadros, então todos pesam igual
+    std::vector<Lut> matchTables(const std::vector<Histogram>& histograms) {
+        std::vector<std::array<double, 256>> cdfs(histograms.size());
+        std::array<double, 256> target{};
+        size_t measured = 0;
+        for (size_t i = 0; i < histograms.size(); ++i) {
+            const uint64_t count = total(histograms[i]);
+            if (count == 0) continue;
+            uint64_t cumulative = 0;
+            for (size_t v = 0; v < 256; ++v) {
+                cumulative += histograms[i][v];
+                cdfs[i][v] = static_cast<double>(cumulative) / count;
+                target[v] += cdfs[i][v];
+            }
+            ++measured;
+        }
+        std::vector<Lut> tables(histograms.size(), identity());
+        if (measured == 0) return tables;
+        for (double& value : target) value /= measured;
+
+        constexpr double kTolerance = 1e-9;
+        for (size_t i = 0; i < histograms.size(); ++i) {
+            if (total(histograms[i]) == 0) continue;
+            size_t t = 0;
+            for (size_t v = 0; v < 256; ++v) {
+                // Os dois acumulados são crescentes: a busca continua de onde parou
+                while (t < 255 && target[t] + kTolerance < cdfs[i][v]) ++t;
+                tables[i][v] = static_cast<uint8_t>(t);
+            }
+        }
+        return tables;
+    }
+
+    struct Frame {
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> rgba;       // vazio se não coube em retainBytes
+        tsimg::memory::Charge charge;
+    };
+
+    size_t decodedBytes(const std::string& path) {
+        int width = 0, height = 0;
+        if (!tsimg::downscale::imageSize(path, width, height)) return 0;
+        return static_cast<size_t>(width) * height * 4;
+    }
+
+    void decode(const std::string& path, Frame& frame, bool debug) {
+        if (!tsimg::downscale::imageSize(path, frame.width, frame.height)) {
+            throw std::runtime_error("Failed to read image header: " + path);
+        }
+        tsimg::downscale::Options decode;
+        decode.stage = tsimg::memory::Stage::Ingest;
+        decode.debug = debug;
+        if (!tsimg::downscale::loadCroppedRgba(path, 0, 0, frame.width, frame.height, frame.rgba, decode)) {
+            throw std::runtime_error("Failed to decode image for normalization: " + path);
+        }
+        frame.charge = tsimg::memory::Charge(tsimg::memory::Stage::Ingest, frame.rgba.size());
+    }
+}
+
+Mode parseMode(const std::string& name) {
+    if (name == "off") return Mode::Off;
+    if (name == "stretch") return Mode::Stretch;
+    if (name == "match") return Mode::Match;
+    throw std::runtime_error("Unknown normalization mode: " + name + " (expected off, stretch or match)");
+}
+
+tsimg::inputs::TemporaryFrames normalizeSeries(const std::vector<std::string>& paths, const Options& options) {
+    if (!options.enabled() || paths.empty()) {
+        tsimg::inputs::TemporaryFrames unchanged;
+        unchanged.paths = paths;
+        return unchanged;
+    }
+    if (options.clipPercent < 0.0 || options.clipPercent >= 50.0) {
+        throw std::runtime_error("Normalization clip must be in [0, 50) percent, got " + std::to_string(options.clipPercent));
+    }
+
+    // Com orçamento, metade dele fica para as demais etapas
+    size_t retainLimit = options.retainBytes;
+    if (tsimg::memory::budget() > 0) {
+        retainLimit = std::min(retainLimit, tsimg::memory::budget() / 2);
+    }
+
+    std::vector<Frame> frames(paths.size());
+    std::vector<Histogram> histograms(paths.size());
+    std::atomic<size_t> retained{0};
+    std::atomic<size_t> redecoded{0};
+    auto started = std::chrono::steady_clock::now();
+
+    // Primeira passada: histogramas, guardando o RGBA que couber para a segunda
+    tsimg::pipeline::parallelFor(paths.size(), options.threads, [&](size_t i) {
+        Frame& frame = frames[i];
+        decode(paths[i], frame, options.debug);
+        histograms[i] = lumaHistogram(frame.rgba.data(), static_cast<size_t>(frame.width) * frame.height);
+        const size_t bytes = frame.rgba.size();
+        if (retained.fetch_add(bytes) + bytes > retainLimit) {
+            retained.fetch_sub(bytes);
+            std::vector<uint8_t>().swap(frame.rgba);
+            frame.charge.reset();
+        }
+    }, [&](size_t i) { return decodedBytes(paths[i]); });
+
+    const std::vector<Lut> tables = options.mode == Mode::Stretch ? stretchTables(histograms, options.clipPercent) : matchTables(histograms);
+    const Lut unchangedTable = identity();
+    std::vector<bool> decodeAgain(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        decodeAgain[i] = frames[i].rgba.empty() && tables[i] != unchangedTable;
+    }
+
+    // Segunda passada: LUT e gravação
+    tsimg::inputs::TemporaryFrames series("tsimg-normalize");
+    series.paths.resize(paths.size());
+    std::atomic<size_t> unchanged{0};
+    tsimg::pipeline::parallelFor(paths.size(), options.threads, [&](size_t i) {
+        Frame& frame = frames[i];
+        if (tables[i] == unchangedTable) {
+            series.paths[i] = paths[i];
+            unchanged.fetch_add(1);
+        } else {
+            if (decodeAgain[i]) {
+                decode(paths[i], frame, options.debug);
+                redecoded.fetch_add(1);
+            }
+            applyLut(frame.rgba.data(), static_cast<size_t>(frame.width) * frame.height, tables[i]);
+
+            bool jpeg = tsimg::inputs::isJpeg(paths[i]);
+            std::string target = series.pathFor(i, paths[i], jpeg ? ".jpg" : ".png");
+            int written = jpeg ? stbi_write_jpg(target.c_str(), frame.width, frame.height, 4, frame.rgba.data(), options.jpegQuality)
+                               : stbi_write_png(target.c_str(), frame.width, frame.height, 4, frame.rgba.data(), frame.width * 4);
+            if (!written) {
+                throw std::runtime_error("Failed to write normalized frame: " + target);
+            }
+            series.paths[i] = target;
+        }
+        std::vector<uint8_t>().swap(frame.rgba);
+        frame.charge.reset();
+    }, [&](size_t i) {
+        // Estimativa para o orçamento de memória: só quem não ficou guardado decodifica de novo
+        return decodeAgain[i] ? decodedBytes(paths[i]) : size_t(0);
+    });
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+    tsimg::utils::debugLog(options.debug, "Normalized " + std::to_string(paths.size() - unchanged.load()) + " frames (" +
+                           (options.mode == Mode::Stretch ? "stretch" : "match") + ") in " + std::to_string(elapsed) + " ms; " +
+                           std::to_string(unchanged.load()) + " unchanged, " + std::to_string(redecoded.load()) +
+                           " decoded twice for lack of retained memory");
+    return series;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "tsimg_inputs.h"
+
+namespace tsimg::normalize {
+
+    // Stretch: leva os percentis clip e 100 - clip da luminância de cada quadro aos valores
+    // medianos da série. Match: casa o histograma de cada quadro com o histograma médio da série.
+    enum class Mode { Off, Stretch, Match };
+
+    // "off", "stretch" ou "match"; lança std::runtime_error para outros nomes
+    Mode parseMode(const std::string& name);
+
+    struct Options {
+        Mode mode = Mode::Off;
+        double clipPercent = 0.5;                  // Stretch: pixels ignorados em cada ponta do histograma
+        size_t retainBytes = size_t(512) << 20;    // RGBA decodificado mantido entre as passadas
+        int jpegQuality = 95;                      // quadros JPEG continuam JPEG depois da correção
+        unsigned threads = 0;                      // 0 = std::thread::hardware_concurrency()
+        bool debug = false;
+
+        bool enabled() const { return mode != Mode::Off; }
+    };
+
+    // Duas passadas em paralelo. A primeira decodifica cada quadro e monta o histograma da
+    // luminância; os histogramas viram o alvo da série e uma tabela (LUT) por quadro. A segunda
+    // aplica a LUT aos canais RGB e grava o quadro num diretório temporário, no formato de origem.
+    // Quadros decodificados na primeira passada ficam em memória até retainBytes (limitado também
+    // pela metade de --memory-budget) e não são decodificados de novo; quadros cuja LUT é a
+    // identidade seguem com o caminho original. Pixels com alfa 0 (nodata) ficam fora dos
+    // histogramas e não são alterados. Lança std::runtime_error se um quadro não puder
+    // ser lido ou gravado.
+    tsimg::inputs::TemporaryFrames normalizeSeries(const std::vector<std::string>& paths, const Options& options);
+}
@@ -0,0 +1,493 @@
+#include "tsimg_pipeline.h"
+#include "tsimg_spice.h"
+#include "tsimg_memory.h"
+#include "tsimg_png.h"
+#include <algorithm>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+#endif
+
+namespace tsimg::pipeline {
+
+namespace {
+    // Quantos quadros o leitor entrega ao FileIO por vez
+    constexpr size_t kReadChunk = 256;
+    constexpr size_t kLazyReadChunk = 16;
+    // Quantos quadros o leitor pode estar à frente do escritor. Quando um quadro atrasa (NFS,
+    // codificação pesada), os seguintes esperam no buffer de reordenação do escritor; a janela
+    // limita esse buffer em vez de deixar a leitura seguir até o fim da série.
+    constexpr size_t kReorderWindow = 2 * kReadChunk;
+    // Quantos itens pendentes o parallelFor com orçamento examina procurando um que caiba
+    constexpr size_t kAdmissionLookahead = 64;
+
+    // Bytes vivos de um quadro do SPICE entre a leitura e a escrita: o arquivo lido e a tag
+    // <img> com o Base64 (4/3 do arquivo mais a marcação)
+    size_t frameFootprint(uintmax_t fileBytes) {
+        return static_cast<size_t>(fileBytes + (fileBytes + 2) / 3 * 4 + 512);
+    }
+
+    struct RawFrame {
+        size_t seq = 0;
+        std::string path;
+        std::vector<unsigned char> data;
+        std::string error;
+        FileStamp stamp;
+        tsimg::memory::Charge charge; // bytes lidos aguardando codificação
+        tsimg::memory::Admission admission; // estimativa do quadro até ele ser escrito
+        int width = 0;
+        int height = 0;
+        std::shared_ptr<const std::vector<uint8_t>> pixels; // quadro de PixelSource, ainda sem PNG
+    };
+
+    struct EncodedFrame {
+        size_t seq = 0;
+        std::shared_ptr<const std::string> tag;
+        std::string error;
+        tsimg::memory::Charge charge; // tag codificada aguardando o escritor
+        tsimg::memory::Admission admission;
+    };
+
+    // Quadro que chegou fora de ordem e espera no buffer de reordenação do escritor
+    struct PendingFrame {
+        std::shared_ptr<const std::string> tag;
+        tsimg::memory::Charge charge;
+        tsimg::memory::Admission admission;
+    };
+
+    constexpr size_t kUnknown = static_cast<size_t>(-1);
+}
+
+FileStamp stampFile(const std::string& path) {
+    bool directory = false;
+    return stampFile(path, directory);
+}
+
+FileStamp stampFile(const std::string& path, bool& directory) {
+    FileStamp stamp;
+    directory = false;
+#if defined(__unix__) || defined(__APPLE__)
+    // Um único stat; directory_entry faria uma chamada para o tamanho e outra para a data
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return stamp;
+    directory = S_ISDIR(st.st_mode);
+    if (!S_ISREG(st.st_mode)) return stamp;
+    stamp.size = static_cast<uintmax_t>(st.st_size);
+#ifdef __APPLE__
+    stamp.mtime = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    stamp.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+#else
+    std::error_code ec;
+    std::filesystem::directory_entry entry(path, ec);
+    if (ec) return stamp;
+    directory = entry.is_directory(ec);
+    if (!entry.is_regular_file(ec)) return stamp;
+    stamp.size = entry.file_size(ec);
+    if (ec) return stamp;
+    auto mtime = entry.last_write_time(ec);
+    if (ec) return stamp;
+    stamp.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+#endif
+    stamp.valid = true;
+    return stamp;
+}
+
+void parallelFor(size_t count, unsigned threads, const std::function<void(size_t)>& work) {
+    std::atomic<size_t> next{0};
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            try {
+                work(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure) failure = std::current_exception();
+                next.store(count);
+            }
+        }
+    };
+    size_t workerCount = std::min<size_t>(threads ? threads : std::max(1u, std::thread::hardware_concurrency()), count);
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < workerCount; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : workers) {
+        t.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+void parallelFor(size_t count, unsigned threads, const std::function<void(size_t)>& work,
+                 const std::function<size_t(size_t)>& estimate) {
+    if (tsimg::memory::budget() == 0) {
+        parallelFor(count, threads, work);
+        return;
+    }
+    // Estimativas vêm de cabeçalhos e tamanhos de arquivo: baratas, mas com E/S
+    std::vector<size_t> estimates(count);
+    parallelFor(count, threads, [&](size_t i) { estimates[i] = estimate(i); });
+
+    std::list<size_t> pending;
+    for (size_t i = 0; i < count; ++i) {
+        pending.push_back(i);
+    }
+    std::mutex pendingMutex;
+    parallelFor(count, threads, [&](size_t) {
+        size_t index = 0;
+        tsimg::memory::Admission admission;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            auto chosen = pending.begin();
+            size_t scanned = 0;
+            for (auto it = pending.begin(); it != pending.end() && scanned < kAdmissionLookahead; ++it, ++scanned) {
+                if (tsimg::memory::tryAdmit(estimates[*it], admission)) {
+                    chosen = it;
+                    break;
+                }
+            }
+            index = *chosen;
+            pending.erase(chosen);
+        }
+        // Nada coube: espera pelo primeiro pendente, sem segurar a lista
+        if (!admission.held() && tsimg::memory::budget() > 0) {
+            admission = tsimg::memory::admit(estimates[index]);
+        }
+        work(index);
+    });
+}
+
+SharedFrames::SharedFrames(const std::vector<std::string>& paths, size_t maxBytes)
+    : entries(paths.size()), maxBytes(maxBytes) {
+    for (size_t i = 0; i < paths.size(); ++i) {
+        waiting[paths[i]].push_back(i);
+    }
+}
+
+void SharedFrames::deposit(const std::string& path, std::shared_ptr<const std::vector<unsigned char>> data) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = waiting.find(path);
+        if (it == waiting.end() || it->second.empty()) {
+            return;
+        }
+        Entry& entry = entries[it->second.front()];
+        it->second.pop_front();
+        if (data && !closed && heldBytes + data->size() <= maxBytes) {
+            heldBytes += data->size();
+            entry.charge = tsimg::memory::Charge(tsimg::memory::Stage::Ingest, data->size());
+            entry.data = std::move(data);
+            entry.state = State::Ready;
+        } else {
+            entry.state = State::Missed;
+        }
+    }
+    changed.notify_all();
+}
+
+std::shared_ptr<const std::vector<unsigned char>> SharedFrames::take(size_t index) {
+    std::unique_lock<std::mutex> lock(mutex);
+    Entry& entry = entries[index];
+    changed.wait(lock, [&]() { return closed || entry.state != State::Pending; });
+    if (entry.state != State::Ready) {
+        return nullptr;
+    }
+    heldBytes -= entry.data->size();
+    entry.state = State::Missed;
+    entry.charge.reset();
+    return std::move(entry.data);
+}
+
+void SharedFrames::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+    }
+    changed.notify_all();
+}
+
+std::vector<size_t> streamSpice(std::ostream& out, const std::vector<OutputSlot>& slots, const std::string& trailer, const StreamOptions& options) {
+    using tsimg::utils::FileIO;
+
+    // Fim de cada slot na numeração global dos quadros; fontes sob demanda só são conhecidas
+    // quando o leitor as esgota, por isso o escritor consulta esses valores enquanto avança.
+    std::unique_ptr<std::atomic<size_t>[]> slotEnd(new std::atomic<size_t>[slots.size()]);
+    bool lazyInput = false;
+    size_t knownFrames = 0;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        lazyInput = lazyInput || static_cast<bool>(slots[i].nextPath) || static_cast<bool>(slots[i].nextPixels);
+        knownFrames += slots[i].framePaths.size();
+        slotEnd[i].store(kUnknown);
+    }
+    std::atomic<size_t> totalFrames{kUnknown};
+    // Quadros já escritos, para a janela de reordenação do leitor
+    std::atomic<size_t> written{0};
+    std::mutex windowMutex;
+    std::condition_variable windowMoved;
+
+    size_t encoderCount = options.encoderThreads;
+    if (encoderCount == 0) {
+        encoderCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (!lazyInput) {
+        encoderCount = std::max<size_t>(1, std::min(encoderCount, knownFrames));
+    }
+
+    tsimg::utils::debugLog(options.debug, "Streaming " + (lazyInput ? std::string("frames from a lazy source") : std::to_string(knownFrames) + " frames") +
+                                          " with " + std::to_string(encoderCount) + " encoder threads");
+
+    std::atomic<bool> cancel{false};
+    BoundedQueue<RawFrame> readQueue(options.queueCapacity);
+    BoundedQueue<EncodedFrame> encodedQueue(options.queueCapacity);
+    std::atomic<size_t> activeEncoders{encoderCount};
+
+    auto& frameCache = tsimg::utils::FrameCache::instance();
+    // Tags em cache podem ter vindo de outra transformação (modo serve); sem consultar nem gravar
+    const bool useCache = frameCache.enabled() && !options.transformFrame;
+
+    auto reader = [&]() {
+        size_t seq = 0;
+        std::vector<std::string> chunk;
+        std::vector<size_t> chunkSeq;
+        std::vector<FileStamp> chunkStamp;
+        std::vector<tsimg::memory::Admission> chunkAdmission;
+        // Lotes menores para fontes sob demanda, para o primeiro quadro não esperar 256 caminhos
+        const size_t chunkLimit = lazyInput ? kLazyReadChunk : kReadChunk;
+
+        auto flush = [&]() {
+            FileIO::readBatch(chunk, [&](FileIO::ReadResult&& result) {
+                tsimg::memory::Charge charge(tsimg::memory::Stage::Ingest, result.data.size());
+                readQueue.push(RawFrame{chunkSeq[result.index], std::move(chunk[result.index]), std::move(result.data),
+                                        std::move(result.error), chunkStamp[result.index], std::move(charge),
+                                        std::move(chunkAdmission[result.index]), 0, 0, nullptr}, cancel);
+            }, options.readQueueDepth, options.debug);
+            chunk.clear();
+            chunkSeq.clear();
+            chunkStamp.clear();
+            chunkAdmission.clear();
+        };
+
+        // Segura o leitor enquanto ele estiver kReorderWindow quadros à frente do escritor. O lote
+        // pendente é lido antes: o quadro que o escritor espera pode estar nele.
+        auto waitForWriter = [&]() {
+            auto inWindow = [&]() { return seq < written.load(std::memory_order_acquire) + kReorderWindow; };
+            if (inWindow()) return;
+            flush();
+            std::unique_lock<std::mutex> lock(windowMutex);
+            while (!windowMoved.wait_for(lock, std::chrono::milliseconds(50), inWindow)) {
+                if (cancel.load()) return;
+            }
+        };
+
+        auto enqueue = [&](const std::string& path, const FileStamp* known) {
+            waitForWriter();
+            FileStamp stamp;
+            if (useCache) {
+                // Quadros já codificados vão direto para o escritor
+                stamp = known && known->valid ? *known : stampFile(path);
+                auto cached = stamp.valid ? frameCache.find(path, stamp.size, stamp.mtime) : nullptr;
+                if (cached) {
+                    if (options.onRawFrame) {
+                        options.onRawFrame(path, nullptr);
+                    }
+                    tsimg::memory::Charge charge(tsimg::memory::Stage::Encode, cached->size());
+                    encodedQueue.push(EncodedFrame{seq++, std::move(cached), "", std::move(charge), {}}, cancel);
+                    return;
+                }
+            }
+            // Com orçamento, o quadro só entra depois de admitido. Se não couber, o lote pendente é
+            // lido primeiro: os quadros dele já admitidos precisam chegar ao escritor para liberar espaço.
+            tsimg::memory::Admission admission;
+            if (tsimg::memory::budget() > 0) {
+                if (!stamp.valid) stamp = known && known->valid ? *known : stampFile(path);
+                size_t footprint = frameFootprint(stamp.size);
+                if (!tsimg::memory::tryAdmit(footprint, admission)) {
+                    flush();
+                    admission = tsimg::memory::admit(footprint, &cancel);
+                }
+            }
+            chunk.push_back(path);
+            chunkSeq.push_back(seq++);
+            chunkStamp.push_back(stamp);
+            chunkAdmission.push_back(std::move(admission));
+            if (chunk.size() >= chunkLimit) {
+                flush();
+            }
+        };
+
+        try {
+            for (size_t i = 0; i < slots.size() && !cancel.load(); ++i) {
+                const auto& slot = slots[i];
+                for (size_t f = 0; f < slot.framePaths.size() && !cancel.load(); ++f) {
+                    enqueue(slot.framePaths[f], f < slot.frameStamps.size() ? &slot.frameStamps[f] : nullptr);
+                }
+                if (slot.nextPath) {
+                    std::string path;
+                    while (!cancel.load() && slot.nextPath(path)) {
+                        enqueue(path, nullptr);
+                    }
+                }
+                if (slot.nextPixels) {
+                    // Os pixels já estão em memória (e contados pela fonte): vão direto aos codificadores
+                    flush();
+                    PixelFrame frame;
+                    while (!cancel.load() && slot.nextPixels(frame)) {
+                        waitForWriter();
+                        readQueue.push(RawFrame{seq++, std::move(frame.name), {}, "", {}, {}, {}, frame.width, frame.height,
+                                                std::move(frame.rgba)}, cancel);
+                        frame = PixelFrame();
+                    }
+                }
+                slotEnd[i].store(seq, std::memory_order_release);
+            }
+            flush();
+            // Só publicado no sucesso: com erro o escritor precisa consumir o quadro de erro
+            totalFrames.store(seq, std::memory_order_release);
+        } catch (const std::exception& e) {
+            readQueue.push(RawFrame{0, "", {}, e.what(), {}, {}, {}, 0, 0, nullptr}, cancel);
+        }
+        readQueue.close();
+    };
+
+    auto encoder = [&]() {
+        RawFrame raw;
+        while (readQueue.pop(raw)) {
+            if (cancel.load(std::memory_order_relaxed)) {
+                continue; // apenas esvazia a fila para liberar o leitor
+            }
+            EncodedFrame encoded{raw.seq, nullptr, std::move(raw.error), {}, std::move(raw.admission)};
+            if (encoded.error.empty() && raw.pixels) {
+                raw.data = tsimg::png::encodeRgba(raw.pixels->data(), raw.width, raw.height, tsimg::png::Options{});
+                raw.pixels.reset();
+                raw.charge = tsimg::memory::Charge(tsimg::memory::Stage::Ingest, raw.data.size());
+            } else if (encoded.error.empty() && !raw.data.empty() && options.transformFrame) {
+                options.transformFrame(raw.path, raw.data);
+                raw.charge = tsimg::memory::Charge(tsimg::memory::Stage::Ingest, raw.data.size());
+            }
+            if (encoded.error.empty()) {
+                if (raw.data.empty()) {
+                    encoded.error = "File is empty or could not be read: " + raw.path;
+                } else {
+                    encoded.tag = std::make_shared<const std::string>(
+                        tsimg::utils::HTMLBuilder::encodeImageTag(raw.data, raw.path));
+                    encoded.charge = tsimg::memory::Charge(tsimg::memory::Stage::Encode, encoded.tag->size());
+                    if (useCache && raw.stamp.valid) {
+                        frameCache.insert(raw.path, raw.stamp.size, raw.stamp.mtime, encoded.tag);
+                    }
+                }
+            }
+            if (options.onRawFrame && encoded.error.empty()) {
+                options.onRawFrame(raw.path, std::make_shared<const std::vector<unsigned char>>(std::move(raw.data)));
+            }
+            raw.data = {};
+            raw.charge.reset();
+            encodedQueue.push(std::move(encoded), cancel);
+        }
+        if (activeEncoders.fetch_sub(1) == 1) {
+            encodedQueue.close();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.emplace_back(reader);
+    for (size_t i = 0; i < encoderCount; ++i) {
+        threads.emplace_back(encoder);
+    }
+
+    auto joinAll = [&]() {
+        for (auto& t : threads) {
+            if (t.joinable()) t.join();
+        }
+    };
+
+    std::vector<size_t> slotFrames(slots.size(), 0);
+    try {
+        size_t next = 0;
+        size_t slotIndex = 0;
+        size_t slotBegin = 0;
+        auto advanceSlots = [&]() {
+            while (slotIndex + 1 < slots.size() && next == slotEnd[slotIndex].load(std::memory_order_acquire)) {
+                slotFrames[slotIndex] = next - slotBegin;
+                slotBegin = next;
+                ++slotIndex;
+                out << slots[slotIndex].text;
+            }
+        };
+
+        if (!slots.empty()) {
+            out << slots[0].text;
+        }
+
+        std::map<size_t, PendingFrame> pending;
+        EncodedFrame frame;
+        for (;;) {
+            advanceSlots();
+            if (next == totalFrames.load(std::memory_order_acquire)) {
+                break;
+            }
+            if (!encodedQueue.pop(frame)) {
+                // Fila fechada: o leitor terminou, então totalFrames já é definitivo
+                if (next == totalFrames.load(std::memory_order_acquire)) continue;
+                throw std::runtime_error("SPICE pipeline stopped before all frames were written");
+            }
+            if (!frame.error.empty()) {
+                throw std::runtime_error(frame.error);
+            }
+            if (frame.seq != next) {
+                size_t bytes = frame.tag->size();
+                frame.charge.reset();
+                pending.emplace(frame.seq, PendingFrame{std::move(frame.tag), tsimg::memory::Charge(tsimg::memory::Stage::Write, bytes),
+                                                        std::move(frame.admission)});
+                continue;
+            }
+            out << *frame.tag;
+            frame.tag.reset();
+            frame.charge.reset();
+            frame.admission.release();
+            ++next;
+            advanceSlots();
+            for (auto it = pending.begin(); it != pending.end() && it->first == next; it = pending.erase(it)) {
+                out << *it->second.tag;
+                ++next;
+                advanceSlots();
+            }
+            {
+                std::lock_guard<std::mutex> lock(windowMutex);
+                written.store(next, std::memory_order_release);
+            }
+            windowMoved.notify_one();
+            if (!out) {
+                throw std::runtime_error("Failed to write SPICE output stream");
+            }
+        }
+        if (!slots.empty()) {
+            slotFrames[slotIndex] = next - slotBegin;
+        }
+
+        out << trailer;
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Failed to write SPICE output stream");
+        }
+    } catch (...) {
+        cancel.store(true);
+        joinAll();
+        throw;
+    }
+
+    joinAll();
+    tsimg::utils::debugLog(options.debug, "SPICE stream completed");
+    return slotFrames;
+}
+
+}
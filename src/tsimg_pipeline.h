@@ -0,0 +1,232 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "tsimg_memory.h"
+
+namespace tsimg::pipeline {
+
+    // Fila circular limitada, sem locks, para vários produtores e consumidores (algoritmo de Vyukov).
+    // A capacidade é arredondada para a próxima potência de dois.
+    template <typename T>
+    class BoundedQueue {
+    public:
+        explicit BoundedQueue(size_t capacity) {
+            size_t size = 2;
+            while (size < capacity) size <<= 1;
+            mask = size - 1;
+            cells.reset(new Cell[size]);
+            for (size_t i = 0; i < size; ++i) {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        bool tryPush(T& value) {
+            size_t pos = enqueuePos.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = cells[pos & mask];
+                size_t seq = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        cell.value = std::move(value);
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool tryPop(T& value) {
+            size_t pos = dequeuePos.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = cells[pos & mask];
+                size_t seq = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        value = std::move(cell.value);
+                        cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = dequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Bloqueia até haver espaço; devolve false se cancel for sinalizado antes disso.
+        bool push(T value, const std::atomic<bool>& cancel) {
+            for (unsigned spins = 0; !tryPush(value); ++spins) {
+                if (cancel.load(std::memory_order_relaxed)) return false;
+                backoff(spins);
+            }
+            return true;
+        }
+
+        // Bloqueia até haver um item; devolve false quando a fila foi fechada e está vazia.
+        bool pop(T& value) {
+            for (unsigned spins = 0; !tryPop(value); ++spins) {
+                if (closed.load(std::memory_order_acquire)) {
+                    return tryPop(value);
+                }
+                backoff(spins);
+            }
+            return true;
+        }
+
+        void close() { closed.store(true, std::memory_order_release); }
+
+    private:
+        static void backoff(unsigned spins) {
+            if (spins < 64) return;
+            if (spins < 256) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        std::unique_ptr<Cell[]> cells;
+        size_t mask = 0;
+        alignas(64) std::atomic<size_t> enqueuePos{0};
+        alignas(64) std::atomic<size_t> dequeuePos{0};
+        alignas(64) std::atomic<bool> closed{false};
+    };
+
+    // Tamanho e data de modificação de um arquivo; identifica se um quadro mudou desde a última leitura.
+    struct FileStamp {
+        bool valid = false;
+        uintmax_t size = 0;
+        int64_t mtime = 0;
+
+        bool operator==(const FileStamp& other) const {
+            return valid == other.valid && size == other.size && mtime == other.mtime;
+        }
+        bool operator!=(const FileStamp& other) const { return !(*this == other); }
+    };
+
+    FileStamp stampFile(const std::string& path);
+
+    // O mesmo stat, informando também se path é um diretório (com o carimbo inválido)
+    FileStamp stampFile(const std::string& path, bool& directory);
+
+    // Executa work(i) para cada i em [0, count) em até threads (0 = hardware_concurrency) em
+    // paralelo; a primeira exceção interrompe a distribuição e é relançada no chamador.
+    void parallelFor(size_t count, unsigned threads, const std::function<void(size_t)>& work);
+
+    // Como o anterior, mas cada item declara antes quanto vai manter vivo (estimate) e só começa
+    // quando a estimativa cabe no orçamento de memória (tsimg::memory::admit). Itens pendentes que
+    // cabem passam à frente do primeiro quando ele não cabe, para ocupar os núcleos que o orçamento
+    // permite. Sem orçamento, as estimativas nem são calculadas.
+    void parallelFor(size_t count, unsigned threads, const std::function<void(size_t)>& work,
+                     const std::function<size_t(size_t)>& estimate);
+
+    // Devolve o próximo caminho em path, ou false quando a fonte acabou.
+    using PathSource = std::function<bool(std::string& path)>;
+
+    // Quadro sem arquivo (ex.: pixels crus do tsimg::raw): RGBA de width x height, codificado em
+    // PNG pelas threads de codificação; name identifica o quadro nos logs e define o tipo da tag
+    struct PixelFrame {
+        std::string name;
+        int width = 0;
+        int height = 0;
+        std::shared_ptr<const std::vector<uint8_t>> rgba;
+    };
+
+    // Devolve o próximo quadro em frame, ou false quando a fonte acabou.
+    using PixelSource = std::function<bool(PixelFrame& frame)>;
+
+    // Trecho literal do template seguido pelos quadros que o substituem no lugar do placeholder:
+    // primeiro framePaths, depois o que nextPath fornecer (lido sob demanda, ex.: stdin) e por
+    // fim o que nextPixels fornecer.
+    // frameStamps, quando preenchido, traz os metadados já coletados na validação de framePaths.
+    struct OutputSlot {
+        std::string text;
+        std::vector<std::string> framePaths;
+        std::vector<FileStamp> frameStamps;
+        PathSource nextPath;
+        PixelSource nextPixels;
+    };
+
+    // Recebe os bytes crus de cada quadro depois de codificado, para outra saída reaproveitar a
+    // leitura; data é nullptr quando o quadro veio pronto do FrameCache. Chamado pelas threads
+    // de codificação, fora de ordem.
+    using RawFrameObserver = std::function<void(const std::string& path, std::shared_ptr<const std::vector<unsigned char>> data)>;
+
+    // Reescreve os bytes de um quadro antes da codificação Base64 (ex.: reotimização de PNG sem
+    // perdas). Chamado pelas threads de codificação; precisa preservar os pixels, porque
+    // RawFrameObserver recebe os bytes já transformados.
+    using FrameTransform = std::function<void(const std::string& path, std::vector<unsigned char>& data)>;
+
+    struct StreamOptions {
+        size_t readQueueDepth = 64;
+        size_t queueCapacity = 64;
+        size_t encoderThreads = 0; // 0 = std::thread::hardware_concurrency()
+        RawFrameObserver onRawFrame;
+        FrameTransform transformFrame; // só quadros lidos de arquivo; com ela, o FrameCache não é consultado
+        bool debug = false;
+    };
+
+    // Quadros lidos por uma saída e entregues a outra da mesma execução (SPICE e GIF, por exemplo).
+    // O produtor deposita os bytes por caminho; o consumidor retira pelo índice em paths, esperando
+    // enquanto o produtor ainda pode entregá-los. Ficam retidos no máximo maxBytes: o que passa
+    // disso é descartado e o consumidor lê o arquivo por conta própria (take devolve nullptr).
+    class SharedFrames {
+    public:
+        SharedFrames(const std::vector<std::string>& paths, size_t maxBytes);
+
+        void deposit(const std::string& path, std::shared_ptr<const std::vector<unsigned char>> data);
+        std::shared_ptr<const std::vector<unsigned char>> take(size_t index);
+        // O produtor terminou (ou falhou): take para de esperar pelo que não veio
+        void close();
+
+    private:
+        enum class State { Pending, Ready, Missed };
+        struct Entry {
+            State state = State::Pending;
+            std::shared_ptr<const std::vector<unsigned char>> data;
+            tsimg::memory::Charge charge;
+        };
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::vector<Entry> entries;
+        std::unordered_map<std::string, std::deque<size_t>> waiting; // índices ainda sem bytes, por caminho
+        size_t heldBytes = 0;
+        size_t maxBytes;
+        bool closed = false;
+    };
+
+    // Escreve slots[0].text, os quadros de slots[0], slots[1].text, ... e por fim trailer.
+    // Leitura, codificação Base64 e escrita ordenada rodam em estágios concorrentes, então o
+    // início do documento chega ao disco assim que o primeiro quadro fica pronto.
+    // Devolve quantos quadros foram escritos em cada slot.
+    std::vector<size_t> streamSpice(std::ostream& out, const std::vector<OutputSlot>& slots, const std::string& trailer, const StreamOptions& options);
+}
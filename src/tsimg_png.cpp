@@ -0,0 +1,328 @@
+#include "tsimg_png.h"
+#include "tsimg_memory.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+// Compressor zlib do stb_image_write (implementado junto com ele em tsimg_gif.cpp); o cabeçalho
+// do stb não o declara fora da implementação
+extern "C" unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality);
+
+namespace tsimg::png {
+
+namespace {
+    constexpr uint8_t kSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+    const std::array<uint32_t, 256>& crcTable() {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[n] = c;
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    uint32_t crc32(const uint8_t* data, size_t length) {
+        const auto& table = crcTable();
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < length; ++i) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    uint32_t readU32(const uint8_t* p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    }
+
+    void putU32(std::vector<unsigned char>& out, uint32_t value) {
+        out.push_back(static_cast<unsigned char>(value >> 24));
+        out.push_back(static_cast<unsigned char>(value >> 16));
+        out.push_back(static_cast<unsigned char>(value >> 8));
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    void writeChunk(std::vector<unsigned char>& out, const char* type, const uint8_t* data, size_t length) {
+        putU32(out, static_cast<uint32_t>(length));
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        if (length > 0) {
+            out.insert(out.end(), data, data + length);
+        }
+        putU32(out, crc32(out.data() + start, length + 4));
+    }
+
+    // Cores RGBA distintas por endereçamento aberto; desiste na 257ª
+    class ColorTable {
+    public:
+        ColorTable() {
+            slots.fill(kEmpty);
+        }
+
+        bool add(uint32_t color) {
+            size_t slot = find(color);
+            if (slots[slot] != kEmpty) return true;
+            if (colors.size() == 256) return false;
+            slots[slot] = static_cast<int16_t>(colors.size());
+            colors.push_back(color);
+            return true;
+        }
+
+        // Índice de color na ordem atual de colors (a cor precisa ter sido adicionada)
+        uint8_t indexOf(uint32_t color) const {
+            return static_cast<uint8_t>(slots[find(color)]);
+        }
+
+        // Reordena colors e atualiza os índices guardados
+        void reorder(std::vector<uint32_t> ordered) {
+            colors = std::move(ordered);
+            for (size_t i = 0; i < colors.size(); ++i) {
+                slots[find(colors[i])] = static_cast<int16_t>(i);
+            }
+        }
+
+        std::vector<uint32_t> colors;
+
+    private:
+        static constexpr size_t kSlots = 1024;
+        static constexpr int16_t kEmpty = -1;
+
+        size_t find(uint32_t color) const {
+            size_t slot = (color * 2654435761u) >> 22; // 10 bits de hash multiplicativo
+            while (slots[slot] != kEmpty && colors[static_cast<size_t>(slots[slot])] != color) {
+                slot = (slot + 1) & (kSlots - 1);
+            }
+            return slot;
+        }
+
+        std::array<int16_t, kSlots> slots;
+    };
+
+    uint32_t packColor(const uint8_t* p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    }
+
+    uint8_t paeth(int a, int b, int c) {
+        int p = a + b - c;
+        int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+        return static_cast<uint8_t>(pb <= pc ? b : c);
+    }
+
+    void applyFilter(int type, const uint8_t* row, const uint8_t* previous, size_t length, size_t bpp, uint8_t* out) {
+        for (size_t i = 0; i < length; ++i) {
+            int a = i >= bpp ? row[i - bpp] : 0;
+            int b = previous[i];
+            int c = i >= bpp ? previous[i - bpp] : 0;
+            int predicted = 0;
+            switch (type) {
+                case 1: predicted = a; break;
+                case 2: predicted = b; break;
+                case 3: predicted = (a + b) >> 1; break;
+                case 4: predicted = paeth(a, b, c); break;
+                default: break;
+            }
+            out[i] = static_cast<uint8_t>(row[i] - predicted);
+        }
+    }
+
+    // Soma dos resíduos como inteiros com sinal, a heurística usual do libpng
+    uint64_t residualCost(const uint8_t* filtered, size_t length) {
+        uint64_t cost = 0;
+        for (size_t i = 0; i < length; ++i) {
+            cost += static_cast<uint64_t>(std::abs(static_cast<int>(static_cast<int8_t>(filtered[i]))));
+        }
+        return cost;
+    }
+
+    std::vector<unsigned char> encode(const uint8_t* rgba, int width, int height, const Options& options, Result* result,
+                                      const std::vector<unsigned char>& colorChunks) {
+        const size_t pixels = static_cast<size_t>(width) * height;
+
+        // Uma passada: opacidade, tons de cinza e até 257 cores; pixels repetidos em sequência
+        // não consultam a tabela
+        bool opaque = true, gray = true, paletteFits = true;
+        ColorTable table;
+        uint32_t last = pixels > 0 ? ~packColor(rgba) : 0;
+        for (size_t i = 0; i < pixels; ++i) {
+            const uint8_t* p = rgba + i * 4;
+            uint32_t color = packColor(p);
+            if (color == last) continue;
+            last = color;
+            opaque = opaque && p[3] == 255;
+            gray = gray && p[0] == p[1] && p[1] == p[2];
+            paletteFits = paletteFits && table.add(color);
+        }
+
+        Layout layout;
+        if (paletteFits && !(gray && opaque && table.colors.size() > 16)) {
+            layout = Layout::Indexed;
+        } else if (gray && opaque) {
+            layout = Layout::Gray;
+        } else {
+            layout = opaque ? Layout::Rgb : Layout::Rgba;
+        }
+
+        int depth = 8;
+        if (layout == Layout::Indexed) {
+            // Entradas translúcidas primeiro: o tRNS pode parar na última delas
+            std::vector<uint32_t> ordered;
+            for (uint32_t color : table.colors) if ((color & 0xFF) != 255) ordered.push_back(color);
+            size_t translucent = ordered.size();
+            for (uint32_t color : table.colors) if ((color & 0xFF) == 255) ordered.push_back(color);
+            table.reorder(std::move(ordered));
+            opaque = translucent == 0;
+            size_t count = table.colors.size();
+            depth = count <= 2 ? 1 : count <= 4 ? 2 : count <= 16 ? 4 : 8;
+        }
+        const size_t channels = layout == Layout::Rgba ? 4 : layout == Layout::Rgb ? 3 : 1;
+        const size_t rowBytes = layout == Layout::Indexed ? (static_cast<size_t>(width) * depth + 7) / 8 : static_cast<size_t>(width) * channels;
+        const size_t bpp = channels;
+
+        std::vector<uint8_t> filtered(static_cast<size_t>(height) * (rowBytes + 1));
+        std::vector<uint8_t> current(rowBytes), previous(rowBytes, 0), candidate(rowBytes), best(rowBytes);
+        tsimg::memory::Charge charge(tsimg::memory::Stage::Encode, filtered.size() + rowBytes * 4);
+        for (int y = 0; y < height; ++y) {
+            const uint8_t* src = rgba + static_cast<size_t>(y) * width * 4;
+            if (layout == Layout::Indexed) {
+                std::fill(current.begin(), current.end(), 0);
+                const int perByte = 8 / depth;
+                for (int x = 0; x < width; ++x) {
+                    uint8_t index = table.indexOf(packColor(src + static_cast<size_t>(x) * 4));
+                    int shift = 8 - depth * (x % perByte + 1);
+                    current[static_cast<size_t>(x / perByte)] |= static_cast<uint8_t>(index << shift);
+                }
+            } else {
+                for (int x = 0; x < width; ++x) {
+                    std::memcpy(&current[static_cast<size_t>(x) * channels], src + static_cast<size_t>(x) * 4, channels);
+                }
+            }
+
+            uint8_t* out = &filtered[static_cast<size_t>(y) * (rowBytes + 1)];
+            if (layout == Layout::Indexed) {
+                // Índices de paleta não variam de forma contínua; sem filtro costuma comprimir melhor
+                out[0] = 0;
+                std::memcpy(out + 1, current.data(), rowBytes);
+            } else {
+                uint64_t bestCost = UINT64_MAX;
+                int bestType = 0;
+                for (int type = 0; type < 5; ++type) {
+                    applyFilter(type, current.data(), previous.data(), rowBytes, bpp, candidate.data());
+                    uint64_t cost = residualCost(candidate.data(), rowBytes);
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestType = type;
+                        best.swap(candidate);
+                    }
+                }
+                out[0] = static_cast<uint8_t>(bestType);
+                std::memcpy(out + 1, best.data(), rowBytes);
+            }
+            previous.swap(current);
+        }
+
+        int compressedLength = 0;
+        std::unique_ptr<unsigned char, void (*)(void*)> compressed(
+            stbi_zlib_compress(filtered.data(), static_cast<int>(filtered.size()), &compressedLength, options.deflateQuality), std::free);
+        if (!compressed) {
+            return {};
+        }
+
+        std::vector<unsigned char> png(kSignature, kSignature + sizeof(kSignature));
+        uint8_t header[13];
+        const uint8_t colorType = layout == Layout::Indexed ? 3 : layout == Layout::Gray ? 0 : layout == Layout::Rgb ? 2 : 6;
+        const uint32_t w = static_cast<uint32_t>(width), h = static_cast<uint32_t>(height);
+        const uint8_t ihdr[13] = {uint8_t(w >> 24), uint8_t(w >> 16), uint8_t(w >> 8), uint8_t(w),
+                                  uint8_t(h >> 24), uint8_t(h >> 16), uint8_t(h >> 8), uint8_t(h),
+                                  static_cast<uint8_t>(depth), colorType, 0, 0, 0};
+        std::memcpy(header, ihdr, sizeof(header));
+        writeChunk(png, "IHDR", header, sizeof(header));
+        png.insert(png.end(), colorChunks.begin(), colorChunks.end());
+        if (layout == Layout::Indexed) {
+            std::vector<uint8_t> palette, alpha;
+            for (uint32_t color : table.colors) {
+                palette.push_back(static_cast<uint8_t>(color >> 24));
+                palette.push_back(static_cast<uint8_t>(color >> 16));
+                palette.push_back(static_cast<uint8_t>(color >> 8));
+                if ((color & 0xFF) != 255) alpha.push_back(static_cast<uint8_t>(color));
+            }
+            writeChunk(png, "PLTE", palette.data(), palette.size());
+            if (!alpha.empty()) {
+                writeChunk(png, "tRNS", alpha.data(), alpha.size());
+            }
+        }
+        writeChunk(png, "IDAT", compressed.get(), static_cast<size_t>(compressedLength));
+        writeChunk(png, "IEND", nullptr, 0);
+
+        if (result) {
+            result->layout = layout;
+            result->colors = paletteFits ? table.colors.size() : 0;
+            result->after = png.size();
+        }
+        return png;
+    }
+}
+
+const char* layoutName(Layout layout) {
+    switch (layout) {
+        case Layout::Indexed: return "indexed";
+        case Layout::Gray: return "gray";
+        case Layout::Rgb: return "rgb";
+        case Layout::Rgba: return "rgba";
+    }
+    return "rgba";
+}
+
+std::vector<unsigned char> encodeRgba(const uint8_t* rgba, int width, int height, const Options& options, Result* result) {
+    return encode(rgba, width, height, options, result, {});
+}
+
+bool optimize(std::vector<unsigned char>& data, const Options& options, Result* result) {
+    if (data.size() < 33 || std::memcmp(data.data(), kSignature, sizeof(kSignature)) != 0 || data[24] != 8) {
+        return false;
+    }
+    // Chunks de cor vão para o novo arquivo; APNG fica como está (só o primeiro quadro decodifica)
+    std::vector<unsigned char> colorChunks;
+    for (size_t pos = 8; pos + 12 <= data.size();) {
+        size_t length = readU32(&data[pos]);
+        if (pos + 12 + length > data.size()) break;
+        const char* type = reinterpret_cast<const char*>(&data[pos + 4]);
+        if (std::memcmp(type, "acTL", 4) == 0) return false;
+        if (std::memcmp(type, "gAMA", 4) == 0 || std::memcmp(type, "cHRM", 4) == 0 ||
+            std::memcmp(type, "sRGB", 4) == 0 || std::memcmp(type, "iCCP", 4) == 0) {
+            colorChunks.insert(colorChunks.end(), data.begin() + pos, data.begin() + pos + 12 + length);
+        }
+        if (std::memcmp(type, "IEND", 4) == 0) break;
+        pos += 12 + length;
+    }
+
+    int width = 0, height = 0, channels = 0;
+    stbi_uc* pixels = stbi_load_from_memory(data.data(), static_cast<int>(data.size()), &width, &height, &channels, 4);
+    if (!pixels) {
+        return false;
+    }
+    std::unique_ptr<stbi_uc, void (*)(void*)> owned(pixels, stbi_image_free);
+    tsimg::memory::Charge decoded(tsimg::memory::Stage::Encode, static_cast<size_t>(width) * height * 4);
+
+    Result local;
+    Result& summary = result ? *result : local;
+    summary.before = data.size();
+    std::vector<unsigned char> png = encode(pixels, width, height, options, &summary, colorChunks);
+    if (png.empty() || png.size() >= data.size()) {
+        summary.after = data.size();
+        return false;
+    }
+    data.swap(png);
+    return true;
+}
+
+}
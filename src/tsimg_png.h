@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tsimg::png {
+
+    struct Options {
+        int deflateQuality = 32; // candidatos por hash na busca do deflate do stb (o stbi_write_png usa 8)
+        bool debug = false;
+    };
+
+    // Forma escolhida por encodeRgba
+    enum class Layout { Indexed, Gray, Rgb, Rgba };
+    const char* layoutName(Layout layout);
+
+    struct Result {
+        Layout layout = Layout::Rgba;
+        size_t colors = 0;     // cores distintas, ou 0 quando passam de 256
+        size_t before = 0;     // bytes do PNG original (optimize)
+        size_t after = 0;      // bytes do PNG gerado
+    };
+
+    // Codifica RGBA no menor PNG sem perdas que o conteúdo permite: indexado (1, 2, 4 ou 8 bits)
+    // com até 256 cores, tons de cinza de 8 bits, RGB quando tudo é opaco, ou RGBA. O filtro de
+    // cada linha é escolhido pela menor soma dos resíduos; paletas ficam sem filtro.
+    std::vector<unsigned char> encodeRgba(const uint8_t* rgba, int width, int height, const Options& options, Result* result = nullptr);
+
+    // Reotimiza um PNG de 8 bits por canal com encodeRgba, mantendo os chunks que afetam a cor
+    // exibida (gAMA, cHRM, sRGB, iCCP). data só é trocado se o resultado for menor; devolve false,
+    // sem mexer em data, para o que não for PNG, PNG de 16 bits ou não decodificar.
+    bool optimize(std::vector<unsigned char>& data, const Options& options, Result* result = nullptr);
+}
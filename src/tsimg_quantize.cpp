@@ -0,0 +1,463 @@
+#include "tsimg_quantize.h"
+#include "tsimg_memory.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace tsimg::quantize {
+
+namespace {
+    constexpr int kOctreeDepth = 6;
+    constexpr size_t kExactCacheBits = 16;
+    constexpr uint32_t kEmptyCacheEntry = 0xFFFFFFFFu; // índice 255 nunca é usado (máximo 254)
+    constexpr int kApproxBits = 6;
+    constexpr int kCellBits = 5;
+
+    uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    uint32_t packRgb(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+    }
+
+    // Amostra determinística: um pixel por bloco de "step", em posição variável dentro do
+    // bloco para não alinhar com a largura da imagem
+    std::vector<uint32_t> samplePixels(const uint8_t* rgba, size_t pixelCount, size_t maxSamples) {
+        std::vector<uint32_t> samples;
+        size_t step = std::max<size_t>(1, (pixelCount + maxSamples - 1) / maxSamples);
+        samples.reserve(pixelCount / step + 1);
+        for (size_t block = 0; block * step < pixelCount; ++block) {
+            size_t i = block * step + (step > 1 ? mix(block) % step : 0);
+            if (i < pixelCount) {
+                samples.push_back(packRgb(rgba + i * 4));
+            }
+        }
+        return samples;
+    }
+
+    // Cores distintas do quadro, se forem no máximo maxColors; desiste na primeira a mais
+    bool collectDistinct(const uint8_t* rgba, size_t pixelCount, size_t maxColors, Palette& palette) {
+        constexpr size_t kSlots = 1024; // potência de 2, bem acima de kMaxColors
+        std::array<uint32_t, kSlots> slots;
+        slots.fill(kEmptyCacheEntry);
+        size_t count = 0;
+        uint32_t last = kEmptyCacheEntry;
+        for (size_t i = 0; i < pixelCount; ++i) {
+            uint32_t rgb = packRgb(rgba + i * 4);
+            if (rgb == last) continue;
+            last = rgb;
+            size_t slot = (rgb * 2654435761u) >> 22;
+            while (slots[slot] != kEmptyCacheEntry && slots[slot] != rgb) {
+                slot = (slot + 1) & (kSlots - 1);
+            }
+            if (slots[slot] == rgb) continue;
+            if (count == maxColors) return false;
+            slots[slot] = rgb;
+            palette.r[count] = static_cast<uint8_t>(rgb >> 16);
+            palette.g[count] = static_cast<uint8_t>(rgb >> 8);
+            palette.b[count] = static_cast<uint8_t>(rgb);
+            ++count;
+        }
+        palette.size = count;
+        return true;
+    }
+
+    class Octree {
+    public:
+        Octree() {
+            nodes.emplace_back();
+            levels[0].push_back(0);
+        }
+
+        void add(uint32_t rgb) {
+            uint8_t r = static_cast<uint8_t>(rgb >> 16), g = static_cast<uint8_t>(rgb >> 8), b = static_cast<uint8_t>(rgb);
+            int32_t node = 0;
+            accumulate(node, r, g, b);
+            for (int level = 0; level < kOctreeDepth && !nodes[node].leaf; ++level) {
+                int shift = 7 - level;
+                int child = (((r >> shift) & 1) << 2) | (((g >> shift) & 1) << 1) | ((b >> shift) & 1);
+                int32_t next = nodes[node].children[child];
+                if (next < 0) {
+                    next = static_cast<int32_t>(nodes.size());
+                    nodes[node].children[child] = next;
+                    nodes.emplace_back();
+                    if (level + 1 == kOctreeDepth) {
+                        nodes[next].leaf = true;
+                        ++leaves;
+                    } else {
+                        levels[level + 1].push_back(next);
+                    }
+                }
+                node = next;
+                accumulate(node, r, g, b);
+            }
+        }
+
+        // Funde os nós mais profundos, os de menos pixels primeiro, até caber em maxColors
+        void reduce(size_t maxColors) {
+            for (int level = kOctreeDepth - 1; level >= 0 && leaves > maxColors; --level) {
+                auto& candidates = levels[level];
+                std::sort(candidates.begin(), candidates.end(), [this](int32_t a, int32_t b) {
+                    return nodes[a].count < nodes[b].count;
+                });
+                for (int32_t node : candidates) {
+                    if (leaves <= maxColors) break;
+                    size_t children = 0;
+                    for (auto& child : nodes[node].children) {
+                        if (child >= 0) {
+                            ++children;
+                            child = -1;
+                        }
+                    }
+                    nodes[node].leaf = true;
+                    leaves = leaves - children + 1;
+                }
+            }
+        }
+
+        void fill(Palette& palette) const {
+            palette.size = 0;
+            collect(0, palette);
+        }
+
+    private:
+        struct Node {
+            uint64_t r = 0, g = 0, b = 0;
+            uint32_t count = 0;
+            int32_t children[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+            bool leaf = false;
+        };
+
+        void accumulate(int32_t node, uint8_t r, uint8_t g, uint8_t b) {
+            auto& n = nodes[node];
+            n.r += r;
+            n.g += g;
+            n.b += b;
+            ++n.count;
+        }
+
+        void collect(int32_t node, Palette& palette) const {
+            const auto& n = nodes[node];
+            if (n.leaf) {
+                if (n.count > 0 && palette.size < kMaxColors) {
+                    palette.r[palette.size] = static_cast<uint8_t>((n.r + n.count / 2) / n.count);
+                    palette.g[palette.size] = static_cast<uint8_t>((n.g + n.count / 2) / n.count);
+                    palette.b[palette.size] = static_cast<uint8_t>((n.b + n.count / 2) / n.count);
+                    ++palette.size;
+                }
+                return;
+            }
+            for (int32_t child : n.children) {
+                if (child >= 0) collect(child, palette);
+            }
+        }
+
+        std::vector<Node> nodes;
+        std::vector<int32_t> levels[kOctreeDepth];
+        size_t leaves = 0;
+    };
+
+    Palette octreePalette(const std::vector<uint32_t>& samples, size_t maxColors) {
+        Octree tree;
+        for (uint32_t rgb : samples) {
+            tree.add(rgb);
+        }
+        tree.reduce(maxColors);
+        Palette palette;
+        tree.fill(palette);
+        return palette;
+    }
+
+    int distance(uint32_t a, const float* center) {
+        float dr = static_cast<float>(a >> 16) - center[0];
+        float dg = static_cast<float>((a >> 8) & 0xff) - center[1];
+        float db = static_cast<float>(a & 0xff) - center[2];
+        return static_cast<int>(dr * dr + dg * dg + db * db);
+    }
+
+    // k-means++ para as sementes e algumas iterações de Lloyd sobre a amostra
+    Palette kmeansPalette(const std::vector<uint32_t>& samples, size_t maxColors) {
+        constexpr int kIterations = 6;
+        std::vector<std::array<float, 3>> centers;
+        centers.reserve(maxColors);
+        auto addCenter = [&](uint32_t rgb) {
+            centers.push_back({static_cast<float>(rgb >> 16), static_cast<float>((rgb >> 8) & 0xff), static_cast<float>(rgb & 0xff)});
+        };
+
+        uint64_t seed = 0x5eed;
+        addCenter(samples[mix(seed) % samples.size()]);
+        std::vector<int> nearestDistance(samples.size(), std::numeric_limits<int>::max());
+        while (centers.size() < maxColors) {
+            const float* latest = centers.back().data();
+            uint64_t total = 0;
+            for (size_t i = 0; i < samples.size(); ++i) {
+                nearestDistance[i] = std::min(nearestDistance[i], distance(samples[i], latest));
+                total += static_cast<uint64_t>(nearestDistance[i]);
+            }
+            if (total == 0) break; // todas as cores da amostra já são centros
+            seed = mix(seed);
+            uint64_t target = seed % total;
+            size_t chosen = 0;
+            for (uint64_t acc = 0; chosen < samples.size(); ++chosen) {
+                acc += static_cast<uint64_t>(nearestDistance[chosen]);
+                if (acc > target) break;
+            }
+            addCenter(samples[std::min(chosen, samples.size() - 1)]);
+        }
+
+        Palette palette;
+        for (int iteration = 0; iteration <= kIterations; ++iteration) {
+            palette.size = centers.size();
+            for (size_t c = 0; c < centers.size(); ++c) {
+                palette.r[c] = static_cast<uint8_t>(std::lround(std::clamp(centers[c][0], 0.0f, 255.0f)));
+                palette.g[c] = static_cast<uint8_t>(std::lround(std::clamp(centers[c][1], 0.0f, 255.0f)));
+                palette.b[c] = static_cast<uint8_t>(std::lround(std::clamp(centers[c][2], 0.0f, 255.0f)));
+            }
+            if (iteration == kIterations) break;
+
+            NearestColor nearest(palette, false);
+            std::vector<std::array<uint64_t, 4>> sums(centers.size(), {0, 0, 0, 0});
+            for (uint32_t rgb : samples) {
+                uint8_t r = static_cast<uint8_t>(rgb >> 16), g = static_cast<uint8_t>(rgb >> 8), b = static_cast<uint8_t>(rgb);
+                auto& sum = sums[nearest.find(r, g, b)];
+                sum[0] += r;
+                sum[1] += g;
+                sum[2] += b;
+                ++sum[3];
+            }
+            for (size_t c = 0; c < centers.size(); ++c) {
+                if (sums[c][3] == 0) continue; // cluster vazio mantém o centro
+                for (int k = 0; k < 3; ++k) {
+                    centers[c][k] = static_cast<float>(sums[c][k]) / sums[c][3];
+                }
+            }
+        }
+        return palette;
+    }
+
+    // Matriz de Bayer 8x8 (valores 0..63)
+    constexpr uint8_t kBayer[8][8] = {
+        { 0, 32,  8, 40,  2, 34, 10, 42},
+        {48, 16, 56, 24, 50, 18, 58, 26},
+        {12, 44,  4, 36, 14, 46,  6, 38},
+        {60, 28, 52, 20, 62, 30, 54, 22},
+        { 3, 35, 11, 43,  1, 33,  9, 41},
+        {51, 19, 59, 27, 49, 17, 57, 25},
+        {15, 47,  7, 39, 13, 45,  5, 37},
+        {63, 31, 55, 23, 61, 29, 53, 21},
+    };
+
+    void mapRows(const uint8_t* image, uint8_t* frame, int width, int rowBegin, int rowEnd, bool hasPrevious,
+                 const Palette& palette, const Options& options) {
+        NearestColor nearest(palette, options.quality == Quality::Fast);
+
+        // Amplitude do dither ~ espaçamento médio entre as cores da paleta
+        int offsets[8][8] = {};
+        if (options.dither && palette.size > 1) {
+            double spread = 256.0 / std::cbrt(static_cast<double>(palette.size));
+            for (int y = 0; y < 8; ++y) {
+                for (int x = 0; x < 8; ++x) {
+                    offsets[y][x] = static_cast<int>(std::lround((kBayer[y][x] - 31.5) / 64.0 * spread));
+                }
+            }
+        }
+
+        for (int y = rowBegin; y < rowEnd; ++y) {
+            const int* rowOffsets = offsets[y & 7];
+            size_t base = static_cast<size_t>(y) * width * 4;
+            const uint8_t* src = image + base;
+            uint8_t* dst = frame + base;
+            for (int x = 0; x < width; ++x, src += 4, dst += 4) {
+                uint8_t r = src[0], g = src[1], b = src[2];
+                if (options.dither) {
+                    int offset = rowOffsets[x & 7];
+                    r = static_cast<uint8_t>(std::clamp(r + offset, 0, 255));
+                    g = static_cast<uint8_t>(std::clamp(g + offset, 0, 255));
+                    b = static_cast<uint8_t>(std::clamp(b + offset, 0, 255));
+                }
+                uint8_t index = nearest.find(r, g, b);
+                uint8_t qr = palette.r[index], qg = palette.g[index], qb = palette.b[index];
+                // A cor exibida não muda: o pixel fica transparente e o LZW comprime melhor
+                if (hasPrevious && dst[0] == qr && dst[1] == qg && dst[2] == qb) {
+                    dst[3] = 0;
+                    continue;
+                }
+                dst[0] = qr;
+                dst[1] = qg;
+                dst[2] = qb;
+                dst[3] = static_cast<uint8_t>(index + 1);
+            }
+        }
+    }
+}
+
+Quality parseQuality(const std::string& name) {
+    if (name == "fast") return Quality::Fast;
+    if (name == "balanced") return Quality::Balanced;
+    if (name == "best") return Quality::Best;
+    throw std::runtime_error("Invalid GIF quality: " + name + " (expected fast, balanced or best)");
+}
+
+const char* qualityName(Quality quality) {
+    switch (quality) {
+        case Quality::Fast: return "fast";
+        case Quality::Balanced: return "balanced";
+        case Quality::Best: return "best";
+    }
+    return "unknown";
+}
+
+Palette buildPalette(const uint8_t* rgba, size_t pixelCount, Quality quality, size_t maxColors) {
+    maxColors = std::clamp<size_t>(maxColors, 1, kMaxColors);
+    Palette palette;
+    if (pixelCount == 0) {
+        palette.size = 1;
+        return palette;
+    }
+    if (collectDistinct(rgba, pixelCount, maxColors, palette)) {
+        return palette;
+    }
+
+    switch (quality) {
+        case Quality::Fast:
+            return octreePalette(samplePixels(rgba, pixelCount, 1 << 16), maxColors);
+        case Quality::Balanced:
+            return octreePalette(samplePixels(rgba, pixelCount, 1 << 18), maxColors);
+        case Quality::Best:
+            return kmeansPalette(samplePixels(rgba, pixelCount, 1 << 16), maxColors);
+    }
+    return palette;
+}
+
+NearestColor::NearestColor(const Palette& palette, bool approximate)
+    : padded((std::max<size_t>(palette.size, 1) + 7) & ~size_t(7)), approximate(approximate) {
+    // Entradas de preenchimento ficam longe de qualquer cor e nunca vencem; a distância delas
+    // (3 * 1023^2) << 8 ainda cabe em int32 na chave da busca
+    for (size_t i = 0; i < 256; ++i) {
+        bool used = i < palette.size;
+        pr[i] = used ? palette.r[i] : 1023;
+        pg[i] = used ? palette.g[i] : 1023;
+        pb[i] = used ? palette.b[i] : 1023;
+    }
+    cache.assign(size_t(1) << (approximate ? 3 * kApproxBits : kExactCacheBits), kEmptyCacheEntry);
+    if (!approximate) {
+        cellStart.assign(size_t(1) << (3 * kCellBits), -1);
+    }
+}
+
+uint8_t NearestColor::search(int r, int g, int b) const {
+    // Distância e índice numa só chave (distância << 8 | índice): o mínimo das chaves é uma
+    // redução simples, sem desvios, e empates ficam com o menor índice
+    int32_t best = std::numeric_limits<int32_t>::max();
+    for (size_t i = 0; i < padded; ++i) {
+        int32_t dr = pr[i] - r;
+        int32_t dg = pg[i] - g;
+        int32_t db = pb[i] - b;
+        int32_t key = ((dr * dr + dg * dg + db * db) << 8) | static_cast<int32_t>(i);
+        best = std::min(best, key);
+    }
+    return static_cast<uint8_t>(best & 0xff);
+}
+
+uint8_t NearestColor::searchCell(int r, int g, int b) {
+    constexpr int shift = 8 - kCellBits;
+    size_t cell = (static_cast<size_t>(r >> shift) << (2 * kCellBits)) | (static_cast<size_t>(g >> shift) << kCellBits) | (b >> shift);
+    int32_t start = cellStart[cell];
+    if (start < 0) {
+        // Candidatas: entradas cuja distância mínima à célula não passa da menor distância
+        // máxima; nenhuma outra pode ser a mais próxima de um ponto da célula
+        int32_t lo[3] = {(r >> shift) << shift, (g >> shift) << shift, (b >> shift) << shift};
+        int32_t hi[3] = {lo[0] + (1 << shift) - 1, lo[1] + (1 << shift) - 1, lo[2] + (1 << shift) - 1};
+        const int32_t* channels[3] = {pr, pg, pb};
+        alignas(32) int32_t nearDistance[256] = {};
+        alignas(32) int32_t farDistance[256] = {};
+        for (int c = 0; c < 3; ++c) {
+            const int32_t* p = channels[c];
+            for (size_t i = 0; i < padded; ++i) {
+                int32_t below = std::max(lo[c] - p[i], 0);
+                int32_t above = std::max(p[i] - hi[c], 0);
+                int32_t inside = below + above;
+                int32_t far = std::max(std::abs(p[i] - lo[c]), std::abs(p[i] - hi[c]));
+                nearDistance[i] += inside * inside;
+                farDistance[i] += far * far;
+            }
+        }
+        int32_t threshold = std::numeric_limits<int32_t>::max();
+        for (size_t i = 0; i < padded; ++i) {
+            threshold = std::min(threshold, farDistance[i]);
+        }
+        start = static_cast<int32_t>(candidates.size());
+        candidates.push_back(0);
+        for (size_t i = 0; i < padded; ++i) {
+            if (nearDistance[i] <= threshold) {
+                candidates.push_back(static_cast<uint8_t>(i));
+                ++candidates[start];
+            }
+        }
+        cellStart[cell] = start;
+    }
+
+    const uint8_t* list = candidates.data() + start;
+    int32_t best = std::numeric_limits<int32_t>::max();
+    for (uint8_t k = 1; k <= list[0]; ++k) {
+        uint8_t i = list[k];
+        int32_t dr = pr[i] - r;
+        int32_t dg = pg[i] - g;
+        int32_t db = pb[i] - b;
+        best = std::min(best, ((dr * dr + dg * dg + db * db) << 8) | i);
+    }
+    return static_cast<uint8_t>(best & 0xff);
+}
+
+uint8_t NearestColor::find(uint8_t r, uint8_t g, uint8_t b) {
+    if (approximate) {
+        constexpr int shift = 8 - kApproxBits;
+        size_t key = (static_cast<size_t>(r >> shift) << (2 * kApproxBits)) | (static_cast<size_t>(g >> shift) << kApproxBits) | (b >> shift);
+        uint32_t& entry = cache[key];
+        if (entry == kEmptyCacheEntry) {
+            // Centro da célula: erro máximo de meia célula por canal
+            constexpr int half = 1 << (shift - 1);
+            entry = search(((r >> shift) << shift) + half, ((g >> shift) << shift) + half, ((b >> shift) << shift) + half);
+        }
+        return static_cast<uint8_t>(entry);
+    }
+
+    uint32_t rgb = (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+    uint32_t& entry = cache[(rgb * 2654435761u) >> (32 - kExactCacheBits)];
+    if ((entry >> 8) == rgb && entry != kEmptyCacheEntry) {
+        return static_cast<uint8_t>(entry);
+    }
+    uint8_t index = searchCell(r, g, b);
+    entry = (rgb << 8) | index;
+    return index;
+}
+
+void mapFrame(const uint8_t* image, uint8_t* frame, int width, int height, bool hasPrevious,
+              const Palette& palette, const Options& options) {
+    // Quadros grandes são divididos em faixas de linhas, cada uma com o seu cache
+    size_t pixels = static_cast<size_t>(width) * height;
+    size_t bands = std::min<size_t>({std::max(1u, std::thread::hardware_concurrency()), 8, pixels / (1 << 20) + 1,
+                                     static_cast<size_t>(std::max(height, 1))});
+    size_t cacheBytes = (size_t(1) << (options.quality == Quality::Fast ? 3 * kApproxBits : kExactCacheBits)) * sizeof(uint32_t);
+    tsimg::memory::Charge caches(tsimg::memory::Stage::Gif, cacheBytes * bands);
+
+    std::vector<std::thread> workers;
+    for (size_t band = 1; band < bands; ++band) {
+        int rowBegin = static_cast<int>(height * band / bands);
+        int rowEnd = static_cast<int>(height * (band + 1) / bands);
+        workers.emplace_back(mapRows, image, frame, width, rowBegin, rowEnd, hasPrevious, std::cref(palette), std::cref(options));
+    }
+    mapRows(image, frame, width, 0, static_cast<int>(height / bands), hasPrevious, palette, options);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tsimg::quantize {
+
+    // Fast: octree em amostra pequena e busca aproximada (tabela 6 bits por canal).
+    // Balanced: octree em amostra maior e busca exata. Best: k-means++ refinado por Lloyd.
+    enum class Quality { Fast, Balanced, Best };
+
+    struct Options {
+        Quality quality = Quality::Balanced;
+        bool dither = false; // dither ordenado (Bayer 8x8)
+    };
+
+    // "fast", "balanced" ou "best"; lança std::runtime_error para outros nomes
+    Quality parseQuality(const std::string& name);
+    const char* qualityName(Quality quality);
+
+    // O índice 0 do GIF fica reservado para a transparência do delta entre quadros
+    constexpr size_t kMaxColors = 255;
+
+    struct Palette {
+        size_t size = 0;
+        uint8_t r[kMaxColors] = {};
+        uint8_t g[kMaxColors] = {};
+        uint8_t b[kMaxColors] = {};
+    };
+
+    // Paleta de até maxColors cores para os pixels RGBA (alfa ignorado). Quadros com poucas
+    // cores distintas (mapas classificados, por exemplo) recebem exatamente essas cores.
+    Palette buildPalette(const uint8_t* rgba, size_t pixelCount, Quality quality, size_t maxColors = kMaxColors);
+
+    // Cor mais próxima da paleta (distância euclidiana em RGB). O espaço RGB é dividido em
+    // células de 8x8x8 e cada célula guarda, calculadas sob demanda, só as entradas que podem ser
+    // a mais próxima de algum ponto dela; os laços sobre a paleta inteira são escritos para o
+    // compilador vetorizar. Na frente fica um cache de cores: séries temporais repetem muito as
+    // mesmas cores. No modo aproximado, a resposta é a da cor central da célula de 4x4x4.
+    class NearestColor {
+    public:
+        NearestColor(const Palette& palette, bool approximate);
+        uint8_t find(uint8_t r, uint8_t g, uint8_t b);
+
+    private:
+        uint8_t search(int r, int g, int b) const;
+        uint8_t searchCell(int r, int g, int b);
+
+        size_t padded;
+        bool approximate;
+        alignas(32) int32_t pr[256];
+        alignas(32) int32_t pg[256];
+        alignas(32) int32_t pb[256];
+        std::vector<uint32_t> cache;
+        std::vector<int32_t> cellStart; // -1 enquanto a célula não foi calculada
+        std::vector<uint8_t> candidates; // por célula: quantidade seguida dos índices
+    };
+
+    // Quantiza image (RGBA) para frame, que guarda o quadro anterior já quantizado quando
+    // hasPrevious. Em frame, RGB recebe a cor da paleta e o alfa o índice GIF (índice da paleta
+    // + 1); pixels que ficariam iguais ao quadro anterior recebem o índice 0 (transparente).
+    void mapFrame(const uint8_t* image, uint8_t* frame, int width, int height, bool hasPrevious,
+                  const Palette& palette, const Options& options);
+}
@@ -0,0 +1,238 @@
+#include "tsimg_raw.h"
+#include "tsimg_memory.h"
+#include "tsimg_spice.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define TSIMG_HAS_SHM 1
+#endif
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace tsimg::raw {
+
+namespace {
+    constexpr char kFrameMagic[4] = {'T', 'S', 'R', 'F'};
+    constexpr char kRingMagic[4] = {'T', 'S', 'R', 'R'};
+    constexpr size_t kFrameHeaderBytes = 16;
+    constexpr uint32_t kMaxSide = 1u << 16;
+
+    static_assert(sizeof(RingHeader) <= kRingHeaderBytes, "RingHeader must fit before the first slot");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring counters are shared with another process");
+
+    uint32_t get32(const uint8_t* p) {
+        return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+    }
+
+    // Bytes de pixels do quadro, depois de validar as dimensões e os canais
+    size_t pixelBytes(uint32_t width, uint32_t height, uint32_t channels, const std::string& source) {
+        if (width == 0 || height == 0 || width > kMaxSide || height > kMaxSide) {
+            throw std::runtime_error("Invalid raw frame size " + std::to_string(width) + "x" + std::to_string(height) + " from " + source);
+        }
+        if (channels != 1 && channels != 3 && channels != 4) {
+            throw std::runtime_error("Unsupported raw frame channel count " + std::to_string(channels) + " from " + source +
+                                     " (expected 1, 3 or 4)");
+        }
+        return static_cast<size_t>(width) * height * channels;
+    }
+
+    // RGBA e a contagem de memória no mesmo bloco: a contagem acompanha o último shared_ptr
+    struct HeldPixels {
+        std::vector<uint8_t> rgba;
+        tsimg::memory::Charge charge;
+    };
+
+    std::shared_ptr<HeldPixels> allocate(uint32_t width, uint32_t height) {
+        auto held = std::make_shared<HeldPixels>();
+        held->rgba.resize(static_cast<size_t>(width) * height * 4);
+        held->charge = tsimg::memory::Charge(tsimg::memory::Stage::Ingest, held->rgba.size());
+        return held;
+    }
+
+    void expand(const uint8_t* src, uint32_t channels, size_t pixels, uint8_t* rgba) {
+        if (channels == 4) {
+            std::memcpy(rgba, src, pixels * 4);
+        } else if (channels == 3) {
+            for (size_t i = 0; i < pixels; ++i) {
+                rgba[i * 4] = src[i * 3];
+                rgba[i * 4 + 1] = src[i * 3 + 1];
+                rgba[i * 4 + 2] = src[i * 3 + 2];
+                rgba[i * 4 + 3] = 255;
+            }
+        } else {
+            for (size_t i = 0; i < pixels; ++i) {
+                rgba[i * 4] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = src[i];
+                rgba[i * 4 + 3] = 255;
+            }
+        }
+    }
+
+    Frame publish(std::shared_ptr<HeldPixels> held, uint32_t width, uint32_t height) {
+        Frame frame;
+        frame.width = static_cast<int>(width);
+        frame.height = static_cast<int>(height);
+        frame.rgba = std::shared_ptr<const std::vector<uint8_t>>(held, &held->rgba);
+        return frame;
+    }
+
+    bool readExact(void* data, size_t bytes) {
+        return std::fread(data, 1, bytes, stdin) == bytes;
+    }
+
+    FrameSource stdinSource(bool debug) {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        auto frames = std::make_shared<size_t>(0);
+        return [frames, debug](Frame& frame) {
+            uint8_t header[kFrameHeaderBytes];
+            size_t got = std::fread(header, 1, sizeof(header), stdin);
+            if (got == 0 && std::feof(stdin)) {
+                tsimg::utils::debugLog(debug, "Read " + std::to_string(*frames) + " raw frames from stdin");
+                return false;
+            }
+            if (got != sizeof(header)) {
+                throw std::runtime_error("Truncated raw frame header on stdin after " + std::to_string(*frames) + " frames");
+            }
+            if (std::memcmp(header, kFrameMagic, sizeof(kFrameMagic)) != 0) {
+                throw std::runtime_error("Raw frame " + std::to_string(*frames + 1) + " on stdin does not start with TSRF");
+            }
+            const uint32_t width = get32(header + 4), height = get32(header + 8), channels = get32(header + 12);
+            const size_t bytes = pixelBytes(width, height, channels, "stdin");
+            auto held = allocate(width, height);
+            bool complete;
+            if (channels == 4) {
+                complete = readExact(held->rgba.data(), bytes);
+            } else {
+                std::vector<uint8_t> packed(bytes);
+                tsimg::memory::Charge packedCharge(tsimg::memory::Stage::Ingest, packed.size());
+                complete = readExact(packed.data(), bytes);
+                if (complete) expand(packed.data(), channels, static_cast<size_t>(width) * height, held->rgba.data());
+            }
+            if (!complete) {
+                throw std::runtime_error("Truncated raw frame " + std::to_string(*frames + 1) + " on stdin");
+            }
+            frame = publish(std::move(held), width, height);
+            ++*frames;
+            return true;
+        };
+    }
+
+#ifdef TSIMG_HAS_SHM
+    // Mapeamento do anel do produtor; só os contadores são escritos deste lado
+    class Ring {
+    public:
+        Ring(const std::string& name, bool debug) : name(name), debug(debug) {
+            int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+            if (fd < 0) {
+                throw std::runtime_error("Could not open shared memory " + name + " (" + std::strerror(errno) + ")");
+            }
+            struct stat st;
+            if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kRingHeaderBytes) {
+                ::close(fd);
+                throw std::runtime_error("Shared memory " + name + " is too small for a raw frame ring");
+            }
+            size = static_cast<size_t>(st.st_size);
+            mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (mapping == MAP_FAILED) {
+                mapping = nullptr;
+                throw std::runtime_error("Could not map shared memory " + name + " (" + std::strerror(errno) + ")");
+            }
+            header = static_cast<RingHeader*>(mapping);
+            stride = sizeof(SlotHeader) + static_cast<size_t>(header->slotBytes);
+            if (std::memcmp(header->magic, kRingMagic, sizeof(kRingMagic)) != 0 || header->version != 1 || header->slotCount == 0 ||
+                kRingHeaderBytes + header->slotCount * stride > size) {
+                ::munmap(mapping, size);
+                throw std::runtime_error("Shared memory " + name + " is not a version 1 raw frame ring");
+            }
+        }
+
+        ~Ring() {
+            if (mapping) ::munmap(mapping, size);
+        }
+
+        Ring(const Ring&) = delete;
+        Ring& operator=(const Ring&) = delete;
+
+        bool next(Frame& frame) {
+            const uint64_t index = header->consumed.load(std::memory_order_relaxed);
+            // Espera ativa curta e depois sono crescente: o produtor costuma estar no meio de um quadro
+            for (unsigned spins = 0; header->written.load(std::memory_order_acquire) == index; ++spins) {
+                if (header->closed.load(std::memory_order_acquire) && header->written.load(std::memory_order_acquire) == index) {
+                    tsimg::utils::debugLog(debug, "Read " + std::to_string(index) + " raw frames from shared memory " + name);
+                    return false;
+                }
+                if (spins < 64) {
+                    std::this_thread::yield();
+                } else {
+                    std::this_thread::sleep_for(std::chrono::microseconds(spins < 1024 ? 50 : 1000));
+                }
+            }
+
+            const uint8_t* slot = static_cast<const uint8_t*>(mapping) + kRingHeaderBytes + (index % header->slotCount) * stride;
+            SlotHeader info;
+            std::memcpy(&info, slot, sizeof(info));
+            const size_t bytes = pixelBytes(info.width, info.height, info.channels, "shared memory " + name);
+            if (bytes > header->slotBytes) {
+                throw std::runtime_error("Raw frame " + std::to_string(index + 1) + " overflows its shared memory slot in " + name);
+            }
+            auto held = allocate(info.width, info.height);
+            expand(slot + sizeof(SlotHeader), info.channels, static_cast<size_t>(info.width) * info.height, held->rgba.data());
+            // Slot copiado: o produtor já pode reutilizá-lo
+            header->consumed.store(index + 1, std::memory_order_release);
+            frame = publish(std::move(held), info.width, info.height);
+            return true;
+        }
+
+    private:
+        std::string name;
+        bool debug;
+        void* mapping = nullptr;
+        size_t size = 0;
+        size_t stride = 0;
+        RingHeader* header = nullptr;
+    };
+#endif
+}
+
+FrameSource open(const std::string& source, bool debug) {
+    if (source == "-") {
+        return stdinSource(debug);
+    }
+    if (source.rfind("shm:", 0) == 0) {
+#ifdef TSIMG_HAS_SHM
+        std::string name = source.substr(4);
+        if (name.empty()) {
+            throw std::runtime_error("Missing shared memory name in raw frame source: " + source);
+        }
+        if (name[0] != '/') name = "/" + name;
+        auto ring = std::make_shared<Ring>(name, debug);
+        tsimg::utils::debugLog(debug, "Reading raw frames from shared memory " + name);
+        return [ring](Frame& frame) { return ring->next(frame); };
+#else
+        throw std::runtime_error("Shared memory raw frames are not supported on this platform");
+#endif
+    }
+    throw std::runtime_error("Unknown raw frame source: " + source + " (expected '-' or 'shm:<name>')");
+}
+
+std::string frameName(size_t index) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "raw-%06zu.png", index + 1);
+    return name;
+}
+
+}
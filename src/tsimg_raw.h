@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tsimg::raw {
+
+    // Quadro cru já convertido para RGBA; os pixels ficam contados na etapa de ingestão enquanto
+    // houver referência a eles
+    struct Frame {
+        int width = 0;
+        int height = 0;
+        std::shared_ptr<const std::vector<uint8_t>> rgba;
+    };
+
+    // Devolve o próximo quadro em frame, ou false quando o produtor terminou. Lança
+    // std::runtime_error para cabeçalho inválido ou fluxo truncado.
+    using FrameSource = std::function<bool(Frame& frame)>;
+
+    // Abre uma fonte de quadros crus, sem PNG nem arquivos no caminho:
+    //   "-"           stdin; cada quadro é um cabeçalho de 16 bytes ("TSRF" seguido de largura,
+    //                 altura e canais como uint32 little-endian) e largura * altura * canais bytes
+    //                 de pixels, linha a linha; o fim do stdin entre dois quadros encerra a série
+    //   "shm:<nome>"  anel em memória compartilhada POSIX criado pelo produtor (ver RingHeader)
+    // Canais 1 (cinza), 3 (RGB) ou 4 (RGBA).
+    FrameSource open(const std::string& source, bool debug);
+
+    // Nome sintético do quadro de índice index, numerado a partir de 1: "raw-000001.png"
+    std::string frameName(size_t index);
+
+    // Início do objeto de memória compartilhada; os slots começam em kRingHeaderBytes, cada um com
+    // um SlotHeader e slotBytes de pixels. O produtor grava o quadro no slot written % slotCount
+    // quando written - consumed < slotCount e só então incrementa written; o tsimg incrementa
+    // consumed quando termina de copiar o slot. closed = 1 depois do último quadro encerra a série.
+    struct RingHeader {
+        char magic[4];                  // "TSRR"
+        uint32_t version;               // 1
+        uint32_t slotCount;
+        uint32_t slotBytes;             // capacidade de pixels de cada slot
+        std::atomic<uint64_t> written;  // quadros publicados pelo produtor
+        std::atomic<uint64_t> consumed; // quadros já copiados pelo tsimg
+        std::atomic<uint32_t> closed;
+    };
+
+    struct SlotHeader {
+        uint32_t width;
+        uint32_t height;
+        uint32_t channels;
+        uint32_t reserved;
+    };
+
+    constexpr size_t kRingHeaderBytes = 64;
+}
@@ -0,0 +1,100 @@
+#include "tsimg_roi.h"
+#include "tsimg_downscale.h"
+#include "tsimg_memory.h"
+#include "tsimg_pipeline.h"
+#include "tsimg_spice.h"
+#include <stb_image_write.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+namespace tsimg::roi {
+
+Box parseBox(const std::string& text) {
+    Box box;
+    char trailing = 0;
+    if (std::sscanf(text.c_str(), "%d,%d,%d,%d%c", &box.x, &box.y, &box.width, &box.height, &trailing) != 4 ||
+        box.x < 0 || box.y < 0 || box.empty()) {
+        throw std::runtime_error("Invalid region of interest: '" + text + "' (expected x,y,width,height)");
+    }
+    return box;
+}
+
+Box clipBox(const Box& box, int width, int height) {
+    Box clipped;
+    clipped.x = std::min(box.x, width);
+    clipped.y = std::min(box.y, height);
+    clipped.width = std::min(box.x + box.width, width) - clipped.x;
+    clipped.height = std::min(box.y + box.height, height) - clipped.y;
+    return clipped;
+}
+
+tsimg::inputs::TemporaryFrames cropSeries(const std::vector<std::string>& paths, const Options& options) {
+    if (!options.enabled() || paths.empty()) {
+        tsimg::inputs::TemporaryFrames unchanged;
+        unchanged.paths = paths;
+        return unchanged;
+    }
+    if (!options.frameBoxes.empty() && options.frameBoxes.size() != paths.size()) {
+        throw std::runtime_error("Expected one region of interest per frame (" + std::to_string(paths.size()) +
+                                 "), got " + std::to_string(options.frameBoxes.size()));
+    }
+
+    tsimg::inputs::TemporaryFrames series("tsimg-roi");
+    series.paths.resize(paths.size());
+    std::atomic<size_t> unchanged{0};
+    auto started = std::chrono::steady_clock::now();
+
+    tsimg::pipeline::parallelFor(paths.size(), options.threads, [&](size_t i) {
+        const std::string& path = paths[i];
+        int width = 0, height = 0;
+        if (!tsimg::downscale::imageSize(path, width, height)) {
+            throw std::runtime_error("Failed to read image header: " + path);
+        }
+        const Box& requested = options.frameBoxes.empty() ? options.box : options.frameBoxes[i];
+        Box box = clipBox(requested, width, height);
+        if (box.empty()) {
+            throw std::runtime_error("Region of interest lies outside the " + std::to_string(width) + "x" +
+                                     std::to_string(height) + " image: " + path);
+        }
+        // Caixa que cobre tudo: os bytes originais seguem intactos
+        if (box.x == 0 && box.y == 0 && box.width == width && box.height == height) {
+            series.paths[i] = path;
+            unchanged.fetch_add(1);
+            return;
+        }
+
+        tsimg::downscale::Options decode;
+        decode.stage = tsimg::memory::Stage::Ingest;
+        decode.debug = options.debug;
+        std::vector<uint8_t> rgba;
+        if (!tsimg::downscale::loadCroppedRgba(path, box.x, box.y, box.width, box.height, rgba, decode)) {
+            throw std::runtime_error("Failed to crop image: " + path);
+        }
+        tsimg::memory::Charge cropped(tsimg::memory::Stage::Ingest, rgba.size());
+
+        bool jpeg = tsimg::inputs::isJpeg(path);
+        std::string target = series.pathFor(i, path, jpeg ? ".jpg" : ".png");
+        int written = jpeg ? stbi_write_jpg(target.c_str(), box.width, box.height, 4, rgba.data(), options.jpegQuality)
+                           : stbi_write_png(target.c_str(), box.width, box.height, 4, rgba.data(), box.width * 4);
+        if (!written) {
+            throw std::runtime_error("Failed to write cropped frame: " + target);
+        }
+        series.paths[i] = target;
+    }, [&](size_t i) {
+        // Estimativa para o orçamento de memória: a imagem decodificada inteira mais o recorte
+        int width = 0, height = 0;
+        if (!tsimg::downscale::imageSize(paths[i], width, height)) return size_t(0);
+        const Box& box = options.frameBoxes.empty() ? options.box : options.frameBoxes[i];
+        return static_cast<size_t>(width) * height * 4 + static_cast<size_t>(box.width) * box.height * 4;
+    });
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+    tsimg::utils::debugLog(options.debug, "Cropped " + std::to_string(paths.size() - unchanged.load()) + " frames in " +
+                           std::to_string(elapsed) + " ms (" + std::to_string(unchanged.load()) + " already inside the region)");
+    return series;
+}
+
+}
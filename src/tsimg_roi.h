@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "tsimg_inputs.h"
+
+namespace tsimg::roi {
+
+    // Caixa em pixels a partir do canto superior esquerdo
+    struct Box {
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+
+        bool empty() const { return width <= 0 || height <= 0; }
+    };
+
+    // "x,y,largura,altura"; lança std::runtime_error se estiver malformada
+    Box parseBox(const std::string& text);
+
+    // Parte da caixa dentro de uma imagem width x height (vazia se não houver interseção)
+    Box clipBox(const Box& box, int width, int height);
+
+    struct Options {
+        Box box;                     // mesma caixa para todos os quadros (vazia = sem recorte)
+        std::vector<Box> frameBoxes; // uma caixa por quadro; tem precedência sobre box
+        int jpegQuality = 95;        // quadros JPEG continuam JPEG depois do recorte
+        unsigned threads = 0;        // 0 = std::thread::hardware_concurrency()
+        bool debug = false;
+
+        bool enabled() const { return !box.empty() || !frameBoxes.empty(); }
+    };
+
+    // Recorta cada quadro em paralelo (caixa limitada à imagem) e grava o resultado num diretório
+    // temporário, no formato de origem: JPEG para JPEG, PNG para o resto. Quadros cuja caixa cobre
+    // a imagem inteira seguem com o caminho original, sem decodificar. Lança std::runtime_error se
+    // frameBoxes não tiver uma caixa por quadro ou se alguma caixa não tocar a imagem.
+    tsimg::inputs::TemporaryFrames cropSeries(const std::vector<std::string>& paths, const Options& options);
+}
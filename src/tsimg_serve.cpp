@@ -0,0 +1,390 @@
+#include "tsimg_serve.h"
+#include "tsimg_spice.h"
+#include "tsimg_memory.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define TSIMG_HAS_UNIX_SOCKETS 1
+#endif
+
+namespace tsimg::serve {
+
+#ifdef TSIMG_HAS_UNIX_SOCKETS
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    std::atomic<bool> stopRequested{false};
+
+    void handleStopSignal(int) {
+        stopRequested.store(true);
+    }
+
+    double millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    struct Job {
+        nlohmann::json config;
+        Clock::time_point enqueued;
+        std::promise<nlohmann::json> reply;
+    };
+
+    class JobQueue {
+    public:
+        bool push(std::shared_ptr<Job> job) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (closed) {
+                    return false;
+                }
+                jobs.push_back(std::move(job));
+            }
+            ready.notify_one();
+            return true;
+        }
+
+        std::shared_ptr<Job> pop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return closed || !jobs.empty(); });
+            if (jobs.empty()) {
+                return nullptr;
+            }
+            auto job = std::move(jobs.front());
+            jobs.pop_front();
+            return job;
+        }
+
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            ready.notify_all();
+        }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return jobs.size();
+        }
+
+    private:
+        mutable std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<std::shared_ptr<Job>> jobs;
+        bool closed = false;
+    };
+
+    class Metrics {
+    public:
+        void record(double latencyMs, bool ok) {
+            std::lock_guard<std::mutex> lock(mutex);
+            (ok ? completed : failed)++;
+            totalMs += latencyMs;
+            maxMs = std::max(maxMs, latencyMs);
+            lastMs = latencyMs;
+            if (recent.size() < kWindow) {
+                recent.push_back(latencyMs);
+            } else {
+                recent[nextSlot] = latencyMs;
+            }
+            nextSlot = (nextSlot + 1) % kWindow;
+        }
+
+        nlohmann::json latencyJson() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::vector<double> sorted = recent;
+            std::sort(sorted.begin(), sorted.end());
+            auto percentile = [&](double p) {
+                if (sorted.empty()) return 0.0;
+                return sorted[static_cast<size_t>(p * (sorted.size() - 1))];
+            };
+            size_t total = completed + failed;
+            return {
+                {"jobs_completed", completed},
+                {"jobs_failed", failed},
+                {"latency_ms", {
+                    {"last", lastMs},
+                    {"mean", total ? totalMs / total : 0.0},
+                    {"max", maxMs},
+                    {"p50", percentile(0.50)},
+                    {"p95", percentile(0.95)},
+                }},
+            };
+        }
+
+    private:
+        static constexpr size_t kWindow = 1024;
+
+        mutable std::mutex mutex;
+        size_t completed = 0;
+        size_t failed = 0;
+        double totalMs = 0;
+        double maxMs = 0;
+        double lastMs = 0;
+        std::vector<double> recent;
+        size_t nextSlot = 0;
+    };
+
+    bool sendLine(int fd, const std::string& line) {
+        std::string payload = line + "\n";
+        size_t sent = 0;
+        while (sent < payload.size()) {
+            ssize_t n = ::send(fd, payload.data() + sent, payload.size() - sent, 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Identidade do socket criado por este processo: no fim, só ele é removido do caminho
+    struct BoundSocket {
+        dev_t device = 0;
+        ino_t inode = 0;
+    };
+
+    // Um socket no caminho que ainda aceita conexões pertence a outro servidor vivo
+    bool socketInUse(const sockaddr_un& address) {
+        int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probe < 0) return false;
+        bool connected = ::connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        ::close(probe);
+        return connected;
+    }
+
+    int openListener(const std::string& socketPath, BoundSocket& bound) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Socket path too long: " + socketPath);
+        }
+        std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+        // Só um socket abandonado (ninguém escutando) é substituído; qualquer outro arquivo fica
+        struct stat existing;
+        if (::lstat(socketPath.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                throw std::runtime_error("Refusing to replace " + socketPath + ": it exists and is not a socket");
+            }
+            if (socketInUse(address)) {
+                throw std::runtime_error("Another server is already listening on " + socketPath);
+            }
+            ::unlink(socketPath.c_str());
+        }
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw std::runtime_error(std::string("Could not create socket: ") + std::strerror(errno));
+        }
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 64) != 0) {
+            std::string error = std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error("Could not listen on " + socketPath + ": " + error);
+        }
+        struct stat created;
+        if (::stat(socketPath.c_str(), &created) == 0) {
+            bound.device = created.st_dev;
+            bound.inode = created.st_ino;
+        }
+        return fd;
+    }
+}
+
+int runServer(const ServeOptions& options, const JobRunner& runJob) {
+    size_t workerCount = options.workers ? options.workers : std::max(1u, std::thread::hardware_concurrency());
+
+    tsimg::utils::TemplateCache::instance().setEnabled(true);
+    tsimg::utils::FrameCache::instance().setCapacity(options.frameCacheBytes);
+
+    int listener = -1;
+    BoundSocket bound;
+    try {
+        listener = openListener(options.socketPath, bound);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    stopRequested.store(false);
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+    std::signal(SIGPIPE, SIG_IGN); // cliente que desconecta não deve derrubar o servidor
+
+    JobQueue queue;
+    Metrics metrics;
+    std::atomic<size_t> activeJobs{0};
+    auto started = Clock::now();
+
+    auto statsJson = [&]() {
+        auto frames = tsimg::utils::FrameCache::instance().stats();
+        auto templates = tsimg::utils::TemplateCache::instance().stats();
+        nlohmann::json stats = metrics.latencyJson();
+        stats["status"] = "ok";
+        stats["uptime_s"] = millisecondsSince(started) / 1000.0;
+        stats["workers"] = workerCount;
+        stats["queue_depth"] = queue.size();
+        stats["active_jobs"] = activeJobs.load();
+        stats["frame_cache"] = {{"entries", frames.entries}, {"bytes", frames.bytes}, {"hits", frames.hits}, {"misses", frames.misses}};
+        stats["template_cache"] = {{"entries", templates.entries}, {"hits", templates.hits}, {"misses", templates.misses}};
+        if (tsimg::memory::enabled()) {
+            stats["memory"] = tsimg::memory::reportJson();
+        }
+        return stats;
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back([&]() {
+            while (auto job = queue.pop()) {
+                ++activeJobs;
+                auto start = Clock::now();
+                nlohmann::json reply;
+                bool ok = true;
+                try {
+                    reply = {{"status", "ok"}, {"output", runJob(job->config)}};
+                } catch (const std::exception& e) {
+                    ok = false;
+                    reply = {{"status", "error"}, {"message", e.what()}};
+                }
+                double totalMs = millisecondsSince(job->enqueued);
+                reply["queue_ms"] = std::chrono::duration<double, std::milli>(start - job->enqueued).count();
+                reply["elapsed_ms"] = totalMs;
+                metrics.record(totalMs, ok);
+                --activeJobs;
+                job->reply.set_value(std::move(reply));
+            }
+        });
+    }
+
+    // Uma thread por cliente; as que já terminaram são recolhidas a cada nova conexão, para um
+    // servidor de longa duração não acumular threads encerradas
+    struct Connection {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> finished;
+    };
+    std::mutex connectionsMutex;
+    std::list<Connection> connections;
+
+    auto serveConnection = [&](int fd, std::shared_ptr<std::atomic<bool>> finished) {
+        std::string buffer;
+        char chunk[4096];
+        while (!stopRequested.load()) {
+            pollfd pfd{fd, POLLIN, 0};
+            int ready = ::poll(&pfd, 1, 200);
+            if (ready == 0 || (ready < 0 && errno == EINTR)) continue;
+            if (ready < 0) break;
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) break;
+            buffer.append(chunk, static_cast<size_t>(n));
+
+            size_t newline;
+            while ((newline = buffer.find('\n')) != std::string::npos) {
+                std::string line = buffer.substr(0, newline);
+                buffer.erase(0, newline + 1);
+                if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+                nlohmann::json reply;
+                try {
+                    nlohmann::json request = nlohmann::json::parse(line);
+                    std::string command = request.is_object() ? request.value("command", "") : "";
+                    if (command == "stats") {
+                        reply = statsJson();
+                    } else if (command == "shutdown") {
+                        stopRequested.store(true);
+                        reply = {{"status", "ok"}};
+                    } else {
+                        // O stdout é o do servidor, não o do cliente: cada job grava num arquivo
+                        if (request.is_object() && request.contains("output_filename") &&
+                            tsimg::utils::FileHandler::isStdStream(request["output_filename"].get<std::string>())) {
+                            throw std::runtime_error("Serve jobs need an output file path; \"-\" would write to the server's stdout");
+                        }
+                        auto job = std::make_shared<Job>();
+                        job->config = std::move(request);
+                        job->enqueued = Clock::now();
+                        auto pending = job->reply.get_future();
+                        if (!queue.push(std::move(job))) {
+                            throw std::runtime_error("Server is shutting down");
+                        }
+                        reply = pending.get();
+                    }
+                } catch (const std::exception& e) {
+                    reply = {{"status", "error"}, {"message", e.what()}};
+                }
+                if (!sendLine(fd, reply.dump())) {
+                    buffer.clear();
+                    break;
+                }
+            }
+        }
+        ::close(fd);
+        finished->store(true);
+    };
+
+    std::cout << "tsimg serving on " << options.socketPath << " with " << workerCount << " workers" << std::endl;
+
+    while (!stopRequested.load()) {
+        pollfd pfd{listener, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, 200);
+        if (ready <= 0) continue;
+        int client = ::accept(listener, nullptr, nullptr);
+        if (client < 0) continue;
+        tsimg::utils::debugLog(options.debug, "Client connected");
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        for (auto it = connections.begin(); it != connections.end();) {
+            if (it->finished->load()) {
+                it->thread.join();
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        auto finished = std::make_shared<std::atomic<bool>>(false);
+        connections.push_back({std::thread(serveConnection, client, finished), finished});
+    }
+
+    ::close(listener);
+    // Outro processo pode ter tomado o caminho depois de nós; o socket dele fica
+    struct stat current;
+    if (::stat(options.socketPath.c_str(), &current) == 0 && current.st_dev == bound.device && current.st_ino == bound.inode) {
+        ::unlink(options.socketPath.c_str());
+    }
+    queue.close();
+    for (auto& t : workers) t.join();
+    for (auto& connection : connections) connection.thread.join();
+
+    std::cout << "tsimg server stopped" << std::endl;
+    return 0;
+}
+
+#else
+
+int runServer(const ServeOptions&, const JobRunner&) {
+    std::cerr << "tsimg serve requires Unix domain sockets, which are not available on this platform." << std::endl;
+    return 1;
+}
+
+#endif
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace tsimg::serve {
+
+    struct ServeOptions {
+        std::string socketPath = "/tmp/tsimg.sock";
+        size_t workers = 0;                       // 0 = std::thread::hardware_concurrency()
+        size_t frameCacheBytes = size_t(512) << 20;
+        bool debug = false;
+    };
+
+    // Executa um job no esquema do arquivo de configuração e devolve o caminho gerado;
+    // falhas são sinalizadas por exceção.
+    using JobRunner = std::function<std::string(const nlohmann::json& job)>;
+
+    // Atende jobs JSON (um por linha) em um socket Unix até receber SIGINT/SIGTERM ou o comando
+    // {"command": "shutdown"}. Os jobs rodam em um conjunto fixo de workers que compartilham os
+    // caches de template e de quadros codificados; {"command": "stats"} devolve os contadores.
+    int runServer(const ServeOptions& options, const JobRunner& runJob);
+}
@@ -1,13 +1,22 @@
 #include "tsimg_spice.h"
+#include "tsimg_container.h"
+#include "tsimg_pipeline.h"
 #include "build_info.h"
+#include "embedded_templates.h"
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <filesystem>
 #include <stdexcept>
 #include <algorithm>
+#include <array>
+#include <set>
 #include <thread>
 #include <future>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 namespace tsimg::utils {
     void debugLog(bool debug, const std::string& message) {
@@ -54,6 +63,44 @@ namespace tsimg::utils {
         }
     }
 
+    namespace {
+        std::streambuf* stdoutBuffer = nullptr;
+    }
+
+    bool FileHandler::isStdStream(const std::string& filepath) {
+        return filepath == "-";
+    }
+
+    void FileHandler::reserveStdout() {
+        if (stdoutBuffer) {
+            return;
+        }
+        std::cout.flush();
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        stdoutBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
+    std::unique_ptr<std::ostream> FileHandler::openOutputStream(const std::string& filepath, bool debug) {
+        if (isStdStream(filepath)) {
+            reserveStdout();
+            debugLog(debug, "Output stream opened: <stdout>");
+            return std::make_unique<std::ostream>(stdoutBuffer);
+        }
+
+        validateFilePath(filepath);
+        createDirectoryIfNeeded(filepath);
+
+        auto file = std::make_unique<std::ofstream>(filepath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file->is_open()) {
+            throw std::runtime_error("Could not open file for writing: " + filepath);
+        }
+        debugLog(debug, "Output stream opened: " + filepath);
+        return file;
+    }
+
     bool FileHandler::isValidImageFormat(const std::string& filepath) {
         static const std::vector<std::string> validExtensions = {
             ".jpg", ".jpeg", ".png", ".gif", ".bmp"
@@ -170,30 +217,136 @@ namespace tsimg::utils {
         return oss.str();
     }
 
-    std::string Base64::encode(const std::vector<unsigned char>& data) {
+    namespace {
+        const std::string_view kImageTagPrefix = "<img src=\"data:image/png;base64,";
+        const std::string_view kImageTagMiddle = "\" alt=\"";
+        const std::string_view kImageTagSuffix = "\" loading=\"lazy\">";
+    }
+
+    size_t HTMLBuilder::imageTagSize(size_t base64Size, size_t pathSize) {
+        return kImageTagPrefix.size() + base64Size + kImageTagMiddle.size() + pathSize + kImageTagSuffix.size();
+    }
+
+    void HTMLBuilder::appendImageTag(std::string& out, std::string_view base64, std::string_view path) {
+        out.append(kImageTagPrefix).append(base64).append(kImageTagMiddle).append(path).append(kImageTagSuffix);
+    }
+
+    std::string HTMLBuilder::createImageTag(std::string_view base64, std::string_view path) {
+        std::string tag;
+        tag.reserve(imageTagSize(base64.size(), path.size()));
+        appendImageTag(tag, base64, path);
+        return tag;
+    }
+
+    std::string HTMLBuilder::encodeImageTag(const std::vector<unsigned char>& data, std::string_view path) {
+        return encodeImageTag(data.data(), data.size(), path);
+    }
+
+    std::string HTMLBuilder::encodeImageTag(const unsigned char* data, size_t length, std::string_view path) {
+        // O Base64 é escrito direto no buffer da tag, sem string intermediária
+        const size_t base64Size = Base64::encodedSize(length);
+        std::string tag(imageTagSize(base64Size, path.size()), '\0');
+        char* out = &tag[0];
+        out = std::copy(kImageTagPrefix.begin(), kImageTagPrefix.end(), out);
+        Base64::encodeTo(data, length, out);
+        out += base64Size;
+        out = std::copy(kImageTagMiddle.begin(), kImageTagMiddle.end(), out);
+        out = std::copy(path.begin(), path.end(), out);
+        std::copy(kImageTagSuffix.begin(), kImageTagSuffix.end(), out);
+        return tag;
+    }
+
+    size_t HTMLBuilder::findImageTag(std::string_view html, size_t from, std::string_view& base64, std::string_view& path, size_t& end) {
+        for (size_t start = html.find(kImageTagPrefix, from); start != std::string_view::npos; start = html.find(kImageTagPrefix, start + 1)) {
+            size_t dataBegin = start + kImageTagPrefix.size();
+            size_t dataEnd = html.find(kImageTagMiddle, dataBegin);
+            if (dataEnd == std::string_view::npos) break;
+            size_t pathBegin = dataEnd + kImageTagMiddle.size();
+            size_t pathEnd = html.find(kImageTagSuffix, pathBegin);
+            if (pathEnd == std::string_view::npos) break;
+            // Uma tag de outro formato no meio indica que esta não é uma tag de quadro
+            if (html.substr(dataBegin, pathEnd - dataBegin).find('<') != std::string_view::npos) continue;
+            base64 = html.substr(dataBegin, dataEnd - dataBegin);
+            path = html.substr(pathBegin, pathEnd - pathBegin);
+            end = pathEnd + kImageTagSuffix.size();
+            return start;
+        }
+        return std::string_view::npos;
+    }
+
+    size_t Base64::encodedSize(size_t length) {
+        return ((length + 2) / 3) * 4;
+    }
+
+    void Base64::encodeTo(const unsigned char* data, size_t length, char* out) {
         static const char* encoding_table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-        std::string encoded;
-        encoded.reserve(((data.size() + 2) / 3) * 4);
 
-        for (size_t i = 0; i < data.size(); i += 3) {
-            uint32_t octet_a = i < data.size() ? data[i] : 0;
-            uint32_t octet_b = i + 1 < data.size() ? data[i + 1] : 0;
-            uint32_t octet_c = i + 2 < data.size() ? data[i + 2] : 0;
+        size_t i = 0;
+        for (; i + 2 < length; i += 3) {
+            uint32_t triple = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+            *out++ = encoding_table[(triple >> 18) & 0x3F];
+            *out++ = encoding_table[(triple >> 12) & 0x3F];
+            *out++ = encoding_table[(triple >> 6) & 0x3F];
+            *out++ = encoding_table[triple & 0x3F];
+        }
 
-            uint32_t triple = (octet_a << 16) + (octet_b << 8) + octet_c;
+        if (i < length) {
+            uint32_t octet_b = i + 1 < length ? data[i + 1] : 0;
+            uint32_t triple = (uint32_t(data[i]) << 16) | (octet_b << 8);
+            *out++ = encoding_table[(triple >> 18) & 0x3F];
+            *out++ = encoding_table[(triple >> 12) & 0x3F];
+            *out++ = i + 1 < length ? encoding_table[(triple >> 6) & 0x3F] : '=';
+            *out++ = '=';
+        }
+    }
 
-            encoded.push_back(encoding_table[(triple >> 18) & 0x3F]);
-            encoded.push_back(encoding_table[(triple >> 12) & 0x3F]);
-            encoded.push_back(encoding_table[(triple >> 6) & 0x3F]);
-            encoded.push_back(encoding_table[triple & 0x3F]);
+    size_t Base64::decodedSize(std::string_view encoded) {
+        size_t padding = 0;
+        while (padding < 2 && padding < encoded.size() && encoded[encoded.size() - 1 - padding] == '=') {
+            ++padding;
         }
+        return encoded.size() / 4 * 3 - padding;
+    }
 
-        int mod_table[] = {0, 2, 1};
-        int padding = mod_table[data.size() % 3];
-        for (int i = 0; i < padding; i++) {
-            encoded[encoded.size() - 1 - i] = '=';
+    size_t Base64::decodeTo(std::string_view encoded, unsigned char* out) {
+        static const auto table = [] {
+            std::array<int8_t, 256> t{};
+            t.fill(-1);
+            const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int i = 0; i < 64; ++i) t[static_cast<unsigned char>(alphabet[i])] = static_cast<int8_t>(i);
+            return t;
+        }();
+
+        if (encoded.size() % 4 != 0) {
+            throw std::runtime_error("Invalid Base64 length");
+        }
+        unsigned char* start = out;
+        for (size_t i = 0; i < encoded.size(); i += 4) {
+            int values[4];
+            int count = 4;
+            for (int k = 0; k < 4; ++k) {
+                char c = encoded[i + k];
+                if (c == '=' && i + 4 == encoded.size() && k >= 2) {
+                    count = std::min(count, k);
+                    values[k] = 0;
+                    continue;
+                }
+                values[k] = table[static_cast<unsigned char>(c)];
+                if (values[k] < 0 || count < 4) {
+                    throw std::runtime_error("Invalid Base64 data");
+                }
+            }
+            uint32_t triple = (uint32_t(values[0]) << 18) | (uint32_t(values[1]) << 12) | (uint32_t(values[2]) << 6) | uint32_t(values[3]);
+            *out++ = static_cast<unsigned char>(triple >> 16);
+            if (count > 2) *out++ = static_cast<unsigned char>(triple >> 8);
+            if (count > 3) *out++ = static_cast<unsigned char>(triple);
         }
+        return static_cast<size_t>(out - start);
+    }
 
+    std::string Base64::encode(const std::vector<unsigned char>& data) {
+        std::string encoded(encodedSize(data.size()), '\0');
+        encodeTo(data.data(), data.size(), &encoded[0]);
         return encoded;
     }
 
@@ -227,54 +380,213 @@ namespace tsimg::utils {
     }
 
     std::vector<std::future<std::unique_ptr<Image>>> ImageProcessor::processImagesAsync(const std::vector<std::string>& imagePaths, bool debug) {
-        std::vector<std::future<std::unique_ptr<Image>>> futures;
-        for (const auto& path : imagePaths) {
-            futures.push_back(std::async(std::launch::async, [path, debug]() {
-                try {
-                    auto imageData = FileIO::readBinary(path);
-                    std::string base64 = Base64::encode(imageData);
-                    return std::make_unique<Image>(path, base64);
-                } catch (const std::exception& e) {
-                    errorLog(debug, "Error processing image: " + path + " - " + e.what());
-                    return std::make_unique<Image>(path, "");
-                }
-            }));
-        }
+        std::vector<std::future<std::unique_ptr<Image>>> futures(imagePaths.size());
+        // As leituras ficam em lote no FileIO; cada buffer concluído já segue para a codificação
+        FileIO::readBatch(imagePaths, [&](FileIO::ReadResult&& result) {
+            const std::string& path = imagePaths[result.index];
+            if (!result.error.empty()) {
+                errorLog(debug, "Error processing image: " + path + " - " + result.error);
+                std::promise<std::unique_ptr<Image>> failed;
+                failed.set_value(std::make_unique<Image>(path, ""));
+                futures[result.index] = failed.get_future();
+                return;
+            }
+            tsimg::memory::Charge ingest(tsimg::memory::Stage::Ingest, result.data.size());
+            // Com --memory-budget, cada codificação só dispara quando o arquivo e o Base64 cabem;
+            // a espera segura também as próximas leituras do lote
+            auto admission = tsimg::memory::admit(result.data.size() + (result.data.size() + 2) / 3 * 4);
+            futures[result.index] = std::async(std::launch::async, [path, data = std::move(result.data), ingest = std::move(ingest),
+                                                                    admission = std::move(admission)]() mutable {
+                // A lambda fica no estado compartilhado até o future ser destruído, e os futures só
+                // são consumidos depois do lote: arquivo, contagem e admissão saem daqui ao codificar
+                auto bytes = std::move(data);
+                auto held = std::move(ingest);
+                auto admitted = std::move(admission);
+                auto image = std::make_unique<Image>(path, Base64::encode(bytes));
+                std::vector<unsigned char>().swap(bytes);
+                held.reset();
+                admitted.release();
+                return image;
+            });
+        }, 64, debug);
         return futures;
     }
 
+    FrameCache& FrameCache::instance() {
+        static FrameCache cache;
+        return cache;
+    }
+
+    void FrameCache::setCapacity(size_t newCapacity) {
+        std::lock_guard<std::mutex> lock(mutex);
+        capacity = newCapacity;
+        evict();
+    }
+
+    bool FrameCache::enabled() const {
+        return capacity.load(std::memory_order_relaxed) > 0;
+    }
+
+    std::shared_ptr<const std::string> FrameCache::find(const std::string& path, uintmax_t size, int64_t mtime) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(path);
+        if (it == entries.end() || it->second.size != size || it->second.mtime != mtime) {
+            ++misses;
+            return nullptr;
+        }
+        ++hits;
+        lru.splice(lru.begin(), lru, it->second.lruPosition);
+        return it->second.tag;
+    }
+
+    void FrameCache::insert(const std::string& path, uintmax_t size, int64_t mtime, std::shared_ptr<const std::string> tag) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tag->size() > capacity) {
+            return;
+        }
+        auto it = entries.find(path);
+        if (it != entries.end()) {
+            bytes -= it->second.tag->size();
+            lru.erase(it->second.lruPosition);
+            entries.erase(it);
+        }
+        lru.push_front(path);
+        bytes += tag->size();
+        entries.emplace(path, Entry{size, mtime, std::move(tag), lru.begin()});
+        evict();
+    }
+
+    void FrameCache::evict() {
+        while (bytes > capacity && !lru.empty()) {
+            auto it = entries.find(lru.back());
+            bytes -= it->second.tag->size();
+            entries.erase(it);
+            lru.pop_back();
+        }
+    }
+
+    FrameCache::Stats FrameCache::stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return Stats{entries.size(), bytes, hits, misses};
+    }
+
+    TemplateCache& TemplateCache::instance() {
+        static TemplateCache cache;
+        return cache;
+    }
+
+    void TemplateCache::setEnabled(bool enabled) {
+        std::lock_guard<std::mutex> lock(mutex);
+        active = enabled;
+        if (!enabled) {
+            resolved.clear();
+            contents.clear();
+        }
+    }
+
+    bool TemplateCache::enabled() const {
+        return active.load(std::memory_order_relaxed);
+    }
+
+    std::string TemplateCache::resolve(const std::string& templateName, const std::function<std::string(const std::string&)>& resolver) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = resolved.find(templateName);
+            if (it != resolved.end()) {
+                return it->second;
+            }
+        }
+        std::string path = resolver(templateName);
+        std::lock_guard<std::mutex> lock(mutex);
+        resolved.emplace(templateName, path);
+        return path;
+    }
+
+    std::string TemplateCache::read(const std::string& templatePath, bool debug) {
+        std::error_code ec;
+        auto mtime = std::filesystem::last_write_time(templatePath, ec);
+        if (!ec) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = contents.find(templatePath);
+            if (it != contents.end() && it->second.mtime == mtime) {
+                ++hits;
+                return it->second.content;
+            }
+            ++misses;
+        }
+        std::string content = FileHandler::readFile(templatePath, debug);
+        if (!ec) {
+            std::lock_guard<std::mutex> lock(mutex);
+            contents[templatePath] = Entry{mtime, content};
+        }
+        return content;
+    }
+
+    TemplateCache::Stats TemplateCache::stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return Stats{contents.size(), hits, misses};
+    }
+
+    const tsimg::embedded::Template* findEmbeddedTemplate(const std::string& templatePath) {
+        std::string_view path(templatePath);
+        if (path.substr(0, kEmbeddedTemplatePrefix.size()) != kEmbeddedTemplatePrefix) {
+            return nullptr;
+        }
+        path.remove_prefix(kEmbeddedTemplatePrefix.size());
+        for (const auto& embeddedTemplate : tsimg::embedded::kTemplates) {
+            if (embeddedTemplate.name == path) {
+                return &embeddedTemplate;
+            }
+        }
+        return nullptr;
+    }
+
     std::string getTemplateContent(const std::string& templatePath, bool debug) {
         std::string fullPath = templatePath;
         if (templatePath.empty()) {
             fullPath = TemplateWriter::getDefaultTemplatePath();
         }
+        // Templates embutidos já estão na memória: sem IO e sem passar pelo cache
+        if (const auto* embeddedTemplate = findEmbeddedTemplate(fullPath)) {
+            debugLog(debug, "Using embedded template: " + std::string(embeddedTemplate->name));
+            return std::string(embeddedTemplate->content);
+        }
+        if (TemplateCache::instance().enabled()) {
+            return TemplateCache::instance().read(fullPath, debug);
+        }
         return FileHandler::readFile(fullPath, debug);
     }
 }
 
-SpiceContent::SpiceContent(const std::string& tag, const std::string& baseHtml, const std::string& variableContent)
-    : tag(tag), baseHtml(baseHtml), variableContent(variableContent) {}
+SpiceContent::SpiceContent(std::string tag, std::string baseHtml, std::string variableContent)
+    : tag(std::move(tag)), baseHtml(std::move(baseHtml)), variableContent(std::move(variableContent)) {}
 
-std::string SpiceContent::getTag() const {
+const std::string& SpiceContent::getTag() const {
     return tag;
 }
 
-std::string SpiceContent::getBaseHtml() const {
+const std::string& SpiceContent::getBaseHtml() const {
     return baseHtml;
 }
 
-std::string SpiceContent::getVariableContent() const {
+const std::string& SpiceContent::getVariableContent() const {
     return variableContent;
 }
 
-Image::Image(const std::string& path, const std::string& base64)
-    : path(path), base64(base64) {}
+Image::Image(std::string path, std::string base64)
+    : path(std::move(path)),
+      base64(std::make_shared<const std::string>(std::move(base64))),
+      charge(tsimg::memory::Stage::Encode, this->base64->size()) {}
 
-std::string Image::getPath() const {
+const std::string& Image::getPath() const {
     return path;
 }
 
-std::string Image::getBase64() const {
+std::string_view Image::getBase64() const {
+    return *base64;
+}
+
+std::shared_ptr<const std::string> Image::shareBase64() const {
     return base64;
 }
 
@@ -286,10 +598,22 @@ std::vector<std::unique_ptr<Image>>& ImageList::getImages() {
     return images;
 }
 
-std::string ImageList::generateImageTags() const {
+size_t ImageList::imageTagsSize() const {
+    size_t total = 0;
+    for (const auto& image : images) {
+        total += tsimg::utils::HTMLBuilder::imageTagSize(image->getBase64().size(), image->getPath().size());
+    }
+    return total;
+}
+
+std::string ImageList::generateImageTags(tsimg::memory::Charge& charge) const {
+    // Tamanho exato calculado antes, para uma única alocação sem temporários por imagem
+    const size_t total = imageTagsSize();
     std::string imageTags;
+    imageTags.reserve(total);
+    charge = tsimg::memory::Charge(tsimg::memory::Stage::Render, total);
     for (const auto& image : images) {
-        imageTags += "<img src=\"data:image/png;base64," + image->getBase64() + "\" alt=\"" + image->getPath() + "\" loading=\"lazy\">";
+        tsimg::utils::HTMLBuilder::appendImageTag(imageTags, image->getBase64(), image->getPath());
     }
     return imageTags;
 }
@@ -364,8 +688,9 @@ SPICEBuilder& SPICEBuilder::addImagesAsync(const std::vector<std::string>& image
                 if (imageLists.find("SPICE_IMAGES") == imageLists.end()) {
                     imageLists["SPICE_IMAGES"] = std::make_unique<ImageList>();
                 }
+                const std::string& path = img->getPath(); // o Image continua vivo dentro da lista
                 imageLists["SPICE_IMAGES"]->addImage(std::move(img));
-                tsimg::utils::debugLog(debug, "Image added successfully: " + img->getPath());
+                tsimg::utils::debugLog(debug, "Image added successfully: " + path);
             }
         } catch (const std::exception& e) {
             tsimg::utils::errorLog(debug, "Failed to add image: " + std::string(e.what()));
@@ -375,6 +700,47 @@ SPICEBuilder& SPICEBuilder::addImagesAsync(const std::vector<std::string>& image
     return *this;
 }
 
+SPICEBuilder& SPICEBuilder::addImagePaths(const std::string& listTag, const std::vector<std::string>& paths) {
+    tsimg::utils::debugLog(debug, "Queueing " + std::to_string(paths.size()) + " images for " + listTag);
+    auto& list = imagePaths[listTag];
+    list.insert(list.end(), paths.begin(), paths.end());
+    imageStamps[listTag].resize(list.size());
+    return *this;
+}
+
+SPICEBuilder& SPICEBuilder::addImageInputs(const std::string& listTag, const std::vector<tsimg::inputs::ImageInput>& inputs) {
+    tsimg::utils::debugLog(debug, "Queueing " + std::to_string(inputs.size()) + " validated images for " + listTag);
+    auto& list = imagePaths[listTag];
+    auto& stamps = imageStamps[listTag];
+    stamps.resize(list.size());
+    for (const auto& input : inputs) {
+        list.push_back(input.path);
+        stamps.push_back(input.stamp);
+    }
+    return *this;
+}
+
+SPICEBuilder& SPICEBuilder::setAtlasSheets(const std::string& listTag, const std::vector<std::string>& sheetPaths, size_t frameCount) {
+    tsimg::utils::debugLog(debug, "Packing " + std::to_string(frameCount) + " frames of " + listTag + " into " +
+                                  std::to_string(sheetPaths.size()) + " atlas sheets");
+    imagePaths[listTag] = sheetPaths;
+    imageStamps[listTag].assign(sheetPaths.size(), tsimg::pipeline::FileStamp{});
+    atlasFrameCounts[listTag] = frameCount;
+    return *this;
+}
+
+SPICEBuilder& SPICEBuilder::addImageSource(const std::string& listTag, tsimg::pipeline::PathSource source) {
+    tsimg::utils::debugLog(debug, "Queueing lazy image source for " + listTag);
+    imageSources[listTag] = std::move(source);
+    return *this;
+}
+
+SPICEBuilder& SPICEBuilder::addPixelSource(const std::string& listTag, tsimg::pipeline::PixelSource source) {
+    tsimg::utils::debugLog(debug, "Queueing pixel frame source for " + listTag);
+    pixelSources[listTag] = std::move(source);
+    return *this;
+}
+
 SPICEBuilder& SPICEBuilder::addImageToList(const std::string& listTag, const std::string& imagePath) {
     if (debug) std::cout << "Adding image to " << listTag << ": " << imagePath << std::endl;
     std::string base64Image = encodeImageToBase64(imagePath, debug);
@@ -382,7 +748,7 @@ SPICEBuilder& SPICEBuilder::addImageToList(const std::string& listTag, const std
         if (imageLists.find(listTag) == imageLists.end()) {
             imageLists[listTag] = std::make_unique<ImageList>();
         }
-        imageLists[listTag]->addImage(std::make_unique<Image>(imagePath, base64Image));
+        imageLists[listTag]->addImage(std::make_unique<Image>(imagePath, std::move(base64Image)));
         if (debug) std::cout << "Image added successfully to " << listTag << ": " << imagePath << std::endl;
     } else {
         if (debug) std::cerr << "Failed to add image to " << listTag << ": " << imagePath << std::endl;
@@ -410,10 +776,20 @@ SPICEBuilder& SPICEBuilder::addLabels(const std::vector<std::string>& labelList)
 
 SPICEBuilder& SPICEBuilder::generateLabelsFromImages() {
     if (debug) std::cout << "Generating labels from images." << std::endl;
-    for (const auto& imageList : imageLists) {
-        for (const auto& image : imageList.second->getImages()) {
+    // Os rótulos acompanham o slider, então vêm apenas da lista principal (a primeira tag)
+    auto encoded = imageLists.begin();
+    auto pending = imagePaths.begin();
+    bool useEncoded = encoded != imageLists.end() && (pending == imagePaths.end() || encoded->first <= pending->first);
+    if (useEncoded) {
+        for (const auto& image : encoded->second->getImages()) {
             labels.push_back(image->getPath());
         }
+        auto samePending = imagePaths.find(encoded->first);
+        if (samePending != imagePaths.end()) {
+            labels.insert(labels.end(), samePending->second.begin(), samePending->second.end());
+        }
+    } else if (pending != imagePaths.end()) {
+        labels.insert(labels.end(), pending->second.begin(), pending->second.end());
     }
     return *this;
 }
@@ -429,6 +805,11 @@ SPICEBuilder& SPICEBuilder::setAuthorImage(const std::string& imagePath) {
     return *this;
 }
 
+SPICEBuilder& SPICEBuilder::setAuthorImageBase64(std::string base64) {
+    authorImageBase64 = std::move(base64);
+    return *this;
+}
+
 SPICEBuilder& SPICEBuilder::setHelp(const std::string& helpText, const std::string& helpLink, const std::string& helpBadgeURL) {
     contents.push_back(SpiceContent("SPICE_HELP_TEXT", "", helpText));
     if (debug) std::cout << "Help text set successfully." << std::endl;
@@ -454,6 +835,30 @@ const std::map<std::string, std::unique_ptr<ImageList>>& SPICEBuilder::getImageL
     return imageLists;
 }
 
+const std::map<std::string, std::vector<std::string>>& SPICEBuilder::getImagePaths() const {
+    return imagePaths;
+}
+
+const std::map<std::string, tsimg::pipeline::PathSource>& SPICEBuilder::getImageSources() const {
+    return imageSources;
+}
+
+const std::map<std::string, tsimg::pipeline::PixelSource>& SPICEBuilder::getPixelSources() const {
+    return pixelSources;
+}
+
+const std::map<std::string, std::vector<tsimg::pipeline::FileStamp>>& SPICEBuilder::getImageStamps() const {
+    return imageStamps;
+}
+
+const std::map<std::string, size_t>& SPICEBuilder::getAtlasFrameCounts() const {
+    return atlasFrameCounts;
+}
+
+const tsimg::pipeline::FrameTransform& SPICEBuilder::getFrameTransform() const {
+    return frameTransform;
+}
+
 const std::vector<std::string>& SPICEBuilder::getLabels() const {
     return labels;
 }
@@ -466,10 +871,13 @@ const std::string& SPICEBuilder::getTitle() const {
     return title;
 }
 
-std::string SPICEBuilder::generateImageTags() const {
+std::string SPICEBuilder::generateImageTags(tsimg::memory::Charge& charge) const {
     std::string imageTags;
+    charge = tsimg::memory::Charge(tsimg::memory::Stage::Render, 0);
     for (const auto& imageList : imageLists) {
-        imageTags += imageList.second->generateImageTags();
+        tsimg::memory::Charge part;
+        imageTags += imageList.second->generateImageTags(part);
+        charge.resize(imageTags.size());
     }
     return imageTags;
 }
@@ -501,18 +909,27 @@ SPICEBuilder& SPICEBuilder::setTemplate(const std::string& templatePath) {
     return *this;
 }
 
+SPICEBuilder& SPICEBuilder::setFrameTransform(tsimg::pipeline::FrameTransform transform) {
+    frameTransform = std::move(transform);
+    return *this;
+}
+
 const std::string& SPICEBuilder::getTemplatePath() const {
     return templatePath;
 }
 
 TemplateWriter::TemplateWriter(const std::string& templatePath, bool debug) : debug(debug) {
-    this->templatePath = resolveTemplatePath(templatePath);
+    auto& templateCache = tsimg::utils::TemplateCache::instance();
+    this->templatePath = templateCache.enabled()
+        ? templateCache.resolve(templatePath, &TemplateWriter::resolveTemplatePath)
+        : resolveTemplatePath(templatePath);
     
     if (debug) {
         std::cout << "Resolved template path: " << this->templatePath << std::endl;
     }
 
     templateContent = tsimg::utils::getTemplateContent(this->templatePath, debug);
+    embeddedTemplate = tsimg::utils::findEmbeddedTemplate(this->templatePath);
     
     if (debug) {
         std::cout << "Using template: " << this->templatePath << std::endl;
@@ -538,77 +955,660 @@ void TemplateWriter::writeToFile(const std::string& outputFile,
             throw std::runtime_error("Image list and labels validation failed - counts must match");
         }
 
-        std::string outputContent = templateContent;
-        tsimg::utils::debugLog(debug, "Processing template content...");
-        
-        outputContent = replaceAllTags(outputContent, contents);
-        tsimg::utils::debugLog(debug, "Tags replacement completed");
-        
+        std::string outputContent = renderStaticContent(contents, labels, authorImageBase64);
+
         outputContent = replaceObjectPlaceholders(outputContent, imageLists);
         tsimg::utils::debugLog(debug, "Object placeholders replacement completed");
+        tsimg::memory::Charge rendered(tsimg::memory::Stage::Render, outputContent.size());
 
-        std::string authorImageTag = authorImageBase64.empty() ? "" : "data:image/png;base64," + authorImageBase64;
-        outputContent = replaceTag(outputContent, "<SPICE_AUTHOR_IMAGE>", authorImageTag);
+        tsimg::utils::FileHandler::writeFile(outputFile, outputContent, debug);
+        
+        tsimg::utils::debugLog(debug, "File written successfully: " + outputFile);
+        
+    } catch (const std::exception& e) {
+        tsimg::utils::errorLog(debug, "Error in writeToFile: " + std::string(e.what()));
+        throw; // Re-throw para permitir tratamento em nível superior
+    }
+}
 
-        if (authorImageTag.empty()) {
-            outputContent = replaceTag(outputContent, "<SPICE_AUTHOR_IMAGE>", "");
-        }
+void TemplateWriter::streamToFile(const std::string& outputFile, const SPICEBuilder& builder,
+                                  const tsimg::pipeline::RawFrameObserver& onRawFrame) {
+    tsimg::utils::debugLog(debug, "Starting streamed SPICE generation for: " + outputFile);
 
-        std::string labelTags;
-        for (const auto& label : labels) {
-            labelTags += "<span>" + label + "</span>";
+    const auto& contents = builder.getContents();
+    const auto& imageLists = builder.getImageLists();
+    const auto& imagePaths = builder.getImagePaths();
+    const auto& imageSources = builder.getImageSources();
+    const auto& pixelSources = builder.getPixelSources();
+    const auto& labels = builder.getLabels();
+
+    if (contents.empty()) {
+        throw std::runtime_error("No contents available to write");
+    }
+    if (imageLists.empty() && imagePaths.empty() && imageSources.empty() && pixelSources.empty()) {
+        throw std::runtime_error("No image lists available to write");
+    }
+
+    // Tags com imagens já codificadas e/ou caminhos pendentes, com a contagem total de cada uma
+    std::map<std::string, size_t> listSizes;
+    for (const auto& [tag, list] : imageLists) {
+        listSizes[tag] += list->getImages().size();
+    }
+    for (const auto& [tag, paths] : imagePaths) {
+        listSizes[tag] += paths.size();
+    }
+    std::set<std::string> lazyTags;
+    for (const auto& entry : imageSources) {
+        lazyTags.insert(entry.first);
+    }
+    for (const auto& entry : pixelSources) {
+        lazyTags.insert(entry.first);
+    }
+    for (const auto& tag : lazyTags) {
+        listSizes.emplace(tag, 0);
+    }
+    // Em atlas, os rótulos seguem os quadros exibidos e não as folhas
+    for (const auto& [tag, frames] : builder.getAtlasFrameCounts()) {
+        listSizes[tag] = frames;
+    }
+    // Listas com fonte sob demanda só têm o tamanho conhecido depois do streaming
+    for (const auto& [tag, count] : listSizes) {
+        if (!lazyTags.count(tag) && count != labels.size()) {
+            throw std::runtime_error("Image list and labels validation failed - counts must match");
         }
-        outputContent = replaceTag(outputContent, "<SPICE_LABELS>", labelTags);
+    }
 
-        std::string helpText = "";
-        std::string helpLink = "";
-        std::string helpBadgeUrl = "";
+    tsimg::pipeline::StreamOptions options;
+    options.onRawFrame = onRawFrame;
+    options.transformFrame = builder.getFrameTransform();
+    options.debug = debug;
 
-        // Procura pelos conteúdos de ajuda
-        for (const auto& content : contents) {
-            if (content.getTag() == "SPICE_HELP_TEXT") {
-                helpText = content.getVariableContent();
-            } else if (content.getTag() == "SPICE_HELP_CONTENT") {
-                helpBadgeUrl = content.getVariableContent();
-            } else if (content.getTag() == "SPICE_HELP_LINK") {
-                helpLink = content.getVariableContent();
+    std::set<std::string> tags;
+    for (const auto& entry : listSizes) {
+        tags.insert(entry.first);
+    }
+    streamDocument(outputFile, builder, renderStaticContent(contents, labels, builder.getAuthorImageBase64()), tags,
+                   0, std::string::npos, options);
+
+    tsimg::utils::debugLog(debug, "File written successfully: " + outputFile);
+}
+
+namespace {
+    // [first, last) de items, limitado ao tamanho
+    template <typename T>
+    std::vector<T> sliceOf(const std::vector<T>& items, size_t first, size_t last) {
+        first = std::min(first, items.size());
+        last = std::min(last, items.size());
+        return first < last ? std::vector<T>(items.begin() + first, items.begin() + last) : std::vector<T>();
+    }
+}
+
+void TemplateWriter::streamDocument(const std::string& outputFile, const SPICEBuilder& builder, const std::string& staticContent,
+                                    const std::set<std::string>& tags, size_t first, size_t last,
+                                    const tsimg::pipeline::StreamOptions& options) {
+    const auto& imageLists = builder.getImageLists();
+    const auto& imagePaths = builder.getImagePaths();
+    const auto& imageSources = builder.getImageSources();
+    const auto& pixelSources = builder.getPixelSources();
+    const auto& imageStamps = builder.getImageStamps();
+    const auto& labels = builder.getLabels();
+    // Fontes sob demanda não têm índice: só entram no documento com a série inteira
+    const bool wholeSeries = first == 0 && last == std::string::npos;
+
+    // Divide o template nos placeholders de imagem; cada ocorrência vira um slot do pipeline
+    std::vector<tsimg::pipeline::OutputSlot> slots;
+    std::vector<std::string> slotTags; // tag da fonte sob demanda de cada slot, se houver
+    std::set<std::string> lazyTags;
+    if (wholeSeries) {
+        for (const auto& entry : imageSources) {
+            lazyTags.insert(entry.first);
+        }
+        for (const auto& entry : pixelSources) {
+            lazyTags.insert(entry.first);
+        }
+    }
+    size_t cursor = 0;
+    for (;;) {
+        size_t bestPos = std::string::npos;
+        std::string bestTag;
+        for (const auto& tag : tags) {
+            size_t pos = staticContent.find("<" + tag + ">", cursor);
+            if (pos < bestPos) {
+                bestPos = pos;
+                bestTag = tag;
             }
         }
+        if (bestPos == std::string::npos) {
+            break;
+        }
 
-        // Cria a seção de ajuda apenas se todas as informações estiverem presentes
-        std::string helpSection = tsimg::utils::HTMLBuilder::createHelpSection(
-            helpText,
-            helpBadgeUrl,
-            helpLink
-        );
-
-        // Se não houver seção de ajuda, remove a tag completamente
-        if (helpSection.empty()) {
-            // Remove a tag e qualquer div container que a contenha
-            size_t startPos = outputContent.find("<div class=\"help-section\">");
-            if (startPos != std::string::npos) {
-                size_t endPos = outputContent.find("</div>", startPos);
-                if (endPos != std::string::npos) {
-                    endPos += 6; // comprimento de "</div>"
-                    outputContent.erase(startPos, endPos - startPos);
+        // Quadros já codificados vêm antes dos caminhos pendentes da mesma tag
+        tsimg::pipeline::OutputSlot slot;
+        slot.text = staticContent.substr(cursor, bestPos - cursor);
+        size_t encodedCount = 0;
+        auto encoded = imageLists.find(bestTag);
+        if (encoded != imageLists.end()) {
+            const auto& images = encoded->second->getImages();
+            encodedCount = images.size();
+            if (wholeSeries) {
+                tsimg::memory::Charge tags;
+                slot.text += encoded->second->generateImageTags(tags);
+            } else {
+                for (size_t i = first; i < std::min(last, encodedCount); ++i) {
+                    tsimg::utils::HTMLBuilder::appendImageTag(slot.text, images[i]->getBase64(), images[i]->getPath());
                 }
             }
-            outputContent = replaceTag(outputContent, "<SPICE_HELP_SECTION>", "");
-        } else {
-            outputContent = replaceTag(outputContent, "<SPICE_HELP_SECTION>", helpSection);
         }
+        auto pending = imagePaths.find(bestTag);
+        if (pending != imagePaths.end()) {
+            const size_t pathFirst = first > encodedCount ? first - encodedCount : 0;
+            const size_t pathLast = last > encodedCount ? last - encodedCount : 0;
+            slot.framePaths = sliceOf(pending->second, pathFirst, pathLast);
+            auto stamps = imageStamps.find(bestTag);
+            if (stamps != imageStamps.end()) {
+                slot.frameStamps = sliceOf(stamps->second, pathFirst, pathLast);
+            }
+        }
+        if (wholeSeries) {
+            auto source = imageSources.find(bestTag);
+            if (source != imageSources.end()) {
+                slot.nextPath = source->second;
+            }
+            auto pixels = pixelSources.find(bestTag);
+            if (pixels != pixelSources.end()) {
+                slot.nextPixels = pixels->second;
+            }
+        }
+        slotTags.push_back(lazyTags.count(bestTag) ? bestTag : std::string());
+        slots.push_back(std::move(slot));
+        cursor = bestPos + bestTag.size() + 2;
+    }
+    std::string trailer = staticContent.substr(cursor);
 
-        // Adicionar substituição do SPICE_BUILDING_INFO
-        outputContent = replaceTag(outputContent, "<SPICE_BUILDING_INFO>", generateBuildInfo());
+    size_t renderedBytes = staticContent.size() + trailer.size();
+    for (const auto& slot : slots) {
+        renderedBytes += slot.text.size();
+    }
+    tsimg::memory::Charge rendered(tsimg::memory::Stage::Render, renderedBytes);
 
-        tsimg::utils::FileHandler::writeFile(outputFile, outputContent, debug);
-        
-        tsimg::utils::debugLog(debug, "File written successfully: " + outputFile);
-        
+    try {
+        auto out = tsimg::utils::FileHandler::openOutputStream(outputFile, debug);
+        auto slotFrames = tsimg::pipeline::streamSpice(*out, slots, trailer, options);
+
+        for (const auto& tag : lazyTags) {
+            auto encoded = imageLists.find(tag);
+            size_t count = encoded != imageLists.end() ? encoded->second->getImages().size() : 0;
+            for (size_t i = 0; i < slots.size(); ++i) {
+                if (slotTags[i] == tag) count += slotFrames[i];
+            }
+            if (count != labels.size()) {
+                throw std::runtime_error("Image list and labels validation failed - " + tag + " has " +
+                                         std::to_string(count) + " images for " + std::to_string(labels.size()) + " labels");
+            }
+        }
     } catch (const std::exception& e) {
-        tsimg::utils::errorLog(debug, "Error in writeToFile: " + std::string(e.what()));
-        throw; // Re-throw para permitir tratamento em nível superior
+        tsimg::utils::errorLog(debug, "Error in streamToFile: " + std::string(e.what()));
+        // O que já foi para o stdout não pode ser desfeito; o código de saída sinaliza a falha
+        if (!tsimg::utils::FileHandler::isStdStream(outputFile)) {
+            std::error_code ec;
+            std::filesystem::remove(outputFile, ec);
+        }
+        throw;
+    }
+}
+
+namespace {
+    // Barra de navegação de uma página de saída fatiada; prev e next vazios omitem o link
+    std::string pageNavigation(const std::string& index, const std::string& prev, const std::string& next, size_t page, size_t pages) {
+        const std::string linkStyle = " style=\"color:#fff\"";
+        std::string nav = "<nav class=\"spice-pages\" style=\"position:fixed;top:0;right:0;z-index:1000;padding:4px 10px;"
+                          "background:rgba(0,0,0,.65);color:#fff;font:13px sans-serif\">";
+        if (!prev.empty()) {
+            nav += "<a rel=\"prev\" href=\"" + prev + "\"" + linkStyle + ">&larr; Previous</a> | ";
+        }
+        nav += "<a href=\"" + index + "\"" + linkStyle + ">Page " + std::to_string(page) + " of " + std::to_string(pages) + "</a>";
+        if (!next.empty()) {
+            nav += " | <a rel=\"next\" href=\"" + next + "\"" + linkStyle + ">Next &rarr;</a>";
+        }
+        return nav + "</nav>";
+    }
+
+    // Antes do último </body>, ou no fim quando o template não tem um
+    std::string insertBeforeBodyEnd(std::string html, const std::string& fragment) {
+        size_t pos = html.rfind("</body>");
+        html.insert(pos == std::string::npos ? html.size() : pos, fragment);
+        return html;
+    }
+
+    size_t countOccurrences(const std::string& text, const std::string& needle) {
+        size_t count = 0;
+        for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + needle.size())) {
+            ++count;
+        }
+        return count;
+    }
+}
+
+std::vector<ShardPage> TemplateWriter::planShards(const std::string& outputFile, const SPICEBuilder& builder, uintmax_t maxPageBytes) {
+    const auto& contents = builder.getContents();
+    const auto& imageLists = builder.getImageLists();
+    const auto& imagePaths = builder.getImagePaths();
+    const auto& imageStamps = builder.getImageStamps();
+    const auto& labels = builder.getLabels();
+
+    if (tsimg::utils::FileHandler::isStdStream(outputFile)) {
+        throw std::runtime_error("Sharded SPICE output needs an output file, not stdout");
+    }
+    if (!builder.getImageSources().empty() || !builder.getPixelSources().empty()) {
+        throw std::runtime_error("Frames read on demand cannot be split into pages; their sizes are not known in advance");
+    }
+    if (!builder.getAtlasFrameCounts().empty()) {
+        throw std::runtime_error("Atlas sheets cannot be split into pages");
+    }
+    if (contents.empty()) {
+        throw std::runtime_error("No contents available to write");
+    }
+    if (imageLists.empty() && imagePaths.empty()) {
+        throw std::runtime_error("No image lists available to write");
+    }
+
+    std::map<std::string, size_t> listSizes;
+    for (const auto& [tag, list] : imageLists) {
+        listSizes[tag] += list->getImages().size();
+    }
+    for (const auto& [tag, paths] : imagePaths) {
+        listSizes[tag] += paths.size();
+    }
+    for (const auto& [tag, count] : listSizes) {
+        if (count != labels.size()) {
+            throw std::runtime_error("Image list and labels validation failed - counts must match");
+        }
+    }
+    const size_t frames = labels.size();
+    if (frames == 0) {
+        throw std::runtime_error("No frames to split into pages");
+    }
+
+    // Bytes de cada quadro em todas as ocorrências das listas no template, com o seu rótulo; o resto
+    // do layout e a navegação (pelo maior tamanho possível) se repetem em todas as páginas
+    const std::string layout = renderLayout(contents, builder.getAuthorImageBase64());
+    const std::string labelsPlaceholder = "<SPICE_LABELS>";
+    const size_t labelOccurrences = countOccurrences(layout, labelsPlaceholder);
+    uintmax_t fixedBytes = layout.size() - labelOccurrences * labelsPlaceholder.size();
+    std::vector<uintmax_t> frameBytes(frames, 0);
+    for (size_t i = 0; i < frames; ++i) {
+        frameBytes[i] = labelOccurrences * tsimg::utils::HTMLBuilder::createLabelTags({labels[i]}).size();
+    }
+    for (const auto& [tag, count] : listSizes) {
+        const size_t occurrences = countOccurrences(layout, "<" + tag + ">");
+        if (occurrences == 0) {
+            continue;
+        }
+        fixedBytes -= occurrences * (tag.size() + 2);
+        size_t encodedCount = 0;
+        auto encoded = imageLists.find(tag);
+        if (encoded != imageLists.end()) {
+            const auto& images = encoded->second->getImages();
+            encodedCount = images.size();
+            for (size_t i = 0; i < encodedCount; ++i) {
+                frameBytes[i] += occurrences * tsimg::utils::HTMLBuilder::imageTagSize(images[i]->getBase64().size(), images[i]->getPath().size());
+            }
+        }
+        auto pending = imagePaths.find(tag);
+        if (pending != imagePaths.end()) {
+            auto stamps = imageStamps.find(tag);
+            for (size_t j = 0; j < pending->second.size(); ++j) {
+                const std::string& path = pending->second[j];
+                // Com a reotimização de PNG o quadro só diminui, então o tamanho do arquivo é um teto
+                tsimg::pipeline::FileStamp stamp;
+                if (stamps != imageStamps.end() && j < stamps->second.size()) stamp = stamps->second[j];
+                if (!stamp.valid) stamp = tsimg::pipeline::stampFile(path);
+                frameBytes[encodedCount + j] += occurrences * tsimg::utils::HTMLBuilder::imageTagSize(
+                    tsimg::utils::Base64::encodedSize(static_cast<size_t>(stamp.size)), path.size());
+            }
+        }
     }
+
+    const std::filesystem::path outputPath(outputFile);
+    const std::string extension = outputPath.has_extension() ? outputPath.extension().string() : ".html";
+    auto pageName = [&outputPath, &extension](size_t page, size_t width) {
+        std::string number = std::to_string(page);
+        number.insert(0, width > number.size() ? width - number.size() : 0, '0');
+        return outputPath.stem().string() + "-" + number + extension;
+    };
+    const std::string indexName = outputPath.filename().string();
+    const size_t maxWidth = std::max<size_t>(3, std::to_string(frames).size());
+    fixedBytes += pageNavigation(indexName, pageName(frames, maxWidth), pageName(frames, maxWidth), frames, frames).size();
+
+    // Corte guloso: cada página leva quadros enquanto couber no orçamento, e ao menos um
+    std::vector<ShardPage> pages;
+    size_t pageFirst = 0;
+    uintmax_t pageBytes = fixedBytes;
+    for (size_t i = 0; i < frames; ++i) {
+        if (i > pageFirst && pageBytes + frameBytes[i] > maxPageBytes) {
+            pages.push_back({std::string(), pageFirst, i, pageBytes});
+            pageFirst = i;
+            pageBytes = fixedBytes;
+        }
+        pageBytes += frameBytes[i];
+        if (i == pageFirst && pageBytes > maxPageBytes) {
+            tsimg::utils::debugLog(debug, "Frame " + std::to_string(i + 1) + " alone exceeds the page budget (" +
+                                   std::to_string(pageBytes) + " bytes)");
+        }
+    }
+    pages.push_back({std::string(), pageFirst, frames, pageBytes});
+
+    const size_t width = std::max<size_t>(3, std::to_string(pages.size()).size());
+    for (size_t page = 0; page < pages.size(); ++page) {
+        pages[page].file = (outputPath.parent_path() / pageName(page + 1, width)).string();
+    }
+    return pages;
+}
+
+std::vector<std::string> TemplateWriter::streamShards(const std::string& outputFile, const SPICEBuilder& builder, uintmax_t maxPageBytes,
+                                                      const tsimg::pipeline::RawFrameObserver& onRawFrame) {
+    tsimg::utils::debugLog(debug, "Starting sharded SPICE generation for: " + outputFile);
+
+    const std::vector<ShardPage> pages = planShards(outputFile, builder, maxPageBytes);
+    const auto& labels = builder.getLabels();
+    const size_t frames = labels.size();
+    const std::string layout = renderLayout(builder.getContents(), builder.getAuthorImageBase64());
+    const std::string labelsPlaceholder = "<SPICE_LABELS>";
+    const std::string indexName = std::filesystem::path(outputFile).filename().string();
+    std::set<std::string> tags;
+    for (const auto& [tag, list] : builder.getImageLists()) tags.insert(tag);
+    for (const auto& [tag, paths] : builder.getImagePaths()) tags.insert(tag);
+
+    std::vector<std::string> names;
+    std::vector<std::string> pageFiles;
+    for (const auto& page : pages) {
+        names.push_back(std::filesystem::path(page.file).filename().string());
+        pageFiles.push_back(page.file);
+    }
+    tsimg::utils::debugLog(debug, "Splitting " + std::to_string(frames) + " frames into " + std::to_string(pages.size()) +
+                           " pages of at most " + std::to_string(maxPageBytes) + " bytes");
+
+    // Páginas em paralelo, cada uma com a sua parte dos codificadores
+    constexpr size_t kMaxConcurrentPages = 4;
+    const unsigned concurrentPages = static_cast<unsigned>(std::min(pages.size(), kMaxConcurrentPages));
+    tsimg::pipeline::StreamOptions options;
+    options.encoderThreads = std::max(1u, std::thread::hardware_concurrency() / concurrentPages);
+    options.onRawFrame = onRawFrame;
+    options.transformFrame = builder.getFrameTransform();
+    options.debug = debug;
+
+    try {
+        tsimg::pipeline::parallelFor(pages.size(), concurrentPages, [&](size_t page) {
+            const size_t first = pages[page].first, last = pages[page].last;
+            std::vector<std::string> pageLabels(labels.begin() + first, labels.begin() + last);
+            std::string staticContent = replaceTag(layout, labelsPlaceholder, tsimg::utils::HTMLBuilder::createLabelTags(pageLabels));
+            staticContent = insertBeforeBodyEnd(std::move(staticContent),
+                                                pageNavigation(indexName, page > 0 ? names[page - 1] : "",
+                                                               page + 1 < names.size() ? names[page + 1] : "", page + 1, names.size()));
+            streamDocument(pageFiles[page], builder, staticContent, tags, first, last, options);
+            tsimg::utils::debugLog(debug, "Page written: " + pageFiles[page] + " (frames " + std::to_string(first + 1) + "-" +
+                                   std::to_string(last) + ")");
+        });
+
+        std::ostringstream index;
+        index << "<!DOCTYPE html>\n<html lang=\"en\">\n<head>\n<meta charset=\"UTF-8\">\n"
+              << "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
+              << "<title>" << builder.getTitle() << "</title>\n"
+              << "<style>body{font-family:sans-serif;margin:2rem}li{margin:.4rem 0}</style>\n</head>\n<body>\n"
+              << "<h1>" << builder.getTitle() << "</h1>\n"
+              << "<p>" << frames << " frames in " << pages.size() << " pages</p>\n<ol>\n";
+        for (size_t page = 0; page < pages.size(); ++page) {
+            const size_t first = pages[page].first, last = pages[page].last;
+            index << "<li><a href=\"" << names[page] << "\">" << labels[first];
+            if (last - first > 1) index << " &ndash; " << labels[last - 1];
+            index << "</a> (" << (last - first) << (last - first == 1 ? " frame" : " frames") << ")</li>\n";
+        }
+        index << "</ol>\n</body>\n</html>\n";
+        tsimg::utils::FileHandler::writeFile(outputFile, index.str(), debug);
+    } catch (...) {
+        // Uma série pela metade não serve de nada: remove as páginas que chegaram a ser escritas
+        for (const auto& file : pageFiles) {
+            std::error_code ec;
+            std::filesystem::remove(file, ec);
+        }
+        throw;
+    }
+
+    tsimg::utils::debugLog(debug, "Index written: " + outputFile);
+    return pageFiles;
+}
+
+uintmax_t TemplateWriter::streamedSize(const SPICEBuilder& builder, const std::function<uintmax_t(const std::string& tag)>& pendingTagBytes) {
+    if (!builder.getImageSources().empty() || !builder.getPixelSources().empty()) {
+        throw std::runtime_error("The output size of an on-demand image source is not known in advance");
+    }
+    // Mesma divisão e mesma validação do streamToFile: cada ocorrência de um placeholder recebe a
+    // lista inteira
+    std::map<std::string, uintmax_t> listBytes;
+    std::map<std::string, size_t> listSizes;
+    for (const auto& [tag, list] : builder.getImageLists()) {
+        listBytes[tag] += list->imageTagsSize();
+        listSizes[tag] += list->getImages().size();
+    }
+    for (const auto& [tag, paths] : builder.getImagePaths()) {
+        listBytes[tag] += pendingTagBytes(tag);
+        listSizes[tag] += paths.size();
+    }
+    for (const auto& [tag, count] : listSizes) {
+        if (count != builder.getLabels().size()) {
+            throw std::runtime_error("Image list and labels validation failed - counts must match");
+        }
+    }
+
+    std::string staticContent = renderStaticContent(builder.getContents(), builder.getLabels(), builder.getAuthorImageBase64());
+    uintmax_t total = staticContent.size();
+    for (const auto& [tag, bytes] : listBytes) {
+        const std::string placeholder = "<" + tag + ">";
+        for (size_t pos = staticContent.find(placeholder); pos != std::string::npos; pos = staticContent.find(placeholder, pos + placeholder.size())) {
+            total = total - placeholder.size() + bytes;
+        }
+    }
+    return total;
+}
+
+void TemplateWriter::streamFromContainer(const std::string& outputFile, const SPICEBuilder& builder, const tsimg::container::Reader& reader) {
+    tsimg::utils::debugLog(debug, "Writing SPICE from container to: " + outputFile);
+
+    const auto lists = reader.metadata().value("lists", std::vector<std::string>{});
+    const auto& entries = reader.entries();
+    std::string staticContent = renderStaticContent(builder.getContents(), builder.getLabels(), builder.getAuthorImageBase64());
+
+    auto out = tsimg::utils::FileHandler::openOutputStream(outputFile, debug);
+    try {
+        size_t cursor = 0;
+        size_t frames = 0;
+        for (;;) {
+            size_t bestPos = std::string::npos;
+            size_t bestList = 0;
+            for (size_t list = 0; list < lists.size(); ++list) {
+                size_t pos = staticContent.find("<" + lists[list] + ">", cursor);
+                if (pos < bestPos) {
+                    bestPos = pos;
+                    bestList = list;
+                }
+            }
+            if (bestPos == std::string::npos) {
+                break;
+            }
+            out->write(staticContent.data() + cursor, static_cast<std::streamsize>(bestPos - cursor));
+            // Os quadros saem do mapeamento direto para a tag; só uma tag fica em memória por vez
+            for (size_t i = 0; i < entries.size(); ++i) {
+                if (entries[i].list != bestList) continue;
+                auto blob = reader.frame(i);
+                std::string tag = tsimg::utils::HTMLBuilder::encodeImageTag(reinterpret_cast<const unsigned char*>(blob.data()), blob.size(), reader.frameName(i));
+                tsimg::memory::Charge charge(tsimg::memory::Stage::Encode, tag.size());
+                out->write(tag.data(), static_cast<std::streamsize>(tag.size()));
+                ++frames;
+            }
+            cursor = bestPos + lists[bestList].size() + 2;
+        }
+        out->write(staticContent.data() + cursor, static_cast<std::streamsize>(staticContent.size() - cursor));
+        out->flush();
+        if (!*out) {
+            throw std::runtime_error("Error writing file: " + outputFile);
+        }
+        tsimg::utils::debugLog(debug, "SPICE written with " + std::to_string(frames) + " frames from container");
+    } catch (...) {
+        out.reset();
+        if (!tsimg::utils::FileHandler::isStdStream(outputFile)) {
+            std::error_code ec;
+            std::filesystem::remove(outputFile, ec);
+        }
+        throw;
+    }
+}
+
+std::string TemplateWriter::renderStaticContent(const std::vector<SpiceContent>& contents,
+                                                const std::vector<std::string>& labels,
+                                                const std::string& authorImageBase64) {
+    std::string labelTags;
+    for (const auto& label : labels) {
+        labelTags += "<span>" + label + "</span>";
+    }
+    return replaceTag(renderLayout(contents, authorImageBase64), "<SPICE_LABELS>", labelTags);
+}
+
+std::string TemplateWriter::renderLayout(const SPICEBuilder& builder) {
+    return renderLayout(builder.getContents(), builder.getAuthorImageBase64());
+}
+
+std::string TemplateWriter::renderLayout(const std::vector<SpiceContent>& contents, const std::string& authorImageBase64) {
+    if (embeddedTemplate) {
+        return renderEmbeddedLayout(contents, authorImageBase64);
+    }
+
+    std::string outputContent = templateContent;
+    tsimg::utils::debugLog(debug, "Processing template content...");
+
+    outputContent = replaceAllTags(outputContent, contents);
+    tsimg::utils::debugLog(debug, "Tags replacement completed");
+
+    std::string authorImageTag = authorImageBase64.empty() ? "" : "data:image/png;base64," + authorImageBase64;
+    outputContent = replaceTag(outputContent, "<SPICE_AUTHOR_IMAGE>", authorImageTag);
+
+    std::string helpText = "";
+    std::string helpLink = "";
+    std::string helpBadgeUrl = "";
+
+    // Procura pelos conteúdos de ajuda
+    for (const auto& content : contents) {
+        if (content.getTag() == "SPICE_HELP_TEXT") {
+            helpText = content.getVariableContent();
+        } else if (content.getTag() == "SPICE_HELP_CONTENT") {
+            helpBadgeUrl = content.getVariableContent();
+        } else if (content.getTag() == "SPICE_HELP_LINK") {
+            helpLink = content.getVariableContent();
+        }
+    }
+
+    // Cria a seção de ajuda apenas se todas as informações estiverem presentes
+    std::string helpSection = tsimg::utils::HTMLBuilder::createHelpSection(
+        helpText,
+        helpBadgeUrl,
+        helpLink
+    );
+
+    // Se não houver seção de ajuda, remove a tag completamente
+    if (helpSection.empty()) {
+        // Remove a tag e qualquer div container que a contenha
+        size_t startPos = outputContent.find("<div class=\"help-section\">");
+        if (startPos != std::string::npos) {
+            size_t endPos = outputContent.find("</div>", startPos);
+            if (endPos != std::string::npos) {
+                endPos += 6; // comprimento de "</div>"
+                outputContent.erase(startPos, endPos - startPos);
+            }
+        }
+        outputContent = replaceTag(outputContent, "<SPICE_HELP_SECTION>", "");
+    } else {
+        outputContent = replaceTag(outputContent, "<SPICE_HELP_SECTION>", helpSection);
+    }
+
+    // Adicionar substituição do SPICE_BUILDING_INFO
+    outputContent = replaceTag(outputContent, "<SPICE_BUILDING_INFO>", generateBuildInfo());
+
+    return outputContent;
+}
+
+// Mesmo resultado de renderLayout, mas em uma única passada guiada pela tabela de placeholders
+// gerada em tempo de compilação: o template não é copiado nem varrido a cada substituição.
+std::string TemplateWriter::renderEmbeddedLayout(const std::vector<SpiceContent>& contents, const std::string& authorImageBase64) {
+    tsimg::utils::debugLog(debug, "Processing embedded template: " + std::string(embeddedTemplate->name));
+
+    std::string helpText;
+    std::string helpLink;
+    std::string helpBadgeUrl;
+    for (const auto& content : contents) {
+        if (content.getTag() == "SPICE_HELP_TEXT") {
+            helpText = content.getVariableContent();
+        } else if (content.getTag() == "SPICE_HELP_CONTENT") {
+            helpBadgeUrl = content.getVariableContent();
+        } else if (content.getTag() == "SPICE_HELP_LINK") {
+            helpLink = content.getVariableContent();
+        }
+    }
+    std::string helpSection = tsimg::utils::HTMLBuilder::createHelpSection(helpText, helpBadgeUrl, helpLink);
+    std::string authorImageTag = authorImageBase64.empty() ? "" : "data:image/png;base64," + authorImageBase64;
+
+    // Como em renderLayout, o primeiro conteúdo com a tag vence; tags sem conteúdo
+    // (<SPICE_LABELS> e as de imagem) ficam intactas
+    auto replacementFor = [&](std::string_view tag) -> const std::string* {
+        for (const auto& content : contents) {
+            const auto& contentTag = content.getTag();
+            if (tag.size() == contentTag.size() + 2 && tag.substr(1, contentTag.size()) == contentTag) {
+                return &content.getVariableContent();
+            }
+        }
+        if (tag == "<SPICE_AUTHOR_IMAGE>") return &authorImageTag;
+        if (tag == "<SPICE_HELP_SECTION>") return &helpSection;
+        return nullptr;
+    };
+
+    std::string_view source = embeddedTemplate->content;
+    std::vector<const std::string*> replacements(embeddedTemplate->placeholderCount);
+    std::string buildInfo;
+    size_t outputSize = source.size();
+    for (size_t i = 0; i < embeddedTemplate->placeholderCount; ++i) {
+        std::string_view tag = embeddedTemplate->placeholders[i].tag;
+        if (tag == "<SPICE_BUILDING_INFO>") {
+            if (buildInfo.empty()) buildInfo = generateBuildInfo();
+            replacements[i] = &buildInfo;
+        } else {
+            replacements[i] = replacementFor(tag);
+        }
+        if (replacements[i]) {
+            outputSize = outputSize - tag.size() + replacements[i]->size();
+        }
+    }
+
+    std::string outputContent;
+    outputContent.reserve(outputSize);
+    tsimg::memory::Charge charge(tsimg::memory::Stage::Render, outputSize);
+    size_t pos = 0;
+    for (size_t i = 0; i < embeddedTemplate->placeholderCount; ++i) {
+        if (!replacements[i]) continue;
+        const auto& placeholder = embeddedTemplate->placeholders[i];
+        outputContent.append(source, pos, placeholder.offset - pos);
+        outputContent += *replacements[i];
+        pos = placeholder.offset + placeholder.tag.size();
+    }
+    outputContent.append(source, pos, std::string_view::npos);
+
+    if (helpSection.empty()) {
+        size_t startPos = outputContent.find("<div class=\"help-section\">");
+        if (startPos != std::string::npos) {
+            size_t endPos = outputContent.find("</div>", startPos);
+            if (endPos != std::string::npos) {
+                outputContent.erase(startPos, endPos + 6 - startPos);
+            }
+        }
+    }
+    return outputContent;
 }
 
 void TemplateWriter::build(const SPICEBuilder& builder, const std::string& outputFile) {
@@ -647,6 +1647,7 @@ std::string TemplateWriter::replaceTag(const std::string& source, const std::str
         }
 
         std::string result = source;
+        tsimg::memory::Charge copy(tsimg::memory::Stage::Render, result.size()); // cópia temporária do documento
         size_t pos = result.find(tag);
         
         if (pos == std::string::npos) {
@@ -689,21 +1690,16 @@ std::string TemplateWriter::replaceObjectPlaceholders(const std::string& source,
     std::string result = source;
     for (const auto& [tag, imageList] : imageLists) {
         std::string placeholder = "<" + tag + ">";
-        std::string replacement = imageList->generateImageTags();
+        tsimg::memory::Charge charge;
+        std::string replacement = imageList->generateImageTags(charge);
         result = replaceTag(result, placeholder, replacement);
     }
     return result;
 }
 
 std::string TemplateWriter::buildHtmlStructure(const SPICEBuilder& builder) {
-    std::ifstream file(templatePath);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open template file: " + templatePath);
-    }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string htmlContent = buffer.str();
+    // O conteúdo já foi carregado no construtor (do disco ou do binário)
+    std::string htmlContent = templateContent;
 
     // Gera o bloco HTML para cada lista de imagens e substitui <SPICE_SLIDER_LISTS>
     const auto& imageLists = builder.getImageLists();
@@ -754,7 +1750,8 @@ std::string TemplateWriter::buildHtmlStructure(const SPICEBuilder& builder) {
     for (const auto& [tag, list] : imageLists) {
         std::string placeholder = "<" + tag + ">";
         if (htmlContent.find(placeholder) != std::string::npos) {
-            std::string imageContent = list->generateImageTags();
+            tsimg::memory::Charge charge;
+            std::string imageContent = list->generateImageTags(charge);
             htmlContent = replaceTag(htmlContent, placeholder, imageContent);
         }
     }
@@ -772,15 +1769,43 @@ std::string TemplateWriter::buildHtmlStructure(const SPICEBuilder& builder) {
     return htmlContent;
 }
 
+namespace {
+    // "embedded:<nome>" se houver um template embutido com esse nome, senão vazio
+    std::string embeddedTemplatePath(const std::string& name) {
+        std::string path = std::string(tsimg::utils::kEmbeddedTemplatePrefix) + name;
+        return tsimg::utils::findEmbeddedTemplate(path) ? path : "";
+    }
+}
+
 std::string TemplateWriter::getDefaultTemplatePath() {
-    std::filesystem::path defaultPath = std::filesystem::current_path() / "templates" / "base_template.html";
-    return defaultPath.string();
+    // Uma cópia em templates/ tem precedência; sem ela, usa a embutida no binário
+    std::string name(tsimg::embedded::kDefaultTemplate);
+    std::error_code ec;
+    std::filesystem::path defaultPath = std::filesystem::current_path() / "templates" / (name + ".html");
+    if (std::filesystem::exists(defaultPath, ec)) {
+        return defaultPath.string();
+    }
+    return embeddedTemplatePath(name);
 }
 
 // Adicionar nova função para resolver o caminho do template
 std::string TemplateWriter::resolveTemplatePath(const std::string& templateName) {
-    // Se o caminho já for completo ou relativo com extensão .html
+    if (templateName.empty()) {
+        return getDefaultTemplatePath();
+    }
+
+    std::error_code ec;
+
+    // Se o caminho já for completo ou relativo com extensão .html; arquivos no disco têm
+    // precedência, e um nome solto de template embutido (ex.: "template_vs.html") cai no binário
     if (templateName.find(".html") != std::string::npos) {
+        std::filesystem::path namePath(templateName);
+        if (!namePath.has_parent_path() && !std::filesystem::exists(namePath, ec)) {
+            std::string embedded = embeddedTemplatePath(namePath.stem().string());
+            if (!embedded.empty()) {
+                return embedded;
+            }
+        }
         return templateName;
     }
 
@@ -788,10 +1813,15 @@ std::string TemplateWriter::resolveTemplatePath(const std::string& templateName)
     std::filesystem::path templatesPath = std::filesystem::current_path() / "templates";
     std::filesystem::path templatePath = templatesPath / (templateName + ".html");
 
-    if (std::filesystem::exists(templatePath)) {
+    if (std::filesystem::exists(templatePath, ec)) {
         return templatePath.string();
     }
 
+    std::string embedded = embeddedTemplatePath(templateName);
+    if (!embedded.empty()) {
+        return embedded;
+    }
+
     // Se não encontrar, retorna o template padrão
     return getDefaultTemplatePath();
 }
@@ -1,28 +1,57 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
+#include <set>
 #include <future>
 #include <thread>
 #include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include <filesystem>
+#include <cstdint>
+#include <ostream>
+#include "tsimg_pipeline.h"
+#include "tsimg_inputs.h"
+#include "tsimg_memory.h"
 
+namespace tsimg::embedded {
+    struct Template;
+}
+
+namespace tsimg::container {
+    class Reader;
+}
+
+// O payload Base64 é movido para dentro e compartilhado por contagem de referências; os
+// acessores devolvem referências/views, nunca cópias.
 class Image {
 public:
-    Image(const std::string& path, const std::string& base64);
-    std::string getPath() const;
-    std::string getBase64() const;
+    Image(std::string path, std::string base64);
+    const std::string& getPath() const;
+    std::string_view getBase64() const;
+    std::shared_ptr<const std::string> shareBase64() const;
 
 private:
     std::string path;
-    std::string base64;
+    std::shared_ptr<const std::string> base64;
+    tsimg::memory::Charge charge;
 };
 
 class ImageList {
 public:
     void addImage(std::unique_ptr<Image> image);
     std::vector<std::unique_ptr<Image>>& getImages();
-    std::string generateImageTags() const;
+    // Tags <img> da lista; charge passa a contar o texto na etapa de renderização e deve viver
+    // tanto quanto ele no chamador
+    std::string generateImageTags(tsimg::memory::Charge& charge) const;
+    // Tamanho exato de generateImageTags, sem montar o texto
+    size_t imageTagsSize() const;
 
 private:
     std::vector<std::unique_ptr<Image>> images;
@@ -30,10 +59,10 @@ private:
 
 class SpiceContent {
 public:
-    SpiceContent(const std::string& tag, const std::string& baseHtml, const std::string& variableContent);
-    std::string getTag() const;
-    std::string getBaseHtml() const;
-    std::string getVariableContent() const;
+    SpiceContent(std::string tag, std::string baseHtml, std::string variableContent);
+    const std::string& getTag() const;
+    const std::string& getBaseHtml() const;
+    const std::string& getVariableContent() const;
 
 private:
     std::string tag;
@@ -51,18 +80,35 @@ public:
     SPICEBuilder& addLabels(const std::vector<std::string>& labelList);
     SPICEBuilder& generateLabelsFromImages();
     SPICEBuilder& setAuthorImage(const std::string& imagePath);
+    SPICEBuilder& setAuthorImageBase64(std::string base64);
     SPICEBuilder& setHelp(const std::string& helpText, const std::string& helpLink, const std::string& helpBadgeURL);
     SPICEBuilder& addTitle(const std::string& title);
     SPICEBuilder& addImagesAsync(const std::vector<std::string>& imagePaths);
+    SPICEBuilder& addImagePaths(const std::string& listTag, const std::vector<std::string>& imagePaths);
+    SPICEBuilder& addImageInputs(const std::string& listTag, const std::vector<tsimg::inputs::ImageInput>& inputs);
+    SPICEBuilder& addImageSource(const std::string& listTag, tsimg::pipeline::PathSource source);
+    // Quadros em pixels, sem arquivo (ex.: --raw-frames); codificados em PNG durante streamToFile
+    SPICEBuilder& addPixelSource(const std::string& listTag, tsimg::pipeline::PixelSource source);
+    // Troca os quadros da lista pelas folhas de um atlas (tsimg::atlas); frameCount continua
+    // sendo o número de quadros exibidos, que é o que os rótulos precisam acompanhar
+    SPICEBuilder& setAtlasSheets(const std::string& listTag, const std::vector<std::string>& sheetPaths, size_t frameCount);
     SPICEBuilder& setTemplate(const std::string& templatePath);
+    // Aplicada aos bytes de cada quadro lido durante streamToFile, antes da codificação Base64
+    SPICEBuilder& setFrameTransform(tsimg::pipeline::FrameTransform transform);
     const std::vector<SpiceContent>& getContents() const;
     const std::map<std::string, std::unique_ptr<ImageList>>& getImageLists() const;
+    const std::map<std::string, std::vector<std::string>>& getImagePaths() const;
+    const std::map<std::string, tsimg::pipeline::PathSource>& getImageSources() const;
+    const std::map<std::string, tsimg::pipeline::PixelSource>& getPixelSources() const;
+    const std::map<std::string, std::vector<tsimg::pipeline::FileStamp>>& getImageStamps() const;
+    const std::map<std::string, size_t>& getAtlasFrameCounts() const;
+    const tsimg::pipeline::FrameTransform& getFrameTransform() const;
     const std::vector<std::string>& getLabels() const;
     const std::string& getAuthorImageBase64() const;
     const std::string& getTitle() const;
     const std::string& getTemplatePath() const;
     std::string getImageTags() const;
-    std::string generateImageTags() const;
+    std::string generateImageTags(tsimg::memory::Charge& charge) const;
     std::string generateLabelTags() const;
     void debugPrint() const;
     bool hasAdditionalImages() const;
@@ -72,6 +118,17 @@ private:
     bool debug;
     std::vector<SpiceContent> contents;
     std::map<std::string, std::unique_ptr<ImageList>> imageLists;
+    // Caminhos ainda não codificados; são lidos e codificados durante streamToFile
+    std::map<std::string, std::vector<std::string>> imagePaths;
+    // Metadados de imagePaths coletados na validação (inválidos quando o caminho veio sem eles)
+    std::map<std::string, std::vector<tsimg::pipeline::FileStamp>> imageStamps;
+    // Fontes sob demanda (ex.: stdin) consumidas uma única vez, depois dos caminhos da mesma tag
+    std::map<std::string, tsimg::pipeline::PathSource> imageSources;
+    // Fontes de pixels, consumidas uma única vez depois das fontes de caminhos da mesma tag
+    std::map<std::string, tsimg::pipeline::PixelSource> pixelSources;
+    // Listas empacotadas em atlas: quadros exibidos por tag (imagePaths guarda as folhas)
+    std::map<std::string, size_t> atlasFrameCounts;
+    tsimg::pipeline::FrameTransform frameTransform;
     std::vector<std::string> labels;
     std::string authorImageBase64;
     std::string templatePath;
@@ -93,6 +150,15 @@ private:
     std::string authorImageBase64;
 };
 
+// Uma página de TemplateWriter::streamShards: os quadros [first, last) e os bytes dela, contados
+// com a barra de navegação mais longa (um teto de poucos bytes)
+struct ShardPage {
+    std::string file;
+    size_t first = 0;
+    size_t last = 0;
+    uintmax_t bytes = 0;
+};
+
 class TemplateWriter {
 public:
     TemplateWriter(const std::string& templatePath, bool debug);
@@ -104,6 +170,27 @@ public:
                      const std::vector<std::string>& labels, 
                      const std::string& authorImageBase64);
     void build(const SPICEBuilder& builder, const std::string& outputFile);
+    // onRawFrame recebe os bytes lidos de cada quadro, para outra saída não precisar relê-los
+    void streamToFile(const std::string& outputFile, const SPICEBuilder& builder,
+                      const tsimg::pipeline::RawFrameObserver& onRawFrame = {});
+    // Divide a série em páginas de até maxPageBytes (ao menos um quadro cada), escritas em paralelo
+    // ao lado de outputFile como <nome>-001.html, <nome>-002.html... Cada página traz os mesmos
+    // quadros de todas as listas, os rótulos deles e links para a anterior e a próxima; outputFile
+    // vira o índice das páginas. Devolve os arquivos das páginas. Lança para fontes sob demanda e atlas.
+    std::vector<std::string> streamShards(const std::string& outputFile, const SPICEBuilder& builder, uintmax_t maxPageBytes,
+                                          const tsimg::pipeline::RawFrameObserver& onRawFrame = {});
+    // Páginas que streamShards escreveria, só pelos tamanhos dos arquivos e sem ler quadro algum;
+    // lança nos mesmos casos
+    std::vector<ShardPage> planShards(const std::string& outputFile, const SPICEBuilder& builder, uintmax_t maxPageBytes);
+    // Bytes exatos que streamToFile escreveria, sem ler quadro algum: pendingTagBytes(tag) dá a
+    // soma das tags <img> dos caminhos pendentes da lista. Lança para fontes sob demanda.
+    uintmax_t streamedSize(const SPICEBuilder& builder, const std::function<uintmax_t(const std::string& tag)>& pendingTagBytes);
+    // Como streamToFile, mas com os quadros vindos do contêiner .spice (builder traz título,
+    // conteúdos, rótulos e autor gravados nele)
+    void streamFromContainer(const std::string& outputFile, const SPICEBuilder& builder, const tsimg::container::Reader& reader);
+    // Template com conteúdos, autor, ajuda e build info aplicados; <SPICE_LABELS> e os
+    // placeholders de imagem ficam intactos para quem monta o documento por partes
+    std::string renderLayout(const SPICEBuilder& builder);
     std::string buildHtmlStructure(const SPICEBuilder& builder);
 
 private:
@@ -116,9 +203,19 @@ private:
     bool validateImageListAndLabels(const std::map<std::string, std::unique_ptr<ImageList>>& imageLists, const std::vector<std::string>& labels);
     std::string replaceAllTags(const std::string& source, const std::vector<SpiceContent>& contents);
     std::string replaceObjectPlaceholders(const std::string& source, const std::map<std::string, std::unique_ptr<ImageList>>& imageLists);
+    std::string renderStaticContent(const std::vector<SpiceContent>& contents,
+                                    const std::vector<std::string>& labels,
+                                    const std::string& authorImageBase64);
+    std::string renderLayout(const std::vector<SpiceContent>& contents, const std::string& authorImageBase64);
+    std::string renderEmbeddedLayout(const std::vector<SpiceContent>& contents, const std::string& authorImageBase64);
+    // Escreve staticContent com os quadros [first, last) de cada lista de tags no lugar dos
+    // placeholders; só a série inteira (0, npos) inclui as fontes sob demanda
+    void streamDocument(const std::string& outputFile, const SPICEBuilder& builder, const std::string& staticContent,
+                        const std::set<std::string>& tags, size_t first, size_t last, const tsimg::pipeline::StreamOptions& options);
 
     std::string templatePath;
     std::string templateContent;
+    const tsimg::embedded::Template* embeddedTemplate = nullptr; // template embutido em uso, se houver
     bool debug;
 };
 
@@ -136,6 +233,12 @@ namespace tsimg::utils {
     public:
         static std::string readFile(const std::string& filepath, bool debug = false);
         static void writeFile(const std::string& filepath, const std::string& content, bool debug = false);
+        // "-" abre a saída padrão; veja reserveStdout
+        static std::unique_ptr<std::ostream> openOutputStream(const std::string& filepath, bool debug = false);
+        static bool isStdStream(const std::string& filepath);
+        // Reserva o stdout para o arquivo gerado e desvia std::cout (logs e mensagens) para o stderr.
+        // Idempotente; deve ser chamada antes de qualquer saída quando o destino é "-".
+        static void reserveStdout();
         static bool isValidImageFormat(const std::string& filepath);
         static bool isFileReadable(const std::string& filepath);
         
@@ -155,6 +258,15 @@ namespace tsimg::utils {
             const std::string& helpLink
         );
         static std::string createLabelTags(const std::vector<std::string>& labels);
+        static std::string createImageTag(std::string_view base64, std::string_view path);
+        // Codifica os bytes da imagem direto no buffer da tag, já com o tamanho exato
+        static std::string encodeImageTag(const std::vector<unsigned char>& data, std::string_view path);
+        static std::string encodeImageTag(const unsigned char* data, size_t length, std::string_view path);
+        static size_t imageTagSize(size_t base64Size, size_t pathSize);
+        static void appendImageTag(std::string& out, std::string_view base64, std::string_view path);
+        // Próxima tag de quadro (formato de appendImageTag) em html a partir de from: devolve o
+        // início e preenche base64, path e end (fim da tag); npos se não houver
+        static size_t findImageTag(std::string_view html, size_t from, std::string_view& base64, std::string_view& path, size_t& end);
     };
 
     class ImageValidator {
@@ -165,12 +277,31 @@ namespace tsimg::utils {
     class Base64 {
     public:
         static std::string encode(const std::vector<unsigned char>& data);
+        static size_t encodedSize(size_t length);
+        // Escreve exatamente encodedSize(length) caracteres em out
+        static void encodeTo(const unsigned char* data, size_t length, char* out);
+        static size_t decodedSize(std::string_view encoded);
+        // Escreve até decodedSize(encoded) bytes em out e devolve quantos; lança para Base64 inválido
+        static size_t decodeTo(std::string_view encoded, unsigned char* out);
     };
 
     class FileIO {
     public:
+        struct ReadResult {
+            size_t index;
+            std::vector<unsigned char> data;
+            std::string error;
+        };
+        using ReadCallback = std::function<void(ReadResult&&)>;
+
         static std::vector<unsigned char> readBinary(const std::string& filepath);
         static void writeBinary(const std::string& filepath, const std::vector<unsigned char>& data);
+
+        // Lê todos os arquivos com até queueDepth leituras em andamento (io_uring no Linux,
+        // threads com pread caso contrário). onComplete é chamado uma vez por caminho, na
+        // ordem em que as leituras terminam, nunca de forma concorrente.
+        static void readBatch(const std::vector<std::string>& paths, const ReadCallback& onComplete, size_t queueDepth = 64, bool debug = false);
+        static bool ioUringAvailable();
     };
 
     class ImageProcessor {
@@ -178,5 +309,76 @@ namespace tsimg::utils {
         static std::vector<std::future<std::unique_ptr<Image>>> processImagesAsync(const std::vector<std::string>& imagePaths, bool debug);
     };
 
+    // Cache de tags <img> já codificadas, usado pelo modo servidor. Entradas são validadas pelo
+    // tamanho e data de modificação do arquivo e descartadas (LRU) acima da capacidade em bytes.
+    class FrameCache {
+    public:
+        struct Stats {
+            size_t entries;
+            size_t bytes;
+            size_t hits;
+            size_t misses;
+        };
+
+        static FrameCache& instance();
+        void setCapacity(size_t bytes);
+        bool enabled() const;
+        std::shared_ptr<const std::string> find(const std::string& path, uintmax_t size, int64_t mtime);
+        void insert(const std::string& path, uintmax_t size, int64_t mtime, std::shared_ptr<const std::string> tag);
+        Stats stats() const;
+
+    private:
+        struct Entry {
+            uintmax_t size;
+            int64_t mtime;
+            std::shared_ptr<const std::string> tag;
+            std::list<std::string>::iterator lruPosition;
+        };
+
+        void evict();
+
+        mutable std::mutex mutex;
+        std::atomic<size_t> capacity{0};
+        size_t bytes = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+        std::unordered_map<std::string, Entry> entries;
+        std::list<std::string> lru;
+    };
+
+    // Memoriza a resolução de nomes de template e o conteúdo lido (revalidado pela data de modificação).
+    class TemplateCache {
+    public:
+        struct Stats {
+            size_t entries;
+            size_t hits;
+            size_t misses;
+        };
+
+        static TemplateCache& instance();
+        void setEnabled(bool enabled);
+        bool enabled() const;
+        std::string resolve(const std::string& templateName, const std::function<std::string(const std::string&)>& resolver);
+        std::string read(const std::string& templatePath, bool debug);
+        Stats stats() const;
+
+    private:
+        struct Entry {
+            std::filesystem::file_time_type mtime;
+            std::string content;
+        };
+
+        mutable std::mutex mutex;
+        std::atomic<bool> active{false};
+        size_t hits = 0;
+        size_t misses = 0;
+        std::unordered_map<std::string, std::string> resolved;
+        std::unordered_map<std::string, Entry> contents;
+    };
+
+    // Caminhos "embedded:<nome>" apontam para os templates embutidos no binário
+    constexpr std::string_view kEmbeddedTemplatePrefix = "embedded:";
+    const tsimg::embedded::Template* findEmbeddedTemplate(const std::string& templatePath);
+
     std::string getTemplateContent(const std::string& templatePath, bool debug);
 }
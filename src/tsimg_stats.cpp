@@ -0,0 +1,251 @@
+#include "tsimg_stats.h"
+#include "tsimg_downscale.h"
+#include "tsimg_memory.h"
+#include "tsimg_pipeline.h"
+#include "tsimg_spice.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+namespace tsimg::stats {
+
+namespace {
+    // Contagem por valor do canal; a classe 256 recebe os pixels fora da máscara ou transparentes
+    // e é descartada
+    constexpr size_t kMasked = 256;
+    using Histogram = std::array<uint64_t, kMasked + 1>;
+
+    // Valor do canal de cada pixel da linha. Laços sem desvio por pixel, que o compilador vetoriza.
+    void channelRow(const uint8_t* rgba, size_t width, Channel channel, uint16_t* out) {
+        if (channel == Channel::Luma) {
+            for (size_t i = 0; i < width; ++i) {
+                const uint8_t* p = rgba + i * 4;
+                out[i] = static_cast<uint16_t>((77u * p[0] + 150u * p[1] + 29u * p[2] + 128u) >> 8);
+            }
+            return;
+        }
+        const size_t offset = channel == Channel::Red ? 0 : channel == Channel::Green ? 1 : 2;
+        for (size_t i = 0; i < width; ++i) {
+            out[i] = rgba[i * 4 + offset];
+        }
+    }
+
+    // Alfa 0 (nodata, inclusive o do tRNS) não é dado: fica fora das medidas
+    void transparentRow(const uint8_t* rgba, size_t width, uint16_t* values) {
+        for (size_t i = 0; i < width; ++i) {
+            values[i] = rgba[i * 4 + 3] ? values[i] : static_cast<uint16_t>(kMasked);
+        }
+    }
+
+    void maskRow(const uint8_t* mask, size_t width, uint16_t* values) {
+        for (size_t i = 0; i < width; ++i) {
+            values[i] = mask[i] ? values[i] : static_cast<uint16_t>(kMasked);
+        }
+    }
+
+    // Quatro histogramas intercalados: pixels vizinhos com o mesmo valor não esperam um pelo
+    // incremento do outro na mesma posição de memória
+    void accumulate(const uint16_t* values, size_t count, std::array<Histogram, 4>& partial) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            ++partial[0][values[i]];
+            ++partial[1][values[i + 1]];
+            ++partial[2][values[i + 2]];
+            ++partial[3][values[i + 3]];
+        }
+        for (; i < count; ++i) {
+            ++partial[0][values[i]];
+        }
+    }
+
+    FrameStats summarize(const Histogram& histogram, int bins) {
+        FrameStats stats;
+        stats.histogram.assign(static_cast<size_t>(bins), 0);
+        const size_t binWidth = kMasked / static_cast<size_t>(bins);
+        double sum = 0.0;
+        double sumSquares = 0.0;
+        for (size_t v = 0; v < kMasked; ++v) {
+            uint64_t n = histogram[v];
+            stats.count += n;
+            sum += static_cast<double>(n) * v;
+            sumSquares += static_cast<double>(n) * v * v;
+            stats.histogram[v / binWidth] += n;
+        }
+        if (stats.count == 0) {
+            return stats;
+        }
+        stats.mean = sum / stats.count;
+        stats.stddev = std::sqrt(std::max(0.0, sumSquares / stats.count - stats.mean * stats.mean));
+
+        // Percentis pelo posto mais próximo sobre o acumulado
+        uint64_t cumulative = 0;
+        size_t next = 0;
+        bool seen = false;
+        for (size_t v = 0; v < kMasked; ++v) {
+            if (histogram[v] == 0) continue;
+            if (!seen) {
+                stats.min = static_cast<int>(v);
+                seen = true;
+            }
+            stats.max = static_cast<int>(v);
+            cumulative += histogram[v];
+            while (next < kPercentiles.size() &&
+                   cumulative * 100 >= static_cast<uint64_t>(kPercentiles[next]) * stats.count) {
+                stats.percentiles[next++] = static_cast<int>(v);
+            }
+        }
+        return stats;
+    }
+
+    struct Mask {
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> pixels;
+    };
+
+    Mask loadMask(const std::string& path) {
+        Mask mask;
+        int channels = 0;
+        stbi_uc* pixels = stbi_load(path.c_str(), &mask.width, &mask.height, &channels, 1);
+        if (!pixels) {
+            throw std::runtime_error("Failed to load statistics mask: " + path);
+        }
+        std::unique_ptr<stbi_uc, void (*)(void*)> owned(pixels, stbi_image_free);
+        mask.pixels.assign(pixels, pixels + static_cast<size_t>(mask.width) * mask.height);
+        return mask;
+    }
+
+    double rounded(double value) {
+        return std::round(value * 100.0) / 100.0;
+    }
+}
+
+Channel parseChannel(const std::string& name) {
+    if (name == "luma") return Channel::Luma;
+    if (name == "red") return Channel::Red;
+    if (name == "green") return Channel::Green;
+    if (name == "blue") return Channel::Blue;
+    throw std::runtime_error("Unknown statistics channel: " + name + " (expected luma, red, green or blue)");
+}
+
+const char* channelName(Channel channel) {
+    switch (channel) {
+        case Channel::Luma: return "luma";
+        case Channel::Red: return "red";
+        case Channel::Green: return "green";
+        case Channel::Blue: return "blue";
+    }
+    return "luma";
+}
+
+std::vector<FrameStats> compute(const std::vector<std::string>& paths, const Options& options) {
+    if (options.bins <= 0 || options.bins > 256 || 256 % options.bins != 0) {
+        throw std::runtime_error("Statistics bins must divide 256, got " + std::to_string(options.bins));
+    }
+    Mask mask;
+    if (!options.maskPath.empty()) {
+        mask = loadMask(options.maskPath);
+    }
+
+    std::vector<FrameStats> stats(paths.size());
+    auto started = std::chrono::steady_clock::now();
+
+    tsimg::pipeline::parallelFor(paths.size(), options.threads, [&](size_t i) {
+        const std::string& path = paths[i];
+        int width = 0, height = 0;
+        if (!tsimg::downscale::imageSize(path, width, height)) {
+            throw std::runtime_error("Failed to read image header: " + path);
+        }
+        if (!mask.pixels.empty() && (mask.width != width || mask.height != height)) {
+            throw std::runtime_error("Statistics mask is " + std::to_string(mask.width) + "x" + std::to_string(mask.height) +
+                                     " but the frame is " + std::to_string(width) + "x" + std::to_string(height) + ": " + path);
+        }
+        tsimg::roi::Box box = options.box.empty() ? tsimg::roi::Box{0, 0, width, height} : tsimg::roi::clipBox(options.box, width, height);
+        if (box.empty()) {
+            throw std::runtime_error("Statistics region lies outside the " + std::to_string(width) + "x" +
+                                     std::to_string(height) + " image: " + path);
+        }
+
+        tsimg::downscale::Options decode;
+        decode.stage = tsimg::memory::Stage::Ingest;
+        decode.debug = options.debug;
+        std::vector<uint8_t> rgba;
+        if (!tsimg::downscale::loadCroppedRgba(path, box.x, box.y, box.width, box.height, rgba, decode)) {
+            throw std::runtime_error("Failed to decode image for statistics: " + path);
+        }
+        tsimg::memory::Charge decoded(tsimg::memory::Stage::Ingest, rgba.size());
+
+        std::array<Histogram, 4> partial{};
+        std::vector<uint16_t> values(static_cast<size_t>(box.width));
+        for (int row = 0; row < box.height; ++row) {
+            const uint8_t* pixels = rgba.data() + static_cast<size_t>(row) * box.width * 4;
+            channelRow(pixels, values.size(), options.channel, values.data());
+            transparentRow(pixels, values.size(), values.data());
+            if (!mask.pixels.empty()) {
+                maskRow(mask.pixels.data() + static_cast<size_t>(box.y + row) * width + box.x, values.size(), values.data());
+            }
+            accumulate(values.data(), values.size(), partial);
+        }
+        Histogram total{};
+        for (const auto& h : partial) {
+            for (size_t v = 0; v < total.size(); ++v) total[v] += h[v];
+        }
+        stats[i] = summarize(total, options.bins);
+    }, [&](size_t i) {
+        // Estimativa para o orçamento de memória: a imagem decodificada inteira
+        int width = 0, height = 0;
+        if (!tsimg::downscale::imageSize(paths[i], width, height)) return size_t(0);
+        return static_cast<size_t>(width) * height * 4;
+    });
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+    tsimg::utils::debugLog(options.debug, "Computed " + std::string(channelName(options.channel)) + " statistics for " +
+                           std::to_string(paths.size()) + " frames in " + std::to_string(elapsed) + " ms");
+    return stats;
+}
+
+nlohmann::json toJson(const std::vector<FrameStats>& stats, const Options& options) {
+    nlohmann::json count = nlohmann::json::array();
+    nlohmann::json mean = nlohmann::json::array();
+    nlohmann::json stddev = nlohmann::json::array();
+    nlohmann::json min = nlohmann::json::array();
+    nlohmann::json max = nlohmann::json::array();
+    nlohmann::json histogram = nlohmann::json::array();
+    std::vector<nlohmann::json> percentiles(kPercentiles.size(), nlohmann::json::array());
+    for (const auto& frame : stats) {
+        count.push_back(frame.count);
+        mean.push_back(rounded(frame.mean));
+        stddev.push_back(rounded(frame.stddev));
+        min.push_back(frame.min);
+        max.push_back(frame.max);
+        histogram.push_back(frame.histogram);
+        for (size_t p = 0; p < kPercentiles.size(); ++p) {
+            percentiles[p].push_back(frame.percentiles[p]);
+        }
+    }
+    nlohmann::json json = {
+        {"channel", channelName(options.channel)},
+        {"bins", options.bins},
+        {"count", count},
+        {"mean", mean},
+        {"stddev", stddev},
+        {"min", min},
+        {"max", max},
+        {"histogram", histogram},
+    };
+    for (size_t p = 0; p < kPercentiles.size(); ++p) {
+        json["p" + std::to_string(kPercentiles[p])] = percentiles[p];
+    }
+    if (!options.box.empty()) {
+        json["roi"] = {options.box.x, options.box.y, options.box.width, options.box.height};
+    }
+    if (!options.maskPath.empty()) {
+        json["masked"] = true;
+    }
+    return json;
+}
+
+}
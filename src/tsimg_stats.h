@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "tsimg_roi.h"
+
+namespace tsimg::stats {
+
+    // Canal medido: luminância (BT.601, inteira) ou um dos canais RGB. Para índices como o NDVI
+    // gravados em tons de cinza, qualquer um deles dá o mesmo valor.
+    enum class Channel { Luma, Red, Green, Blue };
+
+    // "luma", "red", "green" ou "blue"; lança std::runtime_error para outros nomes
+    Channel parseChannel(const std::string& name);
+    const char* channelName(Channel channel);
+
+    struct Options {
+        bool enabled = false;
+        Channel channel = Channel::Luma;
+        int bins = 32;               // classes do histograma gravado (divisor de 256)
+        tsimg::roi::Box box;         // só os pixels desta caixa (vazia = quadro inteiro)
+        std::string maskPath;        // imagem do tamanho dos quadros; conta onde o pixel não é preto
+        unsigned threads = 0;        // 0 = std::thread::hardware_concurrency()
+        bool debug = false;
+    };
+
+    // Percentis guardados em FrameStats::percentiles
+    constexpr std::array<int, 5> kPercentiles = {5, 25, 50, 75, 95};
+
+    struct FrameStats {
+        uint64_t count = 0;          // pixels medidos (dentro da caixa e da máscara, com alfa > 0)
+        double mean = 0.0;
+        double stddev = 0.0;
+        int min = 0;
+        int max = 0;
+        std::array<int, kPercentiles.size()> percentiles{};
+        std::vector<uint64_t> histogram; // options.bins classes de largura 256 / bins
+    };
+
+    // Decodifica cada quadro uma vez, em paralelo e dentro do orçamento de memória, e mede o
+    // canal pedido; pixels transparentes (alfa 0) não entram nas medidas. Lança std::runtime_error se um quadro ou a máscara não puderem ser lidos, se a
+    // máscara tiver outro tamanho ou se a caixa não tocar o quadro.
+    std::vector<FrameStats> compute(const std::vector<std::string>& paths, const Options& options);
+
+    // Forma compacta embutida no SPICE (<SPICE_STATS>): uma lista por medida, um valor por quadro
+    nlohmann::json toJson(const std::vector<FrameStats>& stats, const Options& options);
+}
@@ -0,0 +1,339 @@
+#include "tsimg_watch.h"
+#include "tsimg_spice.h"
+#include "tsimg_gif.h"
+#include "tsimg_inputs.h"
+#include "tsimg_memory.h"
+#include "tsimg_pipeline.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define TSIMG_HAS_INOTIFY 1
+#endif
+
+namespace tsimg::watch {
+
+#ifdef TSIMG_HAS_INOTIFY
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using tsimg::pipeline::FileStamp;
+
+    std::atomic<bool> stopRequested{false};
+
+    void handleStopSignal(int) {
+        stopRequested.store(true);
+    }
+
+    struct NaturalOrder {
+        bool operator()(const std::string& a, const std::string& b) const {
+            return tsimg::inputs::naturalLess(a, b);
+        }
+    };
+
+    struct Frame {
+        FileStamp stamp;
+        std::shared_ptr<const std::string> tag; // só usado na saída SPICE
+        tsimg::memory::Charge charge;
+    };
+
+    // Trecho literal do layout seguido do que entra no lugar do placeholder que o encerra
+    struct Segment {
+        enum class Kind { Labels, Images, End };
+        std::string text;
+        Kind kind;
+    };
+
+    std::vector<Segment> splitLayout(const std::string& layout) {
+        static const std::string labelsTag = "<SPICE_LABELS>";
+        static const std::string imagesTag = "<SPICE_IMAGES>";
+        std::vector<Segment> segments;
+        size_t cursor = 0;
+        for (;;) {
+            size_t labelsPos = layout.find(labelsTag, cursor);
+            size_t imagesPos = layout.find(imagesTag, cursor);
+            size_t pos = std::min(labelsPos, imagesPos);
+            if (pos == std::string::npos) {
+                segments.push_back({layout.substr(cursor), Segment::Kind::End});
+                return segments;
+            }
+            bool labels = pos == labelsPos;
+            segments.push_back({layout.substr(cursor, pos - cursor), labels ? Segment::Kind::Labels : Segment::Kind::Images});
+            cursor = pos + (labels ? labelsTag : imagesTag).size();
+        }
+    }
+
+    class SeriesState {
+    public:
+        SeriesState(const WatchOptions& options, std::vector<Segment> segments)
+            : options(options), segments(std::move(segments)), gifSequence(100, options.gifOptions) {}
+
+        // Atualiza os quadros indicados e devolve true se a série mudou
+        bool update(const std::set<std::string>& dirty) {
+            std::vector<std::string> toEncode;
+            bool changed = false;
+            for (const auto& path : dirty) {
+                FileStamp stamp = tsimg::pipeline::stampFile(path);
+                auto it = frames.find(path);
+                if (!stamp.valid || stamp.size == 0) {
+                    // Removido (ou ainda vazio): sai da série
+                    if (it != frames.end()) {
+                        frames.erase(it);
+                        changed = true;
+                    }
+                    continue;
+                }
+                if (it != frames.end() && it->second.stamp == stamp) {
+                    continue;
+                }
+                frames[path].stamp = stamp;
+                changed = true;
+                if (options.format == "spice") {
+                    toEncode.push_back(path);
+                }
+            }
+            encode(toEncode);
+            return changed;
+        }
+
+        std::set<std::string> paths() const {
+            std::set<std::string> result;
+            for (const auto& entry : frames) {
+                result.insert(entry.first);
+            }
+            return result;
+        }
+
+        void write() {
+            std::string tmpFile = options.outputFile + ".tmp";
+            if (options.format == "gif") {
+                writeGif(tmpFile);
+            } else {
+                writeSpice(tmpFile);
+            }
+            std::filesystem::rename(tmpFile, options.outputFile);
+            std::cout << "Updated " << options.outputFile << " (" << frames.size() << " frames)" << std::endl;
+        }
+
+    private:
+        void encode(const std::vector<std::string>& paths) {
+            if (paths.empty()) {
+                return;
+            }
+            tsimg::utils::debugLog(options.debug, "Encoding " + std::to_string(paths.size()) + " new or changed frames");
+            std::vector<std::future<std::shared_ptr<const std::string>>> futures(paths.size());
+            tsimg::utils::FileIO::readBatch(paths, [&](tsimg::utils::FileIO::ReadResult&& result) {
+                const std::string& path = paths[result.index];
+                if (!result.error.empty() || result.data.empty()) {
+                    tsimg::utils::errorLog(options.debug, "Skipping unreadable frame: " + path);
+                    futures[result.index] = std::async(std::launch::deferred, [] { return std::shared_ptr<const std::string>(); });
+                    return;
+                }
+                futures[result.index] = std::async(std::launch::async, [data = std::move(result.data), &path]() {
+                    return std::make_shared<const std::string>(
+                        tsimg::utils::HTMLBuilder::encodeImageTag(data, path));
+                });
+            }, 64, options.debug);
+            for (size_t i = 0; i < paths.size(); ++i) {
+                auto tag = futures[i].get();
+                if (tag) {
+                    auto& frame = frames[paths[i]];
+                    frame.charge = tsimg::memory::Charge(tsimg::memory::Stage::Encode, tag->size());
+                    frame.tag = std::move(tag);
+                } else {
+                    frames.erase(paths[i]);
+                }
+            }
+        }
+
+        void writeSpice(const std::string& tmpFile) {
+            auto out = tsimg::utils::FileHandler::openOutputStream(tmpFile, options.debug);
+            for (const auto& segment : segments) {
+                *out << segment.text;
+                if (segment.kind == Segment::Kind::Labels) {
+                    for (const auto& [path, frame] : frames) {
+                        *out << "<span>" << path << "</span>";
+                    }
+                } else if (segment.kind == Segment::Kind::Images) {
+                    for (const auto& [path, frame] : frames) {
+                        *out << *frame.tag;
+                    }
+                }
+            }
+            out->flush();
+            if (!*out) {
+                throw std::runtime_error("Failed to write SPICE output: " + tmpFile);
+            }
+        }
+
+        void writeGif(const std::string& tmpFile) {
+            // Quadros só acrescentados no fim reaproveitam a sequência; qualquer outra mudança recomeça
+            size_t kept = 0;
+            auto it = frames.begin();
+            while (kept < gifFrames.size() && it != frames.end() &&
+                   gifFrames[kept].first == it->first && gifFrames[kept].second == it->second.stamp) {
+                ++kept;
+                ++it;
+            }
+            if (kept < gifFrames.size()) {
+                tsimg::utils::debugLog(options.debug, "Frame order changed, re-encoding GIF from the start");
+                gifSequence.reset();
+                gifFrames.clear();
+                it = frames.begin();
+            }
+            for (; it != frames.end(); ++it) {
+                if (!gifSequence.append(it->first, options.debug)) {
+                    throw std::runtime_error("Failed to encode GIF frame: " + it->first);
+                }
+                gifFrames.emplace_back(it->first, it->second.stamp);
+            }
+            if (!gifSequence.writeTo(tmpFile, options.debug)) {
+                throw std::runtime_error("Failed to write GIF output: " + tmpFile);
+            }
+        }
+
+        const WatchOptions& options;
+        std::vector<Segment> segments;
+        std::map<std::string, Frame, NaturalOrder> frames;
+        GifSequence gifSequence;
+        std::vector<std::pair<std::string, FileStamp>> gifFrames;
+    };
+
+    std::set<std::string> scanDirectory(const std::string& directory) {
+        std::set<std::string> paths;
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            if (entry.is_regular_file() && tsimg::utils::FileHandler::isValidImageFormat(entry.path().string())) {
+                paths.insert(entry.path().string());
+            }
+        }
+        return paths;
+    }
+}
+
+int runWatch(const WatchOptions& options, const SPICEBuilder& builder) {
+    if (!std::filesystem::is_directory(options.directory)) {
+        std::cerr << "Watch target is not a directory: " << options.directory << std::endl;
+        return 1;
+    }
+    if (options.format != "spice" && options.format != "gif") {
+        std::cerr << "Unsupported format: " << options.format << std::endl;
+        return 1;
+    }
+
+    std::vector<Segment> segments;
+    if (options.format == "spice") {
+        try {
+            TemplateWriter writer(builder.getTemplatePath(), options.debug);
+            segments = splitLayout(writer.renderLayout(builder));
+        } catch (const std::exception& e) {
+            std::cerr << "Error while preparing the SPICE template: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    SeriesState state(options, std::move(segments));
+
+    int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || ::inotify_add_watch(fd, options.directory.c_str(),
+                                      IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_DELETE_SELF) < 0) {
+        std::cerr << "Could not watch " << options.directory << ": " << std::strerror(errno) << std::endl;
+        if (fd >= 0) ::close(fd);
+        return 1;
+    }
+
+    stopRequested.store(false);
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+
+    // A própria saída (e o temporário) podem estar no diretório observado
+    std::error_code ec;
+    const auto outputPath = std::filesystem::weakly_canonical(options.outputFile, ec);
+    const auto tmpPath = std::filesystem::weakly_canonical(options.outputFile + ".tmp", ec);
+
+    std::set<std::string> dirty = scanDirectory(options.directory);
+    auto lastEvent = Clock::now() - std::chrono::milliseconds(options.debounceMs);
+    int status = 0;
+
+    std::cout << "Watching " << options.directory << " -> " << options.outputFile << std::endl;
+
+    alignas(inotify_event) char buffer[64 * 1024];
+    while (!stopRequested.load()) {
+        auto debounce = std::chrono::milliseconds(options.debounceMs);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - lastEvent);
+        if (!dirty.empty() && elapsed >= debounce) {
+            try {
+                if (state.update(dirty)) {
+                    state.write();
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Error while updating " << options.outputFile << ": " << e.what() << std::endl;
+            }
+            dirty.clear();
+            continue;
+        }
+
+        int timeout = dirty.empty() ? 200 : static_cast<int>((debounce - elapsed).count());
+        pollfd pfd{fd, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, timeout);
+        if (ready <= 0) continue;
+
+        ssize_t length;
+        while ((length = ::read(fd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + length;) {
+                auto* event = reinterpret_cast<inotify_event*>(p);
+                p += sizeof(inotify_event) + event->len;
+
+                if (event->mask & (IN_DELETE_SELF | IN_IGNORED)) {
+                    std::cerr << "Watched directory was removed: " << options.directory << std::endl;
+                    stopRequested.store(true);
+                    status = 1;
+                    break;
+                }
+                if (event->mask & IN_Q_OVERFLOW) {
+                    // Eventos perdidos: reavalia o diretório inteiro e tudo o que já está na série
+                    tsimg::utils::debugLog(options.debug, "inotify queue overflow, rescanning");
+                    dirty = scanDirectory(options.directory);
+                    auto known = state.paths();
+                    dirty.insert(known.begin(), known.end());
+                    lastEvent = Clock::now();
+                    continue;
+                }
+                if (event->len == 0) continue;
+
+                auto path = std::filesystem::path(options.directory) / event->name;
+                if (!tsimg::utils::FileHandler::isValidImageFormat(path.string())) continue;
+                auto canonical = std::filesystem::weakly_canonical(path, ec);
+                if (canonical == outputPath || canonical == tmpPath) continue;
+
+                dirty.insert(path.string());
+                lastEvent = Clock::now();
+            }
+        }
+    }
+
+    ::close(fd);
+    std::cout << "Watch stopped" << std::endl;
+    return status;
+}
+
+#else
+
+int runWatch(const WatchOptions&, const SPICEBuilder&) {
+    std::cerr << "Watch mode requires inotify, which is not available on this platform." << std::endl;
+    return 1;
+}
+
+#endif
+
+}
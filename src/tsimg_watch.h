@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include "tsimg_gif.h"
+
+class SPICEBuilder;
+
+namespace tsimg::watch {
+
+    struct WatchOptions {
+        std::string directory;
+        std::string outputFile;
+        std::string format = "spice";
+        int debounceMs = 500;
+        bool debug = false;
+        GifOptions gifOptions;
+    };
+
+    // Observa directory (inotify) e regrava outputFile sempre que um quadro é criado, alterado ou
+    // removido, depois de debounceMs sem novos eventos. Os quadros codificados, os rótulos e os
+    // trechos do template ficam em memória, então cada rodada só lê e codifica o que mudou.
+    // builder fornece título, ajuda, autor e template; os rótulos vêm dos nomes dos arquivos.
+    // Roda até SIGINT/SIGTERM.
+    int runWatch(const WatchOptions& options, const SPICEBuilder& builder);
+}
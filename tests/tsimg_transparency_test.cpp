@@ -0,0 +1,133 @@
+// Regressão: PNGs indexados com tRNS precisam manter o alfa ao passar pelo leitor em fluxo
+// (tsimg::downscale::loadCroppedRgba) e pelas folhas do atlas, que decodificam por ele.
+#include "tsimg_atlas.h"
+#include "tsimg_downscale.h"
+#include "tsimg_png.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    int failures = 0;
+
+    void check(bool condition, const std::string& message) {
+        if (!condition) {
+            std::cerr << "FAIL: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    // Quadro de poucas cores com um bloco de nodata transparente (alfa 0) e uma faixa translúcida:
+    // encodeRgba o grava como paleta com tRNS
+    std::vector<uint8_t> makeFrame(int width, int height, int seed) {
+        std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                uint8_t* p = rgba.data() + (static_cast<size_t>(y) * width + x) * 4;
+                const int color = (x / 4 + y / 3 + seed) % 5;
+                p[0] = static_cast<uint8_t>(40 * color);
+                p[1] = static_cast<uint8_t>(200 - 30 * color);
+                p[2] = static_cast<uint8_t>(90 + seed);
+                p[3] = 255;
+                if (x < width / 3 && y < height / 2) {
+                    p[0] = p[1] = p[2] = p[3] = 0;
+                } else if (y == height - 1) {
+                    p[3] = 128;
+                }
+            }
+        }
+        return rgba;
+    }
+
+    std::string writePng(const fs::path& path, const std::vector<uint8_t>& rgba, int width, int height) {
+        tsimg::png::Result result;
+        auto png = tsimg::png::encodeRgba(rgba.data(), width, height, tsimg::png::Options{}, &result);
+        check(result.layout == tsimg::png::Layout::Indexed, "test frame should be written as an indexed PNG with tRNS");
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+        if (!out) throw std::runtime_error("Failed to write " + path.string());
+        return path.string();
+    }
+
+    // Compara a caixa (x, y) de tamanho width x height de actual (com stride actualWidth) com expected
+    void compareBox(const std::vector<uint8_t>& actual, int actualWidth, int x, int y, const std::vector<uint8_t>& expected,
+                    int width, int height, const std::string& what) {
+        size_t mismatches = 0;
+        for (int row = 0; row < height; ++row) {
+            for (int col = 0; col < width; ++col) {
+                const uint8_t* a = actual.data() + ((static_cast<size_t>(y) + row) * actualWidth + x + col) * 4;
+                const uint8_t* e = expected.data() + (static_cast<size_t>(row) * width + col) * 4;
+                // A cor de um pixel totalmente transparente não importa
+                bool same = a[3] == e[3] && (e[3] == 0 || (a[0] == e[0] && a[1] == e[1] && a[2] == e[2]));
+                mismatches += same ? 0 : 1;
+            }
+        }
+        check(mismatches == 0, what + ": " + std::to_string(mismatches) + " pixels differ from the source RGBA");
+    }
+}
+
+int main() {
+    const fs::path directory = fs::temp_directory_path() /
+        ("tsimg-transparency-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(directory);
+    try {
+        const int width = 24, height = 18;
+        std::vector<std::vector<uint8_t>> frames;
+        std::vector<std::string> paths;
+        for (int i = 0; i < 3; ++i) {
+            frames.push_back(makeFrame(width, height, i));
+            paths.push_back(writePng(directory / ("frame" + std::to_string(i) + ".png"), frames.back(), width, height));
+        }
+
+        // Quadro inteiro e recorte pelo leitor em fluxo
+        std::vector<uint8_t> decoded;
+        check(tsimg::downscale::loadCroppedRgba(paths[0], 0, 0, width, height, decoded), "full decode failed");
+        if (!decoded.empty()) compareBox(decoded, width, 0, 0, frames[0], width, height, "full decode");
+
+        std::vector<uint8_t> cropped;
+        check(tsimg::downscale::loadCroppedRgba(paths[1], 2, 3, 10, 12, cropped), "cropped decode failed");
+        if (!cropped.empty()) {
+            std::vector<uint8_t> expected;
+            for (int row = 3; row < 15; ++row) {
+                const uint8_t* start = frames[1].data() + (static_cast<size_t>(row) * width + 2) * 4;
+                expected.insert(expected.end(), start, start + 10 * 4);
+            }
+            compareBox(cropped, 10, 0, 0, expected, 10, 12, "cropped decode");
+        }
+
+        // Folha do atlas: cada quadro na sua posição, com o alfa original
+        tsimg::atlas::Options options;
+        auto atlas = tsimg::atlas::pack(paths, options);
+        check(atlas.sheets.paths.size() == 1, "three small frames should fit in one atlas sheet");
+        if (atlas.sheets.paths.size() == 1) {
+            int sheetWidth = 0, sheetHeight = 0;
+            check(tsimg::downscale::imageSize(atlas.sheets.paths[0], sheetWidth, sheetHeight), "atlas sheet header unreadable");
+            std::vector<uint8_t> sheet;
+            check(tsimg::downscale::loadCroppedRgba(atlas.sheets.paths[0], 0, 0, sheetWidth, sheetHeight, sheet), "atlas sheet decode failed");
+            for (size_t i = 0; i < frames.size() && !sheet.empty(); ++i) {
+                const auto& placement = atlas.frames[i];
+                compareBox(sheet, sheetWidth, placement.x, placement.y, frames[i], width, height, "atlas frame " + std::to_string(i));
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "FAIL: " << e.what() << std::endl;
+        ++failures;
+    }
+    std::error_code ec;
+    fs::remove_all(directory, ec);
+
+    if (failures == 0) {
+        std::cout << "tRNS transparency: all checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
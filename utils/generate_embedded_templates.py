@@ -0,0 +1,125 @@
+# generate_embedded_templates.py
+# Embute os templates de templates/*.html no binário (src/embedded_templates.h), junto com a
+# tabela de placeholders <SPICE_*> de cada um, para que a renderização não precise ler nem
+# varrer o template em tempo de execução.
+import os
+import re
+import sys
+
+print("Generating embedded templates...")
+
+script_dir = os.path.dirname(os.path.abspath(__file__))
+templates_dir = os.path.abspath(os.path.join(script_dir, '..', 'templates'))
+header_file_path = os.path.abspath(os.path.join(script_dir, '..', 'src', 'embedded_templates.h'))
+default_template = 'template_vs'
+
+placeholder_pattern = re.compile(r'<SPICE_[A-Z0-9_]+>')
+
+
+def cpp_identifier(name):
+    return 'k' + ''.join(part.capitalize() for part in re.split(r'[^A-Za-z0-9]+', name) if part)
+
+
+def cpp_string_lines(content):
+    # Um literal por linha do template: o header gerado continua legível e com diffs pequenos
+    lines = []
+    for line in content.splitlines(keepends=True):
+        escaped = (line.replace('\\', '\\\\')
+                       .replace('"', '\\"')
+                       .replace('\t', '\\t')
+                       .replace('\r', '\\r')
+                       .replace('\n', '\\n'))
+        # Evita trígrafos e sequências ?? ambíguas em compiladores antigos
+        escaped = escaped.replace('??', '?\\?')
+        lines.append(f'        "{escaped}"')
+    return '\n'.join(lines) if lines else '        ""'
+
+
+try:
+    names = sorted(f for f in os.listdir(templates_dir) if f.endswith('.html'))
+except FileNotFoundError:
+    print(f'Error: Templates directory not found: {templates_dir}')
+    sys.exit(1)
+
+if os.path.splitext(default_template)[0] + '.html' not in names:
+    print(f'Error: Default template {default_template}.html not found in {templates_dir}')
+    sys.exit(1)
+
+blocks = []
+entries = []
+for file_name in names:
+    name = os.path.splitext(file_name)[0]
+    with open(os.path.join(templates_dir, file_name), 'r', encoding='utf-8', newline='') as file:
+        content = file.read()
+    data = content.encode('utf-8')
+    identifier = cpp_identifier(name)
+
+    # Offsets em bytes do UTF-8, que é o que o compilador grava no literal
+    placeholders = []
+    for match in placeholder_pattern.finditer(content):
+        offset = len(content[:match.start()].encode('utf-8'))
+        placeholders.append((offset, match.group(0)))
+
+    placeholder_lines = '\n'.join(f'        {{{offset}, "{tag}"}},' for offset, tag in placeholders)
+    blocks.append(
+        f'    inline constexpr char {identifier}Content[] =\n{cpp_string_lines(content)};\n'
+        f'    static_assert(sizeof({identifier}Content) - 1 == {len(data)}, "{file_name}: unexpected size");\n\n'
+        f'    inline constexpr Placeholder {identifier}Placeholders[] = {{\n{placeholder_lines}\n    }};\n'
+        f'    static_assert(placeholdersMatch({identifier}Content, {identifier}Placeholders), "{file_name}: stale placeholder table");\n'
+    )
+    entries.append(
+        f'        {{"{name}", std::string_view({identifier}Content, sizeof({identifier}Content) - 1), '
+        f'{identifier}Placeholders, {len(placeholders)}}},'
+    )
+    print(f'  {file_name}: {len(data)} bytes, {len(placeholders)} placeholders')
+
+header_content = f'''#pragma once
+
+// Gerado por utils/generate_embedded_templates.py a partir de templates/*.html; não editar.
+
+#include <cstddef>
+#include <string_view>
+
+namespace tsimg::embedded {{
+
+    struct Placeholder {{
+        size_t offset;        // posição em bytes no conteúdo do template
+        std::string_view tag; // inclui os sinais < e >
+    }};
+
+    struct Template {{
+        std::string_view name;
+        std::string_view content;
+        const Placeholder* placeholders;
+        size_t placeholderCount;
+    }};
+
+    // Confere em tempo de compilação que cada offset aponta para a sua tag
+    template <size_t ContentSize, size_t Count>
+    constexpr bool placeholdersMatch(const char (&content)[ContentSize], const Placeholder (&placeholders)[Count]) {{
+        std::string_view text(content, ContentSize - 1);
+        for (size_t i = 0; i < Count; ++i) {{
+            if (text.substr(placeholders[i].offset, placeholders[i].tag.size()) != placeholders[i].tag) {{
+                return false;
+            }}
+        }}
+        return true;
+    }}
+
+{chr(10).join(blocks)}
+    inline constexpr Template kTemplates[] = {{
+{chr(10).join(entries)}
+    }};
+
+    inline constexpr std::string_view kDefaultTemplate = "{default_template}";
+}}
+'''
+
+try:
+    with open(header_file_path, 'w', encoding='utf-8', newline='\n') as file:
+        file.write(header_content)
+        print('Embedded templates header generated successfully')
+except Exception as e:
+    print(f'Error: {e}')
+    print('Failed to generate embedded templates header')
+    sys.exit(1)